@@ -26,14 +26,27 @@
 #endif
 
 DlLibrary DlOpenLibrary(const char* filename) {
+  return DlOpenLibraryWithMode(filename, kDlOpenNow);
+}
+
+DlLibrary DlOpenLibraryWithMode(const char* filename, enum DlOpenMode mode) {
 #ifdef _WIN32
+  if (mode == kDlOpenNoLoad) {
+    return GetModuleHandle(filename);
+  }
   return LoadLibrary(filename);
 #else
+  int flags = RTLD_NOW;
+  if (mode == kDlOpenLazy) {
+    flags = RTLD_LAZY;
+  } else if (mode == kDlOpenNoLoad) {
+    flags = RTLD_NOW | RTLD_NOLOAD;
+  }
   // Load with RTLD_NODELETE in order to ensure that libart.so is not unmapped when it is closed.
   // This is due to the fact that it is possible that some threads might have yet to finish
   // exiting even after JNI_DeleteJavaVM returns, which can lead to segfaults if the library is
   // unloaded.
-  return dlopen(filename, RTLD_NOW | RTLD_NODELETE);
+  return dlopen(filename, flags | RTLD_NODELETE);
 #endif
 }
 
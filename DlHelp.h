@@ -24,7 +24,18 @@ __BEGIN_DECLS
 typedef void* DlLibrary;
 typedef void* DlSymbol;
 
+// How DlOpenLibraryWithMode binds and loads a library.
+enum DlOpenMode {
+  // Resolve all symbols when the library is loaded. This is what DlOpenLibrary uses.
+  kDlOpenNow,
+  // Resolve function symbols on first use.
+  kDlOpenLazy,
+  // Only return a handle if the library is already loaded.
+  kDlOpenNoLoad,
+};
+
 DlLibrary DlOpenLibrary(const char* filename);
+DlLibrary DlOpenLibraryWithMode(const char* filename, enum DlOpenMode mode);
 bool DlCloseLibrary(DlLibrary library);
 DlSymbol DlGetSymbol(DlLibrary library, const char* symbol);
 const char* DlGetError();
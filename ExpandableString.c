@@ -16,27 +16,116 @@
 
 #include "ExpandableString.h"
 
+#include "include_platform/nativehelper/JniArena.h"
+
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Smallest heap allocation made for string data.
+static const size_t kMinimumCapacity = 64;
+
+static bool IsHeapAllocated(const struct ExpandableString* s) {
+    return s->data != NULL && s->data != s->buffer && !s->dataInArena;
+}
+
 void ExpandableStringInitialize(struct ExpandableString *s) {
     memset(s, 0, sizeof(*s));
 }
 
-void ExpandableStringRelease(struct ExpandableString* s) {
-    free(s->data);
+void ExpandableStringInitializeWithBuffer(struct ExpandableString* s,
+                                          char* buffer,
+                                          size_t bufferSize) {
     memset(s, 0, sizeof(*s));
+    s->buffer = buffer;
+    s->bufferSize = bufferSize;
+}
+
+void ExpandableStringInitializeWithArena(struct ExpandableString* s) {
+    memset(s, 0, sizeof(*s));
+    s->useArena = true;
+}
+
+void ExpandableStringRelease(struct ExpandableString* s) {
+    if (IsHeapAllocated(s)) {
+        free(s->data);
+    }
+    s->dataSize = 0;
+    s->capacity = 0;
+    s->data = NULL;
+    s->dataInArena = false;
+}
+
+bool ExpandableStringReserve(struct ExpandableString* s, size_t length) {
+    size_t requiredSize = length + 1;
+    if (requiredSize <= s->capacity) {
+        return true;
+    }
+
+    if (s->data == NULL && requiredSize <= s->bufferSize) {
+        // Use the caller supplied storage until it is exhausted.
+        s->data = s->buffer;
+        s->capacity = s->bufferSize;
+        s->data[0] = '\0';
+        return true;
+    }
+
+    size_t newCapacity = (s->capacity < kMinimumCapacity) ? kMinimumCapacity : s->capacity;
+    while (newCapacity < requiredSize) {
+        if (newCapacity > SIZE_MAX / 2) {
+            newCapacity = requiredSize;
+            break;
+        }
+        newCapacity *= 2;
+    }
+
+    char* data;
+    if (s->useArena && !IsHeapAllocated(s)) {
+        // Arena storage grows in place when nothing else was allocated from the arena since.
+        data = (char*) jniArenaReallocate(s->dataInArena ? s->data : NULL,
+                                          s->dataInArena ? s->capacity : 0, newCapacity);
+        if (data != NULL) {
+            if (!s->dataInArena) {
+                if (s->data != NULL) {
+                    memcpy(data, s->data, s->dataSize + 1);
+                } else {
+                    data[0] = '\0';
+                }
+            }
+            s->data = data;
+            s->capacity = newCapacity;
+            s->dataInArena = true;
+            return true;
+        }
+    }
+    if (IsHeapAllocated(s)) {
+        data = (char*) realloc(s->data, newCapacity);
+        if (data == NULL) {
+            return false;
+        }
+    } else {
+        data = (char*) malloc(newCapacity);
+        if (data == NULL) {
+            return false;
+        }
+        if (s->data != NULL) {
+            memcpy(data, s->data, s->dataSize + 1);
+        } else {
+            data[0] = '\0';
+        }
+    }
+    s->data = data;
+    s->capacity = newCapacity;
+    s->dataInArena = false;
+    return true;
 }
 
 bool ExpandableStringAppend(struct ExpandableString* s, const char* text) {
     size_t textSize = strlen(text);
-    size_t requiredSize = s->dataSize + textSize + 1;
-    char* data = (char*) realloc(s->data, requiredSize);
-    if (data == NULL) {
+    if (!ExpandableStringReserve(s, s->dataSize + textSize)) {
         return false;
     }
-    s->data = data;
     memcpy(s->data + s->dataSize, text, textSize + 1);
     s->dataSize += textSize;
     return true;
@@ -45,4 +134,4 @@ bool ExpandableStringAppend(struct ExpandableString* s, const char* text) {
 bool ExpandableStringAssign(struct ExpandableString* s, const char* text) {
     ExpandableStringRelease(s);
     return ExpandableStringAppend(s, text);
-}
\ No newline at end of file
+}
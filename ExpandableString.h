@@ -25,16 +25,37 @@ __BEGIN_DECLS
 
 struct ExpandableString {
     size_t dataSize;  // The length of the C string data (not including the null-terminator).
+    size_t capacity;  // The size of the storage at |data| (including the null-terminator).
     char* data;       // The C string data.
+    char* buffer;     // Optional caller supplied storage used before any heap allocation.
+    size_t bufferSize;  // The size of |buffer|.
+    bool useArena;    // Whether to grow into the thread's JniArena before the heap.
+    bool dataInArena;  // Whether |data| is in the thread's JniArena.
 };
 
 // Initialize ExpandableString.
 void ExpandableStringInitialize(struct ExpandableString* s);
 
-// Release memory associated with ExpandableString.
+// Initialize ExpandableString with caller supplied storage |buffer| of |bufferSize| bytes. Strings
+// that fit in |buffer| are built without any heap allocation. |buffer| must outlive |s|.
+void ExpandableStringInitializeWithBuffer(struct ExpandableString* s,
+                                          char* buffer,
+                                          size_t bufferSize);
+
+// Initialize ExpandableString to grow into the calling thread's JniArena, falling back to the
+// heap when the arena is exhausted. Must be used and released within a single arena scope.
+void ExpandableStringInitializeWithArena(struct ExpandableString* s);
+
+// Release memory associated with ExpandableString. Any caller supplied storage remains associated
+// with |s| and is used again by subsequent appends.
 void ExpandableStringRelease(struct ExpandableString* s);
 
+// Ensure ExpandableString can hold a C string of |length| characters without further allocation.
+// Returns true on success, false othewise.
+bool ExpandableStringReserve(struct ExpandableString* s, size_t length);
+
 // Append null-terminated string |text| to ExpandableString, expanding the storage if required.
+// Storage grows geometrically so a sequence of appends has amortized linear cost.
 // Returns true on success, false othewise.
 bool ExpandableStringAppend(struct ExpandableString* s, const char* text);
 
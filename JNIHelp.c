@@ -16,11 +16,15 @@
 
 #include "include/nativehelper/JNIHelp.h"
 
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <jni.h>
 
@@ -28,6 +32,33 @@
 #include "ALog-priv.h"
 
 #include "ExpandableString.h"
+#include "JNIHelp-priv.h"
+#include "JniProfiling-priv.h"
+#include "include_platform/nativehelper/JniArena.h"
+#include "include_platform/nativehelper/JniExceptionCache.h"
+
+// Size of on-stack storage for exception summaries. Large enough for the common
+// "<exception_class_name>: <exception_message>" case to avoid heap allocation.
+#define EXCEPTION_SUMMARY_BUFFER_SIZE 256
+
+// Size of on-stack storage for formatted exception messages. Longer messages are formatted into
+// heap storage.
+#define EXCEPTION_MESSAGE_BUFFER_SIZE 512
+
+// Number of slots remembering recently logged exceptions for jniLogExceptionDeduplicated.
+// Exceptions whose fingerprints map to the same slot evict each other.
+#define EXCEPTION_LOG_SLOTS 64
+
+// Number of stack frames, from the top, that distinguish otherwise identical exceptions.
+#define EXCEPTION_FINGERPRINT_FRAMES 3
+
+// Number of errno values whose IOException messages are cached by jniThrowIOException. Messages
+// for larger values are created on every throw.
+#define ERRNO_MESSAGE_CACHE_SIZE 256
+
+// Size in code units of on-stack storage for jniCreateStringUtf8. Longer strings are transcoded
+// into heap storage.
+#define UTF16_STACK_BUFFER_SIZE 256
 
 //
 // Helper methods
@@ -50,16 +81,366 @@ static const char* platformStrError(int errnum, char* buf, size_t buflen) {
 #endif
 }
 
-static jmethodID FindMethod(JNIEnv* env,
-                            const char* className,
-                            const char* methodName,
-                            const char* descriptor) {
-    // This method is only valid for classes in the core library which are
-    // not unloaded during the lifetime of managed code execution.
-    jclass clazz = (*env)->FindClass(env, className);
-    jmethodID methodId = (*env)->GetMethodID(env, clazz, methodName, descriptor);
-    (*env)->DeleteLocalRef(env, clazz);
-    return methodId;
+//
+// Cache of classes and methods used for exception reporting.
+//
+// These are all in the core library, which is not unloaded during the lifetime of managed code
+// execution, so they are resolved once rather than looked up by name on every report.
+//
+
+// jclass list:
+//   <class, signature>
+#define JCLASS_LIST(V)                                                      \
+  V(Class, "java/lang/Class")                                               \
+  V(PrintWriter, "java/io/PrintWriter")                                     \
+  V(StackTraceElement, "java/lang/StackTraceElement")                       \
+  V(StringWriter, "java/io/StringWriter")                                   \
+  V(Throwable, "java/lang/Throwable")
+
+// jmethodID list:
+//   <class, method, method-string, signature>
+#define JMETHODID_LIST(V)                                                   \
+  V(Class, getName, "getName", "()Ljava/lang/String;")                      \
+  V(PrintWriter, init, "<init>", "(Ljava/io/Writer;)V")                     \
+  V(StackTraceElement, hashCode, "hashCode", "()I")                         \
+  V(StringWriter, init, "<init>", "()V")                                    \
+  V(StringWriter, toString, "toString", "()Ljava/lang/String;")             \
+  V(Throwable, getMessage, "getMessage", "()Ljava/lang/String;")            \
+  V(Throwable, getStackTrace, "getStackTrace", "()[Ljava/lang/StackTraceElement;") \
+  V(Throwable, printStackTrace, "printStackTrace", "(Ljava/io/PrintWriter;)V")
+
+#define CLASS_NAME(cls)             g_ ## cls
+#define METHOD_NAME(cls, method)    g_ ## cls ## _ ## method
+
+#define JCLASS_DECLARE_STORAGE(cls, ...)                                    \
+  static jclass CLASS_NAME(cls) = NULL;
+JCLASS_LIST(JCLASS_DECLARE_STORAGE)
+#undef JCLASS_DECLARE_STORAGE
+
+#define JMETHODID_DECLARE_STORAGE(cls, method, ...)                         \
+  static jmethodID METHOD_NAME(cls, method) = NULL;
+JMETHODID_LIST(JMETHODID_DECLARE_STORAGE)
+#undef JMETHODID_DECLARE_STORAGE
+
+static atomic_bool g_cache_initialized = false;
+static pthread_mutex_t g_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ClearCache(JNIEnv* env) {
+#define JCLASS_INVALIDATE(cls, ...)                                         \
+    if (env != NULL && CLASS_NAME(cls) != NULL) {                           \
+        (*env)->DeleteGlobalRef(env, CLASS_NAME(cls));                      \
+    }                                                                       \
+    CLASS_NAME(cls) = NULL;
+    JCLASS_LIST(JCLASS_INVALIDATE)
+#undef JCLASS_INVALIDATE
+
+#define JMETHODID_INVALIDATE(cls, method, ...) METHOD_NAME(cls, method) = NULL;
+    JMETHODID_LIST(JMETHODID_INVALIDATE)
+#undef JMETHODID_INVALIDATE
+}
+
+static jclass FindClassGlobal(JNIEnv* env, const char* signature) {
+    jclass cls = (*env)->FindClass(env, signature);
+    if (cls == NULL) {
+        return NULL;
+    }
+    jclass global = (jclass) (*env)->NewGlobalRef(env, cls);
+    (*env)->DeleteLocalRef(env, cls);
+    return global;
+}
+
+static bool InitializeCache(JNIEnv* env) {
+#define JCLASS_INITIALIZE(cls, signature)                                   \
+    CLASS_NAME(cls) = FindClassGlobal(env, signature);                      \
+    if (CLASS_NAME(cls) == NULL) {                                          \
+        ALOGE("Unable to find class %s", signature);                        \
+        return false;                                                       \
+    }
+    JCLASS_LIST(JCLASS_INITIALIZE)
+#undef JCLASS_INITIALIZE
+
+#define JMETHODID_INITIALIZE(cls, method, name, signature)                  \
+    METHOD_NAME(cls, method) =                                              \
+        (*env)->GetMethodID(env, CLASS_NAME(cls), name, signature);         \
+    if (METHOD_NAME(cls, method) == NULL) {                                 \
+        ALOGE("Unable to find method %s%s", name, signature);               \
+        return false;                                                       \
+    }
+    JMETHODID_LIST(JMETHODID_INITIALIZE)
+#undef JMETHODID_INITIALIZE
+
+    return true;
+}
+
+// Returns true if the cache is initialized. On failure, an exception may be pending and
+// initialization is retried on the next call.
+static bool EnsureCacheInitialized(JNIEnv* env) {
+    if (__builtin_expect(atomic_load_explicit(&g_cache_initialized, memory_order_acquire), 1)) {
+        return true;
+    }
+
+    pthread_mutex_lock(&g_cache_lock);
+    bool initialized = atomic_load_explicit(&g_cache_initialized, memory_order_relaxed);
+    if (!initialized) {
+        initialized = InitializeCache(env);
+        if (initialized) {
+            atomic_store_explicit(&g_cache_initialized, true, memory_order_release);
+        } else {
+            ClearCache(env);
+        }
+    }
+    pthread_mutex_unlock(&g_cache_lock);
+    return initialized;
+}
+
+//
+// Cache of exception classes and their constructors used by the jniThrow* methods.
+//
+// The commonly thrown classes are present from the start and resolved on first use. Further
+// classes can be added with jniRegisterExceptionClass(). Entries are only ever appended, under
+// g_cache_lock, and published by incrementing g_exception_class_count.
+//
+
+// Well-known exception class list:
+//   <class, signature, constructor-signature>
+#define EXCEPTION_CLASS_LIST(V)                                                           \
+  V(ErrnoException, "android/system/ErrnoException", "(Ljava/lang/String;I)V")            \
+  V(IOException, "java/io/IOException", "(Ljava/lang/String;)V")                          \
+  V(NullPointerException, "java/lang/NullPointerException", "(Ljava/lang/String;)V")      \
+  V(RuntimeException, "java/lang/RuntimeException", "(Ljava/lang/String;)V")
+
+// Maximum number of exception classes in the cache, including the well-known classes.
+#define MAX_EXCEPTION_CLASSES 64
+
+struct ExceptionClass {
+    const char* className;
+    size_t classNameLength;
+    const char* ctorSig;
+    jclass clazz;
+    jmethodID init;
+    atomic_bool resolved;
+    // Set when resolution fails, so that later throws go straight to the uncached path. Cleared
+    // with the rest of the entry by ClearExceptionClasses().
+    atomic_bool failed;
+};
+
+#define EXCEPTION_CLASS_ENTRY(cls, signature, ctorSig) \
+    { signature, sizeof(signature) - 1, ctorSig, NULL, NULL, false, false },
+static struct ExceptionClass g_exception_classes[MAX_EXCEPTION_CLASSES] = {
+    EXCEPTION_CLASS_LIST(EXCEPTION_CLASS_ENTRY)
+};
+#undef EXCEPTION_CLASS_ENTRY
+
+#define EXCEPTION_CLASS_COUNT(...) + 1
+static atomic_size_t g_exception_class_count = 0 EXCEPTION_CLASS_LIST(EXCEPTION_CLASS_COUNT);
+#undef EXCEPTION_CLASS_COUNT
+
+// Resolves the class and constructor of |entry|. Must be called with g_cache_lock held.
+static bool ResolveExceptionClassLocked(JNIEnv* env, struct ExceptionClass* entry) {
+    if (atomic_load_explicit(&entry->resolved, memory_order_relaxed)) {
+        return true;
+    }
+    jclass clazz = FindClassGlobal(env, entry->className);
+    if (clazz == NULL) {
+        atomic_store_explicit(&entry->failed, true, memory_order_relaxed);
+        return false;
+    }
+    jmethodID init = (*env)->GetMethodID(env, clazz, "<init>", entry->ctorSig);
+    if (init == NULL) {
+        (*env)->DeleteGlobalRef(env, clazz);
+        atomic_store_explicit(&entry->failed, true, memory_order_relaxed);
+        return false;
+    }
+    entry->clazz = clazz;
+    entry->init = init;
+    atomic_store_explicit(&entry->failed, false, memory_order_relaxed);
+    atomic_store_explicit(&entry->resolved, true, memory_order_release);
+    return true;
+}
+
+static bool ExceptionCtorSigMatches(const struct ExceptionClass* entry, const char* ctorSig) {
+    return entry->ctorSig == ctorSig || strcmp(entry->ctorSig, ctorSig) == 0;
+}
+
+static struct ExceptionClass* FindExceptionClassEntry(const char* className, const char* ctorSig) {
+    size_t count = atomic_load_explicit(&g_exception_class_count, memory_order_acquire);
+    // Callers in this library pass the same literals as the table, so try the pointers first.
+    for (size_t i = 0; i < count; ++i) {
+        struct ExceptionClass* entry = &g_exception_classes[i];
+        if (entry->className == className && ExceptionCtorSigMatches(entry, ctorSig)) {
+            return entry;
+        }
+    }
+    // Names from other binaries are compared by content, and only when the lengths match.
+    size_t classNameLength = strlen(className);
+    for (size_t i = 0; i < count; ++i) {
+        struct ExceptionClass* entry = &g_exception_classes[i];
+        if (entry->classNameLength == classNameLength &&
+            memcmp(entry->className, className, classNameLength) == 0 &&
+            ExceptionCtorSigMatches(entry, ctorSig)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Returns the cached exception class entry for |className| with constructor |ctorSig|, or NULL if
+// the class is not in the cache or cannot be resolved. If NULL is returned, no exception is
+// pending.
+static const struct ExceptionClass* GetCachedExceptionClass(JNIEnv* env,
+                                                            const char* className,
+                                                            const char* ctorSig) {
+    struct ExceptionClass* entry = FindExceptionClassEntry(className, ctorSig);
+    if (entry == NULL) {
+        return NULL;
+    }
+    if (__builtin_expect(atomic_load_explicit(&entry->resolved, memory_order_acquire), 1)) {
+        return entry;
+    }
+    if (atomic_load_explicit(&entry->failed, memory_order_relaxed)) {
+        // Resolution already failed; the uncached path reports the failure.
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_cache_lock);
+    bool resolved = ResolveExceptionClassLocked(env, entry);
+    pthread_mutex_unlock(&g_cache_lock);
+    if (!resolved) {
+        // Let the uncached path retry and report the failure.
+        (*env)->ExceptionClear(env);
+        return NULL;
+    }
+    return entry;
+}
+
+static void ClearExceptionClasses() {
+    size_t count = atomic_load_explicit(&g_exception_class_count, memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        struct ExceptionClass* entry = &g_exception_classes[i];
+        atomic_store_explicit(&entry->resolved, false, memory_order_relaxed);
+        atomic_store_explicit(&entry->failed, false, memory_order_relaxed);
+        entry->clazz = NULL;
+        entry->init = NULL;
+    }
+}
+
+//
+// Cache of the messages of the IOExceptions thrown by jniThrowIOException.
+//
+// The message for an errno value never changes, so it is created once, as a global reference, by
+// the first throw and shared by every later one. Slots are filled with a compare-and-swap.
+//
+
+static _Atomic(jstring) g_errno_messages[ERRNO_MESSAGE_CACHE_SIZE];
+
+// Returns the message for |errno_value|, creating it if need be, or NULL if it cannot be cached.
+// Must be called without an exception pending. If NULL is returned, no exception is pending.
+static jstring GetCachedErrnoMessage(JNIEnv* env, int errno_value) {
+    if (errno_value < 0 || errno_value >= ERRNO_MESSAGE_CACHE_SIZE) {
+        return NULL;
+    }
+    _Atomic(jstring)* slot = &g_errno_messages[errno_value];
+    jstring message = atomic_load_explicit(slot, memory_order_acquire);
+    if (__builtin_expect(message != NULL, 1)) {
+        return message;
+    }
+
+    char buffer[80];
+    jstring local = (*env)->NewStringUTF(env, platformStrError(errno_value, buffer,
+                                                               sizeof(buffer)));
+    jstring global = NULL;
+    if (local != NULL) {
+        global = (jstring) (*env)->NewGlobalRef(env, local);
+        (*env)->DeleteLocalRef(env, local);
+    }
+    if (global == NULL) {
+        (*env)->ExceptionClear(env);
+        return NULL;
+    }
+    jstring expected = NULL;
+    if (!atomic_compare_exchange_strong_explicit(slot, &expected, global, memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        // Another thread cached the message first.
+        (*env)->DeleteGlobalRef(env, global);
+        return expected;
+    }
+    return global;
+}
+
+static void ClearErrnoMessages() {
+    for (size_t i = 0; i < ERRNO_MESSAGE_CACHE_SIZE; ++i) {
+        atomic_store_explicit(&g_errno_messages[i], NULL, memory_order_relaxed);
+    }
+}
+
+void JniHelp_UninitializeCache() {
+    // NB we assume the runtime is stopped at this point and do not delete global references.
+    pthread_mutex_lock(&g_cache_lock);
+    ClearCache(NULL);
+    ClearExceptionClasses();
+    ClearErrnoMessages();
+    atomic_store_explicit(&g_cache_initialized, false, memory_order_release);
+    pthread_mutex_unlock(&g_cache_lock);
+}
+
+// Terminates the UTF-8 string |s| at |length| bytes, dropping any multi-byte sequence that would
+// be left incomplete.
+static void TruncateUtf8(char* s, size_t length) {
+    size_t start = length;
+    while (start > 0 && (s[start - 1] & 0xc0) == 0x80) {
+        --start;
+    }
+    if (start > 0) {
+        unsigned char lead = (unsigned char) s[start - 1];
+        size_t sequenceLength = (lead < 0xc0) ? 1 : (lead < 0xe0) ? 2 : (lead < 0xf0) ? 3 : 4;
+        if (start - 1 + sequenceLength > length) {
+            length = start - 1;
+        }
+    }
+    s[length] = '\0';
+}
+
+// Formats a message of at most |maxLength| bytes into |stackBuffer|, or into heap storage
+// returned in |heapBuffer| if the message does not fit. The caller must free |heapBuffer|.
+static const char* FormatExceptionMsgV(char* stackBuffer, size_t stackBufferSize,
+                                       char** heapBuffer, size_t maxLength,
+                                       const char* fmt, va_list args) {
+    char* msg = stackBuffer;
+    *heapBuffer = NULL;
+
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int formattedLength = vsnprintf(stackBuffer, stackBufferSize, fmt, argsCopy);
+    va_end(argsCopy);
+    if (formattedLength < 0) {
+        stackBuffer[0] = '\0';
+        formattedLength = 0;
+    }
+
+    size_t length = (size_t) formattedLength;
+    if (length >= stackBufferSize && maxLength >= stackBufferSize) {
+        size_t heapSize = ((length < maxLength) ? length : maxLength) + 1;
+        char* buffer = (char*) jniArenaAllocate(heapSize);
+        if (buffer == NULL) {
+            buffer = *heapBuffer = (char*) malloc(heapSize);
+        }
+        if (buffer != NULL) {
+            vsnprintf(buffer, heapSize, fmt, args);
+            msg = buffer;
+            length = heapSize - 1;
+        } else {
+            length = stackBufferSize - 1;
+        }
+    } else if (length >= stackBufferSize) {
+        length = stackBufferSize - 1;
+    }
+    if (length > maxLength) {
+        length = maxLength;
+    }
+    if (length < (size_t) formattedLength) {
+        TruncateUtf8(msg, length);
+    }
+    return msg;
 }
 
 static bool AppendJString(JNIEnv* env, jstring text, struct ExpandableString* dst) {
@@ -79,9 +460,15 @@ static bool AppendJString(JNIEnv* env, jstring text, struct ExpandableString* ds
  */
 static bool GetExceptionSummary(JNIEnv* env, jthrowable thrown, struct ExpandableString* dst) {
     // Summary is <exception_class_name> ": " <exception_message>
+    if (!EnsureCacheInitialized(env)) {
+        ExpandableStringAssign(dst, "<error getting class name>");
+        (*env)->ExceptionClear(env);
+        return false;
+    }
+
     jclass exceptionClass = (*env)->GetObjectClass(env, thrown);  // Always succeeds
-    jmethodID getName = FindMethod(env, "java/lang/Class", "getName", "()Ljava/lang/String;");
-    jstring className = (jstring) (*env)->CallObjectMethod(env, exceptionClass, getName);
+    jstring className =
+        (jstring) (*env)->CallObjectMethod(env, exceptionClass, METHOD_NAME(Class, getName));
     if (className == NULL) {
         ExpandableStringAssign(dst, "<error getting class name>");
         (*env)->ExceptionClear(env);
@@ -100,9 +487,8 @@ static bool GetExceptionSummary(JNIEnv* env, jthrowable thrown, struct Expandabl
     (*env)->DeleteLocalRef(env, className);
     className = NULL;
 
-    jmethodID getMessage =
-        FindMethod(env, "java/lang/Throwable", "getMessage", "()Ljava/lang/String;");
-    jstring message = (jstring) (*env)->CallObjectMethod(env, thrown, getMessage);
+    jstring message =
+        (jstring) (*env)->CallObjectMethod(env, thrown, METHOD_NAME(Throwable, getMessage));
     if (message == NULL) {
         return true;
     }
@@ -126,25 +512,17 @@ static bool GetExceptionSummary(JNIEnv* env, jthrowable thrown, struct Expandabl
 }
 
 static jobject NewStringWriter(JNIEnv* env) {
-    jclass clazz = (*env)->FindClass(env, "java/io/StringWriter");
-    jmethodID init = (*env)->GetMethodID(env, clazz, "<init>", "()V");
-    jobject instance = (*env)->NewObject(env, clazz, init);
-    (*env)->DeleteLocalRef(env, clazz);
-    return instance;
+    return (*env)->NewObject(env, CLASS_NAME(StringWriter), METHOD_NAME(StringWriter, init));
 }
 
 static jstring StringWriterToString(JNIEnv* env, jobject stringWriter) {
-    jmethodID toString =
-        FindMethod(env, "java/io/StringWriter", "toString", "()Ljava/lang/String;");
-    return (jstring) (*env)->CallObjectMethod(env, stringWriter, toString);
+    return (jstring) (*env)->CallObjectMethod(env, stringWriter,
+                                              METHOD_NAME(StringWriter, toString));
 }
 
 static jobject NewPrintWriter(JNIEnv* env, jobject writer) {
-    jclass clazz = (*env)->FindClass(env, "java/io/PrintWriter");
-    jmethodID init = (*env)->GetMethodID(env, clazz, "<init>", "(Ljava/io/Writer;)V");
-    jobject instance = (*env)->NewObject(env, clazz, init, writer);
-    (*env)->DeleteLocalRef(env, clazz);
-    return instance;
+    return (*env)->NewObject(env, CLASS_NAME(PrintWriter), METHOD_NAME(PrintWriter, init),
+                             writer);
 }
 
 static bool GetStackTrace(JNIEnv* env, jthrowable thrown, struct ExpandableString* dst) {
@@ -154,6 +532,10 @@ static bool GetStackTrace(JNIEnv* env, jthrowable thrown, struct ExpandableStrin
     //   thrown.printStackTrace(pw);
     //   String trace = sw.toString();
     //   return trace;
+    if (!EnsureCacheInitialized(env)) {
+        return false;
+    }
+
     jobject sw = NewStringWriter(env);
     if (sw == NULL) {
         return false;
@@ -165,9 +547,7 @@ static bool GetStackTrace(JNIEnv* env, jthrowable thrown, struct ExpandableStrin
         return false;
     }
 
-    jmethodID printStackTrace =
-        FindMethod(env, "java/lang/Throwable", "printStackTrace", "(Ljava/io/PrintWriter;)V");
-    (*env)->CallVoidMethod(env, thrown, printStackTrace, pw);
+    (*env)->CallVoidMethod(env, thrown, METHOD_NAME(Throwable, printStackTrace), pw);
 
     jstring trace = StringWriterToString(env, sw);
 
@@ -225,8 +605,9 @@ static void DiscardPendingException(JNIEnv* env, const char* className) {
         return;
     }
 
+    char summaryBuffer[EXCEPTION_SUMMARY_BUFFER_SIZE];
     struct ExpandableString summary;
-    ExpandableStringInitialize(&summary);
+    ExpandableStringInitializeWithBuffer(&summary, summaryBuffer, sizeof(summaryBuffer));
     GetExceptionSummary(env, exception, &summary);
     const char* details = (summary.data != NULL) ? summary.data : "Unknown";
     ALOGW("Discarding pending exception (%s) to throw %s", details, className);
@@ -234,15 +615,26 @@ static void DiscardPendingException(JNIEnv* env, const char* className) {
     (*env)->DeleteLocalRef(env, exception);
 }
 
-static int ThrowException(JNIEnv* env, const char* className, const char* ctorSig, ...) {
+static int ThrowExceptionV(JNIEnv* env, const char* className, const char* ctorSig,
+                           va_list args) {
     int status = -1;
     jclass exceptionClass = NULL;
 
-    va_list args;
-    va_start(args, ctorSig);
-
     DiscardPendingException(env, className);
 
+    const struct ExceptionClass* cached = GetCachedExceptionClass(env, className, ctorSig);
+    if (cached != NULL) {
+        jobject instance = (*env)->NewObjectV(env, cached->clazz, cached->init, args);
+        if (instance == NULL) {
+            ALOGE("Failed to construct '%s'", className);
+        } else if ((*env)->Throw(env, (jthrowable)instance) != JNI_OK) {
+            ALOGE("Failed to throw '%s'", className);
+        } else {
+            status = 0;
+        }
+        goto end;
+    }
+
     {
         /* We want to clean up local references before returning from this function, so,
          * regardless of return status, the end block must run. Have the work done in a
@@ -277,13 +669,20 @@ static int ThrowException(JNIEnv* env, const char* className, const char* ctorSi
     }
 
 end:
-    va_end(args);
     if (exceptionClass != NULL) {
         (*env)->DeleteLocalRef(env, exceptionClass);
     }
     return status;
 }
 
+static int ThrowException(JNIEnv* env, const char* className, const char* ctorSig, ...) {
+    va_list args;
+    va_start(args, ctorSig);
+    int status = ThrowExceptionV(env, className, ctorSig, args);
+    va_end(args);
+    return status;
+}
+
 static jstring CreateExceptionMsg(JNIEnv* env, const char* msg) {
     jstring detailMessage = (*env)->NewStringUTF(env, msg);
     if (detailMessage == NULL) {
@@ -316,16 +715,55 @@ static jstring CreateExceptionMsg(JNIEnv* env, const char* msg) {
 // JNIHelp external API
 //
 
-int jniRegisterNativeMethods(JNIEnv* env, const char* className,
-    const JNINativeMethod* methods, int numMethods)
-{
-    ALOGV("Registering %s's %d native methods...", className, numMethods);
-    jclass clazz = (*env)->FindClass(env, className);
-    ALOG_ALWAYS_FATAL_IF(clazz == NULL,
-                         "Native registration unable to find class '%s'; aborting...",
-                         className);
+int jniRegisterExceptionClass(JNIEnv* env, const char* className) {
+    static const char* kCtorSig = "(Ljava/lang/String;)V";
+    int status = -1;
+    pthread_mutex_lock(&g_cache_lock);
+    struct ExceptionClass* entry = FindExceptionClassEntry(className, kCtorSig);
+    if (entry == NULL) {
+        size_t count = atomic_load_explicit(&g_exception_class_count, memory_order_relaxed);
+        if (count == MAX_EXCEPTION_CLASSES) {
+            ALOGE("Unable to register exception class %s, cache is full", className);
+            goto end;
+        }
+        size_t nameSize = strlen(className) + 1;
+        char* name = (char*) malloc(nameSize);
+        if (name == NULL) {
+            goto end;
+        }
+        memcpy(name, className, nameSize);
+        entry = &g_exception_classes[count];
+        entry->className = name;
+        entry->classNameLength = nameSize - 1;
+        entry->ctorSig = kCtorSig;
+        atomic_store_explicit(&g_exception_class_count, count + 1, memory_order_release);
+    }
+    if (!ResolveExceptionClassLocked(env, entry)) {
+        ALOGE("Unable to register exception class %s", className);
+        /* an exception, most likely ClassNotFoundException, will now be pending */
+        goto end;
+    }
+    status = 0;
+
+end:
+    pthread_mutex_unlock(&g_cache_lock);
+    return status;
+}
+
+int jniThrowExceptionWithCtorV(JNIEnv* env, const char* className, const char* ctorSig,
+                               va_list args) {
+    return ThrowExceptionV(env, className, ctorSig, args);
+}
+
+static int64_t NowNanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int RegisterNativesOrAbort(JNIEnv* env, jclass clazz, const char* className,
+                                  const JNINativeMethod* methods, int numMethods) {
     int result = (*env)->RegisterNatives(env, clazz, methods, numMethods);
-    (*env)->DeleteLocalRef(env, clazz);
     if (result == 0) {
         return 0;
     }
@@ -334,8 +772,9 @@ int jniRegisterNativeMethods(JNIEnv* env, const char* className,
     // otherwise abort with generic failure message.
     jthrowable thrown = (*env)->ExceptionOccurred(env);
     if (thrown != NULL) {
+        char summaryBuffer[EXCEPTION_SUMMARY_BUFFER_SIZE];
         struct ExpandableString summary;
-        ExpandableStringInitialize(&summary);
+        ExpandableStringInitializeWithBuffer(&summary, summaryBuffer, sizeof(summaryBuffer));
         if (GetExceptionSummary(env, thrown, &summary)) {
             ALOGF("%s", summary.data);
         }
@@ -346,23 +785,219 @@ int jniRegisterNativeMethods(JNIEnv* env, const char* className,
     return result;
 }
 
+int jniRegisterNativeMethods(JNIEnv* env, const char* className,
+    const JNINativeMethod* methods, int numMethods)
+{
+    JNI_PROFILE(jniRegisterNativeMethods);
+    ALOGV("Registering %s's %d native methods...", className, numMethods);
+    jclass clazz = (*env)->FindClass(env, className);
+    ALOG_ALWAYS_FATAL_IF(clazz == NULL,
+                         "Native registration unable to find class '%s'; aborting...",
+                         className);
+    int result = RegisterNativesOrAbort(env, clazz, className, methods, numMethods);
+    (*env)->DeleteLocalRef(env, clazz);
+    return result;
+}
+
+int jniRegisterNativeMethodsBatch(JNIEnv* env, JniNativeRegistration* entries, size_t count) {
+    JNI_PROFILE(jniRegisterNativeMethodsBatch);
+    ALOGV("Registering native methods for %zu classes...", count);
+    for (size_t i = 0; i < count; ++i) {
+        JniNativeRegistration* entry = &entries[i];
+        const char* className = entry->className != NULL ? entry->className : "<unnamed>";
+        int64_t start = NowNanos();
+        jclass clazz = entry->clazz;
+        if (clazz == NULL) {
+            clazz = (*env)->FindClass(env, entry->className);
+            ALOG_ALWAYS_FATAL_IF(clazz == NULL,
+                                 "Native registration unable to find class '%s'; aborting...",
+                                 className);
+        }
+        int64_t found = NowNanos();
+        int result = RegisterNativesOrAbort(env, clazz, className, entry->methods,
+                                            entry->numMethods);
+        if (clazz != entry->clazz) {
+            (*env)->DeleteLocalRef(env, clazz);
+        }
+        entry->findClassNs = found - start;
+        entry->registerNativesNs = NowNanos() - found;
+        if (result != 0) {
+            return result;
+        }
+    }
+    return 0;
+}
+
 void jniLogException(JNIEnv* env, int priority, const char* tag, jthrowable thrown) {
+    JNI_PROFILE(jniLogException);
+    size_t mark = jniArenaBegin();
     struct ExpandableString summary;
-    ExpandableStringInitialize(&summary);
+    ExpandableStringInitializeWithArena(&summary);
     GetStackTraceOrSummary(env, thrown, &summary);
     const char* details = (summary.data != NULL) ? summary.data : "No memory to report exception";
     __android_log_write(priority, tag, details);
     ExpandableStringRelease(&summary);
+    jniArenaEnd(mark);
+}
+
+//
+// Deduplicated exception logging.
+//
+
+// An exception logged by jniLogExceptionDeduplicated within the current window.
+struct ExceptionLogSlot {
+    uint64_t fingerprint;
+    int64_t windowStartNs;
+    // Number of times the exception was seen after being logged in this window.
+    uint64_t repeats;
+    char summary[EXCEPTION_SUMMARY_BUFFER_SIZE];
+};
+
+static pthread_mutex_t g_exception_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ExceptionLogSlot g_exception_log_slots[EXCEPTION_LOG_SLOTS];
+static atomic_int_fast64_t g_exception_log_window_ns = 10 * 1000000000LL;
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t length) {
+    // FNV-1a.
+    const unsigned char* bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Fingerprints |thrown| by its class, message and top stack frames, which takes a few cheap
+// up-calls rather than the printStackTrace rendering of a full trace. The class name and message
+// are also written to |summary|. Returns false, with an exception possibly pending, on failure.
+static bool GetExceptionFingerprint(JNIEnv* env, jthrowable thrown,
+                                    struct ExpandableString* summary, uint64_t* fingerprint) {
+    if (!GetExceptionSummary(env, thrown, summary)) {
+        return false;
+    }
+    uint64_t hash = HashBytes(14695981039346656037ULL, summary->data, summary->dataSize);
+
+    jobjectArray frames = (jobjectArray) (*env)->CallObjectMethod(
+            env, thrown, METHOD_NAME(Throwable, getStackTrace));
+    if ((*env)->ExceptionCheck(env)) {
+        return false;
+    }
+    if (frames != NULL) {
+        jsize count = (*env)->GetArrayLength(env, frames);
+        for (jsize i = 0; i < count && i < EXCEPTION_FINGERPRINT_FRAMES; ++i) {
+            jobject frame = (*env)->GetObjectArrayElement(env, frames, i);
+            jint frameHash = 0;
+            if (frame != NULL) {
+                frameHash = (*env)->CallIntMethod(env, frame,
+                                                  METHOD_NAME(StackTraceElement, hashCode));
+                (*env)->DeleteLocalRef(env, frame);
+            }
+            if ((*env)->ExceptionCheck(env)) {
+                break;
+            }
+            hash = HashBytes(hash, &frameHash, sizeof(frameHash));
+        }
+        (*env)->DeleteLocalRef(env, frames);
+    }
+    *fingerprint = hash;
+    return !(*env)->ExceptionCheck(env);
+}
+
+void jniSetLogExceptionDeduplicationWindow(int64_t windowMs) {
+    atomic_store_explicit(&g_exception_log_window_ns, windowMs > 0 ? windowMs * 1000000LL : 0,
+                          memory_order_relaxed);
+}
+
+void jniLogExceptionDeduplicated(JNIEnv* env, int priority, const char* tag, jthrowable thrown) {
+    JNI_PROFILE(jniLogExceptionDeduplicated);
+    const int64_t windowNs = atomic_load_explicit(&g_exception_log_window_ns, memory_order_relaxed);
+    if (windowNs == 0) {
+        jniLogException(env, priority, tag, thrown);
+        return;
+    }
+
+    jthrowable pendingException = (*env)->ExceptionOccurred(env);
+    if (pendingException != NULL) {
+        (*env)->ExceptionClear(env);
+    }
+    if (thrown == NULL) {
+        thrown = pendingException;
+    }
+
+    char summaryBuffer[EXCEPTION_SUMMARY_BUFFER_SIZE];
+    struct ExpandableString summary;
+    ExpandableStringInitializeWithBuffer(&summary, summaryBuffer, sizeof(summaryBuffer));
+    uint64_t fingerprint;
+    bool log = true;
+    uint64_t evictedRepeats = 0;
+    char evictedSummary[EXCEPTION_SUMMARY_BUFFER_SIZE];
+    if (thrown != NULL && GetExceptionFingerprint(env, thrown, &summary, &fingerprint)) {
+        const int64_t now = NowNanos();
+        pthread_mutex_lock(&g_exception_log_lock);
+        struct ExceptionLogSlot* slot = &g_exception_log_slots[fingerprint % EXCEPTION_LOG_SLOTS];
+        if (slot->windowStartNs != 0 && slot->fingerprint == fingerprint &&
+            now - slot->windowStartNs < windowNs) {
+            slot->repeats++;
+            log = false;
+        } else {
+            // The window of the exception in the slot, this one or another, is over. Report how
+            // often it repeated, then start a new window with a full trace.
+            if (slot->windowStartNs != 0 && slot->repeats > 0) {
+                evictedRepeats = slot->repeats;
+                memcpy(evictedSummary, slot->summary, sizeof(evictedSummary));
+            }
+            slot->fingerprint = fingerprint;
+            slot->windowStartNs = now;
+            slot->repeats = 0;
+            snprintf(slot->summary, sizeof(slot->summary), "%s", summary.data);
+        }
+        pthread_mutex_unlock(&g_exception_log_lock);
+    } else {
+        // Fall back to logging every exception that cannot be fingerprinted.
+        (*env)->ExceptionClear(env);
+    }
+    ExpandableStringRelease(&summary);
+
+    if (evictedRepeats > 0) {
+        __android_log_print(priority, tag, "%s: repeated %llu more times",
+                            evictedSummary, (unsigned long long) evictedRepeats);
+    }
+    if (log) {
+        size_t mark = jniArenaBegin();
+        struct ExpandableString trace;
+        ExpandableStringInitializeWithArena(&trace);
+        GetStackTraceOrSummary(env, thrown, &trace);
+        const char* details = (trace.data != NULL) ? trace.data : "No memory to report exception";
+        __android_log_write(priority, tag, details);
+        ExpandableStringRelease(&trace);
+        jniArenaEnd(mark);
+    }
+
+    if (pendingException != NULL) {
+        (*env)->Throw(env, pendingException);
+        (*env)->DeleteLocalRef(env, pendingException);
+    }
 }
 
 int jniThrowException(JNIEnv* env, const char* className, const char* message) {
+    JNI_PROFILE(jniThrowException);
     return THROW_EXCEPTION_WITH_MESSAGE(env, className, "(Ljava/lang/String;)V", message);
 }
 
 int jniThrowExceptionFmt(JNIEnv* env, const char* className, const char* fmt, va_list args) {
-    char msgBuf[512];
-    vsnprintf(msgBuf, sizeof(msgBuf), fmt, args);
-    return jniThrowException(env, className, msgBuf);
+    return jniThrowExceptionFmtWithLimit(env, className, SIZE_MAX, fmt, args);
+}
+
+int jniThrowExceptionFmtWithLimit(JNIEnv* env, const char* className, size_t maxMessageLength,
+                                  const char* fmt, va_list args) {
+    size_t mark = jniArenaBegin();
+    char msgBuf[EXCEPTION_MESSAGE_BUFFER_SIZE];
+    char* heapMsg;
+    const char* msg = FormatExceptionMsgV(msgBuf, sizeof(msgBuf), &heapMsg, maxMessageLength, fmt,
+                                          args);
+    int status = jniThrowException(env, className, msg);
+    free(heapMsg);
+    jniArenaEnd(mark);
+    return status;
 }
 
 int jniThrowNullPointerException(JNIEnv* env, const char* msg) {
@@ -374,12 +1009,24 @@ int jniThrowRuntimeException(JNIEnv* env, const char* msg) {
 }
 
 int jniThrowIOException(JNIEnv* env, int errno_value) {
+    // Creating a message is not allowed with an exception pending, and the pending exception
+    // must reach ThrowException to be logged, so that case takes the uncached path.
+    jstring cached = NULL;
+    if (!(*env)->ExceptionCheck(env)) {
+        cached = GetCachedErrnoMessage(env, errno_value);
+    }
+    if (cached != NULL) {
+        // Profiled as jniThrowException, which the uncached path goes through.
+        JNI_PROFILE(jniThrowException);
+        return ThrowException(env, "java/io/IOException", "(Ljava/lang/String;)V", cached);
+    }
     char buffer[80];
     const char* message = platformStrError(errno_value, buffer, sizeof(buffer));
     return jniThrowException(env, "java/io/IOException", message);
 }
 
 int jniThrowErrnoException(JNIEnv* env, const char* functionName, int errno_value) {
+    JNI_PROFILE(jniThrowErrnoException);
     return THROW_EXCEPTION_WITH_MESSAGE(env, "android/system/ErrnoException",
             "(Ljava/lang/String;I)V", functionName, errno_value);
 }
@@ -387,3 +1034,27 @@ int jniThrowErrnoException(JNIEnv* env, const char* functionName, int errno_valu
 jstring jniCreateString(JNIEnv* env, const jchar* unicodeChars, jsize len) {
     return (*env)->NewString(env, unicodeChars, len);
 }
+
+jstring jniCreateStringUtf8(JNIEnv* env, const char* utf8, size_t length) {
+    jchar stackBuffer[UTF16_STACK_BUFFER_SIZE];
+    jchar* utf16 = stackBuffer;
+    jchar* heapBuffer = NULL;
+    size_t mark = jniArenaBegin();
+    if (length > UTF16_STACK_BUFFER_SIZE) {
+        if (length > INT32_MAX) {
+            utf16 = NULL;
+        } else if ((utf16 = jniArenaAllocate(length * sizeof(jchar))) == NULL) {
+            utf16 = heapBuffer = malloc(length * sizeof(jchar));
+        }
+        if (utf16 == NULL) {
+            jniArenaEnd(mark);
+            jniThrowException(env, "java/lang/OutOfMemoryError", "jniCreateStringUtf8");
+            return NULL;
+        }
+    }
+    size_t count = jniUtf8ToUtf16(utf8, length, utf16);
+    jstring result = (*env)->NewString(env, utf16, (jsize) count);
+    free(heapBuffer);
+    jniArenaEnd(mark);
+    return result;
+}
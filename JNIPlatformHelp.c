@@ -19,6 +19,7 @@
 #include <stddef.h>
 
 #include "JniConstants.h"
+#include "JniProfiling-priv.h"
 
 static int GetBufferPosition(JNIEnv* env, jobject nioBuffer) {
     return(*env)->GetIntField(env, nioBuffer, JniConstants_NioBuffer_position(env));
@@ -32,7 +33,9 @@ static int GetBufferElementSizeShift(JNIEnv* env, jobject nioBuffer) {
     return(*env)->GetIntField(env, nioBuffer, JniConstants_NioBuffer__elementSizeShift(env));
 }
 
-jarray jniGetNioBufferBaseArray(JNIEnv* env, jobject nioBuffer) {
+// Unprofiled bodies of jniGetNioBufferBaseArray and jniGetNioBufferBaseArrayOffset, so that
+// jniGetNioBufferInfo is counted once.
+static jarray GetBufferBaseArray(JNIEnv* env, jobject nioBuffer) {
     jclass nioAccessClass = JniConstants_NIOAccessClass(env);
     jmethodID getBaseArrayMethod = JniConstants_NIOAccess_getBaseArray(env);
     jobject object = (*env)->CallStaticObjectMethod(env,
@@ -40,13 +43,24 @@ jarray jniGetNioBufferBaseArray(JNIEnv* env, jobject nioBuffer) {
     return (jarray) object;
 }
 
-int jniGetNioBufferBaseArrayOffset(JNIEnv* env, jobject nioBuffer) {
+static int GetBufferBaseArrayOffset(JNIEnv* env, jobject nioBuffer) {
     jclass nioAccessClass = JniConstants_NIOAccessClass(env);
     jmethodID getBaseArrayOffsetMethod = JniConstants_NIOAccess_getBaseArrayOffset(env);
     return (*env)->CallStaticIntMethod(env, nioAccessClass, getBaseArrayOffsetMethod, nioBuffer);
 }
 
+jarray jniGetNioBufferBaseArray(JNIEnv* env, jobject nioBuffer) {
+    JNI_PROFILE(jniGetNioBufferBaseArray);
+    return GetBufferBaseArray(env, nioBuffer);
+}
+
+int jniGetNioBufferBaseArrayOffset(JNIEnv* env, jobject nioBuffer) {
+    JNI_PROFILE(jniGetNioBufferBaseArrayOffset);
+    return GetBufferBaseArrayOffset(env, nioBuffer);
+}
+
 jlong jniGetNioBufferPointer(JNIEnv* env, jobject nioBuffer) {
+    JNI_PROFILE(jniGetNioBufferPointer);
     jlong baseAddress = (*env)->GetLongField(env, nioBuffer, JniConstants_NioBuffer_address(env));
     if (baseAddress != 0) {
         const int position = GetBufferPosition(env, nioBuffer);
@@ -58,8 +72,32 @@ jlong jniGetNioBufferPointer(JNIEnv* env, jobject nioBuffer) {
 
 jlong jniGetNioBufferFields(JNIEnv* env, jobject nioBuffer,
                             jint* position, jint* limit, jint* elementSizeShift) {
+    JNI_PROFILE(jniGetNioBufferFields);
     *position = GetBufferPosition(env, nioBuffer);
     *limit = GetBufferLimit(env, nioBuffer);
     *elementSizeShift = GetBufferElementSizeShift(env, nioBuffer);
     return (*env)->GetLongField(env, nioBuffer, JniConstants_NioBuffer_address(env));
 }
+
+void jniGetNioBufferInfo(JNIEnv* env, jobject nioBuffer, struct JniNioBufferInfo* info) {
+    JNI_PROFILE(jniGetNioBufferInfo);
+    const jlong baseAddress =
+            (*env)->GetLongField(env, nioBuffer, JniConstants_NioBuffer_address(env));
+    info->position = GetBufferPosition(env, nioBuffer);
+    info->limit = GetBufferLimit(env, nioBuffer);
+    info->elementSizeShift = GetBufferElementSizeShift(env, nioBuffer);
+    info->remainingBytes = (jlong) (info->limit - info->position) << info->elementSizeShift;
+    info->isDirect = baseAddress != 0 ? JNI_TRUE : JNI_FALSE;
+    if (baseAddress != 0) {
+        // The position is already known, so the NIOAccess up-calls are only needed for buffers
+        // backed by a managed array.
+        info->address = baseAddress + ((jlong) info->position << info->elementSizeShift);
+        info->baseArray = NULL;
+        info->baseArrayOffset = 0;
+    } else {
+        info->address = 0;
+        info->baseArray = GetBufferBaseArray(env, nioBuffer);
+        info->baseArrayOffset =
+                info->baseArray != NULL ? GetBufferBaseArrayOffset(env, nioBuffer) : 0;
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include_platform/nativehelper/JniArena.h"
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Size of the block of each thread's arena.
+#define JNI_ARENA_SIZE (64 * 1024)
+
+struct JniArena {
+    char* base;     // Allocated on first use, freed when the thread exits.
+    size_t used;    // Offset of the end of the most recent allocation.
+    size_t depth;   // Number of open scopes.
+};
+
+static _Thread_local struct JniArena g_arena;
+
+// Frees each thread's block when the thread exits.
+static pthread_key_t g_arena_key;
+static pthread_once_t g_arena_key_once = PTHREAD_ONCE_INIT;
+
+static void FreeArenaBlock(void* base) {
+    free(base);
+    g_arena.base = NULL;
+}
+
+static void CreateArenaKey() {
+    pthread_key_create(&g_arena_key, FreeArenaBlock);
+}
+
+static bool EnsureArenaBlock(struct JniArena* arena) {
+    if (__builtin_expect(arena->base != NULL, 1)) {
+        return true;
+    }
+    pthread_once(&g_arena_key_once, CreateArenaKey);
+    arena->base = malloc(JNI_ARENA_SIZE);
+    if (arena->base == NULL) {
+        return false;
+    }
+    pthread_setspecific(g_arena_key, arena->base);
+    return true;
+}
+
+size_t jniArenaBegin() {
+    g_arena.depth++;
+    return g_arena.used;
+}
+
+void jniArenaEnd(size_t mark) {
+    g_arena.depth--;
+    g_arena.used = mark;
+}
+
+void* jniArenaAllocate(size_t size) {
+    struct JniArena* arena = &g_arena;
+    if (arena->depth == 0 || !EnsureArenaBlock(arena)) {
+        return NULL;
+    }
+    const size_t alignment = alignof(max_align_t);
+    size_t start = (arena->used + alignment - 1) & ~(alignment - 1);
+    if (start > JNI_ARENA_SIZE || size > JNI_ARENA_SIZE - start) {
+        return NULL;
+    }
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+void* jniArenaReallocate(void* ptr, size_t oldSize, size_t newSize) {
+    struct JniArena* arena = &g_arena;
+    if (arena->depth == 0) {
+        return NULL;
+    }
+    if (ptr != NULL && (char*) ptr + oldSize == arena->base + arena->used) {
+        // The most recent allocation grows in place.
+        size_t start = (size_t) ((char*) ptr - arena->base);
+        if (newSize > JNI_ARENA_SIZE - start) {
+            return NULL;
+        }
+        arena->used = start + newSize;
+        return ptr;
+    }
+    void* data = jniArenaAllocate(newSize);
+    if (data != NULL && ptr != NULL) {
+        memcpy(data, ptr, (oldSize < newSize) ? oldSize : newSize);
+    }
+    return data;
+}
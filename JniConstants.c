@@ -16,19 +16,36 @@
 
 #include "JniConstants.h"
 
+#include <limits.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <nativehelper/JNIHelp.h>
+#include <nativehelper/JniConstantsTable.h>
+
 #define LOG_TAG "JniConstants"
 #include "ALog-priv.h"
 
+#include "JNIHelp-priv.h"
+#include "JniExceptionLogger-priv.h"
+
 // jclass constants list:
 //   <class, signature, androidOnly>
 
 #define JCLASS_CONSTANTS_LIST(V)                                            \
   V(FileDescriptor, "java/io/FileDescriptor", false)                        \
+  V(FileDescriptorArray, "[Ljava/io/FileDescriptor;", false)                \
   V(NIOAccess, "java/nio/NIOAccess", true)                                  \
   V(NioBuffer, "java/nio/Buffer", false)
 
@@ -39,7 +56,8 @@
   V(NIOAccess, getBaseArray, "getBaseArray", "(Ljava/nio/Buffer;)Ljava/lang/Object;", true) \
   V(NIOAccess, getBaseArrayOffset, "getBaseArrayOffset", "(Ljava/nio/Buffer;)I", true)      \
   V(NioBuffer, array, "array", "()Ljava/lang/Object;", false)                               \
-  V(NioBuffer, arrayOffset, "arrayOffset", "()I", false)
+  V(NioBuffer, arrayOffset, "arrayOffset", "()I", false)                                   \
+  V(NioBuffer, clear, "clear", "()Ljava/nio/Buffer;", false)
 
 // jfieldID constants list:
 //   <Class, field, signature, is_static>
@@ -110,46 +128,412 @@ static jfieldID FindField(JNIEnv* env, jclass cls,
     return field;
 }
 
-static pthread_once_t g_initialized = PTHREAD_ONCE_INIT;
-static JNIEnv* g_init_env;
+// Initialization state of the constants. Accessors check for kInitialized with an acquire load
+// so the steady-state cost is a plain load with no writes to shared cache lines.
+enum {
+    kUninitialized = 0,
+    kInitializing = 1,
+    // As kInitializing, with threads waiting for initialization to complete.
+    kInitializingWithWaiters = 2,
+    kInitialized = 3,
+};
+static atomic_int g_state = kUninitialized;
+
+// Serializes initialization and uninitialization of the constants.
+static pthread_mutex_t g_initialization_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Threads that find another thread initializing the constants wait on g_state itself rather than
+// on g_initialization_lock, and are woken together when it completes rather than handed the lock
+// one at a time.
+#if defined(__linux__)
+
+static void WaitForState(int value) {
+    syscall(__NR_futex, (int*) &g_state, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void WakeStateWaiters() {
+    syscall(__NR_futex, (int*) &g_state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+#else
+
+static pthread_mutex_t g_state_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_state_changed = PTHREAD_COND_INITIALIZER;
+
+static void WaitForState(int value) {
+    pthread_mutex_lock(&g_state_lock);
+    while (atomic_load_explicit(&g_state, memory_order_relaxed) == value) {
+        pthread_cond_wait(&g_state_changed, &g_state_lock);
+    }
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+static void WakeStateWaiters() {
+    // Taking the lock orders the wake after any waiter's check of g_state.
+    pthread_mutex_lock(&g_state_lock);
+    pthread_cond_broadcast(&g_state_changed);
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+#endif
 
-static void InitializeConstants() {
+static void InitializeConstants(JNIEnv* env) {
     // Initialize cached classes.
 #define JCLASS_INITIALIZE(cls, signature, androidOnly)                      \
-    CLASS_NAME(cls) = FindClass(g_init_env, signature, androidOnly);
+    CLASS_NAME(cls) = FindClass(env, signature, androidOnly);
     JCLASS_CONSTANTS_LIST(JCLASS_INITIALIZE)
 #undef JCLASS_INITIALIZE
 
     // Initialize cached methods.
 #define JMETHODID_INITIALIZE(cls, method, name, signature, isStatic)        \
     METHOD_NAME(cls, method) =                                              \
-        FindMethod(g_init_env, CLASS_NAME(cls), name, signature, isStatic);
+        FindMethod(env, CLASS_NAME(cls), name, signature, isStatic);
     JMETHODID_CONSTANTS_LIST(JMETHODID_INITIALIZE)
 #undef JMETHODID_INITIALIZE
 
     // Initialize cached fields.
 #define JFIELDID_INITIALIZE(cls, field, signature, isStatic)                \
     FIELD_NAME(cls, field) =                                                \
-        FindField(g_init_env, CLASS_NAME(cls), #field, signature, isStatic);
+        FindField(env, CLASS_NAME(cls), #field, signature, isStatic);
     JFIELDID_CONSTANTS_LIST(JFIELDID_INITIALIZE)
 #undef JFIELDID_INITIALIZE
 }
 
-void EnsureInitialized(JNIEnv* env) {
+static void EnsureInitializedSlow(JNIEnv* env) {
+    int state = kUninitialized;
+    if (atomic_compare_exchange_strong_explicit(&g_state, &state, kInitializing,
+                                                memory_order_acquire, memory_order_acquire)) {
+        pthread_mutex_lock(&g_initialization_lock);
+        InitializeConstants(env);
+        state = atomic_exchange_explicit(&g_state, kInitialized, memory_order_release);
+        pthread_mutex_unlock(&g_initialization_lock);
+        if (state == kInitializingWithWaiters) {
+            WakeStateWaiters();
+        }
+        return;
+    }
+    while (state != kInitialized) {
+        if (state == kUninitialized) {
+            // Uninitialized again before this thread could wait, retry as the initializer.
+            EnsureInitializedSlow(env);
+            return;
+        }
+        if (state == kInitializingWithWaiters ||
+            atomic_compare_exchange_weak_explicit(&g_state, &state, kInitializingWithWaiters,
+                                                  memory_order_acquire, memory_order_acquire)) {
+            WaitForState(kInitializingWithWaiters);
+        }
+        state = atomic_load_explicit(&g_state, memory_order_acquire);
+    }
+}
+
+static inline void EnsureInitialized(JNIEnv* env) {
     // This method has to be called in every cache accesses because library can be built
     // 2 different ways and existing usage for compat version doesn't have a good hook for
     // initialization and is widely used.
-    g_init_env = env;
-    pthread_once(&g_initialized, InitializeConstants);
+    if (__builtin_expect(atomic_load_explicit(&g_state, memory_order_acquire) != kInitialized,
+                         0)) {
+        EnsureInitializedSlow(env);
+    }
+}
+
+//
+// Tables of constants declared by native libraries, see JniConstantsTable.h.
+//
+
+// Resolved tables, reset by jniUninitializeConstants(). Guarded by g_initialization_lock.
+static struct JniConstantsTable* g_resolved_tables = NULL;
+
+static void DeleteTableClasses(JNIEnv* env, const struct JniConstantsTable* table,
+                               const union JniConstantValue* values) {
+    for (size_t i = 0; i < table->count; ++i) {
+        if (table->descriptors[i].kind == kJniConstantClass && values[i].clazz != NULL) {
+            (*env)->DeleteGlobalRef(env, values[i].clazz);
+        }
+    }
+}
+
+static bool ResolveTableEntry(JNIEnv* env, const struct JniConstantsTable* table, size_t index,
+                              union JniConstantValue* values) {
+    const struct JniConstantDescriptor* d = &table->descriptors[index];
+    if (d->kind == kJniConstantClass) {
+        jclass cls = (*env)->FindClass(env, d->name);
+        if (cls == NULL) {
+            return false;
+        }
+        values[index].clazz = (*env)->NewGlobalRef(env, cls);
+        (*env)->DeleteLocalRef(env, cls);
+        return values[index].clazz != NULL;
+    }
+
+    ALOG_ALWAYS_FATAL_IF(d->classIndex >= index ||
+                         table->descriptors[d->classIndex].kind != kJniConstantClass,
+                         "Member %s does not follow its class", d->name);
+    jclass cls = values[d->classIndex].clazz;
+    if (cls == NULL) {
+        // The class is optional and missing.
+        if (!d->optional) {
+            jniThrowException(env, "java/lang/NoClassDefFoundError",
+                              table->descriptors[d->classIndex].name);
+        }
+        return false;
+    }
+    switch (d->kind) {
+        case kJniConstantMethod:
+            values[index].method = (*env)->GetMethodID(env, cls, d->name, d->signature);
+            break;
+        case kJniConstantStaticMethod:
+            values[index].method = (*env)->GetStaticMethodID(env, cls, d->name, d->signature);
+            break;
+        case kJniConstantField:
+            values[index].field = (*env)->GetFieldID(env, cls, d->name, d->signature);
+            break;
+        case kJniConstantStaticField:
+            values[index].field = (*env)->GetStaticFieldID(env, cls, d->name, d->signature);
+            break;
+        case kJniConstantClass:
+            break;
+    }
+    // All members of the union are pointers, so any of them can be tested.
+    return values[index].method != NULL;
+}
+
+bool jniResolveConstants(JNIEnv* env, struct JniConstantsTable* table) {
+    if (jniConstantsResolved(table)) {
+        return true;
+    }
+
+    // Entries are resolved into a private copy without holding the lock, since FindClass can
+    // run static initializers that resolve other tables. If several threads race, the first
+    // to finish publishes its copy and the others discard theirs.
+    union JniConstantValue* values = calloc(table->count > 0 ? table->count : 1,
+                                            sizeof(union JniConstantValue));
+    if (values == NULL) {
+        jniThrowException(env, "java/lang/OutOfMemoryError", "jniResolveConstants");
+        return false;
+    }
+    for (size_t i = 0; i < table->count; ++i) {
+        if (!ResolveTableEntry(env, table, i, values)) {
+            const struct JniConstantDescriptor* d = &table->descriptors[i];
+            if (!d->optional) {
+                ALOGE("Unable to resolve %s %s", d->name, d->signature != NULL ? d->signature : "");
+                DeleteTableClasses(env, table, values);
+                free(values);
+                return false;
+            }
+            (*env)->ExceptionClear(env);
+            values[i].method = NULL;
+        }
+    }
+
+    bool published = false;
+    pthread_mutex_lock(&g_initialization_lock);
+    if (!__atomic_load_n(&table->resolved, __ATOMIC_RELAXED)) {
+        memcpy(table->values, values, table->count * sizeof(union JniConstantValue));
+        table->next = g_resolved_tables;
+        g_resolved_tables = table;
+        __atomic_store_n(&table->resolved, 1, __ATOMIC_RELEASE);
+        published = true;
+    }
+    pthread_mutex_unlock(&g_initialization_lock);
+
+    if (!published) {
+        DeleteTableClasses(env, table, values);
+    }
+    free(values);
+    return true;
+}
+
+void jniUnregisterConstants(JNIEnv* env, struct JniConstantsTable* table) {
+    bool linked = false;
+    pthread_mutex_lock(&g_initialization_lock);
+    for (struct JniConstantsTable** link = &g_resolved_tables; *link != NULL;
+         link = &(*link)->next) {
+        if (*link == table) {
+            *link = table->next;
+            linked = true;
+            break;
+        }
+    }
+    table->next = NULL;
+    __atomic_store_n(&table->resolved, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_initialization_lock);
+
+    if (linked) {
+        DeleteTableClasses(env, table, table->values);
+        memset(table->values, 0, table->count * sizeof(union JniConstantValue));
+    }
+}
+
+// Upper bound on the threads used by jniResolveConstantsInParallel(), including the caller.
+#define MAX_RESOLUTION_THREADS 16
+
+// Work shared by the threads of jniResolveConstantsInParallel().
+struct ParallelResolution {
+    JavaVM* vm;
+    struct JniConstantsTable* const* tables;
+    size_t count;
+    atomic_size_t next;
+};
+
+static void ResolveClaimedTables(JNIEnv* env, struct ParallelResolution* work) {
+    for (;;) {
+        size_t i = atomic_fetch_add_explicit(&work->next, 1, memory_order_relaxed);
+        if (i >= work->count) {
+            return;
+        }
+        if (!jniResolveConstants(env, work->tables[i])) {
+            // Retried on the calling thread, which reports the failure.
+            (*env)->ExceptionClear(env);
+        }
+    }
+}
+
+static void* ParallelResolutionWorker(void* arg) {
+    struct ParallelResolution* work = (struct ParallelResolution*) arg;
+    JNIEnv* env = NULL;
+    JavaVMAttachArgs args = { JNI_VERSION_1_6, "JniConstantsInit", NULL };
+    if ((*work->vm)->AttachCurrentThread(work->vm, &env, &args) != JNI_OK) {
+        return NULL;
+    }
+    ResolveClaimedTables(env, work);
+    (*work->vm)->DetachCurrentThread(work->vm);
+    return NULL;
+}
+
+bool jniResolveConstantsInParallel(JNIEnv* env, struct JniConstantsTable* const* tables,
+                                   size_t count, size_t maxThreads) {
+    struct ParallelResolution work = { NULL, tables, count, 0 };
+    size_t threadCount = maxThreads < count ? maxThreads : count;
+    if (threadCount > MAX_RESOLUTION_THREADS) {
+        threadCount = MAX_RESOLUTION_THREADS;
+    }
+    pthread_t threads[MAX_RESOLUTION_THREADS - 1];
+    size_t started = 0;
+    if (threadCount > 1 && (*env)->GetJavaVM(env, &work.vm) == JNI_OK) {
+        for (; started < threadCount - 1; ++started) {
+            if (pthread_create(&threads[started], NULL, ParallelResolutionWorker, &work) != 0) {
+                break;
+            }
+        }
+    }
+    ResolveClaimedTables(env, &work);
+    for (size_t i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!jniResolveConstants(env, tables[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// Strings interned by jniInternString().
+//
+// A hash table of chains. Entries are only ever prepended, under g_interned_strings_lock, and
+// published with a release store of the bucket head, so lookups take no lock.
+//
+
+// Number of buckets of the table. Must be a power of two.
+#define INTERNED_STRING_BUCKETS 256
+
+struct InternedString {
+    struct InternedString* next;
+    uint32_t hash;
+    jstring string;  // Global reference.
+    char utf8[];
+};
+
+static _Atomic(struct InternedString*) g_interned_strings[INTERNED_STRING_BUCKETS];
+static pthread_mutex_t g_interned_strings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t HashString(const char* s) {
+    // 32-bit FNV-1a.
+    uint32_t hash = 2166136261u;
+    for (; *s != '\0'; ++s) {
+        hash = (hash ^ (uint8_t) *s) * 16777619u;
+    }
+    return hash;
+}
+
+static jstring FindInternedString(struct InternedString* entry, uint32_t hash, const char* utf8) {
+    for (; entry != NULL; entry = entry->next) {
+        if (entry->hash == hash && strcmp(entry->utf8, utf8) == 0) {
+            return entry->string;
+        }
+    }
+    return NULL;
+}
+
+jstring jniInternString(JNIEnv* env, const char* utf8) {
+    const uint32_t hash = HashString(utf8);
+    _Atomic(struct InternedString*)* bucket =
+            &g_interned_strings[hash & (INTERNED_STRING_BUCKETS - 1)];
+    jstring string = FindInternedString(atomic_load_explicit(bucket, memory_order_acquire), hash,
+                                        utf8);
+    if (__builtin_expect(string != NULL, 1)) {
+        return string;
+    }
+
+    // Serialize creation so that each distinct string is created once.
+    pthread_mutex_lock(&g_interned_strings_lock);
+    struct InternedString* head = atomic_load_explicit(bucket, memory_order_relaxed);
+    string = FindInternedString(head, hash, utf8);
+    if (string == NULL) {
+        const size_t size = strlen(utf8) + 1;
+        struct InternedString* entry = malloc(sizeof(struct InternedString) + size);
+        jstring local = NULL;
+        if (entry == NULL) {
+            jniThrowException(env, "java/lang/OutOfMemoryError", "jniInternString");
+        } else if ((local = (*env)->NewStringUTF(env, utf8)) != NULL) {
+            string = (jstring) (*env)->NewGlobalRef(env, local);
+            (*env)->DeleteLocalRef(env, local);
+        }
+        if (string != NULL) {
+            entry->next = head;
+            entry->hash = hash;
+            entry->string = string;
+            memcpy(entry->utf8, utf8, size);
+            atomic_store_explicit(bucket, entry, memory_order_release);
+        } else {
+            free(entry);
+        }
+    }
+    pthread_mutex_unlock(&g_interned_strings_lock);
+    return string;
+}
+
+static void ClearInternedStrings() {
+    pthread_mutex_lock(&g_interned_strings_lock);
+    for (size_t i = 0; i < INTERNED_STRING_BUCKETS; ++i) {
+        struct InternedString* entry = atomic_load_explicit(&g_interned_strings[i],
+                                                            memory_order_relaxed);
+        atomic_store_explicit(&g_interned_strings[i], NULL, memory_order_relaxed);
+        while (entry != NULL) {
+            struct InternedString* next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    pthread_mutex_unlock(&g_interned_strings_lock);
 }
 
 // API exported by libnativehelper_api.h.
 
+void jniInitializeConstants(JNIEnv* env) {
+    EnsureInitialized(env);
+}
+
 void jniUninitializeConstants() {
     // Uninitialize cached classes, methods and fields.
     //
     // NB we assume the runtime is stopped at this point and do not delete global
     // references.
+    pthread_mutex_lock(&g_initialization_lock);
+
 #define JCLASS_INVALIDATE(cls, ...) CLASS_NAME(cls) = NULL;
     JCLASS_CONSTANTS_LIST(JCLASS_INVALIDATE);
 #undef JCLASS_INVALIDATE
@@ -162,10 +546,29 @@ void jniUninitializeConstants() {
     JFIELDID_CONSTANTS_LIST(JFIELDID_INVALIDATE);
 #undef JFIELDID_INVALIDATE
 
+    for (struct JniConstantsTable* table = g_resolved_tables; table != NULL;) {
+        struct JniConstantsTable* next = table->next;
+        memset(table->values, 0, table->count * sizeof(union JniConstantValue));
+        table->next = NULL;
+        __atomic_store_n(&table->resolved, 0, __ATOMIC_RELEASE);
+        table = next;
+    }
+    g_resolved_tables = NULL;
+
     // If jniConstantsUninitialize is called, runtime has shutdown. Reset
     // state as some tests re-start the runtime.
-    pthread_once_t o = PTHREAD_ONCE_INIT;
-    memcpy(&g_initialized, &o, sizeof(o));
+    int state = atomic_exchange_explicit(&g_state, kUninitialized, memory_order_release);
+    pthread_mutex_unlock(&g_initialization_lock);
+    if (state == kInitializingWithWaiters) {
+        // Initialization had started but not taken the lock yet. Wake its waiters to retry.
+        WakeStateWaiters();
+    }
+
+    // As are interned strings, the classes and methods cached by JNIHelp.c, and the thread
+    // jniLogExceptionAsync attached to the runtime.
+    ClearInternedStrings();
+    JniHelp_UninitializeCache();
+    JniExceptionLogger_Uninitialize();
 }
 
 //
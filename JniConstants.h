@@ -29,6 +29,7 @@ __BEGIN_DECLS
 // JniConstants.c.
 //
 jclass JniConstants_FileDescriptorClass(JNIEnv* env);
+jclass JniConstants_FileDescriptorArrayClass(JNIEnv* env);
 jclass JniConstants_NIOAccessClass(JNIEnv* env);
 jclass JniConstants_NioBufferClass(JNIEnv* env);
 
@@ -43,6 +44,7 @@ jmethodID JniConstants_NIOAccess_getBaseArray(JNIEnv* env);
 jmethodID JniConstants_NIOAccess_getBaseArrayOffset(JNIEnv* env);
 jmethodID JniConstants_NioBuffer_array(JNIEnv* env);
 jmethodID JniConstants_NioBuffer_arrayOffset(JNIEnv* env);
+jmethodID JniConstants_NioBuffer_clear(JNIEnv* env);
 
 //
 // Fields in the constants cache.
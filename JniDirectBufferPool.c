@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include_platform/nativehelper/JniDirectBufferPool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define LOG_TAG "JniDirectBufferPool"
+#include "ALog-priv.h"
+
+#include "JniConstants.h"
+
+// The buffers of one size, carved from a single slab.
+struct SizeClass {
+    size_t size;
+    char* slab;
+    jobject* buffers;   // Global references, one per buffer.
+    size_t* freeList;   // Indices of the free buffers, used as a stack.
+    size_t freeCount;
+    bool* leased;
+};
+
+struct JniDirectBufferPool {
+    // Guards the free lists and lease flags of every class.
+    pthread_mutex_t lock;
+    size_t buffersPerClass;
+    size_t classCount;
+    struct SizeClass classes[];
+};
+
+static void FreePool(JNIEnv* env, struct JniDirectBufferPool* pool) {
+    for (size_t i = 0; i < pool->classCount; ++i) {
+        struct SizeClass* c = &pool->classes[i];
+        if (c->buffers != NULL) {
+            for (size_t j = 0; j < pool->buffersPerClass; ++j) {
+                if (c->buffers[j] != NULL) {
+                    (*env)->DeleteGlobalRef(env, c->buffers[j]);
+                }
+            }
+        }
+        free(c->buffers);
+        free(c->freeList);
+        free(c->leased);
+        free(c->slab);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+// Allocates the slab of |c| and wraps each of its buffers. Returns false with an exception
+// pending on failure, leaving whatever was allocated for FreePool().
+static bool InitializeSizeClass(JNIEnv* env, struct SizeClass* c, size_t size, size_t count) {
+    c->size = size;
+    if (size > SIZE_MAX / count) {
+        jniThrowException(env, "java/lang/OutOfMemoryError", "jniCreateDirectBufferPool");
+        return false;
+    }
+    c->slab = malloc(size * count);
+    c->buffers = calloc(count, sizeof(jobject));
+    c->freeList = malloc(count * sizeof(size_t));
+    c->leased = calloc(count, sizeof(bool));
+    if (c->slab == NULL || c->buffers == NULL || c->freeList == NULL || c->leased == NULL) {
+        jniThrowException(env, "java/lang/OutOfMemoryError", "jniCreateDirectBufferPool");
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        jobject local = (*env)->NewDirectByteBuffer(env, c->slab + i * size, (jlong) size);
+        if (local == NULL) {
+            return false;
+        }
+        c->buffers[i] = (*env)->NewGlobalRef(env, local);
+        (*env)->DeleteLocalRef(env, local);
+        if (c->buffers[i] == NULL) {
+            return false;
+        }
+        // Lease the lowest addresses first.
+        c->freeList[count - 1 - i] = i;
+    }
+    c->freeCount = count;
+    return true;
+}
+
+struct JniDirectBufferPool* jniCreateDirectBufferPool(JNIEnv* env, const size_t* classSizes,
+                                                      size_t classCount,
+                                                      size_t buffersPerClass) {
+    if (classCount == 0 || buffersPerClass == 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "Empty pool");
+        return NULL;
+    }
+    for (size_t i = 0; i < classCount; ++i) {
+        if (classSizes[i] == 0 || classSizes[i] > INT32_MAX ||
+            (i > 0 && classSizes[i] <= classSizes[i - 1])) {
+            jniThrowException(env, "java/lang/IllegalArgumentException",
+                              "Size classes must be increasing and fit in a ByteBuffer");
+            return NULL;
+        }
+    }
+
+    // Resolve Buffer.clear() now rather than on the first lease.
+    JniConstants_NioBuffer_clear(env);
+
+    struct JniDirectBufferPool* pool =
+            calloc(1, sizeof(struct JniDirectBufferPool) + classCount * sizeof(struct SizeClass));
+    if (pool == NULL) {
+        jniThrowException(env, "java/lang/OutOfMemoryError", "jniCreateDirectBufferPool");
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->buffersPerClass = buffersPerClass;
+    pool->classCount = classCount;
+    for (size_t i = 0; i < classCount; ++i) {
+        if (!InitializeSizeClass(env, &pool->classes[i], classSizes[i], buffersPerClass)) {
+            FreePool(env, pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void jniDestroyDirectBufferPool(JNIEnv* env, struct JniDirectBufferPool* pool) {
+    if (pool != NULL) {
+        FreePool(env, pool);
+    }
+}
+
+// Returns buffer |index| of |c| to the free list. Called with pool->lock held.
+static void ReturnLeaseLocked(struct SizeClass* c, size_t index) {
+    c->leased[index] = false;
+    c->freeList[c->freeCount++] = index;
+}
+
+jobject jniAcquireDirectBuffer(JNIEnv* env, struct JniDirectBufferPool* pool, size_t size,
+                               void** address) {
+    struct SizeClass* c = NULL;
+    size_t index = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (size_t i = 0; i < pool->classCount; ++i) {
+        if (pool->classes[i].size >= size && pool->classes[i].freeCount > 0) {
+            c = &pool->classes[i];
+            index = c->freeList[--c->freeCount];
+            c->leased[index] = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (c == NULL) {
+        return NULL;
+    }
+
+    // Undo whatever the previous lessee did to the position, limit and mark.
+    jobject buffer = c->buffers[index];
+    jobject self = (*env)->CallObjectMethod(env, buffer, JniConstants_NioBuffer_clear(env));
+    if ((*env)->ExceptionCheck(env)) {
+        pthread_mutex_lock(&pool->lock);
+        ReturnLeaseLocked(c, index);
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+    if (self != NULL) {
+        (*env)->DeleteLocalRef(env, self);
+    }
+    *address = c->slab + index * c->size;
+    return buffer;
+}
+
+void jniReleaseDirectBuffer(JNIEnv* env, struct JniDirectBufferPool* pool, jobject buffer) {
+    char* address = (char*) (*env)->GetDirectBufferAddress(env, buffer);
+    struct SizeClass* c = NULL;
+    for (size_t i = 0; i < pool->classCount; ++i) {
+        struct SizeClass* candidate = &pool->classes[i];
+        if (address >= candidate->slab &&
+            address < candidate->slab + candidate->size * pool->buffersPerClass) {
+            c = candidate;
+            break;
+        }
+    }
+    ALOG_ALWAYS_FATAL_IF(c == NULL || (size_t) (address - c->slab) % c->size != 0,
+                         "Buffer %p is not from pool %p", address, pool);
+
+    const size_t index = (size_t) (address - c->slab) / c->size;
+    pthread_mutex_lock(&pool->lock);
+    ALOG_ALWAYS_FATAL_IF(!c->leased[index], "Buffer %p is released twice", address);
+    ReturnLeaseLocked(c, index);
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include_platform/nativehelper/JNIPlatformHelp.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TAG "JniExceptionLogger"
+#include "ALog-priv.h"
+
+#include "JniExceptionLogger-priv.h"
+#include "JniProfiling-priv.h"
+
+// Number of exceptions that can wait for the logger thread. Must be a power of two.
+#define EXCEPTION_LOG_QUEUE_SIZE 256
+
+// Size of the copy of the log tag kept with each queued exception.
+#define EXCEPTION_LOG_TAG_SIZE 32
+
+// A slot of the queue. |sequence| is the queue position the slot is ready for: producers may
+// fill it when it equals their position, and the consumer may take it when it is one more.
+struct QueuedException {
+    atomic_size_t sequence;
+    jthrowable thrown;  // Global reference.
+    int priority;
+    char tag[EXCEPTION_LOG_TAG_SIZE];
+};
+
+// A logger thread and the bounded multi-producer, single-consumer queue it consumes. Producers
+// claim positions with a compare-and-swap and never block; the logger thread is the only consumer.
+// Each runtime gets a logger of its own, see JniExceptionLogger_Uninitialize().
+struct ExceptionLogger {
+    struct QueuedException queue[EXCEPTION_LOG_QUEUE_SIZE];
+    atomic_size_t enqueue_position;
+    size_t dequeue_position;
+    // Posted once per published slot, the logger thread waits on it.
+    sem_t queued_items;
+    JavaVM* vm;
+    pthread_t thread;
+    // Set when the runtime of the logger has shut down, after which its thread must not use it.
+    atomic_bool abandoned;
+};
+
+static atomic_uint_fast64_t g_queued_count;
+static atomic_uint_fast64_t g_logged_count;
+static atomic_uint_fast64_t g_dropped_count;
+
+// States of the logger thread. It is started by the first jniLogExceptionAsync call and moves to
+// LOGGER_FAILED if it cannot attach, after which exceptions are logged on the calling thread.
+enum {
+    LOGGER_NOT_STARTED,
+    LOGGER_STARTED,
+    LOGGER_FAILED,
+};
+
+// Guards starting and abandoning the logger, and draining the queue once it has failed.
+static pthread_mutex_t g_logger_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int g_logger_state = LOGGER_NOT_STARTED;
+static struct ExceptionLogger* _Atomic g_logger;
+
+static bool Enqueue(struct ExceptionLogger* logger, jthrowable thrown, int priority,
+                    const char* tag) {
+    size_t position = atomic_load_explicit(&logger->enqueue_position, memory_order_relaxed);
+    struct QueuedException* slot;
+    for (;;) {
+        slot = &logger->queue[position & (EXCEPTION_LOG_QUEUE_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&logger->enqueue_position, &position,
+                                                      position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // The logger thread has not taken the slot from the previous lap: the queue is full.
+            return false;
+        } else {
+            position = atomic_load_explicit(&logger->enqueue_position, memory_order_relaxed);
+        }
+    }
+    // Counted before the slot is published, so that g_logged_count never runs ahead of it.
+    atomic_fetch_add_explicit(&g_queued_count, 1, memory_order_relaxed);
+    slot->thrown = thrown;
+    slot->priority = priority;
+    // A NULL tag is kept as an empty one, and logged with the default tag as jniLogException does.
+    snprintf(slot->tag, sizeof(slot->tag), "%s", (tag != NULL) ? tag : "");
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    sem_post(&logger->queued_items);
+    return true;
+}
+
+static struct QueuedException* Dequeue(struct ExceptionLogger* logger) {
+    struct QueuedException* slot =
+            &logger->queue[logger->dequeue_position & (EXCEPTION_LOG_QUEUE_SIZE - 1)];
+    // Each post on queued_items follows a published slot, but slots can be published out of
+    // order, so the slot at the head may still be being filled.
+    while (atomic_load_explicit(&slot->sequence, memory_order_acquire) !=
+           logger->dequeue_position + 1) {
+        sched_yield();
+    }
+    return slot;
+}
+
+static void LogAndRelease(JNIEnv* env, struct ExceptionLogger* logger) {
+    struct QueuedException* slot = Dequeue(logger);
+    jniLogException(env, slot->priority, (slot->tag[0] != '\0') ? slot->tag : NULL, slot->thrown);
+    (*env)->DeleteGlobalRef(env, slot->thrown);
+    atomic_store_explicit(&slot->sequence, logger->dequeue_position + EXCEPTION_LOG_QUEUE_SIZE,
+                          memory_order_release);
+    logger->dequeue_position++;
+    atomic_fetch_add_explicit(&g_logged_count, 1, memory_order_release);
+}
+
+static void* LoggerThread(void* arg) {
+    struct ExceptionLogger* logger = (struct ExceptionLogger*) arg;
+    JNIEnv* env = NULL;
+    JavaVMAttachArgs args = { JNI_VERSION_1_6, "JniExceptionLog", NULL };
+    if ((*logger->vm)->AttachCurrentThreadAsDaemon(logger->vm, &env, &args) != JNI_OK) {
+        ALOGE("Unable to attach the exception logger thread %s", args.name);
+        // Exceptions queued so far are logged by the next caller, see DrainQueueLocked().
+        pthread_mutex_lock(&g_logger_lock);
+        if (atomic_load_explicit(&g_logger, memory_order_relaxed) == logger) {
+            atomic_store_explicit(&g_logger_state, LOGGER_FAILED, memory_order_release);
+        }
+        pthread_mutex_unlock(&g_logger_lock);
+        return NULL;
+    }
+    for (;;) {
+        while (sem_wait(&logger->queued_items) != 0 && errno == EINTR) {
+        }
+        if (atomic_load_explicit(&logger->abandoned, memory_order_acquire)) {
+            break;
+        }
+        LogAndRelease(env, logger);
+    }
+    // The runtime has shut down, so neither it nor the references still queued may be used, not
+    // even to detach. The thread stays parked until the process exits.
+    for (;;) {
+        pause();
+    }
+    return NULL;
+}
+
+// Logs the exceptions left in the queue by a logger thread that failed to attach. The thread has
+// stopped consuming by then, so the caller takes over as the only consumer under g_logger_lock.
+static void DrainQueueLocked(JNIEnv* env, struct ExceptionLogger* logger) {
+    while (sem_trywait(&logger->queued_items) == 0) {
+        LogAndRelease(env, logger);
+    }
+}
+
+// Returns the logger if its thread is running or was started. Returns NULL, after logging any
+// exceptions it left queued, if it could not be started or attached.
+static struct ExceptionLogger* EnsureLoggerStarted(JNIEnv* env) {
+    int state = atomic_load_explicit(&g_logger_state, memory_order_acquire);
+    if (__builtin_expect(state == LOGGER_STARTED, 1)) {
+        return atomic_load_explicit(&g_logger, memory_order_acquire);
+    }
+    pthread_mutex_lock(&g_logger_lock);
+    state = atomic_load_explicit(&g_logger_state, memory_order_acquire);
+    struct ExceptionLogger* logger = atomic_load_explicit(&g_logger, memory_order_relaxed);
+    JavaVM* vm = NULL;
+    if (state == LOGGER_FAILED) {
+        DrainQueueLocked(env, logger);
+        logger = NULL;
+    } else if (state == LOGGER_NOT_STARTED && (*env)->GetJavaVM(env, &vm) == JNI_OK &&
+               (logger = calloc(1, sizeof(*logger))) != NULL) {
+        for (size_t i = 0; i < EXCEPTION_LOG_QUEUE_SIZE; ++i) {
+            atomic_init(&logger->queue[i].sequence, i);
+        }
+        sem_init(&logger->queued_items, 0, 0);
+        logger->vm = vm;
+        atomic_store_explicit(&g_logger, logger, memory_order_release);
+        if (pthread_create(&logger->thread, NULL, LoggerThread, logger) == 0) {
+            // The thread cannot have failed to attach yet, as that takes g_logger_lock.
+            atomic_store_explicit(&g_logger_state, LOGGER_STARTED, memory_order_release);
+        } else {
+            atomic_store_explicit(&g_logger, NULL, memory_order_relaxed);
+            sem_destroy(&logger->queued_items);
+            free(logger);
+            logger = NULL;
+        }
+    }
+    pthread_mutex_unlock(&g_logger_lock);
+    return logger;
+}
+
+void jniLogExceptionAsync(JNIEnv* env, int priority, const char* tag, jthrowable thrown) {
+    JNI_PROFILE(jniLogExceptionAsync);
+    struct ExceptionLogger* logger = EnsureLoggerStarted(env);
+    if (logger == NULL) {
+        jniLogException(env, priority, tag, thrown);
+        return;
+    }
+
+    // As for jniLogException, any pending exception is logged if |thrown| is NULL, and is still
+    // pending on return. NewGlobalRef must not be called with an exception pending.
+    jthrowable pendingException = (*env)->ExceptionOccurred(env);
+    if (pendingException != NULL) {
+        (*env)->ExceptionClear(env);
+        if (thrown == NULL) {
+            thrown = pendingException;
+        }
+    }
+    if (thrown != NULL) {
+        jthrowable global = (jthrowable) (*env)->NewGlobalRef(env, thrown);
+        if (global == NULL || !Enqueue(logger, global, priority, tag)) {
+            if (global != NULL) {
+                (*env)->DeleteGlobalRef(env, global);
+            }
+            atomic_fetch_add_explicit(&g_dropped_count, 1, memory_order_relaxed);
+        }
+    }
+    if (pendingException != NULL) {
+        (*env)->Throw(env, pendingException);
+        (*env)->DeleteLocalRef(env, pendingException);
+    }
+}
+
+void JniExceptionLogger_Uninitialize() {
+    pthread_mutex_lock(&g_logger_lock);
+    struct ExceptionLogger* logger = atomic_load_explicit(&g_logger, memory_order_relaxed);
+    if (logger != NULL) {
+        if (atomic_load_explicit(&g_logger_state, memory_order_relaxed) == LOGGER_FAILED) {
+            // The thread never attached, and has released g_logger_lock for the last time.
+            pthread_join(logger->thread, NULL);
+            sem_destroy(&logger->queued_items);
+            free(logger);
+        } else {
+            // The runtime is stopped, so the thread is neither joined nor detached, and the global
+            // references of exceptions still queued are not deleted. The logger is left to the
+            // parked thread, one per runtime, which only matters to tests that restart it.
+            atomic_store_explicit(&logger->abandoned, true, memory_order_release);
+            sem_post(&logger->queued_items);
+            pthread_detach(logger->thread);
+        }
+        // Exceptions still queued are counted as dropped instead.
+        const uint64_t logged = atomic_load_explicit(&g_logged_count, memory_order_acquire);
+        const uint64_t queued = atomic_load_explicit(&g_queued_count, memory_order_relaxed);
+        const uint64_t unlogged = (queued > logged) ? queued - logged : 0;
+        atomic_fetch_sub_explicit(&g_queued_count, unlogged, memory_order_relaxed);
+        atomic_fetch_add_explicit(&g_dropped_count, unlogged, memory_order_relaxed);
+        atomic_store_explicit(&g_logger, NULL, memory_order_relaxed);
+    }
+    atomic_store_explicit(&g_logger_state, LOGGER_NOT_STARTED, memory_order_release);
+    pthread_mutex_unlock(&g_logger_lock);
+}
+
+void jniFlushAsyncExceptionLog() {
+    const uint64_t queued = atomic_load_explicit(&g_queued_count, memory_order_relaxed);
+    const struct timespec pause = { 0, 1000000 };
+    while (atomic_load_explicit(&g_logged_count, memory_order_acquire) < queued &&
+           atomic_load_explicit(&g_logger_state, memory_order_acquire) != LOGGER_FAILED) {
+        nanosleep(&pause, NULL);
+    }
+}
+
+void jniGetAsyncExceptionLogStats(struct JniAsyncExceptionLogStats* stats) {
+    stats->queued = atomic_load_explicit(&g_queued_count, memory_order_relaxed);
+    stats->logged = atomic_load_explicit(&g_logged_count, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&g_dropped_count, memory_order_relaxed);
+}
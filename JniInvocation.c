@@ -24,10 +24,14 @@
 #endif
 
 #include <jni.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#include <time.h>
 
 #include "DlHelp.h"
+#include "JniTracing-priv.h"
 
 // Name the default library providing the JNI Invocation API.
 static const char* kDefaultJniInvocationLibrary = "libart.so";
@@ -43,35 +47,113 @@ struct JniInvocationImpl {
   jint (*JNI_GetDefaultJavaVMInitArgs)(void*);
   jint (*JNI_CreateJavaVM)(JavaVM**, JNIEnv**, void*);
   jint (*JNI_GetCreatedJavaVMs)(JavaVM**, jsize, jsize*);
+
+  // Time spent in each phase of JniInvocationInit.
+  struct JniInvocationInitTimings init_timings;
+
+  // Whether the envs of the JavaVM created through JNI_CreateJavaVM are traced.
+  bool trace_jni;
 };
 
 static struct JniInvocationImpl g_impl;
 
+// Longest library name, including the terminator, that JniInvocationPreload accepts.
+#define PRELOAD_LIBRARY_NAME_MAX 256
+
+// State of the library opened by JniInvocationPreload.
+struct JniInvocationPreloadState {
+  pthread_mutex_t lock;
+  bool started;
+  bool has_thread;
+  pthread_t thread;
+  enum DlOpenMode mode;
+  char library_name[PRELOAD_LIBRARY_NAME_MAX];
+  DlLibrary library;
+};
+
+static struct JniInvocationPreloadState g_preload = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
 //
 // Internal helpers.
 //
 
 #define UNUSED(x) (x) = (x)
 
-static bool IsDebuggable() {
 #ifdef __ANDROID__
-  char debuggable[PROP_VALUE_MAX] = {0};
-  __system_property_get("ro.debuggable", debuggable);
-  return strcmp(debuggable, "1") == 0;
-#else
-  // Host is always treated as debuggable, which allows choice of library to be overridden.
+
+// A system property whose value is kept and read again only when its serial changes.
+struct CachedProperty {
+  const char* name;
+  // Handle of the property, or NULL until it is found.
+  const prop_info* info;
+  // Serial and value of the property when it was last read.
+  uint32_t serial;
+  char value[PROP_VALUE_MAX];
+};
+
+// The system properties that determine the library chosen by JniInvocationGetLibrary.
+struct JniInvocationProperties {
+  pthread_mutex_t lock;
+  // Whether missing properties have been looked for, and the serial of the whole property area
+  // when they last were.
+  bool searched;
+  uint32_t area_serial;
+  struct CachedProperty debuggable;
+  struct CachedProperty library;
+  // Whether ro.debuggable is "1".
+  bool is_debuggable;
+};
+
+static struct JniInvocationProperties g_properties = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .debuggable = { .name = "ro.debuggable" },
+  .library = { .name = "persist.sys.dalvik.vm.lib.2" },
+};
+
+static void OnPropertyRead(void* cookie, const char* name, const char* value, uint32_t serial) {
+  UNUSED(name);
+  struct CachedProperty* property = (struct CachedProperty*) cookie;
+  strlcpy(property->value, value, sizeof(property->value));
+  property->serial = serial;
+}
+
+// Reads |property| again if it has changed, looking for it first if it has not been found and
+// |find| is set. Returns true if the value was read.
+static bool RefreshProperty(struct CachedProperty* property, bool find) {
+  if (property->info == NULL) {
+    if (!find || (property->info = __system_property_find(property->name)) == NULL) {
+      return false;
+    }
+  } else if (__system_property_serial(property->info) == property->serial) {
+    return false;
+  }
+  __system_property_read_callback(property->info, OnPropertyRead, property);
   return true;
-#endif
 }
 
-static int GetLibrarySystemProperty(char* buffer) {
-#ifdef __ANDROID__
-  return __system_property_get("persist.sys.dalvik.vm.lib.2", buffer);
-#else
-  // Host does not use properties.
-  UNUSED(buffer);
-  return 0;
-#endif
+// Brings g_properties up to date. Must be called with g_properties.lock held.
+static void RefreshLibraryProperties() {
+  // Looking up a property by name walks the property trie, so a property that does not exist is
+  // only looked for again once some property has been added or changed.
+  bool find = false;
+  if (g_properties.debuggable.info == NULL || g_properties.library.info == NULL) {
+    uint32_t area_serial = __system_property_area_serial();
+    find = !g_properties.searched || area_serial != g_properties.area_serial;
+    g_properties.searched = true;
+    g_properties.area_serial = area_serial;
+  }
+  if (RefreshProperty(&g_properties.debuggable, find)) {
+    g_properties.is_debuggable = strcmp(g_properties.debuggable.value, "1") == 0;
+  }
+  RefreshProperty(&g_properties.library, find);
+}
+
+#endif  // __ANDROID__
+
+static int64_t NowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
 }
 
 static DlSymbol FindSymbol(DlLibrary library, const char* symbol) {
@@ -93,7 +175,11 @@ jint JNI_GetDefaultJavaVMInitArgs(void* vmargs) {
 
 jint JNI_CreateJavaVM(JavaVM** p_vm, JNIEnv** p_env, void* vm_args) {
   ALOG_ALWAYS_FATAL_IF(NULL == g_impl.JNI_CreateJavaVM, "Runtime library not loaded.");
-  return g_impl.JNI_CreateJavaVM(p_vm, p_env, vm_args);
+  jint result = g_impl.JNI_CreateJavaVM(p_vm, p_env, vm_args);
+  if (result == JNI_OK && g_impl.trace_jni) {
+    JniTracing_InstallOnJavaVM(*p_vm, *p_env);
+  }
+  return result;
 }
 
 jint JNI_GetCreatedJavaVMs(JavaVM** vms, jsize size, jsize* vm_count) {
@@ -127,14 +213,85 @@ const char* JniInvocationGetLibraryWith(const char* library,
 }
 
 const char* JniInvocationGetLibrary(const char* library, char* buffer) {
-  bool debuggable = IsDebuggable();
   const char* system_preferred_library = NULL;
-  if (buffer != NULL && (GetLibrarySystemProperty(buffer) > 0)) {
+#ifdef __ANDROID__
+  pthread_mutex_lock(&g_properties.lock);
+  RefreshLibraryProperties();
+  bool debuggable = g_properties.is_debuggable;
+  if (buffer != NULL && g_properties.library.value[0] != '\0') {
+    strcpy(buffer, g_properties.library.value);
     system_preferred_library = buffer;
   }
+  pthread_mutex_unlock(&g_properties.lock);
+#else
+  // Host is always treated as debuggable, which allows choice of library to be overridden, and
+  // does not use properties.
+  UNUSED(buffer);
+  bool debuggable = true;
+#endif
   return JniInvocationGetLibraryWith(library, debuggable, system_preferred_library);
 }
 
+static void* PreloadThreadMain(void* arg) {
+  struct JniInvocationPreloadState* preload = (struct JniInvocationPreloadState*) arg;
+  preload->library = DlOpenLibraryWithMode(preload->library_name, preload->mode);
+  return NULL;
+}
+
+bool JniInvocationPreload(const char* library, int flags) {
+#ifdef __ANDROID__
+  char buffer[PROP_VALUE_MAX];
+#else
+  char* buffer = NULL;
+#endif
+  const char* library_name = JniInvocationGetLibrary(library, buffer);
+  if (strlen(library_name) >= sizeof(g_preload.library_name)) {
+    return false;
+  }
+
+  pthread_mutex_lock(&g_preload.lock);
+  bool success = false;
+  if (!g_preload.started) {
+    strcpy(g_preload.library_name, library_name);
+    if ((flags & JNI_INVOCATION_PRELOAD_NO_LOAD) != 0) {
+      // Probing for a loaded library is cheap, so it is done on the calling thread.
+      g_preload.library = DlOpenLibraryWithMode(library_name, kDlOpenNoLoad);
+      success = g_preload.library != NULL;
+    } else {
+      g_preload.mode =
+          (flags & JNI_INVOCATION_PRELOAD_LAZY_BINDING) != 0 ? kDlOpenLazy : kDlOpenNow;
+      g_preload.has_thread =
+          pthread_create(&g_preload.thread, NULL, PreloadThreadMain, &g_preload) == 0;
+      success = g_preload.has_thread;
+    }
+    // A preload that did not start can be tried again, e.g. without NO_LOAD.
+    g_preload.started = success;
+  }
+  pthread_mutex_unlock(&g_preload.lock);
+  return success;
+}
+
+// Waits for any preload of |library_name| and returns its handle, or NULL if the library has not
+// been preloaded. The preloaded handle is handed out at most once.
+static DlLibrary TakePreloadedLibrary(const char* library_name) {
+  pthread_mutex_lock(&g_preload.lock);
+  if (g_preload.has_thread) {
+    pthread_join(g_preload.thread, NULL);
+    g_preload.has_thread = false;
+  }
+  DlLibrary library = g_preload.library;
+  g_preload.library = NULL;
+  bool matches = strcmp(g_preload.library_name, library_name) == 0;
+  pthread_mutex_unlock(&g_preload.lock);
+
+  if (library != NULL && !matches) {
+    ALOGW("Ignoring preloaded %s, %s was requested", g_preload.library_name, library_name);
+    DlCloseLibrary(library);
+    library = NULL;
+  }
+  return library;
+}
+
 struct JniInvocationImpl* JniInvocationCreate() {
   // Android only supports a single JniInvocation instance and only a single JavaVM.
   if (g_impl.jni_provider_library != NULL) {
@@ -144,13 +301,29 @@ struct JniInvocationImpl* JniInvocationCreate() {
 }
 
 bool JniInvocationInit(struct JniInvocationImpl* instance, const char* library_name) {
+  return JniInvocationInitWithFlags(instance, library_name, 0);
+}
+
+bool JniInvocationInitWithFlags(struct JniInvocationImpl* instance,
+                                const char* library_name,
+                                int flags) {
+  struct JniInvocationInitTimings timings = {0};
+  const int64_t start_ns = NowNanos();
 #ifdef __ANDROID__
   char buffer[PROP_VALUE_MAX];
 #else
   char* buffer = NULL;
 #endif
   library_name = JniInvocationGetLibrary(library_name, buffer);
-  DlLibrary library = DlOpenLibrary(library_name);
+  int64_t phase_start_ns = NowNanos();
+  timings.library_lookup_ns = phase_start_ns - start_ns;
+  DlLibrary library = TakePreloadedLibrary(library_name);
+  timings.preloaded = library != NULL;
+  if (library == NULL) {
+    library = DlOpenLibrary(library_name);
+  }
+  int64_t phase_end_ns = NowNanos();
+  timings.dlopen_ns = phase_end_ns - phase_start_ns;
   if (library == NULL) {
     if (strcmp(library_name, kDefaultJniInvocationLibrary) == 0) {
       // Nothing else to try.
@@ -165,13 +338,18 @@ bool JniInvocationInit(struct JniInvocationImpl* instance, const char* library_n
     ALOGW("Falling back from %s to %s after dlopen error: %s",
           library_name, kDefaultJniInvocationLibrary, DlGetError());
     library_name = kDefaultJniInvocationLibrary;
+    timings.fallback_taken = true;
+    phase_start_ns = phase_end_ns;
     library = DlOpenLibrary(library_name);
+    phase_end_ns = NowNanos();
+    timings.fallback_dlopen_ns = phase_end_ns - phase_start_ns;
     if (library == NULL) {
       ALOGE("Failed to dlopen %s: %s", library_name, DlGetError());
       return false;
     }
   }
 
+  phase_start_ns = phase_end_ns;
   DlSymbol JNI_GetDefaultJavaVMInitArgs_ = FindSymbol(library, "JNI_GetDefaultJavaVMInitArgs");
   if (JNI_GetDefaultJavaVMInitArgs_ == NULL) {
     return false;
@@ -186,13 +364,32 @@ bool JniInvocationInit(struct JniInvocationImpl* instance, const char* library_n
   if (JNI_GetCreatedJavaVMs_ == NULL) {
     return false;
   }
+  phase_end_ns = NowNanos();
+  timings.symbol_lookup_ns = phase_end_ns - phase_start_ns;
+  timings.total_ns = phase_end_ns - start_ns;
 
   instance->jni_provider_library_name = library_name;
   instance->jni_provider_library = library;
   instance->JNI_GetDefaultJavaVMInitArgs = (jint (*)(void *)) JNI_GetDefaultJavaVMInitArgs_;
   instance->JNI_CreateJavaVM = (jint (*)(JavaVM**, JNIEnv**, void*)) JNI_CreateJavaVM_;
   instance->JNI_GetCreatedJavaVMs = (jint (*)(JavaVM**, jsize, jsize*)) JNI_GetCreatedJavaVMs_;
+  instance->init_timings = timings;
+  instance->trace_jni = (flags & JNI_INVOCATION_INIT_TRACE_JNI) != 0;
+
+  ALOGV("Initialized %s in %lld ns (lookup %lld ns, dlopen %lld ns, fallback %lld ns, "
+        "symbols %lld ns)", library_name, (long long) timings.total_ns,
+        (long long) timings.library_lookup_ns, (long long) timings.dlopen_ns,
+        (long long) timings.fallback_dlopen_ns, (long long) timings.symbol_lookup_ns);
+
+  return true;
+}
 
+bool JniInvocationGetInitTimings(const struct JniInvocationImpl* instance,
+                                 struct JniInvocationInitTimings* timings) {
+  if (instance == NULL || instance->jni_provider_library == NULL) {
+    return false;
+  }
+  *timings = instance->init_timings;
   return true;
 }
 
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+#include "include_platform/nativehelper/JniProfiling.h"
+
+__BEGIN_DECLS
+
+// JNI_PROFILE(name) records a call to entry point |name| that lasts until the end of the
+// enclosing scope. It must be the first statement of the entry point. Without
+// LIBNATIVEHELPER_PROFILING it expands to nothing.
+#if defined(LIBNATIVEHELPER_PROFILING)
+
+struct JniProfilingScope {
+    enum JniProfilingEntryPoint entryPoint;
+    int64_t startNs;
+};
+
+struct JniProfilingScope JniProfiling_BeginScope(enum JniProfilingEntryPoint entryPoint);
+void JniProfiling_EndScope(const struct JniProfilingScope* scope);
+
+#define JNI_PROFILE(name)                                                      \
+    __attribute__((cleanup(JniProfiling_EndScope), unused))                   \
+    const struct JniProfilingScope jniProfilingScope_ =                        \
+            JniProfiling_BeginScope(kJniProfiling_ ## name)
+
+#else  // defined(LIBNATIVEHELPER_PROFILING)
+
+#define JNI_PROFILE(name) do {} while (0)
+
+#endif  // defined(LIBNATIVEHELPER_PROFILING)
+
+__END_DECLS
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JniProfiling-priv.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(LIBNATIVEHELPER_PROFILING)
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct EntryPointStats {
+    _Atomic(uint64_t) calls;
+    _Atomic(uint64_t) totalNs;
+    _Atomic(uint64_t) histogram[JNI_PROFILING_HISTOGRAM_BUCKETS];
+};
+
+// The same counters, as read by the last jniResetProfilingStats().
+struct EntryPointBaseline {
+    uint64_t calls;
+    uint64_t totalNs;
+    uint64_t histogram[JNI_PROFILING_HISTOGRAM_BUCKETS];
+};
+
+// The stats of one thread. A shard is only written by the thread that owns it, so counters are
+// updated with relaxed loads and stores rather than read-modify-writes, and threads do not
+// contend. That only holds if no other thread stores to them, so a reset does not clear the
+// counters but records their values in |baseline|, which is subtracted when they are read.
+// Shards are never freed: the shard of an exited thread is handed to the next new thread, which
+// keeps adding to it.
+struct Shard {
+    struct Shard* next;      // In gShards.
+    struct Shard* nextFree;  // In gFreeShards.
+    struct EntryPointStats stats[kJniProfiling_EntryPointCount];
+    // Guarded by gShardLock.
+    struct EntryPointBaseline baseline[kJniProfiling_EntryPointCount];
+};
+
+// Guards gShards and gFreeShards.
+static pthread_mutex_t gShardLock = PTHREAD_MUTEX_INITIALIZER;
+// All shards.
+static struct Shard* gShards;
+// Shards of exited threads.
+static struct Shard* gFreeShards;
+
+// Releases the shard of a thread when it exits.
+static pthread_key_t gShardKey;
+static pthread_once_t gShardKeyOnce = PTHREAD_ONCE_INIT;
+
+static _Thread_local struct Shard* tShard;
+
+static void ReleaseShard(void* value) {
+    struct Shard* shard = (struct Shard*) value;
+    pthread_mutex_lock(&gShardLock);
+    shard->nextFree = gFreeShards;
+    gFreeShards = shard;
+    pthread_mutex_unlock(&gShardLock);
+    // Calls made later in this thread's exit get a new shard.
+    tShard = NULL;
+}
+
+static void CreateShardKey() {
+    pthread_key_create(&gShardKey, ReleaseShard);
+}
+
+static __attribute__((noinline)) struct Shard* AcquireShard() {
+    pthread_once(&gShardKeyOnce, CreateShardKey);
+    pthread_mutex_lock(&gShardLock);
+    struct Shard* shard = gFreeShards;
+    if (shard != NULL) {
+        gFreeShards = shard->nextFree;
+    } else {
+        shard = (struct Shard*) calloc(1, sizeof(*shard));
+        if (shard != NULL) {
+            shard->next = gShards;
+            gShards = shard;
+        }
+    }
+    pthread_mutex_unlock(&gShardLock);
+    if (shard != NULL) {
+        pthread_setspecific(gShardKey, shard);
+        tShard = shard;
+    }
+    return shard;
+}
+
+static inline struct Shard* GetShard() {
+    struct Shard* shard = tShard;
+    if (__builtin_expect(shard == NULL, false)) {
+        shard = AcquireShard();
+    }
+    return shard;
+}
+
+static int64_t NowNanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static inline void Add(_Atomic(uint64_t)* counter, uint64_t value) {
+    uint64_t current = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, current + value, memory_order_relaxed);
+}
+
+static inline int HistogramBucket(uint64_t ns) {
+    if (ns < 2) {
+        return 0;
+    }
+    int log2 = 63 - __builtin_clzll(ns);
+    return log2 < JNI_PROFILING_HISTOGRAM_BUCKETS ? log2 : JNI_PROFILING_HISTOGRAM_BUCKETS - 1;
+}
+
+struct JniProfilingScope JniProfiling_BeginScope(enum JniProfilingEntryPoint entryPoint) {
+    struct JniProfilingScope scope = { entryPoint, NowNanos() };
+    return scope;
+}
+
+void JniProfiling_EndScope(const struct JniProfilingScope* scope) {
+    int64_t elapsed = NowNanos() - scope->startNs;
+    struct Shard* shard = GetShard();
+    if (shard == NULL) {
+        return;
+    }
+    uint64_t ns = elapsed > 0 ? (uint64_t) elapsed : 0;
+    struct EntryPointStats* stats = &shard->stats[scope->entryPoint];
+    Add(&stats->calls, 1);
+    Add(&stats->totalNs, ns);
+    Add(&stats->histogram[HistogramBucket(ns)], 1);
+}
+
+bool jniGetProfilingStats(enum JniProfilingEntryPoint entryPoint, struct JniProfilingStats* stats) {
+    if ((int) entryPoint < 0 || entryPoint >= kJniProfiling_EntryPointCount) {
+        return false;
+    }
+    struct JniProfilingStats result = {0};
+    pthread_mutex_lock(&gShardLock);
+    for (struct Shard* shard = gShards; shard != NULL; shard = shard->next) {
+        struct EntryPointStats* shardStats = &shard->stats[entryPoint];
+        const struct EntryPointBaseline* baseline = &shard->baseline[entryPoint];
+        result.calls +=
+                atomic_load_explicit(&shardStats->calls, memory_order_relaxed) - baseline->calls;
+        result.total_ns += atomic_load_explicit(&shardStats->totalNs, memory_order_relaxed) -
+                           baseline->totalNs;
+        for (int i = 0; i < JNI_PROFILING_HISTOGRAM_BUCKETS; ++i) {
+            result.histogram[i] +=
+                    atomic_load_explicit(&shardStats->histogram[i], memory_order_relaxed) -
+                    baseline->histogram[i];
+        }
+    }
+    pthread_mutex_unlock(&gShardLock);
+    *stats = result;
+    return true;
+}
+
+void jniResetProfilingStats() {
+    pthread_mutex_lock(&gShardLock);
+    for (struct Shard* shard = gShards; shard != NULL; shard = shard->next) {
+        for (int e = 0; e < kJniProfiling_EntryPointCount; ++e) {
+            struct EntryPointStats* stats = &shard->stats[e];
+            struct EntryPointBaseline* baseline = &shard->baseline[e];
+            baseline->calls = atomic_load_explicit(&stats->calls, memory_order_relaxed);
+            baseline->totalNs = atomic_load_explicit(&stats->totalNs, memory_order_relaxed);
+            for (int i = 0; i < JNI_PROFILING_HISTOGRAM_BUCKETS; ++i) {
+                baseline->histogram[i] =
+                        atomic_load_explicit(&stats->histogram[i], memory_order_relaxed);
+            }
+        }
+    }
+    pthread_mutex_unlock(&gShardLock);
+}
+
+#else  // defined(LIBNATIVEHELPER_PROFILING)
+
+bool jniGetProfilingStats(enum JniProfilingEntryPoint entryPoint, struct JniProfilingStats* stats) {
+    (void) entryPoint;
+    (void) stats;
+    return false;
+}
+
+void jniResetProfilingStats() {
+}
+
+#endif  // defined(LIBNATIVEHELPER_PROFILING)
@@ -0,0 +1,596 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include_platform/nativehelper/JniTracing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TAG "JniTracing"
+#include "ALog-priv.h"
+
+#include "JniTracing-priv.h"
+
+// Every JNINativeInterface function, in table order, with its parameter types after the env.
+// VARARGS functions are forwarded to the va_list variant of the same name with a V suffix.
+#define JNI_TRACING_FUNCTION_LIST(FUNCTION, VOID_FUNCTION, VARARGS, VOID_VARARGS)                 \
+    FUNCTION(GetVersion, jint, 0, ())                                                              \
+    FUNCTION(DefineClass, jclass, 4, (const char*, jobject, const jbyte*, jsize))                  \
+    FUNCTION(FindClass, jclass, 1, (const char*))                                                  \
+    FUNCTION(FromReflectedMethod, jmethodID, 1, (jobject))                                         \
+    FUNCTION(FromReflectedField, jfieldID, 1, (jobject))                                           \
+    FUNCTION(ToReflectedMethod, jobject, 3, (jclass, jmethodID, jboolean))                         \
+    FUNCTION(GetSuperclass, jclass, 1, (jclass))                                                   \
+    FUNCTION(IsAssignableFrom, jboolean, 2, (jclass, jclass))                                      \
+    FUNCTION(ToReflectedField, jobject, 3, (jclass, jfieldID, jboolean))                           \
+    FUNCTION(Throw, jint, 1, (jthrowable))                                                         \
+    FUNCTION(ThrowNew, jint, 2, (jclass, const char*))                                             \
+    FUNCTION(ExceptionOccurred, jthrowable, 0, ())                                                 \
+    VOID_FUNCTION(ExceptionDescribe, 0, ())                                                        \
+    VOID_FUNCTION(ExceptionClear, 0, ())                                                           \
+    VOID_FUNCTION(FatalError, 1, (const char*))                                                    \
+    FUNCTION(PushLocalFrame, jint, 1, (jint))                                                      \
+    FUNCTION(PopLocalFrame, jobject, 1, (jobject))                                                 \
+    FUNCTION(NewGlobalRef, jobject, 1, (jobject))                                                  \
+    VOID_FUNCTION(DeleteGlobalRef, 1, (jobject))                                                   \
+    VOID_FUNCTION(DeleteLocalRef, 1, (jobject))                                                    \
+    FUNCTION(IsSameObject, jboolean, 2, (jobject, jobject))                                        \
+    FUNCTION(NewLocalRef, jobject, 1, (jobject))                                                   \
+    FUNCTION(EnsureLocalCapacity, jint, 1, (jint))                                                 \
+    FUNCTION(AllocObject, jobject, 1, (jclass))                                                    \
+    VARARGS(NewObject, jobject, 2, (jclass, jmethodID))                                            \
+    FUNCTION(NewObjectV, jobject, 3, (jclass, jmethodID, va_list))                                 \
+    FUNCTION(NewObjectA, jobject, 3, (jclass, jmethodID, const jvalue*))                           \
+    FUNCTION(GetObjectClass, jclass, 1, (jobject))                                                 \
+    FUNCTION(IsInstanceOf, jboolean, 2, (jobject, jclass))                                         \
+    FUNCTION(GetMethodID, jmethodID, 3, (jclass, const char*, const char*))                        \
+    VARARGS(CallObjectMethod, jobject, 2, (jobject, jmethodID))                                    \
+    FUNCTION(CallObjectMethodV, jobject, 3, (jobject, jmethodID, va_list))                         \
+    FUNCTION(CallObjectMethodA, jobject, 3, (jobject, jmethodID, const jvalue*))                   \
+    VARARGS(CallBooleanMethod, jboolean, 2, (jobject, jmethodID))                                  \
+    FUNCTION(CallBooleanMethodV, jboolean, 3, (jobject, jmethodID, va_list))                       \
+    FUNCTION(CallBooleanMethodA, jboolean, 3, (jobject, jmethodID, const jvalue*))                 \
+    VARARGS(CallByteMethod, jbyte, 2, (jobject, jmethodID))                                        \
+    FUNCTION(CallByteMethodV, jbyte, 3, (jobject, jmethodID, va_list))                             \
+    FUNCTION(CallByteMethodA, jbyte, 3, (jobject, jmethodID, const jvalue*))                       \
+    VARARGS(CallCharMethod, jchar, 2, (jobject, jmethodID))                                        \
+    FUNCTION(CallCharMethodV, jchar, 3, (jobject, jmethodID, va_list))                             \
+    FUNCTION(CallCharMethodA, jchar, 3, (jobject, jmethodID, const jvalue*))                       \
+    VARARGS(CallShortMethod, jshort, 2, (jobject, jmethodID))                                      \
+    FUNCTION(CallShortMethodV, jshort, 3, (jobject, jmethodID, va_list))                           \
+    FUNCTION(CallShortMethodA, jshort, 3, (jobject, jmethodID, const jvalue*))                     \
+    VARARGS(CallIntMethod, jint, 2, (jobject, jmethodID))                                          \
+    FUNCTION(CallIntMethodV, jint, 3, (jobject, jmethodID, va_list))                               \
+    FUNCTION(CallIntMethodA, jint, 3, (jobject, jmethodID, const jvalue*))                         \
+    VARARGS(CallLongMethod, jlong, 2, (jobject, jmethodID))                                        \
+    FUNCTION(CallLongMethodV, jlong, 3, (jobject, jmethodID, va_list))                             \
+    FUNCTION(CallLongMethodA, jlong, 3, (jobject, jmethodID, const jvalue*))                       \
+    VARARGS(CallFloatMethod, jfloat, 2, (jobject, jmethodID))                                      \
+    FUNCTION(CallFloatMethodV, jfloat, 3, (jobject, jmethodID, va_list))                           \
+    FUNCTION(CallFloatMethodA, jfloat, 3, (jobject, jmethodID, const jvalue*))                     \
+    VARARGS(CallDoubleMethod, jdouble, 2, (jobject, jmethodID))                                    \
+    FUNCTION(CallDoubleMethodV, jdouble, 3, (jobject, jmethodID, va_list))                         \
+    FUNCTION(CallDoubleMethodA, jdouble, 3, (jobject, jmethodID, const jvalue*))                   \
+    VOID_VARARGS(CallVoidMethod, 2, (jobject, jmethodID))                                          \
+    VOID_FUNCTION(CallVoidMethodV, 3, (jobject, jmethodID, va_list))                               \
+    VOID_FUNCTION(CallVoidMethodA, 3, (jobject, jmethodID, const jvalue*))                         \
+    VARARGS(CallNonvirtualObjectMethod, jobject, 3, (jobject, jclass, jmethodID))                  \
+    FUNCTION(CallNonvirtualObjectMethodV, jobject, 4, (jobject, jclass, jmethodID, va_list))       \
+    FUNCTION(CallNonvirtualObjectMethodA, jobject, 4, (jobject, jclass, jmethodID, const jvalue*)) \
+    VARARGS(CallNonvirtualBooleanMethod, jboolean, 3, (jobject, jclass, jmethodID))                \
+    FUNCTION(CallNonvirtualBooleanMethodV, jboolean, 4, (jobject, jclass, jmethodID, va_list))     \
+    FUNCTION(CallNonvirtualBooleanMethodA, jboolean, 4,                                            \
+             (jobject, jclass, jmethodID, const jvalue*))                                          \
+    VARARGS(CallNonvirtualByteMethod, jbyte, 3, (jobject, jclass, jmethodID))                      \
+    FUNCTION(CallNonvirtualByteMethodV, jbyte, 4, (jobject, jclass, jmethodID, va_list))           \
+    FUNCTION(CallNonvirtualByteMethodA, jbyte, 4, (jobject, jclass, jmethodID, const jvalue*))     \
+    VARARGS(CallNonvirtualCharMethod, jchar, 3, (jobject, jclass, jmethodID))                      \
+    FUNCTION(CallNonvirtualCharMethodV, jchar, 4, (jobject, jclass, jmethodID, va_list))           \
+    FUNCTION(CallNonvirtualCharMethodA, jchar, 4, (jobject, jclass, jmethodID, const jvalue*))     \
+    VARARGS(CallNonvirtualShortMethod, jshort, 3, (jobject, jclass, jmethodID))                    \
+    FUNCTION(CallNonvirtualShortMethodV, jshort, 4, (jobject, jclass, jmethodID, va_list))         \
+    FUNCTION(CallNonvirtualShortMethodA, jshort, 4, (jobject, jclass, jmethodID, const jvalue*))   \
+    VARARGS(CallNonvirtualIntMethod, jint, 3, (jobject, jclass, jmethodID))                        \
+    FUNCTION(CallNonvirtualIntMethodV, jint, 4, (jobject, jclass, jmethodID, va_list))             \
+    FUNCTION(CallNonvirtualIntMethodA, jint, 4, (jobject, jclass, jmethodID, const jvalue*))       \
+    VARARGS(CallNonvirtualLongMethod, jlong, 3, (jobject, jclass, jmethodID))                      \
+    FUNCTION(CallNonvirtualLongMethodV, jlong, 4, (jobject, jclass, jmethodID, va_list))           \
+    FUNCTION(CallNonvirtualLongMethodA, jlong, 4, (jobject, jclass, jmethodID, const jvalue*))     \
+    VARARGS(CallNonvirtualFloatMethod, jfloat, 3, (jobject, jclass, jmethodID))                    \
+    FUNCTION(CallNonvirtualFloatMethodV, jfloat, 4, (jobject, jclass, jmethodID, va_list))         \
+    FUNCTION(CallNonvirtualFloatMethodA, jfloat, 4, (jobject, jclass, jmethodID, const jvalue*))   \
+    VARARGS(CallNonvirtualDoubleMethod, jdouble, 3, (jobject, jclass, jmethodID))                  \
+    FUNCTION(CallNonvirtualDoubleMethodV, jdouble, 4, (jobject, jclass, jmethodID, va_list))       \
+    FUNCTION(CallNonvirtualDoubleMethodA, jdouble, 4, (jobject, jclass, jmethodID, const jvalue*)) \
+    VOID_VARARGS(CallNonvirtualVoidMethod, 3, (jobject, jclass, jmethodID))                        \
+    VOID_FUNCTION(CallNonvirtualVoidMethodV, 4, (jobject, jclass, jmethodID, va_list))             \
+    VOID_FUNCTION(CallNonvirtualVoidMethodA, 4, (jobject, jclass, jmethodID, const jvalue*))       \
+    FUNCTION(GetFieldID, jfieldID, 3, (jclass, const char*, const char*))                          \
+    FUNCTION(GetObjectField, jobject, 2, (jobject, jfieldID))                                      \
+    FUNCTION(GetBooleanField, jboolean, 2, (jobject, jfieldID))                                    \
+    FUNCTION(GetByteField, jbyte, 2, (jobject, jfieldID))                                          \
+    FUNCTION(GetCharField, jchar, 2, (jobject, jfieldID))                                          \
+    FUNCTION(GetShortField, jshort, 2, (jobject, jfieldID))                                        \
+    FUNCTION(GetIntField, jint, 2, (jobject, jfieldID))                                            \
+    FUNCTION(GetLongField, jlong, 2, (jobject, jfieldID))                                          \
+    FUNCTION(GetFloatField, jfloat, 2, (jobject, jfieldID))                                        \
+    FUNCTION(GetDoubleField, jdouble, 2, (jobject, jfieldID))                                      \
+    VOID_FUNCTION(SetObjectField, 3, (jobject, jfieldID, jobject))                                 \
+    VOID_FUNCTION(SetBooleanField, 3, (jobject, jfieldID, jboolean))                               \
+    VOID_FUNCTION(SetByteField, 3, (jobject, jfieldID, jbyte))                                     \
+    VOID_FUNCTION(SetCharField, 3, (jobject, jfieldID, jchar))                                     \
+    VOID_FUNCTION(SetShortField, 3, (jobject, jfieldID, jshort))                                   \
+    VOID_FUNCTION(SetIntField, 3, (jobject, jfieldID, jint))                                       \
+    VOID_FUNCTION(SetLongField, 3, (jobject, jfieldID, jlong))                                     \
+    VOID_FUNCTION(SetFloatField, 3, (jobject, jfieldID, jfloat))                                   \
+    VOID_FUNCTION(SetDoubleField, 3, (jobject, jfieldID, jdouble))                                 \
+    FUNCTION(GetStaticMethodID, jmethodID, 3, (jclass, const char*, const char*))                  \
+    VARARGS(CallStaticObjectMethod, jobject, 2, (jclass, jmethodID))                               \
+    FUNCTION(CallStaticObjectMethodV, jobject, 3, (jclass, jmethodID, va_list))                    \
+    FUNCTION(CallStaticObjectMethodA, jobject, 3, (jclass, jmethodID, const jvalue*))              \
+    VARARGS(CallStaticBooleanMethod, jboolean, 2, (jclass, jmethodID))                             \
+    FUNCTION(CallStaticBooleanMethodV, jboolean, 3, (jclass, jmethodID, va_list))                  \
+    FUNCTION(CallStaticBooleanMethodA, jboolean, 3, (jclass, jmethodID, const jvalue*))            \
+    VARARGS(CallStaticByteMethod, jbyte, 2, (jclass, jmethodID))                                   \
+    FUNCTION(CallStaticByteMethodV, jbyte, 3, (jclass, jmethodID, va_list))                        \
+    FUNCTION(CallStaticByteMethodA, jbyte, 3, (jclass, jmethodID, const jvalue*))                  \
+    VARARGS(CallStaticCharMethod, jchar, 2, (jclass, jmethodID))                                   \
+    FUNCTION(CallStaticCharMethodV, jchar, 3, (jclass, jmethodID, va_list))                        \
+    FUNCTION(CallStaticCharMethodA, jchar, 3, (jclass, jmethodID, const jvalue*))                  \
+    VARARGS(CallStaticShortMethod, jshort, 2, (jclass, jmethodID))                                 \
+    FUNCTION(CallStaticShortMethodV, jshort, 3, (jclass, jmethodID, va_list))                      \
+    FUNCTION(CallStaticShortMethodA, jshort, 3, (jclass, jmethodID, const jvalue*))                \
+    VARARGS(CallStaticIntMethod, jint, 2, (jclass, jmethodID))                                     \
+    FUNCTION(CallStaticIntMethodV, jint, 3, (jclass, jmethodID, va_list))                          \
+    FUNCTION(CallStaticIntMethodA, jint, 3, (jclass, jmethodID, const jvalue*))                    \
+    VARARGS(CallStaticLongMethod, jlong, 2, (jclass, jmethodID))                                   \
+    FUNCTION(CallStaticLongMethodV, jlong, 3, (jclass, jmethodID, va_list))                        \
+    FUNCTION(CallStaticLongMethodA, jlong, 3, (jclass, jmethodID, const jvalue*))                  \
+    VARARGS(CallStaticFloatMethod, jfloat, 2, (jclass, jmethodID))                                 \
+    FUNCTION(CallStaticFloatMethodV, jfloat, 3, (jclass, jmethodID, va_list))                      \
+    FUNCTION(CallStaticFloatMethodA, jfloat, 3, (jclass, jmethodID, const jvalue*))                \
+    VARARGS(CallStaticDoubleMethod, jdouble, 2, (jclass, jmethodID))                               \
+    FUNCTION(CallStaticDoubleMethodV, jdouble, 3, (jclass, jmethodID, va_list))                    \
+    FUNCTION(CallStaticDoubleMethodA, jdouble, 3, (jclass, jmethodID, const jvalue*))              \
+    VOID_VARARGS(CallStaticVoidMethod, 2, (jclass, jmethodID))                                     \
+    VOID_FUNCTION(CallStaticVoidMethodV, 3, (jclass, jmethodID, va_list))                          \
+    VOID_FUNCTION(CallStaticVoidMethodA, 3, (jclass, jmethodID, const jvalue*))                    \
+    FUNCTION(GetStaticFieldID, jfieldID, 3, (jclass, const char*, const char*))                    \
+    FUNCTION(GetStaticObjectField, jobject, 2, (jclass, jfieldID))                                 \
+    FUNCTION(GetStaticBooleanField, jboolean, 2, (jclass, jfieldID))                               \
+    FUNCTION(GetStaticByteField, jbyte, 2, (jclass, jfieldID))                                     \
+    FUNCTION(GetStaticCharField, jchar, 2, (jclass, jfieldID))                                     \
+    FUNCTION(GetStaticShortField, jshort, 2, (jclass, jfieldID))                                   \
+    FUNCTION(GetStaticIntField, jint, 2, (jclass, jfieldID))                                       \
+    FUNCTION(GetStaticLongField, jlong, 2, (jclass, jfieldID))                                     \
+    FUNCTION(GetStaticFloatField, jfloat, 2, (jclass, jfieldID))                                   \
+    FUNCTION(GetStaticDoubleField, jdouble, 2, (jclass, jfieldID))                                 \
+    VOID_FUNCTION(SetStaticObjectField, 3, (jclass, jfieldID, jobject))                            \
+    VOID_FUNCTION(SetStaticBooleanField, 3, (jclass, jfieldID, jboolean))                          \
+    VOID_FUNCTION(SetStaticByteField, 3, (jclass, jfieldID, jbyte))                                \
+    VOID_FUNCTION(SetStaticCharField, 3, (jclass, jfieldID, jchar))                                \
+    VOID_FUNCTION(SetStaticShortField, 3, (jclass, jfieldID, jshort))                              \
+    VOID_FUNCTION(SetStaticIntField, 3, (jclass, jfieldID, jint))                                  \
+    VOID_FUNCTION(SetStaticLongField, 3, (jclass, jfieldID, jlong))                                \
+    VOID_FUNCTION(SetStaticFloatField, 3, (jclass, jfieldID, jfloat))                              \
+    VOID_FUNCTION(SetStaticDoubleField, 3, (jclass, jfieldID, jdouble))                            \
+    FUNCTION(NewString, jstring, 2, (const jchar*, jsize))                                         \
+    FUNCTION(GetStringLength, jsize, 1, (jstring))                                                 \
+    FUNCTION(GetStringChars, const jchar*, 2, (jstring, jboolean*))                                \
+    VOID_FUNCTION(ReleaseStringChars, 2, (jstring, const jchar*))                                  \
+    FUNCTION(NewStringUTF, jstring, 1, (const char*))                                              \
+    FUNCTION(GetStringUTFLength, jsize, 1, (jstring))                                              \
+    FUNCTION(GetStringUTFChars, const char*, 2, (jstring, jboolean*))                              \
+    VOID_FUNCTION(ReleaseStringUTFChars, 2, (jstring, const char*))                                \
+    FUNCTION(GetArrayLength, jsize, 1, (jarray))                                                   \
+    FUNCTION(NewObjectArray, jobjectArray, 3, (jsize, jclass, jobject))                            \
+    FUNCTION(GetObjectArrayElement, jobject, 2, (jobjectArray, jsize))                             \
+    VOID_FUNCTION(SetObjectArrayElement, 3, (jobjectArray, jsize, jobject))                        \
+    FUNCTION(NewBooleanArray, jbooleanArray, 1, (jsize))                                           \
+    FUNCTION(NewByteArray, jbyteArray, 1, (jsize))                                                 \
+    FUNCTION(NewCharArray, jcharArray, 1, (jsize))                                                 \
+    FUNCTION(NewShortArray, jshortArray, 1, (jsize))                                               \
+    FUNCTION(NewIntArray, jintArray, 1, (jsize))                                                   \
+    FUNCTION(NewLongArray, jlongArray, 1, (jsize))                                                 \
+    FUNCTION(NewFloatArray, jfloatArray, 1, (jsize))                                               \
+    FUNCTION(NewDoubleArray, jdoubleArray, 1, (jsize))                                             \
+    FUNCTION(GetBooleanArrayElements, jboolean*, 2, (jbooleanArray, jboolean*))                    \
+    FUNCTION(GetByteArrayElements, jbyte*, 2, (jbyteArray, jboolean*))                             \
+    FUNCTION(GetCharArrayElements, jchar*, 2, (jcharArray, jboolean*))                             \
+    FUNCTION(GetShortArrayElements, jshort*, 2, (jshortArray, jboolean*))                          \
+    FUNCTION(GetIntArrayElements, jint*, 2, (jintArray, jboolean*))                                \
+    FUNCTION(GetLongArrayElements, jlong*, 2, (jlongArray, jboolean*))                             \
+    FUNCTION(GetFloatArrayElements, jfloat*, 2, (jfloatArray, jboolean*))                          \
+    FUNCTION(GetDoubleArrayElements, jdouble*, 2, (jdoubleArray, jboolean*))                       \
+    VOID_FUNCTION(ReleaseBooleanArrayElements, 3, (jbooleanArray, jboolean*, jint))                \
+    VOID_FUNCTION(ReleaseByteArrayElements, 3, (jbyteArray, jbyte*, jint))                         \
+    VOID_FUNCTION(ReleaseCharArrayElements, 3, (jcharArray, jchar*, jint))                         \
+    VOID_FUNCTION(ReleaseShortArrayElements, 3, (jshortArray, jshort*, jint))                      \
+    VOID_FUNCTION(ReleaseIntArrayElements, 3, (jintArray, jint*, jint))                            \
+    VOID_FUNCTION(ReleaseLongArrayElements, 3, (jlongArray, jlong*, jint))                         \
+    VOID_FUNCTION(ReleaseFloatArrayElements, 3, (jfloatArray, jfloat*, jint))                      \
+    VOID_FUNCTION(ReleaseDoubleArrayElements, 3, (jdoubleArray, jdouble*, jint))                   \
+    VOID_FUNCTION(GetBooleanArrayRegion, 4, (jbooleanArray, jsize, jsize, jboolean*))              \
+    VOID_FUNCTION(GetByteArrayRegion, 4, (jbyteArray, jsize, jsize, jbyte*))                       \
+    VOID_FUNCTION(GetCharArrayRegion, 4, (jcharArray, jsize, jsize, jchar*))                       \
+    VOID_FUNCTION(GetShortArrayRegion, 4, (jshortArray, jsize, jsize, jshort*))                    \
+    VOID_FUNCTION(GetIntArrayRegion, 4, (jintArray, jsize, jsize, jint*))                          \
+    VOID_FUNCTION(GetLongArrayRegion, 4, (jlongArray, jsize, jsize, jlong*))                       \
+    VOID_FUNCTION(GetFloatArrayRegion, 4, (jfloatArray, jsize, jsize, jfloat*))                    \
+    VOID_FUNCTION(GetDoubleArrayRegion, 4, (jdoubleArray, jsize, jsize, jdouble*))                 \
+    VOID_FUNCTION(SetBooleanArrayRegion, 4, (jbooleanArray, jsize, jsize, const jboolean*))        \
+    VOID_FUNCTION(SetByteArrayRegion, 4, (jbyteArray, jsize, jsize, const jbyte*))                 \
+    VOID_FUNCTION(SetCharArrayRegion, 4, (jcharArray, jsize, jsize, const jchar*))                 \
+    VOID_FUNCTION(SetShortArrayRegion, 4, (jshortArray, jsize, jsize, const jshort*))              \
+    VOID_FUNCTION(SetIntArrayRegion, 4, (jintArray, jsize, jsize, const jint*))                    \
+    VOID_FUNCTION(SetLongArrayRegion, 4, (jlongArray, jsize, jsize, const jlong*))                 \
+    VOID_FUNCTION(SetFloatArrayRegion, 4, (jfloatArray, jsize, jsize, const jfloat*))              \
+    VOID_FUNCTION(SetDoubleArrayRegion, 4, (jdoubleArray, jsize, jsize, const jdouble*))           \
+    FUNCTION(RegisterNatives, jint, 3, (jclass, const JNINativeMethod*, jint))                     \
+    FUNCTION(UnregisterNatives, jint, 1, (jclass))                                                 \
+    FUNCTION(MonitorEnter, jint, 1, (jobject))                                                     \
+    FUNCTION(MonitorExit, jint, 1, (jobject))                                                      \
+    FUNCTION(GetJavaVM, jint, 1, (JavaVM**))                                                       \
+    VOID_FUNCTION(GetStringRegion, 4, (jstring, jsize, jsize, jchar*))                             \
+    VOID_FUNCTION(GetStringUTFRegion, 4, (jstring, jsize, jsize, char*))                           \
+    FUNCTION(GetPrimitiveArrayCritical, void*, 2, (jarray, jboolean*))                             \
+    VOID_FUNCTION(ReleasePrimitiveArrayCritical, 3, (jarray, void*, jint))                         \
+    FUNCTION(GetStringCritical, const jchar*, 2, (jstring, jboolean*))                             \
+    VOID_FUNCTION(ReleaseStringCritical, 2, (jstring, const jchar*))                               \
+    FUNCTION(NewWeakGlobalRef, jweak, 1, (jobject))                                                \
+    VOID_FUNCTION(DeleteWeakGlobalRef, 1, (jweak))                                                 \
+    FUNCTION(ExceptionCheck, jboolean, 0, ())                                                      \
+    FUNCTION(NewDirectByteBuffer, jobject, 2, (void*, jlong))                                      \
+    FUNCTION(GetDirectBufferAddress, void*, 1, (jobject))                                          \
+    FUNCTION(GetDirectBufferCapacity, jlong, 1, (jobject))                                         \
+    FUNCTION(GetObjectRefType, jobjectRefType, 1, (jobject))
+
+enum TracedFunction {
+#define TRACED_FUNCTION_ENUM(name, ...) kTraced_ ## name,
+    JNI_TRACING_FUNCTION_LIST(TRACED_FUNCTION_ENUM, TRACED_FUNCTION_ENUM, TRACED_FUNCTION_ENUM,
+                              TRACED_FUNCTION_ENUM)
+#undef TRACED_FUNCTION_ENUM
+    kTracedFunctionCount
+};
+
+static const char* const kTracedFunctionNames[] = {
+#define TRACED_FUNCTION_NAME(name, ...) #name,
+    JNI_TRACING_FUNCTION_LIST(TRACED_FUNCTION_NAME, TRACED_FUNCTION_NAME, TRACED_FUNCTION_NAME,
+                              TRACED_FUNCTION_NAME)
+#undef TRACED_FUNCTION_NAME
+};
+
+// The functions traced with an atrace section. Sections cost a write to the trace marker, so
+// they are kept to functions that usually take microseconds.
+static const enum TracedFunction kSectionFunctions[] = {
+    kTraced_DefineClass,
+    kTraced_FindClass,
+    kTraced_GetMethodID,
+    kTraced_GetFieldID,
+    kTraced_GetStaticMethodID,
+    kTraced_GetStaticFieldID,
+    kTraced_GetStringChars,
+    kTraced_GetStringUTFChars,
+    kTraced_GetBooleanArrayElements,
+    kTraced_GetByteArrayElements,
+    kTraced_GetCharArrayElements,
+    kTraced_GetShortArrayElements,
+    kTraced_GetIntArrayElements,
+    kTraced_GetLongArrayElements,
+    kTraced_GetFloatArrayElements,
+    kTraced_GetDoubleArrayElements,
+    kTraced_RegisterNatives,
+    kTraced_MonitorEnter,
+    kTraced_GetPrimitiveArrayCritical,
+    kTraced_GetStringCritical,
+};
+
+struct FunctionStats {
+    _Atomic(uint64_t) calls;
+    _Atomic(uint64_t) sampledCalls;
+    _Atomic(uint64_t) sampledNs;
+};
+
+static struct FunctionStats gStats[kTracedFunctionCount];
+
+// Guards everything below.
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+// The table of the traced envs, which the tracing table forwards to. It may only change when
+// no env is traced.
+static const struct JNINativeInterface* gOriginal;
+static size_t gTracedEnvs;
+static struct JNINativeInterface gTracingTable;
+static bool gSections[kTracedFunctionCount];
+// The JavaVM interface wrapped by JniTracing_InstallOnJavaVM(), and its replacement.
+static const struct JNIInvokeInterface* gOriginalInvoke;
+static struct JNIInvokeInterface gTracingInvoke;
+
+// The kernel trace marker atrace sections are written to, or -1 if it cannot be opened. The pid
+// in each marker comes from getpid() rather than a copy, which a forked child would inherit.
+static pthread_once_t gTraceMarkerOnce = PTHREAD_ONCE_INIT;
+static int gTraceMarkerFd = -1;
+
+// Calls left on this thread before the next one whose latency is measured, and the state of the
+// generator of the gaps between measured calls.
+static _Thread_local uint32_t tCallsUntilSample;
+static _Thread_local uint32_t tSampleGapState;
+
+// Returns the number of calls to skip before the next measured one. The gaps are random, with a
+// mean of JNI_TRACING_SAMPLE_PERIOD - 1, so that sampling does not lock onto calls that repeat
+// in a fixed pattern, like the GetIntField that always follows an IsInstanceOf.
+static uint32_t NextSampleGap() {
+    uint32_t x = tSampleGapState;
+    if (x == 0) {
+        x = (uint32_t) (uintptr_t) &tSampleGapState | 1;
+    }
+    // xorshift32.
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    tSampleGapState = x;
+    return x % (2 * JNI_TRACING_SAMPLE_PERIOD - 1);
+}
+
+static void OpenTraceMarker() {
+    static const char* const kPaths[] = {
+        "/sys/kernel/tracing/trace_marker",
+        "/sys/kernel/debug/tracing/trace_marker",
+    };
+    for (size_t i = 0; i < sizeof(kPaths) / sizeof(kPaths[0]) && gTraceMarkerFd == -1; ++i) {
+        gTraceMarkerFd = open(kPaths[i], O_WRONLY | O_CLOEXEC);
+    }
+}
+
+static void WriteTraceMarker(const char* marker, int length) {
+    if (length <= 0) {
+        return;
+    }
+    while (write(gTraceMarkerFd, marker, (size_t) length) == -1 && errno == EINTR) {
+    }
+}
+
+static int64_t NowNanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+struct TracedCall {
+    enum TracedFunction function;
+    // Zero unless the latency of the call is measured.
+    int64_t startNs;
+    bool section;
+};
+
+static inline struct TracedCall BeginCall(enum TracedFunction function) {
+    struct TracedCall call = { function, 0, false };
+    atomic_fetch_add_explicit(&gStats[function].calls, 1, memory_order_relaxed);
+    if (gSections[function] && gTraceMarkerFd != -1) {
+        char marker[64];
+        WriteTraceMarker(marker, snprintf(marker, sizeof(marker), "B|%d|JNI %s", getpid(),
+                                          kTracedFunctionNames[function]));
+        call.section = true;
+    }
+    if (tCallsUntilSample == 0) {
+        tCallsUntilSample = NextSampleGap();
+        call.startNs = NowNanos();
+    } else {
+        --tCallsUntilSample;
+    }
+    return call;
+}
+
+static inline void EndCall(const struct TracedCall* call) {
+    if (call->startNs != 0) {
+        int64_t elapsed = NowNanos() - call->startNs;
+        struct FunctionStats* stats = &gStats[call->function];
+        atomic_fetch_add_explicit(&stats->sampledCalls, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats->sampledNs, elapsed > 0 ? (uint64_t) elapsed : 0,
+                                  memory_order_relaxed);
+    }
+    if (call->section) {
+        char marker[32];
+        WriteTraceMarker(marker, snprintf(marker, sizeof(marker), "E|%d", getpid()));
+    }
+}
+
+// TRACE_CALL(name) records a call to the JNI function |name| that lasts until the end of the
+// enclosing scope, including the evaluation of a returned value.
+#define TRACE_CALL(name)                                                       \
+    __attribute__((cleanup(EndCall), unused))                                 \
+    const struct TracedCall tracedCall_ = BeginCall(kTraced_ ## name)
+
+#define PARAMS_0() JNIEnv* env
+#define PARAMS_1(T0) JNIEnv* env, T0 a0
+#define PARAMS_2(T0, T1) JNIEnv* env, T0 a0, T1 a1
+#define PARAMS_3(T0, T1, T2) JNIEnv* env, T0 a0, T1 a1, T2 a2
+#define PARAMS_4(T0, T1, T2, T3) JNIEnv* env, T0 a0, T1 a1, T2 a2, T3 a3
+#define ARGS_0 env
+#define ARGS_1 env, a0
+#define ARGS_2 env, a0, a1
+#define ARGS_3 env, a0, a1, a2
+#define ARGS_4 env, a0, a1, a2, a3
+#define LAST_ARG_2 a1
+#define LAST_ARG_3 a2
+
+#define DEFINE_FUNCTION(name, R, n, types)                                     \
+    static R Trace_ ## name(PARAMS_ ## n types) {                              \
+        TRACE_CALL(name);                                                      \
+        return gOriginal->name(ARGS_ ## n);                                    \
+    }
+#define DEFINE_VOID_FUNCTION(name, n, types)                                   \
+    static void Trace_ ## name(PARAMS_ ## n types) {                           \
+        TRACE_CALL(name);                                                      \
+        gOriginal->name(ARGS_ ## n);                                           \
+    }
+#define DEFINE_VARARGS(name, R, n, types)                                      \
+    static R Trace_ ## name(PARAMS_ ## n types, ...) {                         \
+        TRACE_CALL(name);                                                      \
+        va_list args;                                                          \
+        va_start(args, LAST_ARG_ ## n);                                        \
+        R result = gOriginal->name ## V(ARGS_ ## n, args);                     \
+        va_end(args);                                                          \
+        return result;                                                         \
+    }
+#define DEFINE_VOID_VARARGS(name, n, types)                                    \
+    static void Trace_ ## name(PARAMS_ ## n types, ...) {                      \
+        TRACE_CALL(name);                                                      \
+        va_list args;                                                          \
+        va_start(args, LAST_ARG_ ## n);                                        \
+        gOriginal->name ## V(ARGS_ ## n, args);                                \
+        va_end(args);                                                          \
+    }
+
+JNI_TRACING_FUNCTION_LIST(DEFINE_FUNCTION, DEFINE_VOID_FUNCTION, DEFINE_VARARGS,
+                          DEFINE_VOID_VARARGS)
+
+#undef DEFINE_FUNCTION
+#undef DEFINE_VOID_FUNCTION
+#undef DEFINE_VARARGS
+#undef DEFINE_VOID_VARARGS
+
+// Makes the tracing table forward to |original|. Called with gLock held.
+static void InitializeTracingTable(const struct JNINativeInterface* original) {
+    pthread_once(&gTraceMarkerOnce, OpenTraceMarker);
+    gOriginal = original;
+    // Copies the reserved slots, which the runtime may use.
+    gTracingTable = *original;
+#define INSTALL_THUNK(name, ...) gTracingTable.name = Trace_ ## name;
+    JNI_TRACING_FUNCTION_LIST(INSTALL_THUNK, INSTALL_THUNK, INSTALL_THUNK, INSTALL_THUNK)
+#undef INSTALL_THUNK
+    for (size_t i = 0; i < sizeof(kSectionFunctions) / sizeof(kSectionFunctions[0]); ++i) {
+        gSections[kSectionFunctions[i]] = true;
+    }
+}
+
+bool jniTraceJniEnv(C_JNIEnv* env) {
+    if (*env == &gTracingTable) {
+        return true;
+    }
+    pthread_mutex_lock(&gLock);
+    if (gTracedEnvs == 0 && gOriginal != *env) {
+        InitializeTracingTable(*env);
+    }
+    const bool traced = *env == gOriginal;
+    if (traced) {
+        *env = &gTracingTable;
+        ++gTracedEnvs;
+    }
+    pthread_mutex_unlock(&gLock);
+    if (!traced) {
+        ALOGW("Not tracing env %p, its function table differs from the traced envs", env);
+    }
+    return traced;
+}
+
+void jniUntraceJniEnv(C_JNIEnv* env) {
+    pthread_mutex_lock(&gLock);
+    if (*env == &gTracingTable) {
+        *env = gOriginal;
+        --gTracedEnvs;
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+bool jniGetTracingStats(const char* function, struct JniTracingStats* stats) {
+    for (size_t i = 0; i < kTracedFunctionCount; ++i) {
+        if (strcmp(kTracedFunctionNames[i], function) == 0) {
+            stats->calls = atomic_load_explicit(&gStats[i].calls, memory_order_relaxed);
+            stats->sampled_calls =
+                    atomic_load_explicit(&gStats[i].sampledCalls, memory_order_relaxed);
+            stats->sampled_ns = atomic_load_explicit(&gStats[i].sampledNs, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void jniResetTracingStats() {
+    for (size_t i = 0; i < kTracedFunctionCount; ++i) {
+        atomic_store_explicit(&gStats[i].calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&gStats[i].sampledCalls, 0, memory_order_relaxed);
+        atomic_store_explicit(&gStats[i].sampledNs, 0, memory_order_relaxed);
+    }
+}
+
+void jniLogTracingStats(int priority, const char* tag) {
+    for (size_t i = 0; i < kTracedFunctionCount; ++i) {
+        uint64_t calls = atomic_load_explicit(&gStats[i].calls, memory_order_relaxed);
+        if (calls == 0) {
+            continue;
+        }
+        uint64_t sampledCalls = atomic_load_explicit(&gStats[i].sampledCalls, memory_order_relaxed);
+        uint64_t sampledNs = atomic_load_explicit(&gStats[i].sampledNs, memory_order_relaxed);
+        __android_log_print(priority, tag, "%s: %" PRIu64 " calls, %" PRIu64 " ns mean of %" PRIu64
+                            " sampled", kTracedFunctionNames[i], calls,
+                            sampledCalls != 0 ? sampledNs / sampledCalls : 0, sampledCalls);
+    }
+}
+
+//
+// JavaVM interposition.
+//
+
+// Only the JNI versions of GetEnv return a JNIEnv, others return agent interfaces like JVMTI.
+static bool IsJniVersion(jint version) {
+    return (version & 0xffff0000) == 0x00010000;
+}
+
+static jint TraceGetEnv(JavaVM* vm, void** env, jint version) {
+    jint result = gOriginalInvoke->GetEnv(vm, env, version);
+    if (result == JNI_OK && IsJniVersion(version)) {
+        jniTraceJniEnv((C_JNIEnv*) *env);
+    }
+    return result;
+}
+
+static jint TraceAttachCurrentThread(JavaVM* vm, JNIEnv** env, void* args) {
+    jint result = gOriginalInvoke->AttachCurrentThread(vm, env, args);
+    if (result == JNI_OK) {
+        jniTraceJniEnv(*env);
+    }
+    return result;
+}
+
+static jint TraceAttachCurrentThreadAsDaemon(JavaVM* vm, JNIEnv** env, void* args) {
+    jint result = gOriginalInvoke->AttachCurrentThreadAsDaemon(vm, env, args);
+    if (result == JNI_OK) {
+        jniTraceJniEnv(*env);
+    }
+    return result;
+}
+
+void JniTracing_InstallOnJavaVM(JavaVM* vm, JNIEnv* env) {
+    pthread_mutex_lock(&gLock);
+    if (*vm != &gTracingInvoke) {
+        gOriginalInvoke = *vm;
+        gTracingInvoke = **vm;
+        gTracingInvoke.GetEnv = TraceGetEnv;
+        gTracingInvoke.AttachCurrentThread = TraceAttachCurrentThread;
+        gTracingInvoke.AttachCurrentThreadAsDaemon = TraceAttachCurrentThreadAsDaemon;
+        *vm = &gTracingInvoke;
+    }
+    pthread_mutex_unlock(&gLock);
+    jniTraceJniEnv(env);
+}
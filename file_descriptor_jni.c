@@ -16,6 +16,7 @@
 
 #include <android/file_descriptor_jni.h>
 
+#include <stdbool.h>
 #include <stddef.h>
 
 #define LOG_TAG "file_descriptor_jni"
@@ -45,3 +46,102 @@ JNIEXPORT void AFileDescriptor_setFd(JNIEnv* env, jobject fileDescriptor, int fd
     EnsureArgumentIsFileDescriptor(env, fileDescriptor);
     (*env)->SetIntField(env, fileDescriptor, JniConstants_FileDescriptor_descriptor(env), fd);
 }
+
+// The unchecked accessors skip the IsInstanceOf call, halving the number of JNI transitions.
+// When CheckJNI is enabled the runtime still validates that the field belongs to the object's
+// class, and debug builds of libnativehelper keep the full check.
+static void EnsureArgumentIsNotNull(JNIEnv* env, jobject instance) {
+#ifndef NDEBUG
+    EnsureArgumentIsFileDescriptor(env, instance);
+#else
+    (void) env;
+    ALOG_ALWAYS_FATAL_IF(instance == NULL, "FileDescriptor is NULL");
+#endif
+}
+
+JNIEXPORT int AFileDescriptor_getFdUnchecked(JNIEnv* env, jobject fileDescriptor) {
+    EnsureArgumentIsNotNull(env, fileDescriptor);
+    return (*env)->GetIntField(env, fileDescriptor, JniConstants_FileDescriptor_descriptor(env));
+}
+
+JNIEXPORT void AFileDescriptor_setFdUnchecked(JNIEnv* env, jobject fileDescriptor, int fd) {
+    EnsureArgumentIsNotNull(env, fileDescriptor);
+    (*env)->SetIntField(env, fileDescriptor, JniConstants_FileDescriptor_descriptor(env), fd);
+}
+
+// Returns true if every element of |fileDescriptors| is known to be a java.io.FileDescriptor or
+// null, because the array is a FileDescriptor[]. Other arrays have their elements checked
+// individually.
+static bool IsFileDescriptorArray(JNIEnv* env, jobjectArray fileDescriptors) {
+    ALOG_ALWAYS_FATAL_IF(fileDescriptors == NULL, "FileDescriptor array is NULL");
+    return (*env)->IsInstanceOf(env, fileDescriptors, JniConstants_FileDescriptorArrayClass(env));
+}
+
+static void EnsureArrayHoldsCount(JNIEnv* env, jobjectArray fileDescriptors, size_t count) {
+    jsize length = (*env)->GetArrayLength(env, fileDescriptors);
+    ALOG_ALWAYS_FATAL_IF(count > (size_t) length,
+                         "Count %zu exceeds FileDescriptor array length %d", count, length);
+}
+
+JNIEXPORT void AFileDescriptor_getFds(JNIEnv* env,
+                                      jobjectArray fileDescriptors,
+                                      int* fds,
+                                      size_t count) {
+    bool checked = IsFileDescriptorArray(env, fileDescriptors);
+    EnsureArrayHoldsCount(env, fileDescriptors, count);
+    jfieldID descriptor = JniConstants_FileDescriptor_descriptor(env);
+    for (size_t i = 0; i < count; ++i) {
+        jobject fileDescriptor = (*env)->GetObjectArrayElement(env, fileDescriptors, (jsize) i);
+        if (fileDescriptor == NULL) {
+            fds[i] = -1;
+            continue;
+        }
+        if (!checked) {
+            EnsureArgumentIsFileDescriptor(env, fileDescriptor);
+        }
+        fds[i] = (*env)->GetIntField(env, fileDescriptor, descriptor);
+        (*env)->DeleteLocalRef(env, fileDescriptor);
+    }
+}
+
+JNIEXPORT void AFileDescriptor_setFds(JNIEnv* env,
+                                      jobjectArray fileDescriptors,
+                                      const int* fds,
+                                      size_t count) {
+    bool checked = IsFileDescriptorArray(env, fileDescriptors);
+    EnsureArrayHoldsCount(env, fileDescriptors, count);
+    jfieldID descriptor = JniConstants_FileDescriptor_descriptor(env);
+    for (size_t i = 0; i < count; ++i) {
+        jobject fileDescriptor = (*env)->GetObjectArrayElement(env, fileDescriptors, (jsize) i);
+        if (checked) {
+            ALOG_ALWAYS_FATAL_IF(fileDescriptor == NULL, "FileDescriptor is NULL");
+        } else {
+            EnsureArgumentIsFileDescriptor(env, fileDescriptor);
+        }
+        (*env)->SetIntField(env, fileDescriptor, descriptor, fds[i]);
+        (*env)->DeleteLocalRef(env, fileDescriptor);
+    }
+}
+
+JNIEXPORT _Nullable jobjectArray AFileDescriptor_createArray(JNIEnv* env,
+                                                            const int* fds,
+                                                            size_t count) {
+    jclass fileDescriptorClass = JniConstants_FileDescriptorClass(env);
+    jmethodID init = JniConstants_FileDescriptor_init(env);
+    jfieldID descriptor = JniConstants_FileDescriptor_descriptor(env);
+    jobjectArray result = (*env)->NewObjectArray(env, (jsize) count, fileDescriptorClass, NULL);
+    if (result == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        jobject fileDescriptor = (*env)->NewObject(env, fileDescriptorClass, init);
+        if (fileDescriptor == NULL) {
+            (*env)->DeleteLocalRef(env, result);
+            return NULL;
+        }
+        (*env)->SetIntField(env, fileDescriptor, descriptor, fds[i]);
+        (*env)->SetObjectArrayElement(env, result, (jsize) i, fileDescriptor);
+        (*env)->DeleteLocalRef(env, fileDescriptor);
+    }
+    return result;
+}
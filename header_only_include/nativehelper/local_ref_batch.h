@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <jni.h>
+
+#include "nativehelper_utils.h"
+#include "scoped_local_ref.h"
+
+// A LocalRefBatch collects local references and deletes them together with a single
+// PopLocalFrame, instead of one DeleteLocalRef per reference. It pushes a local frame with room
+// for |capacity| references when constructed, and every local reference created while the batch
+// is alive belongs to it:
+//
+//   LocalRefBatch batch(env, 64);
+//   for (jsize i = 0; batch.isValid() && i < length; ++i) {
+//     jobject element = batch.add(env->GetObjectArrayElement(array, i));
+//     ...
+//     if (batch.size() == batch.capacity()) {
+//       batch.clear();
+//     }
+//   }
+//
+// References owned by a ScopedLocalRef can be handed over with add(std::move(ref)) or
+// add(ref.release()), and a single reference can be kept beyond the batch with escape().
+class LocalRefBatch {
+public:
+    LocalRefBatch(JNIEnv* env, jint capacity)
+        : mEnv(env), mCapacity(capacity > 0 ? capacity : 1), mSize(0),
+          mPushed(mEnv->PushLocalFrame(mCapacity) == JNI_OK) {
+    }
+
+    LocalRefBatch(LocalRefBatch&& rhs) noexcept
+        : mEnv(rhs.mEnv), mCapacity(rhs.mCapacity), mSize(rhs.mSize), mPushed(rhs.mPushed) {
+        rhs.mSize = 0;
+        rhs.mPushed = false;
+    }
+
+    // Frames can only be popped innermost first, and the frames of two batches may have been
+    // pushed in either order, so a batch cannot take over another's frame by assignment.
+    LocalRefBatch& operator=(LocalRefBatch&& rhs) = delete;
+
+    ~LocalRefBatch() {
+        pop(nullptr);
+    }
+
+    // Records that |localRef| belongs to the batch and returns it. The reference must have been
+    // created while the batch was alive.
+    template <typename T>
+    T add(T localRef) {
+        if (localRef != nullptr) {
+            ++mSize;
+        }
+        return localRef;
+    }
+
+    template <typename T>
+    T add(ScopedLocalRef<T>&& localRef) {
+        return add(localRef.release());
+    }
+
+    // Deletes every reference in the batch with one PopLocalFrame and starts a new batch. Returns
+    // false if the new frame could not be pushed, in which case an OutOfMemoryError is pending.
+    bool clear() {
+        pop(nullptr);
+        return push();
+    }
+
+    // Deletes every reference in the batch except |localRef|, which is moved to the enclosing
+    // frame and returned, then starts a new batch. The returned reference is no longer part of any
+    // batch and must be deleted by the caller, for example with a ScopedLocalRef. If the new batch
+    // frame could not be pushed, the returned reference is still valid but isValid() returns false
+    // and an OutOfMemoryError is pending.
+    template <typename T>
+    T escape(T localRef) {
+        if (!mPushed) {
+            // Without a frame, |localRef| already belongs to the enclosing frame.
+            return localRef;
+        }
+        T result = static_cast<T>(pop(localRef));
+        push();
+        return result;
+    }
+
+    // Number of references added since the batch was last cleared.
+    size_t size() const {
+        return mSize;
+    }
+
+    jint capacity() const {
+        return mCapacity;
+    }
+
+    // Returns false if the batch frame could not be pushed.
+    bool isValid() const {
+        return mPushed;
+    }
+
+private:
+    bool push() {
+        mSize = 0;
+        mPushed = mEnv->PushLocalFrame(mCapacity) == JNI_OK;
+        return mPushed;
+    }
+
+    jobject pop(jobject result) {
+        mSize = 0;
+        if (!mPushed) {
+            return result;
+        }
+        mPushed = false;
+        return mEnv->PopLocalFrame(result);
+    }
+
+    JNIEnv* const mEnv;
+    const jint mCapacity;
+    size_t mSize;
+    bool mPushed;
+
+    DISALLOW_COPY_AND_ASSIGN(LocalRefBatch);
+};
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#if defined(__cplusplus) && __cplusplus >= 201703L
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <jni.h>
+
+#include "nativehelper_utils.h"
+#include "scoped_primitive_array.h"
+
+namespace nativehelper {
+
+// A view of |size| elements starting at |data|.
+template <typename T>
+class ArraySpan {
+  public:
+    ArraySpan() : mData(nullptr), mSize(0) {}
+    ArraySpan(T* data, size_t size) : mData(data), mSize(size) {}
+
+    T* data() const { return mData; }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+    T& operator[](size_t n) const { return mData[n]; }
+    T* begin() const { return mData; }
+    T* end() const { return mData + mSize; }
+
+  private:
+    T* mData;
+    size_t mSize;
+};
+
+}  // namespace nativehelper
+
+// ScopedCriticalArrays<T...> pins several primitive arrays at once with
+// GetPrimitiveArrayCritical, for kernels that read some arrays and write others without copying
+// any of them:
+//
+//   ScopedCriticalArrays<const jfloat, const jfloat, jfloat> arrays(env, left, right, out);
+//   if (!arrays.isValid()) {
+//     return;  // An exception is pending.
+//   }
+//   auto [l, r, o] = arrays.spans();
+//   for (size_t i = 0; i < o.size(); ++i) {
+//     o[i] = l[i] + r[i];
+//   }
+//
+// Each T is the element type of an array, const for arrays that are only read, which are
+// released with JNI_ABORT, while the others are released with mode 0 so that a copy, if the
+// runtime made one, is written back. Null arrays throw a NullPointerException before any array is
+// pinned. Arrays are pinned in order and released in reverse order, when the object goes out of
+// scope or on release(). Empty arrays are not pinned.
+//
+// While the arrays are pinned the code must not make JNI calls or block on other threads, since
+// the runtime may have suspended garbage collection. CheckJNI aborts on such calls. Objects may be
+// nested, as critical regions may.
+template <typename... T>
+class ScopedCriticalArrays {
+  public:
+    template <size_t I>
+    using Element = std::tuple_element_t<I, std::tuple<T...>>;
+
+    template <size_t I>
+    using ArrayType =
+            typename nativehelper::detail::PrimitiveArrayTraits<std::remove_const_t<Element<I>>>::
+                    ArrayType;
+
+    explicit ScopedCriticalArrays(JNIEnv* env,
+                                  typename nativehelper::detail::PrimitiveArrayTraits<
+                                          std::remove_const_t<T>>::ArrayType... arrays)
+        : mEnv(env), mJavaArrays{arrays...}, mData{}, mSizes{}, mPinned(false) {
+        // No other JNI call may be made once an array is pinned, so the lengths are read first.
+        for (size_t i = 0; i < kCount; ++i) {
+            if (mJavaArrays[i] == nullptr) {
+                jniThrowNullPointerException(mEnv);
+                return;
+            }
+            mSizes[i] = mEnv->GetArrayLength(mJavaArrays[i]);
+        }
+        for (size_t i = 0; i < kCount; ++i) {
+            if (mSizes[i] == 0) {
+                continue;
+            }
+            mData[i] = mEnv->GetPrimitiveArrayCritical(mJavaArrays[i], nullptr);
+            if (mData[i] == nullptr) {
+                // An OutOfMemoryError is pending.
+                unpin(i);
+                return;
+            }
+        }
+        mPinned = true;
+    }
+
+    ~ScopedCriticalArrays() {
+        release();
+    }
+
+    // Returns false if an array was null or could not be pinned, in which case an exception is
+    // pending, or once the arrays have been released.
+    bool isValid() const {
+        return mPinned;
+    }
+
+    // Releases the arrays early, in reverse order. JNI calls may be made again afterwards.
+    void release() {
+        if (!mPinned) {
+            return;
+        }
+        mPinned = false;
+        unpin(kCount);
+    }
+
+    // The elements of array |I|, or an empty span if the arrays are not pinned.
+    template <size_t I>
+    nativehelper::ArraySpan<Element<I>> get() const {
+        if (!mPinned) {
+            return nativehelper::ArraySpan<Element<I>>();
+        }
+        return nativehelper::ArraySpan<Element<I>>(static_cast<Element<I>*>(mData[I]),
+                                                   static_cast<size_t>(mSizes[I]));
+    }
+
+    template <size_t I>
+    ArrayType<I> getJavaArray() const {
+        return static_cast<ArrayType<I>>(mJavaArrays[I]);
+    }
+
+    // The elements of every array, for structured bindings.
+    std::tuple<nativehelper::ArraySpan<T>...> spans() const {
+        return spans(std::index_sequence_for<T...>());
+    }
+
+  private:
+    static constexpr size_t kCount = sizeof...(T);
+    static_assert(kCount > 0, "ScopedCriticalArrays needs at least one array");
+
+    template <size_t... I>
+    std::tuple<nativehelper::ArraySpan<T>...> spans(std::index_sequence<I...>) const {
+        return std::make_tuple(get<I>()...);
+    }
+
+    // Releases the pinned arrays among the first |count|, last first.
+    void unpin(size_t count) {
+        static constexpr bool kReadOnly[] = {std::is_const_v<T>...};
+        while (count > 0) {
+            --count;
+            if (mData[count] != nullptr) {
+                mEnv->ReleasePrimitiveArrayCritical(mJavaArrays[count], mData[count],
+                                                    kReadOnly[count] ? JNI_ABORT : 0);
+                mData[count] = nullptr;
+            }
+        }
+    }
+
+    JNIEnv* const mEnv;
+    const jarray mJavaArrays[kCount];
+    void* mData[kCount];
+    jsize mSizes[kCount];
+    bool mPinned;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedCriticalArrays);
+};
+
+#endif  // defined(__cplusplus) && __cplusplus >= 201703L
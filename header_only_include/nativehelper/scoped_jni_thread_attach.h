@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <jni.h>
+
+#include "nativehelper_utils.h"
+
+namespace nativehelper {
+namespace detail {
+
+// The JNIEnv of the current thread if this header attached the thread, in which case the
+// destructor detaches the thread when it exits. The JNIEnv of a thread attached by other code is
+// not cached, since that code may detach the thread at any time.
+class ThreadAttachment {
+  public:
+    ThreadAttachment() : mVm(nullptr), mEnv(nullptr), mAttached(false) {}
+
+    ~ThreadAttachment() {
+        if (mAttached) {
+            mVm->DetachCurrentThread();
+        }
+    }
+
+    JNIEnv* get(JavaVM* vm, const char* threadName) {
+        if (mAttached && mVm == vm) {
+            return mEnv;
+        }
+        return attach(vm, threadName);
+    }
+
+  private:
+    JNIEnv* attach(JavaVM* vm, const char* threadName) {
+        JNIEnv* env = nullptr;
+        jint result = vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
+        if (result == JNI_OK) {
+            return env;
+        }
+        if (result != JNI_EDETACHED) {
+            return nullptr;
+        }
+        JavaVMAttachArgs args = {JNI_VERSION_1_6, threadName, nullptr};
+        if (vm->AttachCurrentThread(&env, &args) != JNI_OK) {
+            return nullptr;
+        }
+        if (!mAttached) {
+            mVm = vm;
+            mEnv = env;
+            mAttached = true;
+        }
+        return env;
+    }
+
+    JavaVM* mVm;
+    JNIEnv* mEnv;
+    bool mAttached;
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadAttachment);
+};
+
+inline ThreadAttachment& CurrentThreadAttachment() {
+    static thread_local ThreadAttachment attachment;
+    return attachment;
+}
+
+}  // namespace detail
+}  // namespace nativehelper
+
+// Returns the JNIEnv of the calling thread in |vm|, attaching the thread with the name
+// |threadName| if it is not attached yet. The JNIEnv of a thread attached here is cached in
+// thread-local storage, so after the first call on such a thread this does not call into the VM.
+// For a thread attached by other code, the JNIEnv is looked up with GetEnv on every call, as that
+// code may detach the thread. A thread attached here stays
+// attached until it exits and is then detached automatically, so code on the thread must not
+// detach it with DetachCurrentThread. Returns nullptr if the thread cannot be attached.
+inline JNIEnv* GetJniEnvForCurrentThread(JavaVM* vm, const char* threadName = nullptr) {
+    return nativehelper::detail::CurrentThreadAttachment().get(vm, threadName);
+}
+
+// Gives native threads, such as the workers of a callback thread pool, a JNIEnv for the scope:
+//
+//   void OnEvent(JavaVM* vm, const Event& event) {
+//     ScopedJniThreadAttach attach(vm, "EventWorker");
+//     if (!attach.isValid()) return;
+//     attach.env()->CallVoidMethod(...);
+//   }
+//
+// Unlike pairing AttachCurrentThread with DetachCurrentThread, the thread stays attached when
+// the scope ends, so only the first event on each thread pays for attaching, and the thread is
+// detached when it exits. Threads that were already attached, such as threads created by Java
+// code, are never detached.
+class ScopedJniThreadAttach {
+  public:
+    explicit ScopedJniThreadAttach(JavaVM* vm, const char* threadName = nullptr)
+        : mEnv(GetJniEnvForCurrentThread(vm, threadName)) {
+    }
+
+    // Returns false if the thread could not be attached.
+    bool isValid() const {
+        return mEnv != nullptr;
+    }
+
+    JNIEnv* env() const {
+        return mEnv;
+    }
+
+  private:
+    JNIEnv* const mEnv;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedJniThreadAttach);
+};
@@ -20,19 +20,89 @@
 
 #include "nativehelper_utils.h"
 
+// Pushes a local reference frame on construction and pops it on destruction, releasing every
+// local reference created in between. |capacity| is the number of local references the frame
+// reserves; pass roughly the number the scope creates.
 class ScopedLocalFrame {
 public:
-    explicit ScopedLocalFrame(JNIEnv* env) : mEnv(env) {
-        mEnv->PushLocalFrame(128);
+    static constexpr jint kDefaultCapacity = 128;
+
+    explicit ScopedLocalFrame(JNIEnv* env, jint capacity = kDefaultCapacity)
+        : mEnv(env), mPushed(mEnv->PushLocalFrame(capacity) == JNI_OK) {
     }
 
     ~ScopedLocalFrame() {
-        mEnv->PopLocalFrame(nullptr);
+        if (mPushed) {
+            mEnv->PopLocalFrame(nullptr);
+        }
+    }
+
+    // Returns false if the frame could not be pushed, in which case an OutOfMemoryError is
+    // pending.
+    bool isValid() const {
+        return mPushed;
     }
 
 private:
     JNIEnv* const mEnv;
+    const bool mPushed;
 
     DISALLOW_COPY_AND_ASSIGN(ScopedLocalFrame);
 };
 
+// Keeps a local reference frame pushed while a loop runs, popping and re-pushing it after every
+// |iterationsPerFrame| iterations. Loops that create local references in each iteration keep the
+// local reference table bounded without paying for a push and pop per iteration:
+//
+//   ScopedBatchedLocalFrame frame(env, 64);
+//   for (size_t i = 0; frame.isValid() && i < count; ++i) {
+//     ...create up to localsPerIteration local references...
+//     frame.next();
+//   }
+//
+// Local references created in an iteration must not be used once next() has been called.
+class ScopedBatchedLocalFrame {
+public:
+    ScopedBatchedLocalFrame(JNIEnv* env, jint iterationsPerFrame, jint localsPerIteration = 1)
+        : mEnv(env),
+          mIterationsPerFrame(iterationsPerFrame > 0 ? iterationsPerFrame : 1),
+          mCapacity(mIterationsPerFrame * (localsPerIteration > 0 ? localsPerIteration : 1)),
+          mIteration(0),
+          mPushed(mEnv->PushLocalFrame(mCapacity) == JNI_OK) {
+    }
+
+    ~ScopedBatchedLocalFrame() {
+        if (mPushed) {
+            mEnv->PopLocalFrame(nullptr);
+        }
+    }
+
+    // Marks the end of an iteration, recycling the frame if it has been used for
+    // |iterationsPerFrame| iterations. Returns false if the frame could not be pushed again, in
+    // which case an OutOfMemoryError is pending.
+    bool next() {
+        if (!mPushed) {
+            return false;
+        }
+        if (++mIteration < mIterationsPerFrame) {
+            return true;
+        }
+        mIteration = 0;
+        mEnv->PopLocalFrame(nullptr);
+        mPushed = mEnv->PushLocalFrame(mCapacity) == JNI_OK;
+        return mPushed;
+    }
+
+    bool isValid() const {
+        return mPushed;
+    }
+
+private:
+    JNIEnv* const mEnv;
+    const jint mIterationsPerFrame;
+    const jint mCapacity;
+    jint mIteration;
+    bool mPushed;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedBatchedLocalFrame);
+};
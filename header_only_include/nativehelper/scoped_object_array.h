@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+#include <jni.h>
+
+#include "nativehelper_utils.h"
+#include "scoped_utf_chars.h"
+
+// A range over the elements of a Java object array, for use in a range-based for loop:
+//
+//   ScopedObjectArrayRO<jstring> names(env, javaNames);
+//   for (jstring name : names) {
+//     ...
+//   }
+//
+// The length is read once on construction, and each element is fetched with one
+// GetObjectArrayElement when an iterator reaches it. The range keeps a single local reference
+// slot for the current element, deleted when the iterator moves on and when the range is
+// destroyed, so traversing an array of any length holds at most one element's local reference.
+// Each range owns its own slot, so several ranges can be iterated at once, for example over the
+// keys and values of a map in parallel.
+//
+// A null |array| throws a NullPointerException and gives an empty range. The local reference to
+// an element must not be used once the iterator has moved on, and a range supports one traversal
+// at a time. The range and its iterators are only valid on the thread that created them.
+template <typename T = jobject>
+class ScopedObjectArrayRO {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = T;
+
+        T operator*() const {
+            return mRange->mElement;
+        }
+
+        iterator& operator++() {
+            ++mIndex;
+            mRange->fetch(mIndex);
+            return *this;
+        }
+
+        void operator++(int) {
+            ++*this;
+        }
+
+        bool operator==(const iterator& rhs) const {
+            return mIndex == rhs.mIndex;
+        }
+
+        bool operator!=(const iterator& rhs) const {
+            return mIndex != rhs.mIndex;
+        }
+
+        // Index of the element the iterator is at.
+        jsize index() const {
+            return mIndex;
+        }
+
+    private:
+        friend class ScopedObjectArrayRO;
+
+        iterator(ScopedObjectArrayRO* range, jsize index) : mRange(range), mIndex(index) {}
+
+        ScopedObjectArrayRO* mRange;
+        jsize mIndex;
+    };
+
+    ScopedObjectArrayRO(JNIEnv* env, jobjectArray array)
+        : mEnv(env), mArray(array), mLength(0), mElement(nullptr) {
+        if (mArray == nullptr) {
+            jniThrowNullPointerException(mEnv);
+        } else {
+            mLength = mEnv->GetArrayLength(mArray);
+        }
+    }
+
+    ~ScopedObjectArrayRO() {
+        fetch(mLength);
+    }
+
+    // Returns false if |array| was null, in which case a NullPointerException is pending and the
+    // range is empty.
+    bool isValid() const {
+        return mArray != nullptr;
+    }
+
+    jobjectArray get() const {
+        return mArray;
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(mLength);
+    }
+
+    iterator begin() {
+        fetch(0);
+        return iterator(this, 0);
+    }
+
+    iterator end() {
+        return iterator(this, mLength);
+    }
+
+private:
+    // Replaces the element in the slot with the one at |index|, or with null past the end.
+    void fetch(jsize index) {
+        if (mElement != nullptr) {
+            mEnv->DeleteLocalRef(mElement);
+        }
+        mElement = (index < mLength)
+                ? static_cast<T>(mEnv->GetObjectArrayElement(mArray, index))
+                : nullptr;
+    }
+
+    JNIEnv* const mEnv;
+    const jobjectArray mArray;
+    jsize mLength;
+    T mElement;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedObjectArrayRO);
+};
+
+// The elements of a Java String[] as modified UTF-8, each wrapped in a ScopedUtfChars:
+//
+//   for (ScopedUtfChars path : ScopedUtfCharsArrayRO(env, javaPaths)) {
+//     if (path.c_str() == nullptr) {
+//       return;  // A null element, a NullPointerException is pending.
+//     }
+//     ...
+//   }
+//
+// Iteration must stop at a null element, as no further JNI calls but releases may be made with
+// the exception pending. The ScopedUtfChars must be destroyed before the iterator moves on, which
+// a range-based for loop does.
+class ScopedUtfCharsArrayRO {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = ScopedUtfChars;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = ScopedUtfChars;
+
+        ScopedUtfChars operator*() const {
+            return ScopedUtfChars(mEnv, *mElements);
+        }
+
+        iterator& operator++() {
+            ++mElements;
+            return *this;
+        }
+
+        void operator++(int) {
+            ++*this;
+        }
+
+        bool operator==(const iterator& rhs) const {
+            return mElements == rhs.mElements;
+        }
+
+        bool operator!=(const iterator& rhs) const {
+            return mElements != rhs.mElements;
+        }
+
+        jsize index() const {
+            return mElements.index();
+        }
+
+    private:
+        friend class ScopedUtfCharsArrayRO;
+
+        iterator(JNIEnv* env, ScopedObjectArrayRO<jstring>::iterator elements)
+            : mEnv(env), mElements(elements) {}
+
+        JNIEnv* mEnv;
+        ScopedObjectArrayRO<jstring>::iterator mElements;
+    };
+
+    ScopedUtfCharsArrayRO(JNIEnv* env, jobjectArray array)
+        : mEnv(env), mElements(env, array) {}
+
+    bool isValid() const {
+        return mElements.isValid();
+    }
+
+    jobjectArray get() const {
+        return mElements.get();
+    }
+
+    size_t size() const {
+        return mElements.size();
+    }
+
+    iterator begin() {
+        return iterator(mEnv, mElements.begin());
+    }
+
+    iterator end() {
+        return iterator(mEnv, mElements.end());
+    }
+
+private:
+    JNIEnv* const mEnv;
+    ScopedObjectArrayRO<jstring> mElements;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedUtfCharsArrayRO);
+};
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdio.h>
 
 #include <jni.h>
 
@@ -38,12 +39,18 @@
 // ScopedFloatArrayRO, ScopedIntArrayRO, ScopedLongArrayRO, and ScopedShortArrayRO provide
 // convenient read-only access to Java arrays from JNI code. This is cheaper than read-write
 // access and should be used by default.
+//
+// Arrays of up to kInlineCapacity elements are copied into storage inside the object, larger
+// arrays are accessed with Get<Type>ArrayElements. The Scoped<Type>ArrayRO types use an inline
+// capacity of 1024 elements, Scoped<Type>ArrayROWithCapacity<N> allows the stack usage to be
+// tuned, e.g. ScopedLongArrayROWithCapacity<4> for small arrays.
 #define INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_RO(PRIMITIVE_TYPE, NAME) \
-    class Scoped ## NAME ## ArrayRO { \
+    template <jsize kInlineCapacity> \
+    class Scoped ## NAME ## ArrayROWithCapacity { \
     public: \
-        explicit Scoped ## NAME ## ArrayRO(JNIEnv* env) \
+        explicit Scoped ## NAME ## ArrayROWithCapacity(JNIEnv* env) \
         : mEnv(env), mJavaArray(nullptr), mRawArray(nullptr), mSize(0) {} \
-        Scoped ## NAME ## ArrayRO(JNIEnv* env, PRIMITIVE_TYPE ## Array javaArray) \
+        Scoped ## NAME ## ArrayROWithCapacity(JNIEnv* env, PRIMITIVE_TYPE ## Array javaArray) \
         : mEnv(env) { \
             if (javaArray == nullptr) { \
                 mJavaArray = nullptr; \
@@ -54,7 +61,7 @@
                 reset(javaArray); \
             } \
         } \
-        ~Scoped ## NAME ## ArrayRO() { \
+        ~Scoped ## NAME ## ArrayROWithCapacity() { \
             if (mRawArray != nullptr && mRawArray != mBuffer) { \
                 mEnv->Release ## NAME ## ArrayElements(mJavaArray, mRawArray, JNI_ABORT); \
             } \
@@ -62,7 +69,7 @@
         void reset(PRIMITIVE_TYPE ## Array javaArray) { \
             mJavaArray = javaArray; \
             mSize = mEnv->GetArrayLength(mJavaArray); \
-            if (mSize <= buffer_size) { \
+            if (mSize <= kInlineCapacity) { \
                 mEnv->Get ## NAME ## ArrayRegion(mJavaArray, 0, mSize, mBuffer); \
                 mRawArray = mBuffer; \
             } else { \
@@ -74,14 +81,15 @@
         const PRIMITIVE_TYPE& operator[](size_t n) const { return mRawArray[n]; } \
         size_t size() const { return mSize; } \
     private: \
-        static const jsize buffer_size = 1024; \
+        static_assert(kInlineCapacity >= 0, "Inline capacity must not be negative"); \
         JNIEnv* const mEnv; \
         PRIMITIVE_TYPE ## Array mJavaArray; \
         POINTER_TYPE(PRIMITIVE_TYPE) mRawArray; \
         jsize mSize; \
-        PRIMITIVE_TYPE mBuffer[buffer_size]; \
-        DISALLOW_COPY_AND_ASSIGN(Scoped ## NAME ## ArrayRO); \
-    }
+        PRIMITIVE_TYPE mBuffer[kInlineCapacity > 0 ? kInlineCapacity : 1]; \
+        DISALLOW_COPY_AND_ASSIGN(Scoped ## NAME ## ArrayROWithCapacity); \
+    }; \
+    using Scoped ## NAME ## ArrayRO = Scoped ## NAME ## ArrayROWithCapacity<1024>
 
 INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_RO(jboolean, Boolean);
 INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_RO(jbyte, Byte);
@@ -94,21 +102,104 @@ INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_RO(jshort, Short);
 
 #undef INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_RO
 
+// ScopedBooleanArrayCriticalRO, ScopedByteArrayCriticalRO, ScopedCharArrayCriticalRO,
+// ScopedDoubleArrayCriticalRO, ScopedFloatArrayCriticalRO, ScopedIntArrayCriticalRO,
+// ScopedLongArrayCriticalRO, and ScopedShortArrayCriticalRO provide read-only access to Java
+// arrays through GetPrimitiveArrayCritical. On ART this usually avoids copying the array, which
+// makes it the cheapest way to read large arrays.
+//
+// While one of these objects is in scope the code must not make JNI calls or block on other
+// threads, since the runtime may have suspended garbage collection. Keep the scope short.
+#define INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(PRIMITIVE_TYPE, NAME) \
+    class Scoped ## NAME ## ArrayCriticalRO { \
+    public: \
+        Scoped ## NAME ## ArrayCriticalRO(JNIEnv* env, PRIMITIVE_TYPE ## Array javaArray) \
+        : mEnv(env), mJavaArray(javaArray), mRawArray(nullptr), mSize(0) { \
+            if (mJavaArray == nullptr) { \
+                jniThrowNullPointerException(mEnv); \
+            } else { \
+                mSize = mEnv->GetArrayLength(mJavaArray); \
+                mRawArray = static_cast<PRIMITIVE_TYPE*>( \
+                        mEnv->GetPrimitiveArrayCritical(mJavaArray, nullptr)); \
+            } \
+        } \
+        ~Scoped ## NAME ## ArrayCriticalRO() { \
+            if (mRawArray != nullptr) { \
+                mEnv->ReleasePrimitiveArrayCritical(mJavaArray, mRawArray, JNI_ABORT); \
+            } \
+        } \
+        const PRIMITIVE_TYPE* get() const { return mRawArray; } \
+        PRIMITIVE_TYPE ## Array getJavaArray() const { return mJavaArray; } \
+        const PRIMITIVE_TYPE& operator[](size_t n) const { return mRawArray[n]; } \
+        size_t size() const { return mSize; } \
+    private: \
+        JNIEnv* const mEnv; \
+        const PRIMITIVE_TYPE ## Array mJavaArray; \
+        POINTER_TYPE(PRIMITIVE_TYPE) mRawArray; \
+        jsize mSize; \
+        DISALLOW_COPY_AND_ASSIGN(Scoped ## NAME ## ArrayCriticalRO); \
+    }
+
+INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(jboolean, Boolean);
+INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(jbyte, Byte);
+INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(jchar, Char);
+INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(jdouble, Double);
+INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(jfloat, Float);
+INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(jint, Int);
+INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(jlong, Long);
+INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO(jshort, Short);
+
+#undef INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_CRITICAL_RO
+
+namespace nativehelper {
+namespace detail {
+
+// Throws the ArrayIndexOutOfBoundsException the region functions throw for a region of |length|
+// elements at |offset| of an array of |arrayLength| elements.
+inline void ThrowArrayRegionOutOfBounds(JNIEnv* env, jsize arrayLength, jsize offset,
+                                        jsize length) {
+    if (env->ExceptionCheck()) {
+        // Drop any pending exception.
+        env->ExceptionClear();
+    }
+    jclass e_class = env->FindClass("java/lang/ArrayIndexOutOfBoundsException");
+    if (e_class == nullptr) {
+        return;
+    }
+    char message[80];
+    snprintf(message, sizeof(message), "length=%d; regionStart=%d; regionLength=%d",
+             static_cast<int>(arrayLength), static_cast<int>(offset), static_cast<int>(length));
+    env->ThrowNew(e_class, message);
+    env->DeleteLocalRef(e_class);
+}
+
+}  // namespace detail
+}  // namespace nativehelper
+
 // ScopedBooleanArrayRW, ScopedByteArrayRW, ScopedCharArrayRW, ScopedDoubleArrayRW,
 // ScopedFloatArrayRW, ScopedIntArrayRW, ScopedLongArrayRW, and ScopedShortArrayRW provide
 // convenient read-write access to Java arrays from JNI code. These are more expensive,
 // since they entail a copy back onto the Java heap, and should only be used when necessary.
+//
+// By default the whole array is copied back when the object goes out of scope. commit() copies
+// it back early and keeps the elements, for periodic flushes during a long computation.
+// discard() releases the elements without copying anything back. commitRange() copies back
+// only the span that was modified, with Set<Type>ArrayRegion, which is much cheaper than the
+// full copy-back when a small part of a large array has changed. After discard() or
+// commitRange() get() returns nullptr and size() returns 0. commitRange() throws an
+// ArrayIndexOutOfBoundsException, and copies nothing back, if the span is not within the array.
+// It copies nothing back either while an exception is pending.
 #define INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_RW(PRIMITIVE_TYPE, NAME) \
     class Scoped ## NAME ## ArrayRW { \
     public: \
         explicit Scoped ## NAME ## ArrayRW(JNIEnv* env) \
-        : mEnv(env), mJavaArray(nullptr), mRawArray(nullptr) {} \
+        : mEnv(env), mJavaArray(nullptr), mRawArray(nullptr), mSize(0), mIsCopy(JNI_FALSE) {} \
         Scoped ## NAME ## ArrayRW(JNIEnv* env, PRIMITIVE_TYPE ## Array javaArray) \
-        : mEnv(env), mJavaArray(javaArray), mRawArray(nullptr) { \
+        : mEnv(env), mJavaArray(javaArray), mRawArray(nullptr), mSize(0), mIsCopy(JNI_FALSE) { \
             if (mJavaArray == nullptr) { \
                 jniThrowNullPointerException(mEnv); \
             } else { \
-                mRawArray = mEnv->Get ## NAME ## ArrayElements(mJavaArray, nullptr); \
+                reset(javaArray); \
             } \
         } \
         ~Scoped ## NAME ## ArrayRW() { \
@@ -118,18 +209,50 @@ INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_RO(jshort, Short);
         } \
         void reset(PRIMITIVE_TYPE ## Array javaArray) { \
             mJavaArray = javaArray; \
-            mRawArray = mEnv->Get ## NAME ## ArrayElements(mJavaArray, nullptr); \
+            mSize = mEnv->GetArrayLength(mJavaArray); \
+            mRawArray = mEnv->Get ## NAME ## ArrayElements(mJavaArray, &mIsCopy); \
+        } \
+        /* Copies the elements back to the Java array and keeps them. */ \
+        void commit() { \
+            if (mRawArray) { \
+                mEnv->Release ## NAME ## ArrayElements(mJavaArray, mRawArray, JNI_COMMIT); \
+            } \
+        } \
+        /* Releases the elements without copying back any changes. */ \
+        void discard() { \
+            if (mRawArray) { \
+                mEnv->Release ## NAME ## ArrayElements(mJavaArray, mRawArray, JNI_ABORT); \
+                mRawArray = nullptr; \
+                mSize = 0; \
+            } \
+        } \
+        /* Copies back |length| elements from |start| only, then releases the elements. */ \
+        void commitRange(jsize start, jsize length) { \
+            if (mRawArray) { \
+                if (start < 0 || length < 0 || start > mSize || length > mSize - start) { \
+                    ::nativehelper::detail::ThrowArrayRegionOutOfBounds(mEnv, mSize, start, \
+                                                                        length); \
+                } else if (mIsCopy && !mEnv->ExceptionCheck()) { \
+                    mEnv->Set ## NAME ## ArrayRegion(mJavaArray, start, length, \
+                                                      mRawArray + start); \
+                } \
+                mEnv->Release ## NAME ## ArrayElements(mJavaArray, mRawArray, JNI_ABORT); \
+                mRawArray = nullptr; \
+                mSize = 0; \
+            } \
         } \
         const PRIMITIVE_TYPE* get() const { return mRawArray; } \
         PRIMITIVE_TYPE ## Array getJavaArray() const { return mJavaArray; } \
         const PRIMITIVE_TYPE& operator[](size_t n) const { return mRawArray[n]; } \
         POINTER_TYPE(PRIMITIVE_TYPE) get() { return mRawArray; }  \
         REFERENCE_TYPE(PRIMITIVE_TYPE) operator[](size_t n) { return mRawArray[n]; } \
-        size_t size() const { return mEnv->GetArrayLength(mJavaArray); } \
+        size_t size() const { return mSize; } \
     private: \
         JNIEnv* const mEnv; \
         PRIMITIVE_TYPE ## Array mJavaArray; \
         POINTER_TYPE(PRIMITIVE_TYPE) mRawArray; \
+        jsize mSize; \
+        jboolean mIsCopy; \
         DISALLOW_COPY_AND_ASSIGN(Scoped ## NAME ## ArrayRW); \
     }
 
@@ -146,3 +269,372 @@ INSTANTIATE_SCOPED_PRIMITIVE_ARRAY_RW(jshort, Short);
 #undef POINTER_TYPE
 #undef REFERENCE_TYPE
 
+namespace nativehelper {
+namespace detail {
+
+// Maps a primitive element type to its Java array type and region accessors.
+template <typename T>
+struct PrimitiveArrayTraits;
+
+#define INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(PRIMITIVE_TYPE, NAME) \
+    template <> \
+    struct PrimitiveArrayTraits<PRIMITIVE_TYPE> { \
+        using ArrayType = PRIMITIVE_TYPE ## Array; \
+        static void GetRegion(JNIEnv* env, ArrayType array, jsize start, jsize length, \
+                              PRIMITIVE_TYPE* buffer) { \
+            env->Get ## NAME ## ArrayRegion(array, start, length, buffer); \
+        } \
+        static void SetRegion(JNIEnv* env, ArrayType array, jsize start, jsize length, \
+                              const PRIMITIVE_TYPE* buffer) { \
+            env->Set ## NAME ## ArrayRegion(array, start, length, buffer); \
+        } \
+    }
+
+INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(jboolean, Boolean);
+INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(jbyte, Byte);
+INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(jchar, Char);
+INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(jdouble, Double);
+INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(jfloat, Float);
+INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(jint, Int);
+INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(jlong, Long);
+INSTANTIATE_PRIMITIVE_ARRAY_TRAITS(jshort, Short);
+
+#undef INSTANTIATE_PRIMITIVE_ARRAY_TRAITS
+
+// Returns true if the region of |length| elements at |offset| is within |javaArray|, which must
+// not be null. Otherwise throws an ArrayIndexOutOfBoundsException and returns false, so that
+// callers can reject a region before allocating for it or touching any of it.
+inline bool CheckArrayRegion(JNIEnv* env, jarray javaArray, jsize offset, jsize length) {
+    const jsize arrayLength = env->GetArrayLength(javaArray);
+    // Neither subtraction can overflow once both values are known not to be negative.
+    if (offset >= 0 && length >= 0 && offset <= arrayLength && length <= arrayLength - offset) {
+        return true;
+    }
+    ThrowArrayRegionOutOfBounds(env, arrayLength, offset, length);
+    return false;
+}
+
+// Storage for a copy of part of a Java array. Up to kInlineCapacity elements are held in the
+// object, larger copies are allocated on the heap.
+template <typename T, jsize kInlineCapacity>
+class PrimitiveArrayRegionStorage {
+  public:
+    PrimitiveArrayRegionStorage() : mHeap(nullptr) {}
+
+    ~PrimitiveArrayRegionStorage() {
+        delete[] mHeap;
+    }
+
+    T* allocate(jsize length) {
+        if (length <= kInlineCapacity) {
+            return mInline;
+        }
+        delete[] mHeap;
+        mHeap = new T[length];
+        return mHeap;
+    }
+
+  private:
+    static_assert(kInlineCapacity >= 0, "Inline capacity must not be negative");
+    T* mHeap;
+    T mInline[kInlineCapacity > 0 ? kInlineCapacity : 1];
+
+    DISALLOW_COPY_AND_ASSIGN(PrimitiveArrayRegionStorage);
+};
+
+}  // namespace detail
+}  // namespace nativehelper
+
+// ScopedPrimitiveArrayRegionRO<T> provides read-only access to a window of |length| elements
+// starting at |offset| of a Java array. Only the window is copied, with Get<Type>ArrayRegion,
+// which is cheaper than Scoped<Type>ArrayRO when native code only needs a slice of a large
+// array.
+//
+// If the array is null a NullPointerException is thrown, and if the window is out of bounds an
+// ArrayIndexOutOfBoundsException is thrown. In both cases get() returns nullptr.
+template <typename T, jsize kInlineCapacity = 64>
+class ScopedPrimitiveArrayRegionRO {
+  public:
+    using ArrayType = typename nativehelper::detail::PrimitiveArrayTraits<T>::ArrayType;
+
+    ScopedPrimitiveArrayRegionRO(JNIEnv* env, ArrayType javaArray, jsize offset, jsize length)
+        : mEnv(env), mJavaArray(javaArray), mOffset(offset), mSize(0), mRawArray(nullptr) {
+        if (mJavaArray == nullptr) {
+            jniThrowNullPointerException(mEnv);
+            return;
+        }
+        // Checked first, as a length past the end of the array must not be allocated.
+        if (!nativehelper::detail::CheckArrayRegion(mEnv, mJavaArray, offset, length)) {
+            return;
+        }
+        T* buffer = mStorage.allocate(length);
+        nativehelper::detail::PrimitiveArrayTraits<T>::GetRegion(mEnv, mJavaArray, offset,
+                                                                 length, buffer);
+        if (!mEnv->ExceptionCheck()) {
+            mRawArray = buffer;
+            mSize = length;
+        }
+    }
+
+    const T* get() const { return mRawArray; }
+    ArrayType getJavaArray() const { return mJavaArray; }
+    const T& operator[](size_t n) const { return mRawArray[n]; }
+    size_t size() const { return mSize; }
+    // Index in the Java array of the first element of the window.
+    jsize offset() const { return mOffset; }
+
+  private:
+    JNIEnv* const mEnv;
+    const ArrayType mJavaArray;
+    const jsize mOffset;
+    jsize mSize;
+    T* mRawArray;
+    nativehelper::detail::PrimitiveArrayRegionStorage<T, kInlineCapacity> mStorage;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedPrimitiveArrayRegionRO);
+};
+
+// ScopedPrimitiveArrayRegionRW<T> provides read-write access to a window of a Java array. The
+// window is written back with Set<Type>ArrayRegion when the object goes out of scope, or on
+// commit(), but only if it has been accessed through a non-const accessor. It is not written back
+// while an exception is pending, as JNI does not allow it, so code that throws after modifying the
+// window leaves the Java array as it was.
+template <typename T, jsize kInlineCapacity = 64>
+class ScopedPrimitiveArrayRegionRW {
+  public:
+    using ArrayType = typename nativehelper::detail::PrimitiveArrayTraits<T>::ArrayType;
+
+    ScopedPrimitiveArrayRegionRW(JNIEnv* env, ArrayType javaArray, jsize offset, jsize length)
+        : mEnv(env), mJavaArray(javaArray), mOffset(offset), mSize(0), mRawArray(nullptr),
+          mDirty(false) {
+        if (mJavaArray == nullptr) {
+            jniThrowNullPointerException(mEnv);
+            return;
+        }
+        // Checked first, as a length past the end of the array must not be allocated.
+        if (!nativehelper::detail::CheckArrayRegion(mEnv, mJavaArray, offset, length)) {
+            return;
+        }
+        T* buffer = mStorage.allocate(length);
+        nativehelper::detail::PrimitiveArrayTraits<T>::GetRegion(mEnv, mJavaArray, offset,
+                                                                 length, buffer);
+        if (!mEnv->ExceptionCheck()) {
+            mRawArray = buffer;
+            mSize = length;
+        }
+    }
+
+    ~ScopedPrimitiveArrayRegionRW() {
+        commit();
+    }
+
+    // Writes the window back to the Java array if it may have been modified and no exception is
+    // pending.
+    void commit() {
+        if (mDirty && mRawArray != nullptr && !mEnv->ExceptionCheck()) {
+            nativehelper::detail::PrimitiveArrayTraits<T>::SetRegion(mEnv, mJavaArray, mOffset,
+                                                                     mSize, mRawArray);
+        }
+        mDirty = false;
+    }
+
+    const T* get() const { return mRawArray; }
+    ArrayType getJavaArray() const { return mJavaArray; }
+    const T& operator[](size_t n) const { return mRawArray[n]; }
+    T* get() { mDirty = true; return mRawArray; }
+    T& operator[](size_t n) { mDirty = true; return mRawArray[n]; }
+    size_t size() const { return mSize; }
+    // Index in the Java array of the first element of the window.
+    jsize offset() const { return mOffset; }
+
+  private:
+    JNIEnv* const mEnv;
+    const ArrayType mJavaArray;
+    const jsize mOffset;
+    jsize mSize;
+    T* mRawArray;
+    bool mDirty;
+    nativehelper::detail::PrimitiveArrayRegionStorage<T, kInlineCapacity> mStorage;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedPrimitiveArrayRegionRW);
+};
+
+// ScopedPrimitiveArrayChunksRO<T> walks a Java array, or a window of one, in chunks of up to
+// kChunkSize elements so that very large arrays can be processed with bounded native memory and
+// without pinning or copying the whole array:
+//
+//   ScopedPrimitiveArrayChunksRO<jint> chunks(env, javaArray);
+//   while (chunks.next()) {
+//     for (size_t i = 0; i < chunks.size(); ++i) {
+//       sum += chunks[i];
+//     }
+//   }
+//
+// next() returns false once the array is exhausted, or if the array is null or the window out of
+// bounds, in which case an exception is pending. The window is checked on construction, before
+// any chunk is loaded.
+template <typename T, jsize kChunkSize = 256>
+class ScopedPrimitiveArrayChunksRO {
+  public:
+    using ArrayType = typename nativehelper::detail::PrimitiveArrayTraits<T>::ArrayType;
+
+    ScopedPrimitiveArrayChunksRO(JNIEnv* env, ArrayType javaArray)
+        : ScopedPrimitiveArrayChunksRO(env, javaArray, 0,
+                                       javaArray != nullptr ? env->GetArrayLength(javaArray) : 0) {
+    }
+
+    ScopedPrimitiveArrayChunksRO(JNIEnv* env, ArrayType javaArray, jsize offset, jsize length)
+        : mEnv(env), mJavaArray(javaArray), mNext(offset), mEnd(offset),
+          mChunkOffset(offset), mChunkSize(0), mFailed(false) {
+        init(length);
+    }
+
+    // Loads the next chunk. Returns false when there are no more elements or on failure.
+    bool next() {
+        mChunkOffset = mNext;
+        mChunkSize = 0;
+        if (mFailed || mNext >= mEnd) {
+            return false;
+        }
+        jsize size = (mEnd - mNext < kChunkSize) ? mEnd - mNext : kChunkSize;
+        nativehelper::detail::PrimitiveArrayTraits<T>::GetRegion(mEnv, mJavaArray, mNext, size,
+                                                                 mBuffer);
+        if (mEnv->ExceptionCheck()) {
+            mFailed = true;
+            return false;
+        }
+        mChunkSize = size;
+        mNext += size;
+        return true;
+    }
+
+    const T* get() const { return mBuffer; }
+    ArrayType getJavaArray() const { return mJavaArray; }
+    const T& operator[](size_t n) const { return mBuffer[n]; }
+    // Number of elements in the current chunk.
+    size_t size() const { return mChunkSize; }
+    // Index in the Java array of the first element of the current chunk.
+    jsize offset() const { return mChunkOffset; }
+
+  private:
+    static_assert(kChunkSize > 0, "Chunk size must be positive");
+
+    // Checks the whole window up front, so that no chunk is touched if it is out of bounds, and
+    // so that its end fits in a jsize.
+    void init(jsize length) {
+        if (mJavaArray == nullptr) {
+            mFailed = true;
+            jniThrowNullPointerException(mEnv);
+        } else if (!nativehelper::detail::CheckArrayRegion(mEnv, mJavaArray, mNext, length)) {
+            mFailed = true;
+        } else {
+            mEnd = mNext + length;
+        }
+    }
+
+    JNIEnv* const mEnv;
+    const ArrayType mJavaArray;
+    jsize mNext;
+    jsize mEnd;
+    jsize mChunkOffset;
+    jsize mChunkSize;
+    bool mFailed;
+    T mBuffer[kChunkSize];
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedPrimitiveArrayChunksRO);
+};
+
+// ScopedPrimitiveArrayChunksRW<T> is the read-write equivalent of ScopedPrimitiveArrayChunksRO.
+// A chunk accessed through a non-const accessor is written back with Set<Type>ArrayRegion before
+// the next chunk is loaded, on flush(), or when the object goes out of scope. Chunks that are only
+// read are not written back, and neither is any chunk while an exception is pending.
+template <typename T, jsize kChunkSize = 256>
+class ScopedPrimitiveArrayChunksRW {
+  public:
+    using ArrayType = typename nativehelper::detail::PrimitiveArrayTraits<T>::ArrayType;
+
+    ScopedPrimitiveArrayChunksRW(JNIEnv* env, ArrayType javaArray)
+        : ScopedPrimitiveArrayChunksRW(env, javaArray, 0,
+                                       javaArray != nullptr ? env->GetArrayLength(javaArray) : 0) {
+    }
+
+    ScopedPrimitiveArrayChunksRW(JNIEnv* env, ArrayType javaArray, jsize offset, jsize length)
+        : mEnv(env), mJavaArray(javaArray), mNext(offset), mEnd(offset),
+          mChunkOffset(offset), mChunkSize(0), mFailed(false), mDirty(false) {
+        init(length);
+    }
+
+    ~ScopedPrimitiveArrayChunksRW() {
+        flush();
+    }
+
+    // Writes back the current chunk if it may have been modified, then loads the next chunk.
+    // Returns false when there are no more elements or on failure.
+    bool next() {
+        flush();
+        mChunkOffset = mNext;
+        mChunkSize = 0;
+        if (mFailed || mNext >= mEnd || mEnv->ExceptionCheck()) {
+            return false;
+        }
+        jsize size = (mEnd - mNext < kChunkSize) ? mEnd - mNext : kChunkSize;
+        nativehelper::detail::PrimitiveArrayTraits<T>::GetRegion(mEnv, mJavaArray, mNext, size,
+                                                                 mBuffer);
+        if (mEnv->ExceptionCheck()) {
+            mFailed = true;
+            return false;
+        }
+        mChunkSize = size;
+        mNext += size;
+        return true;
+    }
+
+    // Writes back the current chunk if it may have been modified and no exception is pending.
+    void flush() {
+        if (mDirty && mChunkSize > 0 && !mEnv->ExceptionCheck()) {
+            nativehelper::detail::PrimitiveArrayTraits<T>::SetRegion(mEnv, mJavaArray,
+                                                                     mChunkOffset, mChunkSize,
+                                                                     mBuffer);
+        }
+        mDirty = false;
+    }
+
+    const T* get() const { return mBuffer; }
+    ArrayType getJavaArray() const { return mJavaArray; }
+    const T& operator[](size_t n) const { return mBuffer[n]; }
+    T* get() { mDirty = true; return mBuffer; }
+    T& operator[](size_t n) { mDirty = true; return mBuffer[n]; }
+    // Number of elements in the current chunk.
+    size_t size() const { return mChunkSize; }
+    // Index in the Java array of the first element of the current chunk.
+    jsize offset() const { return mChunkOffset; }
+
+  private:
+    static_assert(kChunkSize > 0, "Chunk size must be positive");
+
+    // Checks the whole window up front, so that no chunk is touched if it is out of bounds, and
+    // so that its end fits in a jsize.
+    void init(jsize length) {
+        if (mJavaArray == nullptr) {
+            mFailed = true;
+            jniThrowNullPointerException(mEnv);
+        } else if (!nativehelper::detail::CheckArrayRegion(mEnv, mJavaArray, mNext, length)) {
+            mFailed = true;
+        } else {
+            mEnd = mNext + length;
+        }
+    }
+
+    JNIEnv* const mEnv;
+    const ArrayType mJavaArray;
+    jsize mNext;
+    jsize mEnd;
+    jsize mChunkOffset;
+    jsize mChunkSize;
+    bool mFailed;
+    bool mDirty;
+    T mBuffer[kChunkSize];
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedPrimitiveArrayChunksRW);
+};
+
@@ -72,3 +72,71 @@ class ScopedStringChars {
   DISALLOW_COPY_AND_ASSIGN(ScopedStringChars);
 };
 
+// ScopedStringCharsRO provides read-only access to the UTF-16 chars of a Java string, choosing
+// how to obtain them from the string's length:
+//
+//   - strings of up to kInlineCapacity chars are copied with GetStringRegion into a buffer held
+//     in the object, so short strings need no allocation and no pinning;
+//   - longer strings are accessed with GetStringCritical, which avoids a copy for long scans.
+//
+// As with GetStringCritical, while a ScopedStringCharsRO on a long string is alive the caller
+// must not call other JNI functions or block. Use ScopedStringChars if that is not acceptable.
+//
+// Like ScopedStringChars, a null jstring throws NullPointerException and get returns nullptr.
+template <jsize kInlineCapacity = 64>
+class ScopedStringCharsRO {
+ public:
+  ScopedStringCharsRO(JNIEnv* env, jstring s)
+      : env_(env), string_(s), chars_(nullptr), critical_chars_(nullptr), size_(0) {
+    if (s == nullptr) {
+      jniThrowNullPointerException(env);
+      return;
+    }
+    jsize length = env->GetStringLength(s);
+    if (length <= kInlineCapacity) {
+      env->GetStringRegion(s, 0, length, buffer_);
+      chars_ = buffer_;
+    } else {
+      critical_chars_ = env->GetStringCritical(s, nullptr);
+      chars_ = critical_chars_;
+    }
+    if (chars_ != nullptr) {
+      size_ = length;
+    }
+  }
+
+  ~ScopedStringCharsRO() {
+    if (critical_chars_ != nullptr) {
+      env_->ReleaseStringCritical(string_, critical_chars_);
+    }
+  }
+
+  const jchar* get() const {
+    return chars_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  const jchar& operator[](size_t n) const {
+    return chars_[n];
+  }
+
+  // Returns true if the chars were obtained with GetStringCritical.
+  bool isCritical() const {
+    return critical_chars_ != nullptr;
+  }
+
+ private:
+  static_assert(kInlineCapacity >= 0, "Inline capacity must not be negative");
+
+  JNIEnv* const env_;
+  const jstring string_;
+  const jchar* chars_;
+  const jchar* critical_chars_;
+  size_t size_;
+  jchar buffer_[kInlineCapacity > 0 ? kInlineCapacity : 1];
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedStringCharsRO);
+};
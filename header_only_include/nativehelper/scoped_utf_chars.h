@@ -19,6 +19,10 @@
 #include <stddef.h>
 #include <string.h>
 
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
 #include <jni.h>
 
 #include "nativehelper_utils.h"
@@ -32,9 +36,12 @@
 //   if (name.c_str() == nullptr) {
 //     return nullptr;
 //   }
+//
+// The length is computed at most once, so size() is cheap to call repeatedly.
 class ScopedUtfChars {
  public:
-  ScopedUtfChars(JNIEnv* env, jstring s) : env_(env), string_(s) {
+  ScopedUtfChars(JNIEnv* env, jstring s) : env_(env), string_(s), size_(kUnknownSize),
+      owned_(true) {
     if (s == nullptr) {
       utf_chars_ = nullptr;
       jniThrowNullPointerException(env);
@@ -43,15 +50,40 @@ class ScopedUtfChars {
     }
   }
 
+  // Decodes the string with GetStringUTFRegion into |buffer| when it is certain to fit,
+  // including the terminating NUL, which avoids the copy GetStringUTFChars makes on the heap.
+  // Longer strings fall back to GetStringUTFChars. |buffer| must outlive this object.
+  ScopedUtfChars(JNIEnv* env, jstring s, char* buffer, size_t buffer_size)
+      : env_(env), string_(s), size_(kUnknownSize), owned_(true) {
+    if (s == nullptr) {
+      utf_chars_ = nullptr;
+      jniThrowNullPointerException(env);
+      return;
+    }
+    // Each UTF-16 code unit decodes to at most three bytes of modified UTF-8.
+    jsize length = env->GetStringLength(s);
+    if (buffer_size > 0 && static_cast<size_t>(length) <= (buffer_size - 1) / 3) {
+      env->GetStringUTFRegion(s, 0, length, buffer);
+      size_ = static_cast<size_t>(env->GetStringUTFLength(s));
+      buffer[size_] = '\0';
+      utf_chars_ = buffer;
+      owned_ = false;
+    } else {
+      utf_chars_ = env->GetStringUTFChars(s, nullptr);
+    }
+  }
+
   ScopedUtfChars(ScopedUtfChars&& rhs) noexcept :
-      env_(rhs.env_), string_(rhs.string_), utf_chars_(rhs.utf_chars_) {
+      env_(rhs.env_), string_(rhs.string_), utf_chars_(rhs.utf_chars_), size_(rhs.size_),
+      owned_(rhs.owned_) {
     rhs.env_ = nullptr;
     rhs.string_ = nullptr;
     rhs.utf_chars_ = nullptr;
+    rhs.size_ = kUnknownSize;
   }
 
   ~ScopedUtfChars() {
-    if (utf_chars_) {
+    if (utf_chars_ && owned_) {
       env_->ReleaseStringUTFChars(string_, utf_chars_);
     }
   }
@@ -65,9 +97,12 @@ class ScopedUtfChars {
       env_ = rhs.env_;
       string_ = rhs.string_;
       utf_chars_ = rhs.utf_chars_;
+      size_ = rhs.size_;
+      owned_ = rhs.owned_;
       rhs.env_ = nullptr;
       rhs.string_ = nullptr;
       rhs.utf_chars_ = nullptr;
+      rhs.size_ = kUnknownSize;
     }
     return *this;
   }
@@ -77,18 +112,67 @@ class ScopedUtfChars {
   }
 
   size_t size() const {
-    return strlen(utf_chars_);
+    if (size_ == kUnknownSize) {
+      size_ = strlen(utf_chars_);
+    }
+    return size_;
+  }
+
+#if __cplusplus >= 201703L
+  // Returns a view of the chars without copying them. Only valid while this object is alive.
+  std::string_view view() const {
+    return std::string_view(utf_chars_, size());
   }
+#endif
 
   const char& operator[](size_t n) const {
     return utf_chars_[n];
   }
 
  private:
+  static constexpr size_t kUnknownSize = static_cast<size_t>(-1);
+
   JNIEnv* env_;
   jstring string_;
   const char* utf_chars_;
+  mutable size_t size_;
+  bool owned_;
 
   DISALLOW_COPY_AND_ASSIGN(ScopedUtfChars);
 };
 
+// A ScopedUtfChars with an inline buffer of kInlineCapacity bytes, so that strings of up to
+// (kInlineCapacity - 1) / 3 UTF-16 code units are decoded without any heap allocation.
+template <size_t kInlineCapacity = 64>
+class ScopedUtfCharsWithBuffer {
+ public:
+  ScopedUtfCharsWithBuffer(JNIEnv* env, jstring s)
+      : utf_chars_(env, s, buffer_, kInlineCapacity) {}
+
+  const char* c_str() const {
+    return utf_chars_.c_str();
+  }
+
+  size_t size() const {
+    return utf_chars_.size();
+  }
+
+#if __cplusplus >= 201703L
+  std::string_view view() const {
+    return utf_chars_.view();
+  }
+#endif
+
+  const char& operator[](size_t n) const {
+    return utf_chars_[n];
+  }
+
+ private:
+  static_assert(kInlineCapacity > 0, "Inline capacity must be positive");
+
+  // Declared before utf_chars_ so that it is available when utf_chars_ is constructed.
+  char buffer_[kInlineCapacity];
+  ScopedUtfChars utf_chars_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedUtfCharsWithBuffer);
+};
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <jni.h>
+
+/*
+ * Transcodes |length| bytes of standard UTF-8 from |utf8| to UTF-16 in |utf16|, which must have
+ * room for |length| code units: no input decodes to more code units than it has bytes. Returns
+ * the number of code units written.
+ *
+ * This is a single pass that validates as it goes. Each maximal ill-formed subsequence, such as
+ * an overlong form, an encoded surrogate or a truncated sequence, becomes one U+FFFD, which
+ * matches new String(bytes, StandardCharsets.UTF_8). Unlike NewStringUTF the input need not be
+ * NUL-terminated and may contain NULs. ASCII is converted sixteen bytes at a time.
+ */
+static inline size_t jniUtf8ToUtf16(const char* utf8, size_t length, jchar* utf16) {
+    const uint8_t* in = (const uint8_t*) utf8;
+    const uint8_t* const end = in + length;
+    jchar* out = utf16;
+    while (in != end) {
+        // ASCII fast path. The block is copied to a local first so that the widening stores
+        // cannot alias the input, which lets compilers vectorize the loop.
+        while (end - in >= 16) {
+            uint8_t block[16];
+            memcpy(block, in, sizeof(block));
+            uint64_t words[2];
+            memcpy(words, block, sizeof(words));
+            if (((words[0] | words[1]) & UINT64_C(0x8080808080808080)) != 0) {
+                break;
+            }
+            for (int i = 0; i < 16; ++i) {
+                out[i] = block[i];
+            }
+            in += 16;
+            out += 16;
+        }
+        if (in == end) {
+            break;
+        }
+
+        const uint8_t lead = *in++;
+        if (lead < 0x80) {
+            *out++ = lead;
+            continue;
+        }
+        // Two byte sequences, most of Latin, Greek, Cyrillic, Hebrew and Arabic.
+        if (lead >= 0xc2 && lead <= 0xdf && in != end && (*in & 0xc0) == 0x80) {
+            *out++ = (jchar) (((lead & 0x1f) << 6) | (*in++ & 0x3f));
+            continue;
+        }
+        // The valid range of the first continuation byte depends on the lead byte, which rules
+        // out overlong forms, surrogates and code points above U+10FFFF (Unicode table 3-7).
+        int continuations;
+        uint8_t low = 0x80;
+        uint8_t high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf) {
+            continuations = 1;
+        } else if (lead >= 0xe0 && lead <= 0xef) {
+            continuations = 2;
+            if (lead == 0xe0) {
+                low = 0xa0;
+            } else if (lead == 0xed) {
+                high = 0x9f;
+            }
+        } else if (lead >= 0xf0 && lead <= 0xf4) {
+            continuations = 3;
+            if (lead == 0xf0) {
+                low = 0x90;
+            } else if (lead == 0xf4) {
+                high = 0x8f;
+            }
+        } else {
+            *out++ = 0xfffd;
+            continue;
+        }
+
+        uint32_t codePoint = lead & (0x3f >> continuations);
+        for (; continuations > 0; --continuations) {
+            if (in == end || *in < low || *in > high) {
+                break;
+            }
+            codePoint = (codePoint << 6) | (*in++ & 0x3f);
+            low = 0x80;
+            high = 0xbf;
+        }
+        if (continuations != 0) {
+            // The offending byte is not consumed, it starts the next sequence.
+            *out++ = 0xfffd;
+        } else if (codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            *out++ = (jchar) (0xd800 | (codePoint >> 10));
+            *out++ = (jchar) (0xdc00 | (codePoint & 0x3ff));
+        } else {
+            *out++ = (jchar) codePoint;
+        }
+    }
+    return (size_t) (out - utf16);
+}
@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <sys/cdefs.h>
 
 #include <jni.h>
@@ -83,6 +84,98 @@ int AFileDescriptor_getFd(JNIEnv* env, jobject fileDescriptor) __INTRODUCED_IN(3
  */
 void AFileDescriptor_setFd(JNIEnv* env, jobject fileDescriptor, int fd) __INTRODUCED_IN(31);
 
+/**
+ * Returns the Unix file descriptor represented by the given java.io.FileDescriptor.
+ *
+ * Equivalent to AFileDescriptor_getFd() but without checking that \a fileDescriptor is a
+ * java.io.FileDescriptor instance, which saves a JNI call on each access. Passing any other
+ * object is undefined behavior unless CheckJNI is enabled, in which case the runtime reports the
+ * error.
+ *
+ * Aborts the program if \a fileDescriptor is NULL.
+ *
+ * Available since API level 33.
+ *
+ * \param env a pointer to the JNI Native Interface of the current thread.
+ * \param fileDescriptor a java.io.FileDescriptor instance.
+ * \return the Unix file descriptor wrapped by \a fileDescriptor.
+ */
+int AFileDescriptor_getFdUnchecked(JNIEnv* env, jobject fileDescriptor) __INTRODUCED_IN(33);
+
+/**
+ * Sets the Unix file descriptor represented by the given java.io.FileDescriptor.
+ *
+ * Equivalent to AFileDescriptor_setFd() but without checking that \a fileDescriptor is a
+ * java.io.FileDescriptor instance, which saves a JNI call on each access. Passing any other
+ * object is undefined behavior unless CheckJNI is enabled, in which case the runtime reports the
+ * error.
+ *
+ * Aborts the program if \a fileDescriptor is NULL.
+ *
+ * Available since API level 33.
+ *
+ * \param env a pointer to the JNI Native Interface of the current thread.
+ * \param fileDescriptor a java.io.FileDescriptor instance.
+ * \param fd a Unix file descriptor that \a fileDescriptor will subsequently represent.
+ */
+void AFileDescriptor_setFdUnchecked(JNIEnv* env, jobject fileDescriptor, int fd)
+    __INTRODUCED_IN(33);
+
+/**
+ * Returns a new java.io.FileDescriptor[] of \a count elements, where element i represents the
+ * Unix file descriptor \a fds[i].
+ *
+ * Callers of this method should be aware that it can fail, returning NULL with a pending Java
+ * exception.
+ *
+ * Available since API level 33.
+ *
+ * \param env a pointer to the JNI Native Interface of the current thread.
+ * \param fds an array of \a count Unix file descriptors.
+ * \param count the number of file descriptors to create.
+ * \return a java.io.FileDescriptor[] on success, nullptr if insufficient heap memory is available.
+ */
+jobjectArray AFileDescriptor_createArray(JNIEnv* env, const int* fds, size_t count)
+    __INTRODUCED_IN(33);
+
+/**
+ * Reads the Unix file descriptors represented by the first \a count elements of an array of
+ * java.io.FileDescriptor into \a fds, as if by calling AFileDescriptor_getFd() on each element.
+ * Null elements are reported as -1, which poll(2) ignores.
+ *
+ * The field lookup is done once and, if \a fileDescriptors is a java.io.FileDescriptor[], the
+ * per-element type check is skipped.
+ *
+ * Aborts the program if \a fileDescriptors is NULL, has fewer than \a count elements, or holds an
+ * object that is not a java.io.FileDescriptor.
+ *
+ * Available since API level 33.
+ *
+ * \param env a pointer to the JNI Native Interface of the current thread.
+ * \param fileDescriptors an array of java.io.FileDescriptor instances.
+ * \param fds an array of at least \a count elements to receive the Unix file descriptors.
+ * \param count the number of elements to read.
+ */
+void AFileDescriptor_getFds(JNIEnv* env, jobjectArray fileDescriptors, int* fds, size_t count)
+    __INTRODUCED_IN(33);
+
+/**
+ * Sets the Unix file descriptors represented by the first \a count elements of an array of
+ * java.io.FileDescriptor from \a fds, as if by calling AFileDescriptor_setFd() on each element.
+ *
+ * Aborts the program if \a fileDescriptors is NULL, has fewer than \a count elements, or holds a
+ * null element or an object that is not a java.io.FileDescriptor.
+ *
+ * Available since API level 33.
+ *
+ * \param env a pointer to the JNI Native Interface of the current thread.
+ * \param fileDescriptors an array of java.io.FileDescriptor instances.
+ * \param fds an array of \a count Unix file descriptors.
+ * \param count the number of elements to set.
+ */
+void AFileDescriptor_setFds(JNIEnv* env, jobjectArray fileDescriptors, const int* fds,
+                            size_t count) __INTRODUCED_IN(33);
+
 __END_DECLS
 
 /** @} */
@@ -26,15 +26,23 @@
 
 #include <errno.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#if defined(__cplusplus) && __cplusplus >= 201703L
+#include <string_view>
+#endif
+
 #include <jni.h>
 
 #include <android/log.h>
 
+#include <nativehelper/utf8_to_utf16.h>
+
 // Avoid formatting this as it must match webview's usage (webview/graphics_utils.cpp).
 // clang-format off
 #ifndef NELEM
@@ -43,40 +51,156 @@
 // clang-format on
 
 /*
- * For C++ code, we provide inlines that map to the C functions.  g++ always
- * inlines these, even on non-optimized builds.
+ * An entry for jniRegisterNativeMethodsBatch: the native methods of one class.
+ */
+struct JniNativeRegistration {
+    /* Class name as passed to FindClass, e.g. "java/lang/String". */
+    const char* className;
+    /* Optional already resolved class. If not NULL no FindClass is needed for this entry. */
+    jclass clazz;
+    const JNINativeMethod* methods;
+    int numMethods;
+    /* Set by jniRegisterNativeMethodsBatch: time spent in FindClass and RegisterNatives. */
+    int64_t findClassNs;
+    int64_t registerNativesNs;
+};
+#if !defined(__cplusplus)
+typedef struct JniNativeRegistration JniNativeRegistration;
+#endif
+
+/*
+ * Code built with the platform headers of libnativehelper, i.e. that uses libnativehelper or
+ * libnativehelper_lazy, shares its exception class cache. See JniExceptionCache.h.
+ */
+#if defined(__has_include)
+#if __has_include(<nativehelper/JniExceptionCache.h>)
+#include <nativehelper/JniExceptionCache.h>
+#define JNIHELP_HAS_EXCEPTION_CACHE 1
+#endif
+#endif
+
+/*
+ * For C++ code, we provide inlines that map to the C functions.
+ *
+ * Only the small wrappers are meant to be inlined into callers. The larger helpers are hidden
+ * inline functions kept out of line, so that a binary has a single copy of each however many of
+ * its translation units include this header, and those only reached when reporting errors, such
+ * as throwing and rendering exceptions, are also marked cold so that the compiler moves them, and
+ * the branches that call them, away from the hot code.
  */
 #if defined(__cplusplus)
 
+#define JNIHELP_INLINE [[maybe_unused]] inline __attribute__((visibility("hidden")))
+#define JNIHELP_OUT_OF_LINE JNIHELP_INLINE __attribute__((noinline))
+#define JNIHELP_COLD JNIHELP_INLINE __attribute__((cold, noinline))
+
+/*
+ * The throw helpers differ with JNIHELP_HAS_EXCEPTION_CACHE, which depends on the include path
+ * and so may differ between translation units of a binary. They have internal linkage, so that
+ * each translation unit keeps the definition it was compiled with.
+ */
+#define JNIHELP_THROW_INLINE [[maybe_unused]] static inline
+#define JNIHELP_THROW_OUT_OF_LINE [[maybe_unused]] static __attribute__((noinline))
+#define JNIHELP_THROW_COLD [[maybe_unused]] static __attribute__((cold, noinline))
+
 namespace android::jnihelp {
 struct [[maybe_unused]] ExpandableString {
     size_t dataSize; // The length of the C string data (not including the null-terminator).
+    size_t capacity; // The size of the storage at |data| (including the null-terminator).
     char* data;      // The C string data.
+    char* buffer;    // Optional caller supplied storage used before any heap allocation.
+    size_t bufferSize; // The size of |buffer|.
 };
 
-[[maybe_unused]] static void ExpandableStringInitialize(struct ExpandableString* s) {
+// Size of on-stack storage for exception summaries. Large enough for the common
+// "<exception_class_name>: <exception_message>" case to avoid heap allocation.
+[[maybe_unused]] static constexpr size_t kExceptionSummaryBufferSize = 256;
+
+// Size in code units of on-stack storage for jniCreateStringUtf8. Longer strings are
+// transcoded into heap storage.
+[[maybe_unused]] static constexpr size_t kUtf16StackBufferSize = 256;
+
+JNIHELP_INLINE bool ExpandableStringIsHeapAllocated(const struct ExpandableString* s) {
+    return s->data != NULL && s->data != s->buffer;
+}
+
+JNIHELP_INLINE void ExpandableStringInitialize(struct ExpandableString* s) {
     memset(s, 0, sizeof(*s));
 }
 
-[[maybe_unused]] static void ExpandableStringRelease(struct ExpandableString* s) {
-    free(s->data);
+JNIHELP_INLINE void ExpandableStringInitializeWithBuffer(struct ExpandableString* s, char* buffer,
+                                                         size_t bufferSize) {
     memset(s, 0, sizeof(*s));
+    s->buffer = buffer;
+    s->bufferSize = bufferSize;
+}
+
+JNIHELP_COLD void ExpandableStringRelease(struct ExpandableString* s) {
+    if (ExpandableStringIsHeapAllocated(s)) {
+        free(s->data);
+    }
+    s->dataSize = 0;
+    s->capacity = 0;
+    s->data = NULL;
+}
+
+JNIHELP_COLD bool ExpandableStringReserve(struct ExpandableString* s, size_t length) {
+    size_t requiredSize = length + 1;
+    if (requiredSize <= s->capacity) {
+        return true;
+    }
+
+    if (s->data == NULL && requiredSize <= s->bufferSize) {
+        // Use the caller supplied storage until it is exhausted.
+        s->data = s->buffer;
+        s->capacity = s->bufferSize;
+        s->data[0] = '\0';
+        return true;
+    }
+
+    constexpr size_t kMinimumCapacity = 64;
+    size_t newCapacity = (s->capacity < kMinimumCapacity) ? kMinimumCapacity : s->capacity;
+    while (newCapacity < requiredSize) {
+        if (newCapacity > SIZE_MAX / 2) {
+            newCapacity = requiredSize;
+            break;
+        }
+        newCapacity *= 2;
+    }
+
+    char* data;
+    if (ExpandableStringIsHeapAllocated(s)) {
+        data = (char*)realloc(s->data, newCapacity);
+        if (data == NULL) {
+            return false;
+        }
+    } else {
+        data = (char*)malloc(newCapacity);
+        if (data == NULL) {
+            return false;
+        }
+        if (s->data != NULL) {
+            memcpy(data, s->data, s->dataSize + 1);
+        } else {
+            data[0] = '\0';
+        }
+    }
+    s->data = data;
+    s->capacity = newCapacity;
+    return true;
 }
 
-[[maybe_unused]] static bool ExpandableStringAppend(struct ExpandableString* s, const char* text) {
+JNIHELP_COLD bool ExpandableStringAppend(struct ExpandableString* s, const char* text) {
     size_t textSize = strlen(text);
-    size_t requiredSize = s->dataSize + textSize + 1;
-    char* data = (char*)realloc(s->data, requiredSize);
-    if (data == NULL) {
+    if (!ExpandableStringReserve(s, s->dataSize + textSize)) {
         return false;
     }
-    s->data = data;
     memcpy(s->data + s->dataSize, text, textSize + 1);
     s->dataSize += textSize;
     return true;
 }
 
-[[maybe_unused]] static bool ExpandableStringAssign(struct ExpandableString* s, const char* text) {
+JNIHELP_COLD bool ExpandableStringAssign(struct ExpandableString* s, const char* text) {
     ExpandableStringRelease(s);
     return ExpandableStringAppend(s, text);
 }
@@ -95,12 +219,12 @@ struct [[maybe_unused]] ExpandableString {
     return buf;
 }
 
-[[maybe_unused]] static const char* platformStrError(int errnum, char* buf, size_t buflen) {
+JNIHELP_INLINE const char* platformStrError(int errnum, char* buf, size_t buflen) {
     return safe_strerror(strerror_r, errnum, buf, buflen);
 }
 
-[[maybe_unused]] static jmethodID FindMethod(JNIEnv* env, const char* className,
-                                             const char* methodName, const char* descriptor) {
+JNIHELP_COLD jmethodID FindMethod(JNIEnv* env, const char* className, const char* methodName,
+                                  const char* descriptor) {
     // This method is only valid for classes in the core library which are
     // not unloaded during the lifetime of managed code execution.
     jclass clazz = env->FindClass(className);
@@ -109,8 +233,7 @@ struct [[maybe_unused]] ExpandableString {
     return methodId;
 }
 
-[[maybe_unused]] static bool AppendJString(JNIEnv* env, jstring text,
-                                           struct ExpandableString* dst) {
+JNIHELP_COLD bool AppendJString(JNIEnv* env, jstring text, struct ExpandableString* dst) {
     const char* utfText = env->GetStringUTFChars(text, NULL);
     if (utfText == NULL) {
         return false;
@@ -125,8 +248,8 @@ struct [[maybe_unused]] ExpandableString {
  * be populated with the "binary" class name and, if present, the
  * exception message.
  */
-[[maybe_unused]] static bool GetExceptionSummary(JNIEnv* env, jthrowable thrown,
-                                                 struct ExpandableString* dst) {
+JNIHELP_COLD bool GetExceptionSummary(JNIEnv* env, jthrowable thrown,
+                                      struct ExpandableString* dst) {
     // Summary is <exception_class_name> ": " <exception_message>
     jclass exceptionClass = env->GetObjectClass(thrown); // Always succeeds
     jmethodID getName = FindMethod(env, "java/lang/Class", "getName", "()Ljava/lang/String;");
@@ -174,7 +297,7 @@ struct [[maybe_unused]] ExpandableString {
     return success;
 }
 
-[[maybe_unused]] static jobject NewStringWriter(JNIEnv* env) {
+JNIHELP_COLD jobject NewStringWriter(JNIEnv* env) {
     jclass clazz = env->FindClass("java/io/StringWriter");
     jmethodID init = env->GetMethodID(clazz, "<init>", "()V");
     jobject instance = env->NewObject(clazz, init);
@@ -182,13 +305,13 @@ struct [[maybe_unused]] ExpandableString {
     return instance;
 }
 
-[[maybe_unused]] static jstring StringWriterToString(JNIEnv* env, jobject stringWriter) {
+JNIHELP_COLD jstring StringWriterToString(JNIEnv* env, jobject stringWriter) {
     jmethodID toString =
             FindMethod(env, "java/io/StringWriter", "toString", "()Ljava/lang/String;");
     return (jstring)env->CallObjectMethod(stringWriter, toString);
 }
 
-[[maybe_unused]] static jobject NewPrintWriter(JNIEnv* env, jobject writer) {
+JNIHELP_COLD jobject NewPrintWriter(JNIEnv* env, jobject writer) {
     jclass clazz = env->FindClass("java/io/PrintWriter");
     jmethodID init = env->GetMethodID(clazz, "<init>", "(Ljava/io/Writer;)V");
     jobject instance = env->NewObject(clazz, init, writer);
@@ -196,8 +319,7 @@ struct [[maybe_unused]] ExpandableString {
     return instance;
 }
 
-[[maybe_unused]] static bool GetStackTrace(JNIEnv* env, jthrowable thrown,
-                                           struct ExpandableString* dst) {
+JNIHELP_COLD bool GetStackTrace(JNIEnv* env, jthrowable thrown, struct ExpandableString* dst) {
     // This function is equivalent to the following Java snippet:
     //   StringWriter sw = new StringWriter();
     //   PrintWriter pw = new PrintWriter(sw);
@@ -235,8 +357,8 @@ struct [[maybe_unused]] ExpandableString {
     return success;
 }
 
-[[maybe_unused]] static void GetStackTraceOrSummary(JNIEnv* env, jthrowable thrown,
-                                                    struct ExpandableString* dst) {
+JNIHELP_COLD void GetStackTraceOrSummary(JNIEnv* env, jthrowable thrown,
+                                         struct ExpandableString* dst) {
     // This method attempts to get a stack trace or summary info for an exception.
     // The exception may be provided in the |thrown| argument to this function.
     // If |thrown| is NULL, then any pending exception is used if it exists.
@@ -269,15 +391,16 @@ struct [[maybe_unused]] ExpandableString {
     }
 }
 
-[[maybe_unused]] static void DiscardPendingException(JNIEnv* env, const char* className) {
+JNIHELP_COLD void DiscardPendingException(JNIEnv* env, const char* className) {
     jthrowable exception = env->ExceptionOccurred();
     env->ExceptionClear();
     if (exception == NULL) {
         return;
     }
 
+    char summaryBuffer[kExceptionSummaryBufferSize];
     struct ExpandableString summary;
-    ExpandableStringInitialize(&summary);
+    ExpandableStringInitializeWithBuffer(&summary, summaryBuffer, sizeof(summaryBuffer));
     GetExceptionSummary(env, exception, &summary);
     const char* details = (summary.data != NULL) ? summary.data : "Unknown";
     __android_log_print(ANDROID_LOG_WARN, "JNIHelp",
@@ -286,14 +409,12 @@ struct [[maybe_unused]] ExpandableString {
     env->DeleteLocalRef(exception);
 }
 
-[[maybe_unused]] static int ThrowException(JNIEnv* env, const char* className, const char* ctorSig,
-                                           ...) {
+// Throws without the exception class cache of libnativehelper.
+JNIHELP_COLD int ThrowExceptionV(JNIEnv* env, const char* className, const char* ctorSig,
+                                 va_list args) {
     int status = -1;
     jclass exceptionClass = NULL;
 
-    va_list args;
-    va_start(args, ctorSig);
-
     DiscardPendingException(env, className);
 
     {
@@ -333,14 +454,87 @@ struct [[maybe_unused]] ExpandableString {
     }
 
 end:
-    va_end(args);
     if (exceptionClass != NULL) {
         env->DeleteLocalRef(exceptionClass);
     }
     return status;
 }
 
-[[maybe_unused]] static jstring CreateExceptionMsg(JNIEnv* env, const char* msg) {
+JNIHELP_THROW_COLD int ThrowException(JNIEnv* env, const char* className, const char* ctorSig,
+                                      ...) {
+    va_list args;
+    va_start(args, ctorSig);
+#if defined(JNIHELP_HAS_EXCEPTION_CACHE)
+    int status = jniThrowExceptionWithCtorV(&env->functions, className, ctorSig, args);
+#else
+    int status = ThrowExceptionV(env, className, ctorSig, args);
+#endif
+    va_end(args);
+    return status;
+}
+
+// Size of on-stack storage for formatted exception messages. Longer messages are formatted into
+// heap storage.
+[[maybe_unused]] static constexpr size_t kExceptionMessageBufferSize = 512;
+
+// Terminates the UTF-8 string |s| at |length| bytes, dropping any multi-byte sequence that would
+// be left incomplete.
+JNIHELP_COLD void TruncateUtf8(char* s, size_t length) {
+    size_t start = length;
+    while (start > 0 && (s[start - 1] & 0xc0) == 0x80) {
+        --start;
+    }
+    if (start > 0) {
+        unsigned char lead = static_cast<unsigned char>(s[start - 1]);
+        size_t sequenceLength = (lead < 0xc0) ? 1 : (lead < 0xe0) ? 2 : (lead < 0xf0) ? 3 : 4;
+        if (start - 1 + sequenceLength > length) {
+            length = start - 1;
+        }
+    }
+    s[length] = '\0';
+}
+
+// Formats a message of at most |maxLength| bytes into |stackBuffer|, or into heap storage
+// returned in |heapBuffer| if the message does not fit. The caller must free |heapBuffer|.
+JNIHELP_COLD const char* FormatExceptionMsgV(char* stackBuffer, size_t stackBufferSize,
+                                             char** heapBuffer, size_t maxLength, const char* fmt,
+                                             va_list args) {
+    char* msg = stackBuffer;
+    *heapBuffer = NULL;
+
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int formattedLength = vsnprintf(stackBuffer, stackBufferSize, fmt, argsCopy);
+    va_end(argsCopy);
+    if (formattedLength < 0) {
+        stackBuffer[0] = '\0';
+        formattedLength = 0;
+    }
+
+    size_t length = static_cast<size_t>(formattedLength);
+    if (length >= stackBufferSize && maxLength >= stackBufferSize) {
+        size_t heapSize = ((length < maxLength) ? length : maxLength) + 1;
+        *heapBuffer = static_cast<char*>(malloc(heapSize));
+        if (*heapBuffer != NULL) {
+            vsnprintf(*heapBuffer, heapSize, fmt, args);
+            msg = *heapBuffer;
+            length = heapSize - 1;
+        } else {
+            length = stackBufferSize - 1;
+        }
+    } else if (length >= stackBufferSize) {
+        length = stackBufferSize - 1;
+    }
+    if (length > maxLength) {
+        length = maxLength;
+    }
+    if (length < static_cast<size_t>(formattedLength)) {
+        TruncateUtf8(msg, length);
+    }
+    return msg;
+}
+
+JNIHELP_COLD jstring CreateExceptionMsg(JNIEnv* env, const char* msg) {
     jstring detailMessage = env->NewStringUTF(msg);
     if (detailMessage == NULL) {
         /* Not really much we can do here. We're probably dead in the water,
@@ -351,13 +545,47 @@ end:
 }
 } // namespace android::jnihelp
 
+namespace android::jnihelp {
+JNIHELP_INLINE int64_t NowNanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+// Reports the failure of RegisterNatives for |className|, which is fatal.
+JNIHELP_COLD void AbortRegisterNatives(JNIEnv* env, const char* className) {
+    // Try to report the corresponding exception, otherwise abort with generic failure message.
+    jthrowable thrown = env->ExceptionOccurred();
+    if (thrown != NULL) {
+        char summaryBuffer[kExceptionSummaryBufferSize];
+        struct ExpandableString summary;
+        ExpandableStringInitializeWithBuffer(&summary, summaryBuffer, sizeof(summaryBuffer));
+        if (GetExceptionSummary(env, thrown, &summary)) {
+            __android_log_print(ANDROID_LOG_FATAL, "JNIHelp", "%s", summary.data);
+        }
+        ExpandableStringRelease(&summary);
+        env->DeleteLocalRef(thrown);
+    }
+    __android_log_print(ANDROID_LOG_FATAL, "JNIHelp",
+                        "RegisterNatives failed for '%s'; aborting...", className);
+}
+
+JNIHELP_INLINE int RegisterNativesOrAbort(JNIEnv* env, jclass clazz, const char* className,
+                                          const JNINativeMethod* methods, int numMethods) {
+    int result = env->RegisterNatives(clazz, methods, numMethods);
+    if (result != 0) {
+        AbortRegisterNatives(env, className);
+    }
+    return result;
+}
+} // namespace android::jnihelp
+
 /*
  * Register one or more native methods with a particular class.  "className" looks like
  * "java/lang/String". Aborts on failure, returns 0 on success.
  */
-[[maybe_unused]] static int jniRegisterNativeMethods(JNIEnv* env, const char* className,
-                                                     const JNINativeMethod* methods,
-                                                     int numMethods) {
+JNIHELP_OUT_OF_LINE int jniRegisterNativeMethods(JNIEnv* env, const char* className,
+                                                 const JNINativeMethod* methods, int numMethods) {
     using namespace android::jnihelp;
     jclass clazz = env->FindClass(className);
     if (clazz == NULL) {
@@ -365,27 +593,44 @@ end:
                              "Native registration unable to find class '%s'; aborting...",
                              className);
     }
-    int result = env->RegisterNatives(clazz, methods, numMethods);
+    int result = RegisterNativesOrAbort(env, clazz, className, methods, numMethods);
     env->DeleteLocalRef(clazz);
-    if (result == 0) {
-        return 0;
-    }
+    return result;
+}
 
-    // Failure to register natives is fatal. Try to report the corresponding exception,
-    // otherwise abort with generic failure message.
-    jthrowable thrown = env->ExceptionOccurred();
-    if (thrown != NULL) {
-        struct ExpandableString summary;
-        ExpandableStringInitialize(&summary);
-        if (GetExceptionSummary(env, thrown, &summary)) {
-            __android_log_print(ANDROID_LOG_FATAL, "JNIHelp", "%s", summary.data);
+/*
+ * Register the native methods of several classes in one call. See JniNativeRegistration.
+ * Aborts on failure, returns 0 on success.
+ */
+JNIHELP_OUT_OF_LINE int jniRegisterNativeMethodsBatch(JNIEnv* env, JniNativeRegistration* entries,
+                                                      size_t count) {
+    using namespace android::jnihelp;
+    for (size_t i = 0; i < count; ++i) {
+        JniNativeRegistration* entry = &entries[i];
+        const char* className = entry->className != NULL ? entry->className : "<unnamed>";
+        int64_t start = NowNanos();
+        jclass clazz = entry->clazz;
+        if (clazz == NULL) {
+            clazz = env->FindClass(entry->className);
+            if (clazz == NULL) {
+                __android_log_assert("clazz == NULL", "JNIHelp",
+                                     "Native registration unable to find class '%s'; aborting...",
+                                     className);
+            }
+        }
+        int64_t found = NowNanos();
+        int result = RegisterNativesOrAbort(env, clazz, className, entry->methods,
+                                            entry->numMethods);
+        if (clazz != entry->clazz) {
+            env->DeleteLocalRef(clazz);
+        }
+        entry->findClassNs = found - start;
+        entry->registerNativesNs = NowNanos() - found;
+        if (result != 0) {
+            return result;
         }
-        ExpandableStringRelease(&summary);
-        env->DeleteLocalRef(thrown);
     }
-    __android_log_print(ANDROID_LOG_FATAL, "JNIHelp",
-                        "RegisterNatives failed for '%s'; aborting...", className);
-    return result;
+    return 0;
 }
 
 /*
@@ -402,7 +647,7 @@ end:
  *
  * Currently aborts the VM if it can't throw the exception.
  */
-[[maybe_unused]] static int jniThrowException(JNIEnv* env, const char* className, const char* msg) {
+JNIHELP_THROW_COLD int jniThrowException(JNIEnv* env, const char* className, const char* msg) {
     using namespace android::jnihelp;
     jstring _detailMessage = CreateExceptionMsg(env, msg);
     int _status = ThrowException(env, className, "(Ljava/lang/String;)V", _detailMessage);
@@ -415,8 +660,7 @@ end:
 /*
  * Throw an android.system.ErrnoException, with the given function name and errno value.
  */
-[[maybe_unused]] static int jniThrowErrnoException(JNIEnv* env, const char* functionName,
-                                                   int errnum) {
+JNIHELP_THROW_COLD int jniThrowErrnoException(JNIEnv* env, const char* functionName, int errnum) {
     using namespace android::jnihelp;
     jstring _detailMessage = CreateExceptionMsg(env, functionName);
     int _status = ThrowException(env, "android/system/ErrnoException", "(Ljava/lang/String;I)V",
@@ -441,51 +685,115 @@ end:
  *
  * Currently aborts the VM if it can't throw the exception.
  */
-[[maybe_unused]] static int jniThrowExceptionFmt(JNIEnv* env, const char* className,
-                                                 const char* fmt, ...) {
+JNIHELP_THROW_COLD int jniThrowExceptionFmt(JNIEnv* env, const char* className, const char* fmt,
+                                            ...) {
+    using namespace android::jnihelp;
+    va_list args;
+    va_start(args, fmt);
+    char msgBuf[kExceptionMessageBufferSize];
+    char* heapMsg;
+    const char* msg = FormatExceptionMsgV(msgBuf, sizeof(msgBuf), &heapMsg, SIZE_MAX, fmt, args);
+    va_end(args);
+    int status = jniThrowException(env, className, msg);
+    free(heapMsg);
+    return status;
+}
+
+/*
+ * Throw an exception with the specified class and formatted error message of at most
+ * "maxMessageLength" bytes. Longer messages are truncated at a character boundary.
+ *
+ * Otherwise behaves as jniThrowExceptionFmt.
+ */
+JNIHELP_THROW_COLD int jniThrowExceptionFmtWithLimit(JNIEnv* env, const char* className,
+                                                     size_t maxMessageLength, const char* fmt,
+                                                     ...) {
+    using namespace android::jnihelp;
     va_list args;
     va_start(args, fmt);
-    char msgBuf[512];
-    vsnprintf(msgBuf, sizeof(msgBuf), fmt, args);
+    char msgBuf[kExceptionMessageBufferSize];
+    char* heapMsg;
+    const char* msg = FormatExceptionMsgV(msgBuf, sizeof(msgBuf), &heapMsg, maxMessageLength, fmt,
+                                          args);
     va_end(args);
-    return jniThrowException(env, className, msgBuf);
+    int status = jniThrowException(env, className, msg);
+    free(heapMsg);
+    return status;
 }
 
-[[maybe_unused]] static int jniThrowNullPointerException(JNIEnv* env, const char* msg) {
+JNIHELP_THROW_INLINE int jniThrowNullPointerException(JNIEnv* env, const char* msg) {
     return jniThrowException(env, "java/lang/NullPointerException", msg);
 }
 
-[[maybe_unused]] static int jniThrowRuntimeException(JNIEnv* env, const char* msg) {
+JNIHELP_THROW_INLINE int jniThrowRuntimeException(JNIEnv* env, const char* msg) {
     return jniThrowException(env, "java/lang/RuntimeException", msg);
 }
 
-[[maybe_unused]] static int jniThrowIOException(JNIEnv* env, int errno_value) {
+/*
+ * Throw a java.io.IOException with the strerror message of |errno_value|. With the exception
+ * cache of libnativehelper this is its C jniThrowIOException, which also caches the message.
+ */
+JNIHELP_THROW_COLD int jniThrowIOException(JNIEnv* env, int errno_value) {
+#if defined(JNIHELP_HAS_EXCEPTION_CACHE)
+    return jniThrowIOException(&env->functions, errno_value);
+#else
     using namespace android::jnihelp;
     char buffer[80];
     const char* message = platformStrError(errno_value, buffer, sizeof(buffer));
     return jniThrowException(env, "java/io/IOException", message);
+#endif
 }
 
 /*
  * Returns a Java String object created from UTF-16 data either from jchar or,
  * if called from C++11, char16_t (a bitwise identical distinct type).
  */
-[[maybe_unused]] static inline jstring jniCreateString(JNIEnv* env, const jchar* unicodeChars,
-                                                       jsize len) {
+JNIHELP_INLINE jstring jniCreateString(JNIEnv* env, const jchar* unicodeChars, jsize len) {
     return env->NewString(unicodeChars, len);
 }
 
-[[maybe_unused]] static inline jstring jniCreateString(JNIEnv* env, const char16_t* unicodeChars,
-                                                       jsize len) {
+JNIHELP_INLINE jstring jniCreateString(JNIEnv* env, const char16_t* unicodeChars, jsize len) {
     return jniCreateString(env, reinterpret_cast<const jchar*>(unicodeChars), len);
 }
 
+/*
+ * Returns a Java String object created from |length| bytes of standard UTF-8, which need
+ * not be NUL-terminated. Ill-formed input is replaced with U+FFFD as by
+ * new String(bytes, StandardCharsets.UTF_8). Returns NULL with an exception pending on failure.
+ *
+ * Unlike NewStringUTF this takes standard rather than modified UTF-8 and reads the input once.
+ */
+JNIHELP_THROW_OUT_OF_LINE jstring jniCreateStringUtf8(JNIEnv* env, const char* utf8,
+                                                      size_t length) {
+    jchar stackBuffer[android::jnihelp::kUtf16StackBufferSize];
+    jchar* utf16 = stackBuffer;
+    if (length > android::jnihelp::kUtf16StackBufferSize) {
+        if (length > INT32_MAX ||
+            (utf16 = static_cast<jchar*>(malloc(length * sizeof(jchar)))) == nullptr) {
+            jniThrowException(env, "java/lang/OutOfMemoryError", "jniCreateStringUtf8");
+            return nullptr;
+        }
+    }
+    size_t count = jniUtf8ToUtf16(utf8, length, utf16);
+    jstring result = env->NewString(utf16, static_cast<jsize>(count));
+    if (utf16 != stackBuffer) {
+        free(utf16);
+    }
+    return result;
+}
+
+#if __cplusplus >= 201703L
+JNIHELP_THROW_INLINE jstring jniCreateStringUtf8(JNIEnv* env, std::string_view utf8) {
+    return jniCreateStringUtf8(env, utf8.data(), utf8.size());
+}
+#endif
+
 /*
  * Log a message and an exception.
  * If exception is NULL, logs the current exception in the JNI environment.
  */
-[[maybe_unused]] static void jniLogException(JNIEnv* env, int priority, const char* tag,
-                                             jthrowable exception = NULL) {
+JNIHELP_COLD void jniLogException(JNIEnv* env, int priority, const char* tag,
+                                  jthrowable exception = NULL) {
     using namespace android::jnihelp;
     struct ExpandableString summary;
     ExpandableStringInitialize(&summary);
@@ -495,6 +803,13 @@ end:
     ExpandableStringRelease(&summary);
 }
 
+#undef JNIHELP_THROW_COLD
+#undef JNIHELP_THROW_OUT_OF_LINE
+#undef JNIHELP_THROW_INLINE
+#undef JNIHELP_COLD
+#undef JNIHELP_OUT_OF_LINE
+#undef JNIHELP_INLINE
+
 #else // defined(__cplusplus)
 
 // ART-internal only methods (not exported), exposed for legacy C users
@@ -502,10 +817,32 @@ end:
 int jniRegisterNativeMethods(JNIEnv* env, const char* className, const JNINativeMethod* gMethods,
                              int numMethods);
 
+/*
+ * Register the native methods of several classes in one call, recording the time spent on each
+ * entry. Aborts on failure, returns 0 on success.
+ */
+int jniRegisterNativeMethodsBatch(JNIEnv* env, JniNativeRegistration* entries, size_t count);
+
 void jniLogException(JNIEnv* env, int priority, const char* tag, jthrowable thrown);
 
 int jniThrowException(JNIEnv* env, const char* className, const char* msg);
 
 int jniThrowNullPointerException(JNIEnv* env, const char* msg);
 
+/*
+ * Returns a Java String object created from |length| bytes of standard UTF-8, which need not be
+ * NUL-terminated. Ill-formed input is replaced with U+FFFD. Returns NULL with an exception
+ * pending on failure.
+ */
+jstring jniCreateStringUtf8(JNIEnv* env, const char* utf8, size_t length);
+
+/*
+ * Throw an exception with the specified class and formatted error message of at most
+ * "maxMessageLength" bytes. Longer messages are truncated at a character boundary.
+ */
+int jniThrowExceptionFmtWithLimit(JNIEnv* env, const char* className, size_t maxMessageLength,
+                                  const char* fmt, va_list args);
+
 #endif // defined(__cplusplus)
+
+#undef JNIHELP_HAS_EXCEPTION_CACHE
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#if defined(__cplusplus) && __cplusplus >= 201703L
+
+#include <stddef.h>
+
+#include <string_view>
+#include <vector>
+
+#include "JNIHelp.h"
+#include "ScopedLocalFrame.h"
+
+namespace android {
+namespace jnihelp {
+
+// Number of elements read in each local reference frame by fromStringArray.
+static constexpr jint kFromStringArrayBatchSize = 128;
+
+}  // namespace jnihelp
+}  // namespace android
+
+// The elements of a Java String[] as modified UTF-8, filled in by fromStringArray. All the
+// characters are stored in one arena, each string followed by a NUL, and element i is a view
+// into it. The views are valid for the lifetime of the object.
+class NativeStringArray {
+public:
+    NativeStringArray() = default;
+    NativeStringArray(NativeStringArray&&) = default;
+    NativeStringArray& operator=(NativeStringArray&&) = default;
+
+    size_t size() const {
+        return mViews.size();
+    }
+
+    bool empty() const {
+        return mViews.empty();
+    }
+
+    std::string_view operator[](size_t i) const {
+        return mViews[i];
+    }
+
+    // Element i as a NUL-terminated string.
+    const char* c_str(size_t i) const {
+        return mViews[i].data();
+    }
+
+    std::vector<std::string_view>::const_iterator begin() const {
+        return mViews.begin();
+    }
+
+    std::vector<std::string_view>::const_iterator end() const {
+        return mViews.end();
+    }
+
+private:
+    friend bool fromStringArray(JNIEnv* env, jobjectArray array, NativeStringArray* result);
+
+    std::vector<char> mArena;
+    std::vector<std::string_view> mViews;
+
+    NativeStringArray(const NativeStringArray&) = delete;
+    void operator=(const NativeStringArray&) = delete;
+};
+
+// Reads every element of |array| into |result|, replacing its contents. Returns false with an
+// exception pending if |array| or one of its elements is null.
+//
+// Each element is read once: GetObjectArrayElement, GetStringLength, GetStringUTFLength and
+// GetStringUTFRegion straight into the arena, which grows as needed. That is as many JNI calls
+// as the usual GetStringUTFChars loop, but without a copy and a std::string per element. The
+// arena and views of |result| are reused, so reading into the same result again does not
+// allocate unless the strings have grown. The elements are read in local frames of
+// kFromStringArrayBatchSize, so a large array does not grow the local reference table.
+inline bool fromStringArray(JNIEnv* env, jobjectArray array, NativeStringArray* result) {
+    std::vector<char>& arena = result->mArena;
+    std::vector<std::string_view>& views = result->mViews;
+    arena.clear();
+    views.clear();
+    if (array == nullptr) {
+        jniThrowNullPointerException(env, "array == null");
+        return false;
+    }
+    const jsize count = env->GetArrayLength(array);
+    views.reserve(count);
+    {
+        ScopedBatchedLocalFrame frame(env, android::jnihelp::kFromStringArrayBatchSize);
+        for (jsize i = 0; i < count; ++i) {
+            jstring s = nullptr;
+            if (frame.isValid()) {
+                s = static_cast<jstring>(env->GetObjectArrayElement(array, i));
+                if (s == nullptr) {
+                    jniThrowNullPointerException(env, "array element == null");
+                }
+            }
+            if (s == nullptr) {
+                arena.clear();
+                views.clear();
+                return false;
+            }
+            const jsize length = env->GetStringLength(s);
+            const size_t utfLength = static_cast<size_t>(env->GetStringUTFLength(s));
+            const size_t offset = arena.size();
+            arena.resize(offset + utfLength + 1);
+            env->GetStringUTFRegion(s, 0, length, arena.data() + offset);
+            arena[offset + utfLength] = '\0';
+            // Only the size is used until the arena has stopped moving.
+            views.emplace_back(arena.data() + offset, utfLength);
+            frame.next();
+        }
+    }
+    const char* chars = arena.data();
+    for (std::string_view& view : views) {
+        view = std::string_view(chars, view.size());
+        chars += view.size() + 1;
+    }
+    return true;
+}
+
+#endif  // defined(__cplusplus) && __cplusplus >= 201703L
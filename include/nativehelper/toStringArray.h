@@ -21,26 +21,75 @@
 #include <string>
 #include <vector>
 
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
 #include "JNIHelp.h"
+#include "ScopedLocalFrame.h"
 #include "ScopedLocalRef.h"
 
+namespace android {
+namespace jnihelp {
+
+// Number of strings created in each local reference frame by toStringArray.
+static constexpr jint kToStringArrayBatchSize = 128;
+
+inline jstring NewStringUTF(JNIEnv* env, const char* s) {
+    return env->NewStringUTF(s);
+}
+
+#if __cplusplus >= 201703L
+// JNI has no length-taking NewStringUTF, so views go through jniCreateStringUtf8, which reads
+// them once in place rather than copying them to add a NUL for NewStringUTF to strlen.
+inline jstring NewStringUTF(JNIEnv* env, std::string_view s) {
+    return jniCreateStringUtf8(env, s);
+}
+#endif
+
+}  // namespace jnihelp
+}  // namespace android
+
+// Returns a new String[] of |count| elements where element i is built from visitor(i). The
+// visitor may return a NUL-terminated const char* of modified UTF-8, or nullptr for a null
+// element, or, for C++17 and later, a std::string_view of standard UTF-8, which may hold NULs
+// and is decoded as by jniCreateStringUtf8.
+//
+// Strings are created in batches of kToStringArrayBatchSize within a local reference frame of
+// that capacity, so a large array does not grow the local reference table and each element costs
+// one NewStringUTF, or NewString for a view, and one SetObjectArrayElement. Returns nullptr with
+// an exception pending on failure.
+//
+// java.lang.String is looked up once per call rather than cached, so that no global reference
+// outlives the Java VM it was created with.
 template <typename StringVisitor>
 jobjectArray toStringArray(JNIEnv* env, size_t count, StringVisitor&& visitor) {
-    jclass stringClass = env->FindClass("java/lang/String");
-    ScopedLocalRef<jobjectArray> result(env, env->NewObjectArray(count, stringClass, NULL));
-    env->DeleteLocalRef(stringClass);
+    ScopedLocalRef<jobjectArray> result(env);
+    {
+        ScopedLocalRef<jclass> stringClass(env, env->FindClass("java/lang/String"));
+        if (stringClass == nullptr) {
+            return nullptr;
+        }
+        result.reset(env->NewObjectArray(count, stringClass.get(), NULL));
+    }
     if (result == nullptr) {
         return nullptr;
     }
+    const jint batchSize = count < static_cast<size_t>(android::jnihelp::kToStringArrayBatchSize)
+            ? static_cast<jint>(count) : android::jnihelp::kToStringArrayBatchSize;
+    ScopedBatchedLocalFrame frame(env, batchSize);
     for (size_t i = 0; i < count; ++i) {
-        ScopedLocalRef<jstring> s(env, env->NewStringUTF(visitor(i)));
-        if (env->ExceptionCheck()) {
+        if (!frame.isValid()) {
             return nullptr;
         }
-        env->SetObjectArrayElement(result.get(), i, s.get());
+        // A null const char* makes a null element, so only a pending exception is a failure.
+        jstring s = android::jnihelp::NewStringUTF(env, visitor(i));
         if (env->ExceptionCheck()) {
             return nullptr;
         }
+        // The index is in range and the element is a String, so this cannot throw.
+        env->SetObjectArrayElement(result.get(), i, s);
+        frame.next();
     }
     return result.release();
 }
@@ -49,6 +98,12 @@ inline jobjectArray toStringArray(JNIEnv* env, const std::vector<std::string>& s
     return toStringArray(env, strings.size(), [&strings](size_t i) { return strings[i].c_str(); });
 }
 
+#if __cplusplus >= 201703L
+inline jobjectArray toStringArray(JNIEnv* env, const std::vector<std::string_view>& strings) {
+    return toStringArray(env, strings.size(), [&strings](size_t i) { return strings[i]; });
+}
+#endif
+
 inline jobjectArray toStringArray(JNIEnv* env, const char* const* strings) {
     size_t count = 0;
     for (; strings[count] != nullptr; ++count) {}
@@ -73,11 +73,113 @@ jlong jniGetNioBufferFields(C_JNIEnv* env,
  */
 jlong jniGetNioBufferPointer(C_JNIEnv* env, jobject nioBuffer);
 
+/*
+ * Description of a java.nio.Buffer instance, filled in by jniGetNioBufferInfo().
+ */
+struct JniNioBufferInfo {
+    /* Address of the current position for direct buffers, 0 otherwise. */
+    jlong address;
+    /* Local reference to the managed array backing the buffer, or NULL if there is none. */
+    jarray baseArray;
+    /* Offset of the current position in bytes from the start of |baseArray|. */
+    jint baseArrayOffset;
+    /* The |position|, |limit| and |elementSizeShift| fields of the buffer. */
+    jint position;
+    jint limit;
+    jint elementSizeShift;
+    /* Number of bytes between the current position and the limit. */
+    jlong remainingBytes;
+    /* JNI_TRUE if the buffer is backed by a direct buffer. */
+    jboolean isDirect;
+};
+
+/*
+ * Gets everything needed to access the contents of a java.nio.Buffer instance in one call.
+ *
+ * The buffer fields are read once. For buffers that are not direct this method also performs
+ * JNI calls to java.nio.NIOAccess.getBaseArray() and java.nio.NIOAccess.getBaseArrayOffset(),
+ * which direct buffers do not need. The caller owns the |baseArray| local reference.
+ */
+void jniGetNioBufferInfo(C_JNIEnv* env, jobject nioBuffer, /*out*/struct JniNioBufferInfo* info);
+
+/*
+ * Logs |thrown|, or the pending exception if it is NULL, like jniLogException, but collapses
+ * storms of the same exception. Exceptions are fingerprinted by class, message and top stack
+ * frames. The full stack trace is logged the first time a fingerprint is seen in a window,
+ * further occurrences in the window are only counted, and the count is logged with the next
+ * occurrence after the window ends. Counting a repeat costs a few up-calls instead of the
+ * printStackTrace rendering of the full trace.
+ */
+void jniLogExceptionDeduplicated(C_JNIEnv* env, int priority, const char* tag, jthrowable thrown);
+
+/*
+ * Sets the window of jniLogExceptionDeduplicated, 10 seconds by default. A window of 0 logs every
+ * exception in full.
+ */
+void jniSetLogExceptionDeduplicationWindow(int64_t windowMs);
+
+/*
+ * Logs |thrown|, or the pending exception if it is NULL, like jniLogException, but on a logger
+ * thread so that rendering and writing the stack trace does not delay the caller. The caller
+ * only takes a global reference and queues it, without blocking. If the queue is full the
+ * exception is dropped and counted in JniAsyncExceptionLogStats.
+ *
+ * The logger thread is started and attached to the VM of |env| as a daemon by the first call.
+ * If it cannot be started or attached, exceptions are logged synchronously, including any that
+ * were queued for it. jniUninitializeConstants(), which is called once the runtime has shut
+ * down, leaves the thread parked without using the runtime again and drops any exceptions still
+ * queued, without deleting their global references. The next call after it starts a new thread.
+ *
+ * Not for the zygote, or any process that forks after the first call: a forked child does not
+ * have the logger thread, and what it queues would never be logged.
+ */
+void jniLogExceptionAsync(C_JNIEnv* env, int priority, const char* tag, jthrowable thrown);
+
+/*
+ * Waits until the logger thread has written every exception queued before the call. Returns at
+ * once if the logger thread failed to attach, the next jniLogExceptionAsync call then logs what
+ * is left in the queue.
+ */
+void jniFlushAsyncExceptionLog();
+
+/*
+ * Counters of jniLogExceptionAsync, filled in by jniGetAsyncExceptionLogStats().
+ */
+struct JniAsyncExceptionLogStats {
+    /* Exceptions queued for the logger thread. */
+    uint64_t queued;
+    /* Exceptions written by the logger thread. */
+    uint64_t logged;
+    /* Exceptions dropped because the queue was full, or still queued when the logger thread was
+     * abandoned by jniUninitializeConstants(). */
+    uint64_t dropped;
+};
+
+void jniGetAsyncExceptionLogStats(/*out*/struct JniAsyncExceptionLogStats* stats);
+
+/*
+ * Resolves the constants libnativehelper caches, which are otherwise resolved on first use.
+ * The runtime or an application can call this during startup so that the FindClass and
+ * GetFieldID calls are not made on a latency-sensitive thread later.
+ */
+void jniInitializeConstants(C_JNIEnv* env);
+
 /*
  * Clear the cache of constants libnativehelper is using.
  */
 void jniUninitializeConstants();
 
+/*
+ * Returns a String with the contents of |utf8|, in modified UTF-8 as for NewStringUTF. The String
+ * is created by the first call with those contents and returned again by later calls, so
+ * constant strings such as header or enum names need not be allocated on every use.
+ *
+ * The result is a global reference owned by libnativehelper that the caller must not delete. It
+ * is valid until jniUninitializeConstants(). Returns NULL with an exception pending if the String
+ * cannot be created.
+ */
+jstring jniInternString(C_JNIEnv* env, const char* utf8);
+
 __END_DECLS
 
 /*
@@ -130,4 +232,26 @@ inline jlong jniGetNioBufferPointer(JNIEnv* env, jobject nioBuffer) {
     return jniGetNioBufferPointer(&env->functions, nioBuffer);
 }
 
+inline void jniGetNioBufferInfo(JNIEnv* env, jobject nioBuffer, JniNioBufferInfo* info) {
+    jniGetNioBufferInfo(&env->functions, nioBuffer, info);
+}
+
+inline void jniLogExceptionDeduplicated(JNIEnv* env, int priority, const char* tag,
+                                        jthrowable thrown = nullptr) {
+    jniLogExceptionDeduplicated(&env->functions, priority, tag, thrown);
+}
+
+inline void jniLogExceptionAsync(JNIEnv* env, int priority, const char* tag,
+                                 jthrowable thrown = nullptr) {
+    jniLogExceptionAsync(&env->functions, priority, tag, thrown);
+}
+
+inline void jniInitializeConstants(JNIEnv* env) {
+    jniInitializeConstants(&env->functions);
+}
+
+inline jstring jniInternString(JNIEnv* env, const char* utf8) {
+    return jniInternString(&env->functions, utf8);
+}
+
 #endif  // defined(__cplusplus)
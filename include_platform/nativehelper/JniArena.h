@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A per-thread scratch arena for temporary buffers of native methods.
+ *
+ * Each thread has a single block of memory, allocated on first use and kept until the thread
+ * exits. Allocations are made by bumping an offset within a scope, and everything allocated in
+ * a scope is released at once when it ends, so a native method using the arena for its
+ * temporaries makes no heap allocations after the first call on its thread:
+ *
+ *   void Foo_bar(JNIEnv* env, jobject, jint count) {
+ *       ScopedJniArena arena;
+ *       jint* values = arena.allocate<jint>(count);
+ *       ...
+ *   }
+ *
+ * libnativehelper opens its own scopes for the messages and stack traces formatted by
+ * jniThrowExceptionFmt, jniLogException and similar helpers.
+ *
+ * Scopes nest, and must end in the reverse order to which they began. Memory from the arena
+ * must not be passed to another thread or used after its scope ends.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+/*
+ * Begins a scope on the calling thread's arena and returns the mark to pass to jniArenaEnd().
+ */
+size_t jniArenaBegin();
+
+/*
+ * Ends the scope begun by the jniArenaBegin() call that returned |mark|, releasing everything
+ * allocated since.
+ */
+void jniArenaEnd(size_t mark);
+
+/*
+ * Returns |size| bytes aligned for any type from the calling thread's arena. Returns NULL if no
+ * scope is open or the arena does not have |size| bytes left, in which case the caller should
+ * fall back to the heap.
+ */
+void* jniArenaAllocate(size_t size);
+
+/*
+ * Grows the allocation |ptr| of |oldSize| bytes to |newSize| bytes, in place if it is the most
+ * recent allocation of the arena, otherwise by copying it to a new allocation. |ptr| may be NULL
+ * to allocate. Returns NULL if the arena does not have enough room, in which case |ptr| is left
+ * unchanged.
+ */
+void* jniArenaReallocate(void* ptr, size_t oldSize, size_t newSize);
+
+__END_DECLS
+
+#if defined(__cplusplus)
+
+// A scope of the calling thread's arena, see above.
+class ScopedJniArena {
+  public:
+    ScopedJniArena() : mMark(jniArenaBegin()) {}
+
+    ~ScopedJniArena() {
+        jniArenaEnd(mMark);
+    }
+
+    // Returns storage for |count| objects of the trivial type T, or nullptr if the arena is
+    // exhausted.
+    template <typename T>
+    T* allocate(size_t count) {
+        if (count > SIZE_MAX / sizeof(T)) {
+            return nullptr;
+        }
+        return static_cast<T*>(jniArenaAllocate(count * sizeof(T)));
+    }
+
+  private:
+    const size_t mMark;
+
+    ScopedJniArena(const ScopedJniArena&) = delete;
+    void operator=(const ScopedJniArena&) = delete;
+};
+
+#endif  // defined(__cplusplus)
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tables of classes, methods and fields cached by libnativehelper for native libraries.
+ *
+ * A library declares its constants once, as an array of descriptors and an array to hold the
+ * resolved values:
+ *
+ *   enum { kFoo, kFoo_bar, kFoo_count, kConstantCount };
+ *   static const struct JniConstantDescriptor kDescriptors[kConstantCount] = {
+ *       JNI_CONSTANT_CLASS("com/example/Foo"),
+ *       JNI_CONSTANT_METHOD(kFoo, "bar", "(I)V"),
+ *       JNI_CONSTANT_FIELD(kFoo, "count", "I"),
+ *   };
+ *   static union JniConstantValue gValues[kConstantCount];
+ *   static struct JniConstantsTable gConstants = JNI_CONSTANTS_TABLE_INIT(kDescriptors, gValues);
+ *
+ * and resolves it from JNI_OnLoad with jniResolveConstants(), or lets the accessors resolve it
+ * on first use. Once resolved, reading a constant is an acquire load and an array index.
+ *
+ * FindClass uses the class loader of the calling native method, so tables naming classes that
+ * are not on the boot class path should be resolved from JNI_OnLoad.
+ *
+ * Tables are invalidated by jniUninitializeConstants() and resolved again on next use.
+ *
+ * A resolved table is linked into libnativehelper, which writes to it when the runtime shuts
+ * down, so tables are expected to have static storage. A table that does not outlive the
+ * runtime, because its memory is freed or because it is in a library that can be unloaded with
+ * its class loader, must be passed to jniUnregisterConstants() first, e.g. from JNI_OnUnload.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/cdefs.h>
+
+#include <jni.h>
+
+#include <nativehelper/JNIHelp.h>
+
+__BEGIN_DECLS
+
+enum JniConstantKind {
+    kJniConstantClass,
+    kJniConstantMethod,
+    kJniConstantStaticMethod,
+    kJniConstantField,
+    kJniConstantStaticField,
+};
+
+/*
+ * One entry of a table. Classes have a binary name, e.g. "java/lang/String", and members name
+ * the index of the class entry that declares them, which must come earlier in the table.
+ *
+ * A missing entry makes resolution fail unless it is optional, in which case its value is NULL,
+ * as are the values of any optional members of a missing optional class.
+ */
+struct JniConstantDescriptor {
+    enum JniConstantKind kind;
+    const char* name;
+    const char* signature;
+    size_t classIndex;
+    bool optional;
+};
+
+#define JNI_CONSTANT_CLASS(name) { kJniConstantClass, (name), NULL, 0, false }
+#define JNI_CONSTANT_OPTIONAL_CLASS(name) { kJniConstantClass, (name), NULL, 0, true }
+#define JNI_CONSTANT_METHOD(cls, name, sig) { kJniConstantMethod, (name), (sig), (cls), false }
+#define JNI_CONSTANT_STATIC_METHOD(cls, name, sig) \
+    { kJniConstantStaticMethod, (name), (sig), (cls), false }
+#define JNI_CONSTANT_FIELD(cls, name, sig) { kJniConstantField, (name), (sig), (cls), false }
+#define JNI_CONSTANT_STATIC_FIELD(cls, name, sig) \
+    { kJniConstantStaticField, (name), (sig), (cls), false }
+
+union JniConstantValue {
+    jclass clazz;  /* A global reference. */
+    jmethodID method;
+    jfieldID field;
+};
+
+struct JniConstantsTable {
+    const struct JniConstantDescriptor* descriptors;
+    union JniConstantValue* values;
+    size_t count;
+    /* Private to libnativehelper. */
+    int resolved;
+    struct JniConstantsTable* next;
+};
+
+#define JNI_CONSTANTS_TABLE_INIT(descriptors, values) \
+    { (descriptors), (values), sizeof(descriptors) / sizeof((descriptors)[0]), 0, NULL }
+
+/*
+ * Resolves every entry of |table| that is not already resolved. Safe to call from any number
+ * of threads. Returns true on success, or false with an exception pending if a required entry
+ * is missing, in which case the table is left unresolved.
+ */
+bool jniResolveConstants(C_JNIEnv* env, struct JniConstantsTable* table);
+
+/*
+ * Resolves |count| independent tables on up to |maxThreads| threads, at most 16, including
+ * the calling thread. The other threads are attached to the VM of |env| for the duration of the
+ * call, so the tables should only name classes on the boot class path: FindClass on an attached
+ * thread does not see the application class loader. Tables that cannot be resolved on another
+ * thread are retried on the calling thread. Returns true if all tables are resolved, or false
+ * with the exception of the first failure pending.
+ */
+bool jniResolveConstantsInParallel(C_JNIEnv* env, struct JniConstantsTable* const* tables,
+                                   size_t count, size_t maxThreads);
+
+/*
+ * Unlinks |table| from libnativehelper, deletes the global references to its classes and
+ * resets it to unresolved. Does nothing if the table is not resolved. Must not be called while
+ * other threads use the table.
+ */
+void jniUnregisterConstants(C_JNIEnv* env, struct JniConstantsTable* table);
+
+/*
+ * Returns whether |table| has been resolved.
+ */
+static inline bool jniConstantsResolved(const struct JniConstantsTable* table) {
+    return __atomic_load_n(&table->resolved, __ATOMIC_ACQUIRE) != 0;
+}
+
+/*
+ * Returns entry |index| of |table|, resolving the table first if need be. Returns NULL with an
+ * exception pending if the table cannot be resolved.
+ */
+static inline const union JniConstantValue* jniGetConstant(C_JNIEnv* env,
+                                                           struct JniConstantsTable* table,
+                                                           size_t index) {
+    if (__builtin_expect(!jniConstantsResolved(table), 0) && !jniResolveConstants(env, table)) {
+        return NULL;
+    }
+    return &table->values[index];
+}
+
+static inline jclass jniGetConstantClass(C_JNIEnv* env, struct JniConstantsTable* table,
+                                         size_t index) {
+    const union JniConstantValue* value = jniGetConstant(env, table, index);
+    return value != NULL ? value->clazz : NULL;
+}
+
+static inline jmethodID jniGetConstantMethod(C_JNIEnv* env, struct JniConstantsTable* table,
+                                             size_t index) {
+    const union JniConstantValue* value = jniGetConstant(env, table, index);
+    return value != NULL ? value->method : NULL;
+}
+
+static inline jfieldID jniGetConstantField(C_JNIEnv* env, struct JniConstantsTable* table,
+                                           size_t index) {
+    const union JniConstantValue* value = jniGetConstant(env, table, index);
+    return value != NULL ? value->field : NULL;
+}
+
+__END_DECLS
+
+#if defined(__cplusplus)
+
+inline bool jniResolveConstants(JNIEnv* env, JniConstantsTable* table) {
+    return jniResolveConstants(&env->functions, table);
+}
+
+inline bool jniResolveConstantsInParallel(JNIEnv* env, JniConstantsTable* const* tables,
+                                          size_t count, size_t maxThreads) {
+    return jniResolveConstantsInParallel(&env->functions, tables, count, maxThreads);
+}
+
+inline void jniUnregisterConstants(JNIEnv* env, JniConstantsTable* table) {
+    jniUnregisterConstants(&env->functions, table);
+}
+
+inline jclass jniGetConstantClass(JNIEnv* env, JniConstantsTable* table, size_t index) {
+    return jniGetConstantClass(&env->functions, table, index);
+}
+
+inline jmethodID jniGetConstantMethod(JNIEnv* env, JniConstantsTable* table, size_t index) {
+    return jniGetConstantMethod(&env->functions, table, index);
+}
+
+inline jfieldID jniGetConstantField(JNIEnv* env, JniConstantsTable* table, size_t index) {
+    return jniGetConstantField(&env->functions, table, index);
+}
+
+#endif  // defined(__cplusplus)
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Pools of direct ByteBuffers for handing native data to Java without copying it.
+ *
+ * A pool allocates one native slab per size class when it is created and wraps every buffer of
+ * the slab in a direct ByteBuffer once. Native code then leases a buffer, fills it and passes it
+ * to Java, and Java hands it back through a native method when it is done:
+ *
+ *   static struct JniDirectBufferPool* gPool;  // Created from JNI_OnLoad.
+ *
+ *   jobject Decoder_nextFrame(JNIEnv* env, jobject) {
+ *       void* address;
+ *       jobject buffer = jniAcquireDirectBuffer(env, gPool, frameSize, &address);
+ *       if (buffer == NULL) {
+ *           return NULL;  // Or fall back to NewDirectByteBuffer.
+ *       }
+ *       decode(address, frameSize);
+ *       return buffer;
+ *   }
+ *
+ *   void Decoder_recycle(JNIEnv* env, jobject, jobject buffer) {
+ *       jniReleaseDirectBuffer(env, gPool, buffer);
+ *   }
+ *
+ * so that steady-state transfers allocate neither native memory nor Java objects.
+ *
+ * All functions other than jniDestroyDirectBufferPool() are safe to call from any thread.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sys/cdefs.h>
+
+#include <jni.h>
+
+#include <nativehelper/JNIHelp.h>
+
+__BEGIN_DECLS
+
+struct JniDirectBufferPool;
+
+/*
+ * Creates a pool with |buffersPerClass| buffers of each of the |classCount| sizes in
+ * |classSizes|, which must be in increasing order. Returns NULL with an exception pending on
+ * failure.
+ */
+struct JniDirectBufferPool* jniCreateDirectBufferPool(C_JNIEnv* env, const size_t* classSizes,
+                                                      size_t classCount,
+                                                      size_t buffersPerClass);
+
+/*
+ * Frees |pool| and its native memory. Java code must no longer reference any of its buffers,
+ * since they would point at freed memory.
+ */
+void jniDestroyDirectBufferPool(C_JNIEnv* env, struct JniDirectBufferPool* pool);
+
+/*
+ * Leases a buffer of at least |size| bytes from the smallest size class that has one free, and
+ * stores its native address in |address|. The buffer is cleared, so its position is 0 and its
+ * limit is its capacity, which is the size of its class.
+ *
+ * The result is a global reference owned by the pool that the caller must not delete. Returns
+ * NULL, without an exception pending, if |size| is larger than the largest class or every
+ * buffer large enough is leased, and NULL with an exception pending, leaving the buffer free,
+ * if clearing it threw. No exception may be pending on entry.
+ */
+jobject jniAcquireDirectBuffer(C_JNIEnv* env, struct JniDirectBufferPool* pool, size_t size,
+                               /*out*/void** address);
+
+/*
+ * Returns a leased buffer to |pool|. |buffer| may be any reference to a ByteBuffer returned by
+ * jniAcquireDirectBuffer(), but not to a slice or duplicate of one. Aborts if |buffer| is not
+ * leased from |pool|.
+ */
+void jniReleaseDirectBuffer(C_JNIEnv* env, struct JniDirectBufferPool* pool, jobject buffer);
+
+__END_DECLS
+
+#if defined(__cplusplus)
+
+inline JniDirectBufferPool* jniCreateDirectBufferPool(JNIEnv* env, const size_t* classSizes,
+                                                      size_t classCount,
+                                                      size_t buffersPerClass) {
+    return jniCreateDirectBufferPool(&env->functions, classSizes, classCount, buffersPerClass);
+}
+
+inline void jniDestroyDirectBufferPool(JNIEnv* env, JniDirectBufferPool* pool) {
+    jniDestroyDirectBufferPool(&env->functions, pool);
+}
+
+inline jobject jniAcquireDirectBuffer(JNIEnv* env, JniDirectBufferPool* pool, size_t size,
+                                      void** address) {
+    return jniAcquireDirectBuffer(&env->functions, pool, size, address);
+}
+
+inline void jniReleaseDirectBuffer(JNIEnv* env, JniDirectBufferPool* pool, jobject buffer) {
+    jniReleaseDirectBuffer(&env->functions, pool, buffer);
+}
+
+#endif  // defined(__cplusplus)
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The exception class cache used by the jniThrow* functions of libnativehelper.
+ *
+ * These functions are platform-only. JNIHelp.h includes this header when it is on the include
+ * path, i.e. for code using libnativehelper or libnativehelper_lazy, so that the C++ throw
+ * helpers share the cache in libnativehelper. Other C++ code, such as code built against the
+ * header-only or NDK variants, looks exception classes up on every throw instead.
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <sys/cdefs.h>
+
+#include <jni.h>
+
+__BEGIN_DECLS
+
+/*
+ * Register an exception class so that subsequent jniThrowException calls for "className" use a
+ * cached class and constructor rather than looking them up by name. The class must have a
+ * constructor taking a single String argument. Commonly thrown classes such as
+ * java/lang/NullPointerException and java/io/IOException are cached without registration.
+ *
+ * Returns 0 on success, nonzero if something failed (e.g. the exception class couldn't be
+ * found, so *an* exception will be pending).
+ */
+int jniRegisterExceptionClass(C_JNIEnv* env, const char* className);
+
+/*
+ * Throw an exception of class "className" created by the constructor with signature "ctorSig"
+ * from "args", using the cached class and constructor where there is one. A pending exception is
+ * logged and cleared first.
+ *
+ * Returns 0 on success, nonzero if something failed (e.g. the exception class couldn't be
+ * found, so *an* exception will still be pending).
+ */
+int jniThrowExceptionWithCtorV(C_JNIEnv* env, const char* className, const char* ctorSig,
+                               va_list args);
+
+/*
+ * Throw a java.io.IOException with the strerror message of "errno_value", using a message cached
+ * per errno value where possible. The C++ jniThrowIOException of JNIHelp.h calls this.
+ *
+ * Returns 0 on success, nonzero if something failed.
+ */
+int jniThrowIOException(C_JNIEnv* env, int errno_value);
+
+__END_DECLS
+
+#if defined(__cplusplus)
+
+inline int jniRegisterExceptionClass(JNIEnv* env, const char* className) {
+    return jniRegisterExceptionClass(&env->functions, className);
+}
+
+#endif  // defined(__cplusplus)
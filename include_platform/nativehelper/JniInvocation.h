@@ -19,6 +19,7 @@
 #include <sys/cdefs.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 
 __BEGIN_DECLS
 
@@ -55,6 +56,72 @@ struct JniInvocationImpl* JniInvocationCreate();
  */
 bool JniInvocationInit(struct JniInvocationImpl* instance, const char* library);
 
+/*
+ * Flags for JniInvocationInitWithFlags().
+ */
+/* Trace the JNI calls made through the envs of the JavaVM created with JNI_CreateJavaVM, see
+ * JniTracing.h. This covers the env of the creating thread and envs returned by the GetEnv and
+ * AttachCurrentThread functions of the JavaVM. */
+#define JNI_INVOCATION_INIT_TRACE_JNI 0x1
+
+/*
+ * Like JniInvocationInit(), with |flags| a bitwise OR of the JNI_INVOCATION_INIT_* flags.
+ */
+bool JniInvocationInitWithFlags(struct JniInvocationImpl* instance, const char* library,
+                                int flags);
+
+/*
+ * Flags for JniInvocationPreload().
+ */
+/* Open the library with lazy binding rather than resolving all symbols up front. Bionic always
+ * resolves symbols when a library is loaded, so this has no effect on Android devices. */
+#define JNI_INVOCATION_PRELOAD_LAZY_BINDING 0x1
+/* Only use the library if it is already loaded, for example by the zygote. No thread is created. */
+#define JNI_INVOCATION_PRELOAD_NO_LOAD 0x2
+
+/*
+ * Starts opening the library JniInvocationInit() would choose for |library| on a background
+ * thread. A later JniInvocationInit() call for the same library waits for the preload to finish and
+ * uses its handle, so the cost of loading and relocating the library can overlap other process
+ * start-up work. If JniInvocationInit() chooses a different library, the preloaded handle is not
+ * used.
+ *
+ * |flags| is a bitwise OR of the JNI_INVOCATION_PRELOAD_* flags.
+ *
+ * Returns false if a preload has already been started, the background thread could not be
+ * created, or JNI_INVOCATION_PRELOAD_NO_LOAD was passed and the library is not loaded. Only a
+ * call that returns true starts a preload; after a failure, another call may try again.
+ */
+bool JniInvocationPreload(const char* library, int flags);
+
+/*
+ * Time spent in each phase of the last successful JniInvocationInit() call.
+ */
+struct JniInvocationInitTimings {
+  /* Choosing the library, including the system property reads. */
+  int64_t library_lookup_ns;
+  /* Opening the requested library, whether or not it succeeded. */
+  int64_t dlopen_ns;
+  /* Opening the default library after the requested one failed, or 0 if there was no fallback. */
+  int64_t fallback_dlopen_ns;
+  /* Resolving the JNI invocation symbols. */
+  int64_t symbol_lookup_ns;
+  /* The whole JniInvocationInit() call. */
+  int64_t total_ns;
+  /* True if the default library was used because the requested one could not be opened. */
+  bool fallback_taken;
+  /* True if the library opened by JniInvocationPreload() was used. */
+  bool preloaded;
+};
+
+/*
+ * Gets the timings recorded by the last successful JniInvocationInit() call on |instance|.
+ *
+ * Returns false if |instance| has not been successfully initialized.
+ */
+bool JniInvocationGetInitTimings(const struct JniInvocationImpl* instance,
+                                 struct JniInvocationInitTimings* timings);
+
 /*
  * Release resources associated with JniInvocationImpl instance.
  */
@@ -72,6 +139,9 @@ void JniInvocationDestroy(struct JniInvocationImpl* instance);
  * optional, but should be provisioned to be PROP_VALUE_MAX bytes if provided to ensure it is
  * large enough to hold a system property.
  *
+ * The system properties are looked up once and read again only when their serials change, so
+ * repeated calls are cheap.
+ *
  * Returns the filename of the invocation library determined from the inputs and system
  * properties. The returned value may be |library|, |buffer|, or a pointer to a string constant
  * "libart.so".
@@ -107,6 +177,11 @@ class JniInvocation final {
     return JniInvocationInit(impl_, library) != 0;
   }
 
+  // Like Init(), with flags a bitwise OR of the JNI_INVOCATION_INIT_* flags.
+  bool Init(const char* library, int flags) {
+    return JniInvocationInitWithFlags(impl_, library, flags);
+  }
+
   // Exposes which library is actually loaded from the given name. The
   // buffer of size PROPERTY_VALUE_MAX will be used to load the system
   // property for the default library, if necessary. If no buffer is
@@ -115,6 +190,12 @@ class JniInvocation final {
     return JniInvocationGetLibrary(library, buffer);
   }
 
+  // Gets the time spent in each phase of Init(). Returns false if Init()
+  // has not succeeded.
+  bool GetInitTimings(JniInvocationInitTimings* timings) const {
+    return JniInvocationGetInitTimings(impl_, timings);
+  }
+
  private:
   JniInvocation(const JniInvocation&) = delete;
   JniInvocation& operator=(const JniInvocation&) = delete;
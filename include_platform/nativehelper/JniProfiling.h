@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Call counters and latency histograms for the libnativehelper entry points.
+ *
+ * Profiling is compiled in only when libnativehelper is built with LIBNATIVEHELPER_PROFILING
+ * defined. Without it the entry points below are not instrumented and the query functions report
+ * that no profile is available.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+/*
+ * The instrumented entry points. jniThrowException also covers jniThrowExceptionFmt,
+ * jniThrowNullPointerException, jniThrowRuntimeException and jniThrowIOException, which
+ * are implemented with it.
+ */
+#define JNI_PROFILING_ENTRY_POINT_LIST(V) \
+    V(jniThrowException)                  \
+    V(jniThrowErrnoException)             \
+    V(jniLogException)                    \
+    V(jniRegisterNativeMethods)           \
+    V(jniRegisterNativeMethodsBatch)      \
+    V(jniGetNioBufferBaseArray)           \
+    V(jniGetNioBufferBaseArrayOffset)     \
+    V(jniGetNioBufferPointer)             \
+    V(jniGetNioBufferFields)              \
+    V(jniGetNioBufferInfo)                \
+    V(jniLogExceptionDeduplicated)        \
+    V(jniLogExceptionAsync)
+
+enum JniProfilingEntryPoint {
+#define JNI_PROFILING_ENTRY_POINT(name) kJniProfiling_ ## name,
+    JNI_PROFILING_ENTRY_POINT_LIST(JNI_PROFILING_ENTRY_POINT)
+#undef JNI_PROFILING_ENTRY_POINT
+
+    // Marker for count of entry points
+    kJniProfiling_EntryPointCount
+};
+
+/*
+ * Number of latency histogram buckets. Bucket 0 counts calls that took less than 2ns, bucket
+ * i counts calls that took [2^i, 2^(i+1)) ns, and the last bucket also counts anything slower.
+ */
+#define JNI_PROFILING_HISTOGRAM_BUCKETS 32
+
+struct JniProfilingStats {
+    /* Number of calls. */
+    uint64_t calls;
+    /* Total time spent in the calls. */
+    uint64_t total_ns;
+    /* Calls by latency, see JNI_PROFILING_HISTOGRAM_BUCKETS. */
+    uint64_t histogram[JNI_PROFILING_HISTOGRAM_BUCKETS];
+};
+
+/*
+ * Gets the calls to |entryPoint| made by all threads since the process started or the last
+ * jniResetProfilingStats() call. Calls in progress on other threads may or may not be included.
+ *
+ * Returns false if libnativehelper was built without profiling or |entryPoint| is out of range.
+ */
+bool jniGetProfilingStats(enum JniProfilingEntryPoint entryPoint, struct JniProfilingStats* stats);
+
+/*
+ * Clears the stats of all entry points. Calls that end concurrently with the reset may be counted
+ * as before or after it, other calls on other threads are not affected.
+ */
+void jniResetProfilingStats();
+
+__END_DECLS
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tracing of the JNI calls made through an env, for profiling JNI overhead without rebuilding
+ * the runtime.
+ *
+ * A traced env has its function table replaced by one that counts every call per JNI function,
+ * measures the latency of roughly one call in JNI_TRACING_SAMPLE_PERIOD, and emits an atrace
+ * section, visible in Perfetto and systrace, around calls to expensive functions such as
+ * FindClass, the method and field ID lookups and Get<Type>ArrayElements. Stats are kept for
+ * the whole process.
+ *
+ * Envs are traced with jniTraceJniEnv() or, for every env the runtime hands out through its
+ * JavaVM, by passing JNI_INVOCATION_INIT_TRACE_JNI to JniInvocationInitWithFlags(). Tracing
+ * slows every JNI call down, so it is meant for benchmarks and debugging only.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+#include <jni.h>
+
+__BEGIN_DECLS
+
+/* Latency is measured for one JNI call in this many on each thread, on average. */
+#define JNI_TRACING_SAMPLE_PERIOD 64
+
+struct JniTracingStats {
+    /* Number of calls. */
+    uint64_t calls;
+    /* Number of calls whose latency was measured. */
+    uint64_t sampled_calls;
+    /* Total time spent in the calls whose latency was measured. */
+    uint64_t sampled_ns;
+};
+
+/*
+ * Replaces the function table of |env| with the tracing table. Returns true if |env| is traced,
+ * or false if it has a different function table to the envs already traced, for example because
+ * CheckJNI was enabled after they were.
+ */
+bool jniTraceJniEnv(C_JNIEnv* env);
+
+/*
+ * Restores the original function table of |env| if it is traced.
+ */
+void jniUntraceJniEnv(C_JNIEnv* env);
+
+/*
+ * Gets the stats of the JNI function called |function|, e.g. "FindClass", for calls made through
+ * any traced env since the process started or the last jniResetTracingStats() call.
+ *
+ * Returns false if |function| is not the name of a JNINativeInterface function.
+ */
+bool jniGetTracingStats(const char* function, struct JniTracingStats* stats);
+
+/*
+ * Clears the stats of all JNI functions. Calls made concurrently with the reset may be lost.
+ */
+void jniResetTracingStats();
+
+/*
+ * Logs a line with the stats of every JNI function that has been called to the Android log with
+ * |priority| and |tag|.
+ */
+void jniLogTracingStats(int priority, const char* tag);
+
+__END_DECLS
+
+#if defined(__cplusplus)
+
+inline bool jniTraceJniEnv(JNIEnv* env) {
+    return jniTraceJniEnv(&env->functions);
+}
+
+inline void jniUntraceJniEnv(JNIEnv* env) {
+    jniUntraceJniEnv(&env->functions);
+}
+
+#endif  // defined(__cplusplus)
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+/*
+ * Binds every method forwarded by libnativehelper_lazy, loading libnativehelper.so if needed.
+ *
+ * libnativehelper_lazy otherwise binds each method the first time it is called. Startup code can
+ * call this on a background thread so that later calls on latency sensitive threads do not pay
+ * for dlsym. Calling it is optional and it is safe to call more than once.
+ *
+ * Only available to code linked against libnativehelper_lazy.
+ */
+void LibnativehelperLazyPrebind();
+
+__END_DECLS
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <jni.h>
+
+#include <nativehelper/JNIPlatformHelp.h>
+#include <nativehelper/nativehelper_utils.h>
+
+// ScopedNioBuffer provides access to the bytes between the position and the limit of a
+// java.nio.Buffer without copying them.
+//
+// For direct buffers get() returns the direct address. For buffers backed by a managed array the
+// array is pinned with GetPrimitiveArrayCritical for the lifetime of the object, so the usual
+// rules for critical regions apply to those buffers: do not call other JNI functions or block
+// until the ScopedNioBuffer goes out of scope. Writes through get() are visible in the buffer.
+//
+// A null buffer throws NullPointerException and a buffer with no accessible storage throws
+// IllegalArgumentException. In both cases get() returns nullptr:
+//
+//   ScopedNioBuffer buffer(env, javaBuffer);
+//   if (buffer.get() == nullptr) {
+//     return;
+//   }
+//   memcpy(dst, buffer.get(), buffer.size());
+class ScopedNioBuffer {
+ public:
+  ScopedNioBuffer(JNIEnv* env, jobject buffer)
+      : env_(env), info_(), critical_(nullptr), data_(nullptr), size_(0) {
+    if (buffer == nullptr) {
+      jniThrowNullPointerException(env);
+      return;
+    }
+    jniGetNioBufferInfo(env, buffer, &info_);
+    if (info_.isDirect) {
+      data_ = reinterpret_cast<void*>(static_cast<uintptr_t>(info_.address));
+    } else if (info_.baseArray != nullptr) {
+      critical_ = env->GetPrimitiveArrayCritical(info_.baseArray, nullptr);
+      if (critical_ != nullptr) {
+        data_ = static_cast<uint8_t*>(critical_) + info_.baseArrayOffset;
+      }
+    } else {
+      jniThrowException(env, "java/lang/IllegalArgumentException",
+                        "Buffer has neither a direct address nor a backing array");
+    }
+    if (data_ != nullptr) {
+      size_ = static_cast<size_t>(info_.remainingBytes);
+    }
+  }
+
+  ~ScopedNioBuffer() {
+    if (critical_ != nullptr) {
+      env_->ReleasePrimitiveArrayCritical(info_.baseArray, critical_, 0);
+    }
+    if (info_.baseArray != nullptr) {
+      env_->DeleteLocalRef(info_.baseArray);
+    }
+  }
+
+  // Returns the address of the buffer position, or nullptr on failure.
+  void* get() const {
+    return data_;
+  }
+
+  // Returns the number of bytes between the buffer position and limit.
+  size_t size() const {
+    return size_;
+  }
+
+  bool isDirect() const {
+    return info_.isDirect;
+  }
+
+ private:
+  JNIEnv* const env_;
+  JniNioBufferInfo info_;
+  void* critical_;
+  void* data_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedNioBuffer);
+};
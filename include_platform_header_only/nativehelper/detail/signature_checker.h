@@ -951,11 +951,14 @@ struct is_valid_jni_argument_type<native_kind, position, T, Args...> {
 };
 
 // This helper is required to decompose the function type into a list of arg types.
-template<NativeKind native_kind, typename T, T* fn>
+//
+// It is keyed by the function type only, so that all natives sharing a C++ function type
+// share one instantiation.
+template<NativeKind native_kind, typename T>
 struct is_valid_jni_function_type_helper;
 
-template<NativeKind native_kind, typename R, typename ... Args, R (*fn)(Args...)>
-struct is_valid_jni_function_type_helper<native_kind, R(Args...), fn> {
+template<NativeKind native_kind, typename R, typename ... Args>
+struct is_valid_jni_function_type_helper<native_kind, R(Args...)> {
   static constexpr bool value =
       IsJniParameterCountValid(native_kind, sizeof...(Args))
           && IsValidJniParameter<R>(native_kind, kReturnPosition)
@@ -967,7 +970,7 @@ struct is_valid_jni_function_type_helper<native_kind, R(Args...), fn> {
 // Is this function type 'T' a valid C++ function type given the native_kind?
 template<NativeKind native_kind, typename T, T* fn>
 constexpr bool IsValidJniFunctionType() {
-  return is_valid_jni_function_type_helper<native_kind, T, fn>::value;
+  return is_valid_jni_function_type_helper<native_kind, T>::value;
   // TODO: we could replace template metaprogramming with constexpr by
   // using FunctionTypeMetafunction.
 }
@@ -1036,13 +1039,16 @@ constexpr auto MakeArray(Args&& ... args) {
 }
 
 // See below.
-template<typename T, T* fn>
-struct FunctionTypeMetafunction {
+template<typename T>
+struct FunctionTypeTraits {
 };
 
 // Enables the "map" operation over the function component types.
-template<typename R, typename ... Args, R (*fn)(Args...)>
-struct FunctionTypeMetafunction<R(Args...), fn> {
+//
+// Only depends on the function type. FunctionTypeMetafunction below is the per-function
+// spelling of the same thing.
+template<typename R, typename ... Args>
+struct FunctionTypeTraits<R(Args...)> {
   // Count how many arguments there are, and add 1 for the return type.
   static constexpr size_t
       count = sizeof...(Args) + 1u;  // args and return type.
@@ -1084,6 +1090,10 @@ struct FunctionTypeMetafunction<R(Args...), fn> {
   }
 };
 
+template<typename T, T* fn>
+struct FunctionTypeMetafunction : FunctionTypeTraits<T> {
+};
+
 // Apply ReifiedJniTypeTrait::Reify<T> for every function component type.
 template<typename T>
 struct ReifyJniTypeMetafunction {
@@ -1107,23 +1117,21 @@ using ReifiedJniSignature = FunctionSignatureDescriptor<ReifiedJniTypeTrait,
 //    parses are nonfatal -> returns nullopt (test behavior).
 template <NativeKind native_kind,
           typename T,
-          T* fn,
-          size_t kMaxSize = FunctionTypeMetafunction<T, fn>::count>
+          size_t kMaxSize = FunctionTypeTraits<T>::count>
 constexpr ConstexprOptional<ReifiedJniSignature<kMaxSize>>
-MaybeMakeReifiedJniSignature() {
-  if (!IsValidJniFunctionType<native_kind, T, fn>()) {
+MaybeMakeReifiedJniSignatureOfType() {
+  if (!is_valid_jni_function_type_helper<native_kind, T>::value) {
     PARSE_FAILURE("The function signature has one or more types incompatible with JNI.");
   }
 
   ReifiedJniTypeTrait return_jni_trait =
-      FunctionTypeMetafunction<T,
-                         fn>::template map_return<ReifyJniTypeMetafunction>();
+      FunctionTypeTraits<T>::template map_return<ReifyJniTypeMetafunction>();
 
   constexpr size_t
       kSkipArgumentPrefix = (native_kind != kCriticalNative) ? 2u : 0u;
   ConstexprVector<ReifiedJniTypeTrait, kMaxSize> args;
   auto args_list =
-      FunctionTypeMetafunction<T, fn>::template map_args<ReifyJniTypeMetafunction>();
+      FunctionTypeTraits<T>::template map_args<ReifyJniTypeMetafunction>();
   size_t args_index = 0;
   for (auto& arg : args_list) {
     // Ignore the 'JNIEnv*, jobject' / 'JNIEnv*, jclass' prefix,
@@ -1138,6 +1146,34 @@ MaybeMakeReifiedJniSignature() {
   return {{args, return_jni_trait}};
 }
 
+// Evaluates MaybeMakeReifiedJniSignatureOfType once per (native_kind, function type).
+//
+// Registration files typically have many natives with the same C++ function type
+// (e.g. jlong(JNIEnv*, jclass, jlong)), which then share this constant instead of each
+// re-evaluating the conversion.
+template <NativeKind native_kind, typename T>
+struct ReifiedJniSignatureCache {
+  static constexpr size_t kMaxSize = FunctionTypeTraits<T>::count;
+  static constexpr ConstexprOptional<ReifiedJniSignature<kMaxSize>> value =
+      MaybeMakeReifiedJniSignatureOfType<native_kind, T>();
+};
+
+#if __cplusplus < 201703L
+// Out-of-line definition of the static member, implicit in C++17.
+template <NativeKind native_kind, typename T>
+constexpr ConstexprOptional<ReifiedJniSignature<ReifiedJniSignatureCache<native_kind, T>::kMaxSize>>
+    ReifiedJniSignatureCache<native_kind, T>::value;
+#endif
+
+template <NativeKind native_kind,
+          typename T,
+          T* fn,
+          size_t kMaxSize = FunctionTypeMetafunction<T, fn>::count>
+constexpr ConstexprOptional<ReifiedJniSignature<kMaxSize>>
+MaybeMakeReifiedJniSignature() {
+  return ReifiedJniSignatureCache<native_kind, T>::value;
+}
+
 #define COMPARE_DESCRIPTOR_CHECK(expr) if (!(expr)) return false
 #define COMPARE_DESCRIPTOR_FAILURE_MSG(msg) if ((true)) return false
 
@@ -1221,11 +1257,11 @@ CompareJniDescriptorNodeErased(JniDescriptorNode user_defined_descriptor,
 template<NativeKind native_kind, typename T, T* fn, size_t kMaxSize>
 constexpr bool
 MatchJniDescriptorWithFunctionType(ConstexprStringView user_function_descriptor) {
-  constexpr size_t kReifiedMaxSize = FunctionTypeMetafunction<T, fn>::count;
+  constexpr size_t kReifiedMaxSize = FunctionTypeTraits<T>::count;
 
   ConstexprOptional<ReifiedJniSignature<kReifiedMaxSize>>
       reified_signature_opt =
-      MaybeMakeReifiedJniSignature<native_kind, T, fn>();
+      ReifiedJniSignatureCache<native_kind, T>::value;
   if (!reified_signature_opt) {
     // Assertion handling done by MaybeMakeReifiedJniSignature.
     return false;
@@ -1267,9 +1303,12 @@ MatchJniDescriptorWithFunctionType(ConstexprStringView user_function_descriptor)
 
 // Supports inferring the JNI function descriptor string from the C++
 // function type when all type components are final.
-template<NativeKind native_kind, typename T, T* fn>
-struct InferJniDescriptor {
-  static constexpr size_t kMaxSize = FunctionTypeMetafunction<T, fn>::count;
+//
+// Keyed by the function type only: natives with the same C++ function type share the
+// inferred descriptor and its static storage. See InferJniDescriptor.
+template<NativeKind native_kind, typename T>
+struct InferJniDescriptorOfType {
+  static constexpr size_t kMaxSize = FunctionTypeTraits<T>::count;
 
   // Convert the C++ function type into a JniSignatureDescriptor which holds
   // the canonical (according to jni_traits) descriptors for each component.
@@ -1282,7 +1321,7 @@ struct InferJniDescriptor {
     constexpr size_t kReifiedMaxSize = kMaxSize;
     ConstexprOptional<ReifiedJniSignature<kReifiedMaxSize>>
         reified_signature_opt =
-        MaybeMakeReifiedJniSignature<native_kind, T, fn>();
+        ReifiedJniSignatureCache<native_kind, T>::value;
     if (!reified_signature_opt) {
       // Assertion handling done by MaybeMakeReifiedJniSignature.
       return NullConstexprOptional{};
@@ -1405,6 +1444,108 @@ struct InferJniDescriptor {
   }
 };
 
+template<NativeKind native_kind, typename T, T* fn>
+struct InferJniDescriptor : InferJniDescriptorOfType<native_kind, T> {
+};
+
+// Computes the method "shorty" from the C++ function type: the return type followed by
+// one character per parameter, where every reference type is collapsed to 'L'.
+//
+// The 'JNIEnv*, jobject' / 'JNIEnv*, jclass' prefix of normal and fast natives is not part
+// of the shorty, nor of the argument count.
+template<NativeKind native_kind, typename T>
+struct JniShorty {
+  static constexpr size_t kSkipArgumentPrefix = (native_kind != kCriticalNative) ? 2u : 0u;
+  static constexpr size_t kArgumentCount =
+      FunctionTypeTraits<T>::count - 1u >= kSkipArgumentPrefix
+          ? FunctionTypeTraits<T>::count - 1u - kSkipArgumentPrefix
+          : 0u;
+  using ConstexprStringShortyType = ConstexprArray<char, kArgumentCount + 2u>;
+
+  static constexpr char ShortyOf(const ReifiedJniTypeTrait& trait) {
+    char shorty = trait.type_descriptor.empty() ? '\0' : trait.type_descriptor[0];
+    return shorty == '[' ? 'L' : shorty;
+  }
+
+  static constexpr ConstexprStringShortyType GetString() {
+    ConstexprStringShortyType c_str{};
+
+    size_t pos = 0u;
+    c_str[pos++] = ShortyOf(
+        FunctionTypeTraits<T>::template map_return<ReifyJniTypeMetafunction>());
+
+    auto args_list =
+        FunctionTypeTraits<T>::template map_args<ReifyJniTypeMetafunction>();
+    size_t args_index = 0;
+    for (auto& arg : args_list) {
+      if (args_index >= kSkipArgumentPrefix && pos <= kArgumentCount) {
+        c_str[pos++] = ShortyOf(arg);
+      }
+      ++args_index;
+    }
+
+    c_str[pos] = '\0';
+    return c_str;
+  }
+
+  // See InferJniDescriptor::GetStringAtRuntime.
+  static const char* GetStringAtRuntime() {
+    static constexpr ConstexprStringShortyType str = GetString();
+    return &str[0];
+  }
+};
+
+// Are all of Args primitive types, i.e. types allowed in a @CriticalNative signature?
+template<typename ... Args>
+struct are_critical_native_types {
+  static constexpr bool value = true;
+};
+
+template<typename T, typename ... Args>
+struct are_critical_native_types<T, Args...> {
+  static constexpr bool value =
+      jni_type_trait<T>::native_kind == kCriticalNative
+          && are_critical_native_types<Args...>::value;
+};
+
+// Could a normal or fast native with the C++ function type 'T' be registered as
+// @CriticalNative instead? This requires a static method (a jclass receiver) whose
+// return type and remaining parameters are all primitives.
+template<typename T>
+struct is_critical_native_candidate {
+  static constexpr bool value = false;
+};
+
+template<typename R, typename ... Args>
+struct is_critical_native_candidate<R(JNIEnv*, jclass, Args...)> {
+  static constexpr bool value = are_critical_native_types<R, Args...>::value;
+};
+
+// Instantiating Check() for a candidate triggers a deprecation warning at the
+// registration site. See JNI_SIGNATURE_CHECKER_WARN_CRITICAL_NATIVE_CANDIDATES.
+template<bool kIsCandidate>
+struct CriticalNativeCandidateWarning {
+  static constexpr bool Check() { return true; }
+};
+
+template<>
+struct CriticalNativeCandidateWarning<true> {
+  [[deprecated("this native could be registered as @CriticalNative")]]
+  static constexpr bool Check() { return true; }
+};
+
+// Defining JNI_SIGNATURE_CHECKER_WARN_CRITICAL_NATIVE_CANDIDATES before including jni_macros.h
+// makes every normal and fast native that qualifies for @CriticalNative emit a
+// -Wdeprecated-declarations warning, giving a compile-time report of natives to move over.
+#if defined(JNI_SIGNATURE_CHECKER_WARN_CRITICAL_NATIVE_CANDIDATES)
+#define WARN_IF_CRITICAL_NATIVE_CANDIDATE(native_kind, fn)                 \
+  (void)CriticalNativeCandidateWarning<                                  \
+      native_kind != kCriticalNative &&                                  \
+      is_critical_native_candidate<decltype(fn)>::value>::Check()
+#else
+#define WARN_IF_CRITICAL_NATIVE_CANDIDATE(native_kind, fn) (void)0
+#endif
+
 // Expression to return JNINativeMethod, performs checking on signature+fn.
 #define MAKE_CHECKED_JNI_NATIVE_METHOD(native_kind, name_, signature_, fn) \
   ([]() {                                                                \
@@ -1415,6 +1556,7 @@ struct InferJniDescriptor {
                                            fn,                           \
                                            sizeof(signature_)>(signature_),\
         "JNI signature doesn't match C++ function type.");               \
+    WARN_IF_CRITICAL_NATIVE_CANDIDATE(native_kind, fn);                  \
     /* Suppress implicit cast warnings by explicitly casting. */         \
     return JNINativeMethod {                                             \
         const_cast<decltype(JNINativeMethod::name)>(name_),              \
@@ -1426,6 +1568,7 @@ struct InferJniDescriptor {
 #define MAKE_INFERRED_JNI_NATIVE_METHOD(native_kind, name_, fn)          \
   ([]() {                                                                \
     using namespace nativehelper::detail;  /* NOLINT(google-build-using-namespace) */ \
+    WARN_IF_CRITICAL_NATIVE_CANDIDATE(native_kind, fn);                  \
     /* Suppress implicit cast warnings by explicitly casting. */         \
     return JNINativeMethod {                                             \
         const_cast<decltype(JNINativeMethod::name)>(name_),              \
@@ -1436,6 +1579,93 @@ struct InferJniDescriptor {
         reinterpret_cast<void*>(&(fn))};                                 \
   })()
 
+// Expression to return JniNativeMethodInfo, performs checking on signature+fn.
+#define MAKE_CHECKED_JNI_NATIVE_METHOD_INFO(native_kind, name_, signature_, fn) \
+  ([]() {                                                                \
+    using namespace nativehelper::detail;  /* NOLINT(google-build-using-namespace) */ \
+    return nativehelper::JniNativeMethodInfo {                           \
+        MAKE_CHECKED_JNI_NATIVE_METHOD(native_kind, name_, signature_, fn), \
+        JniShorty<native_kind, decltype(fn)>::GetStringAtRuntime(),  \
+        JniShorty<native_kind, decltype(fn)>::kArgumentCount,        \
+        native_kind,                                                     \
+        is_critical_native_candidate<decltype(fn)>::value};              \
+  })()
+
+// Expression to return JniNativeMethodInfo, infers signature from fn.
+#define MAKE_INFERRED_JNI_NATIVE_METHOD_INFO(native_kind, name_, fn)     \
+  ([]() {                                                                \
+    using namespace nativehelper::detail;  /* NOLINT(google-build-using-namespace) */ \
+    return nativehelper::JniNativeMethodInfo {                           \
+        MAKE_INFERRED_JNI_NATIVE_METHOD(native_kind, name_, fn),         \
+        JniShorty<native_kind, decltype(fn)>::GetStringAtRuntime(),  \
+        JniShorty<native_kind, decltype(fn)>::kArgumentCount,        \
+        native_kind,                                                     \
+        is_critical_native_candidate<decltype(fn)>::value};              \
+  })()
+
 }  // namespace detail
-}  // namespace nativehelper
 
+// A JNINativeMethod together with the metadata derived from its C++ function type
+// at compile time. See MAKE_JNI_NATIVE_METHOD_INFO in jni_macros.h.
+struct JniNativeMethodInfo {
+  JNINativeMethod method;
+  // Return type followed by one character per parameter, e.g. "ZJL" for
+  // jboolean(JNIEnv*, jclass, jlong, jstring).
+  const char* shorty;
+  // Number of parameters, excluding the JNIEnv* and jobject/jclass prefix.
+  size_t argument_count;
+  // One of kNormalNative, kFastNative or kCriticalNative.
+  detail::NativeKind native_kind;
+  // Whether the C++ function type also qualifies for @CriticalNative.
+  // See IsCriticalNativeCandidate.
+  bool critical_native_candidate;
+};
+
+// Could a native with the C++ function type 'T', e.g. decltype(MyClass_myNative), be
+// registered as @CriticalNative? True for static natives taking and returning only
+// primitives besides the JNIEnv* and jclass, which @CriticalNative drops.
+template<typename T>
+constexpr bool IsCriticalNativeCandidate() {
+  return detail::is_critical_native_candidate<T>::value;
+}
+
+// Calls fn(const JniNativeMethodInfo&) for every normal or fast native in the table
+// that could be registered as @CriticalNative, e.g. to log them in a debug build.
+template<size_t kCount, typename Fn>
+inline void ForEachCriticalNativeCandidate(const JniNativeMethodInfo (&table)[kCount], Fn&& fn) {
+  for (const JniNativeMethodInfo& info : table) {
+    if (info.native_kind != detail::kCriticalNative && info.critical_native_candidate) {
+      fn(info);
+    }
+  }
+}
+
+// Copies the JNINativeMethods out of a JniNativeMethodInfo table and registers them
+// all with a single RegisterNatives call. Returns the RegisterNatives result.
+template<size_t kCount>
+inline jint RegisterNativeMethodTable(JNIEnv* env,
+                                      jclass clazz,
+                                      const JniNativeMethodInfo (&table)[kCount]) {
+  JNINativeMethod methods[kCount];
+  for (size_t i = 0; i < kCount; ++i) {
+    methods[i] = table[i].method;
+  }
+  return env->RegisterNatives(clazz, methods, static_cast<jint>(kCount));
+}
+
+// As above, but looks up the class by name first. Returns JNI_ERR if the class cannot
+// be found, leaving the pending exception for the caller.
+template<size_t kCount>
+inline jint RegisterNativeMethodTable(JNIEnv* env,
+                                      const char* class_name,
+                                      const JniNativeMethodInfo (&table)[kCount]) {
+  jclass clazz = env->FindClass(class_name);
+  if (clazz == nullptr) {
+    return JNI_ERR;
+  }
+  jint result = RegisterNativeMethodTable(env, clazz, table);
+  env->DeleteLocalRef(clazz);
+  return result;
+}
+
+}  // namespace nativehelper
@@ -53,6 +53,22 @@
  *
  *     // and then call JNIEnv::RegisterNatives with gMethods as usual.
  *
+ * The MAKE_JNI_[FAST_|CRITICAL_]NATIVE_METHOD_INFO[_AUTOSIG] variants evaluate to a
+ * nativehelper::JniNativeMethodInfo which additionally carries the method shorty, argument
+ * count and native kind computed at compile time. A table of these is registered in one
+ * RegisterNatives call with nativehelper::RegisterNativeMethodTable:
+ *
+ *     const nativehelper::JniNativeMethodInfo gMethodInfos[] = {
+ *         MAKE_JNI_NATIVE_METHOD_INFO_AUTOSIG("normal", KlassName_normal),
+ *         MAKE_JNI_CRITICAL_NATIVE_METHOD_INFO_AUTOSIG("critical", KlassName_critical),
+ *     };
+ *     nativehelper::RegisterNativeMethodTable(env, "path/to/package/KlassName", gMethodInfos);
+ *
+ * Natives that take and return only primitives (besides the JNIEnv* and jclass) qualify for
+ * the cheaper @CriticalNative calling convention. nativehelper::IsCriticalNativeCandidate<T>()
+ * classifies a C++ function type, and defining JNI_SIGNATURE_CHECKER_WARN_CRITICAL_NATIVE_CANDIDATES
+ * before including this header emits a warning for every normal or fast native that qualifies.
+ *
  * For convenience the following macros are defined:
  *   [FAST_|CRITICAL_]NATIVE_METHOD - Return JNINativeMethod for class, func name, and signature.
  *   OVERLOADED_[FAST_|CRITICAL_]NATIVE_METHOD - Same as above but allows a separate func identifier.
@@ -190,6 +206,27 @@
 #define MAKE_JNI_CRITICAL_NATIVE_METHOD_AUTOSIG(name, function)                 \
   _NATIVEHELPER_JNI_MAKE_METHOD_AUTOSIG(kCriticalNative, name, function)
 
+// Metadata-carrying variants of the above. Each evaluates to a nativehelper::JniNativeMethodInfo
+// { JNINativeMethod, shorty, argument_count, native_kind } with the same compile-time checking.
+// Only available in C++14 or newer.
+#define MAKE_JNI_NATIVE_METHOD_INFO(name, signature, function)                 \
+  _NATIVEHELPER_JNI_MAKE_METHOD_INFO(kNormalNative, name, signature, function)
+
+#define MAKE_JNI_FAST_NATIVE_METHOD_INFO(name, signature, function)            \
+  _NATIVEHELPER_JNI_MAKE_METHOD_INFO(kFastNative, name, signature, function)
+
+#define MAKE_JNI_CRITICAL_NATIVE_METHOD_INFO(name, signature, function)        \
+  _NATIVEHELPER_JNI_MAKE_METHOD_INFO(kCriticalNative, name, signature, function)
+
+#define MAKE_JNI_NATIVE_METHOD_INFO_AUTOSIG(name, function)                    \
+  _NATIVEHELPER_JNI_MAKE_METHOD_INFO_AUTOSIG(kNormalNative, name, function)
+
+#define MAKE_JNI_FAST_NATIVE_METHOD_INFO_AUTOSIG(name, function)               \
+  _NATIVEHELPER_JNI_MAKE_METHOD_INFO_AUTOSIG(kFastNative, name, function)
+
+#define MAKE_JNI_CRITICAL_NATIVE_METHOD_INFO_AUTOSIG(name, function)           \
+  _NATIVEHELPER_JNI_MAKE_METHOD_INFO_AUTOSIG(kCriticalNative, name, function)
+
 // Convenience macros when the functions follow the naming convention:
 //       .java file           .cpp file
 //       JavaLanguageName <-> ${ClassName}_${JavaLanguageName}
@@ -260,6 +297,14 @@
 #define _NATIVEHELPER_JNI_MAKE_METHOD_AUTOSIG(kind, name, function) \
   MAKE_INFERRED_JNI_NATIVE_METHOD(kind, name, function)
 
+// Expands to a compound expression whose type is nativehelper::JniNativeMethodInfo.
+#define _NATIVEHELPER_JNI_MAKE_METHOD_INFO(kind, name, sig, fn) \
+  MAKE_CHECKED_JNI_NATIVE_METHOD_INFO(kind, name, sig, fn)
+
+// Expands to a compound expression whose type is nativehelper::JniNativeMethodInfo.
+#define _NATIVEHELPER_JNI_MAKE_METHOD_INFO_AUTOSIG(kind, name, function) \
+  MAKE_INFERRED_JNI_NATIVE_METHOD_INFO(kind, name, function)
+
 #else
 // Older versions of C++ or C code get the regular macro that's unchecked.
 // Expands to a compound expression whose type is JNINativeMethod.
@@ -270,6 +315,12 @@
 #define _NATIVEHELPER_JNI_MAKE_METHOD_AUTOSIG(kind, name, function) \
   static_assert(false, "Cannot infer JNI signatures prior to C++14 for function " #function);
 
+// Need C++14 or newer to compute method metadata.
+#define _NATIVEHELPER_JNI_MAKE_METHOD_INFO(kind, name, sig, fn) \
+  static_assert(false, "Cannot compute JNI method metadata prior to C++14 for function " #fn);
+#define _NATIVEHELPER_JNI_MAKE_METHOD_INFO_AUTOSIG(kind, name, function) \
+  static_assert(false, "Cannot compute JNI method metadata prior to C++14 for function " #function);
+
 #endif  // C++14 check
 
 // C-style cast for C, C++-style cast for C++ to avoid warnings/errors.
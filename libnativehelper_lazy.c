@@ -28,44 +28,106 @@
 #include "android/file_descriptor_jni.h"
 #include "nativehelper/JNIHelp.h"
 #include "nativehelper/JNIPlatformHelp.h"
+#include "nativehelper/JniArena.h"
+#include "nativehelper/JniConstantsTable.h"
+#include "nativehelper/JniDirectBufferPool.h"
+#include "nativehelper/JniExceptionCache.h"
 #include "nativehelper/JniInvocation.h"
+#include "nativehelper/JniProfiling.h"
+#include "nativehelper/JniTracing.h"
+#include "nativehelper/LibnativehelperLazy.h"
 
 // This file provides a lazy interface to libnativehelper.so to address early boot dependencies.
 // Specifically bootanimation now runs before the ART APEX is loaded and libnativehelper.so is
 // in the ART APEX. bootanimation does not call any code in libnativehelper.
 
-// Method pointers to libnativehelper methods are held in array which simplifies checking
-// all pointers are initialized.
+// Methods forwarded to libnativehelper.so:
+//   <method>
+#define LIBNATIVEHELPER_METHOD_LIST(V)                                      \
+    /* NDK file descriptor API in file_descriptor_jni.h. */                 \
+    V(AFileDescriptor_create)                                               \
+    V(AFileDescriptor_getFd)                                                \
+    V(AFileDescriptor_setFd)                                                \
+    V(AFileDescriptor_getFdUnchecked)                                       \
+    V(AFileDescriptor_setFdUnchecked)                                       \
+    V(AFileDescriptor_createArray)                                          \
+    V(AFileDescriptor_getFds)                                               \
+    V(AFileDescriptor_setFds)                                               \
+    /* JNI_Invocation API declared in jni.h. */                             \
+    V(JNI_CreateJavaVM)                                                     \
+    V(JNI_GetCreatedJavaVMs)                                                \
+    V(JNI_GetDefaultJavaVMInitArgs)                                         \
+    /* Methods in JniExceptionCache.h. */                                   \
+    V(jniRegisterExceptionClass)                                            \
+    V(jniThrowExceptionWithCtorV)                                           \
+    V(jniThrowIOException)                                                  \
+    /* Methods in JNIPlatformHelp.h. */                                     \
+    V(jniGetNioBufferBaseArray)                                             \
+    V(jniGetNioBufferBaseArrayOffset)                                       \
+    V(jniGetNioBufferFields)                                                \
+    V(jniGetNioBufferInfo)                                                  \
+    V(jniGetNioBufferPointer)                                               \
+    V(jniLogExceptionDeduplicated)                                          \
+    V(jniSetLogExceptionDeduplicationWindow)                                \
+    V(jniLogExceptionAsync)                                                 \
+    V(jniFlushAsyncExceptionLog)                                            \
+    V(jniGetAsyncExceptionLogStats)                                         \
+    V(jniInitializeConstants)                                               \
+    V(jniUninitializeConstants)                                             \
+    V(jniInternString)                                                      \
+    /* Methods in JniConstantsTable.h. */                                   \
+    V(jniResolveConstants)                                                  \
+    V(jniResolveConstantsInParallel)                                        \
+    V(jniUnregisterConstants)                                               \
+    /* Methods in JniArena.h. */                                            \
+    V(jniArenaBegin)                                                        \
+    V(jniArenaEnd)                                                          \
+    V(jniArenaAllocate)                                                     \
+    V(jniArenaReallocate)                                                   \
+    /* Methods in JniDirectBufferPool.h. */                                 \
+    V(jniCreateDirectBufferPool)                                            \
+    V(jniDestroyDirectBufferPool)                                           \
+    V(jniAcquireDirectBuffer)                                               \
+    V(jniReleaseDirectBuffer)                                               \
+    /* Methods in JniInvocation.h. */                                       \
+    V(JniInvocationCreate)                                                  \
+    V(JniInvocationDestroy)                                                 \
+    V(JniInvocationGetLibrary)                                              \
+    V(JniInvocationGetInitTimings)                                          \
+    V(JniInvocationPreload)                                                 \
+    V(JniInvocationInit)                                                    \
+    V(JniInvocationInitWithFlags)                                           \
+    /* Methods in JniProfiling.h. */                                        \
+    V(jniGetProfilingStats)                                                 \
+    V(jniResetProfilingStats)                                               \
+    /* Methods in JniTracing.h. */                                          \
+    V(jniTraceJniEnv)                                                       \
+    V(jniUntraceJniEnv)                                                     \
+    V(jniGetTracingStats)                                                   \
+    V(jniResetTracingStats)                                                 \
+    V(jniLogTracingStats)
+
+// Method pointers to libnativehelper methods are held in an array indexed by MethodIndex.
+// Entries are NULL until bound, so forwarders need only a load and a well-predicted null check
+// before the indirect call once their method is bound.
 enum MethodIndex {
-    // NDK file descriptor API in file_descriptor_jni.h.
-    k_AFileDescriptor_create,
-    k_AFileDescriptor_getFd,
-    k_AFileDescriptor_setFd,
-
-    // JNI_Invocation API declared in jni.h.
-    k_JNI_CreateJavaVM,
-    k_JNI_GetCreatedJavaVMs,
-    k_JNI_GetDefaultJavaVMInitArgs,
-
-    // Methods in JNIPlatformHelp.h.
-    k_jniGetNioBufferBaseArray,
-    k_jniGetNioBufferBaseArrayOffset,
-    k_jniGetNioBufferFields,
-    k_jniGetNioBufferPointer,
-    k_jniUninitializeConstants,
-
-    // Methods in JniInvocation.h.
-    k_JniInvocationCreate,
-    k_JniInvocationDestroy,
-    k_JniInvocationGetLibrary,
-    k_JniInvocationInit,
+#define METHOD_INDEX(name) k_ ## name,
+    LIBNATIVEHELPER_METHOD_LIST(METHOD_INDEX)
+#undef METHOD_INDEX
 
     // Marker for count of methods
     k_MethodCount
 };
 
+// Symbol names of the methods, indexed by MethodIndex.
+static const char* const kMethodNames[k_MethodCount] = {
+#define METHOD_NAME(name) #name,
+    LIBNATIVEHELPER_METHOD_LIST(METHOD_NAME)
+#undef METHOD_NAME
+};
+
 // Table of methods pointers in libnativehelper APIs.
-static void* g_Methods[k_MethodCount];
+static _Atomic(void*) g_Methods[k_MethodCount];
 
 //
 // Libnativehelper lazy loading.
@@ -84,76 +146,79 @@ static void* LoadLibnativehelper(int dlopen_flags) {
     return dlopen("libnativehelper.so", dlopen_flags);
 }
 
+// Set once libnativehelper.so is known to be loaded. The library is never unloaded, so only the
+// positive result of the RTLD_NOLOAD probe is cached.
+static atomic_bool gLibnativehelperLoaded = false;
+
 static bool IsLibnativehelperLoaded() {
-    return LoadLibnativehelper(RTLD_NOLOAD) != NULL;
+    if (atomic_load_explicit(&gLibnativehelperLoaded, memory_order_acquire)) {
+        return true;
+    }
+    // dlopen takes the linker's global lock, so avoid repeating it once it has succeeded.
+    if (LoadLibnativehelper(RTLD_NOLOAD) == NULL) {
+        return false;
+    }
+    atomic_store_explicit(&gLibnativehelperLoaded, true, memory_order_release);
+    return true;
 }
 
 //
 // Initialization and symbol binding.
 //
 
-static void BindSymbol(void* handle, const char* name, enum MethodIndex index) {
+// Handle for libnativehelper.so, set once by LoadOnce().
+static void* g_Handle;
+
+static void LoadOnce() {
+    g_Handle = LoadLibnativehelper(RTLD_NOW);
+    LOG_ALWAYS_FATAL_IF(g_Handle == NULL, "Failed to load libnativehelper.so: %s", dlerror());
+    atomic_store_explicit(&gLibnativehelperLoaded, true, memory_order_release);
+}
+
+static void* EnsureLoaded() {
+    static pthread_once_t loaded = PTHREAD_ONCE_INIT;
+    pthread_once(&loaded, LoadOnce);
+    return g_Handle;
+}
+
+// Binds a single method. Symbols are bound on first use rather than all together, so a caller
+// only pays for the methods it uses. Concurrent binds of the same method store the same value.
+static __attribute__((noinline)) void* BindMethod(enum MethodIndex index) {
+    void* handle = EnsureLoaded();
+    const char* name = kMethodNames[index];
     void* symbol = dlsym(handle, name);
     LOG_ALWAYS_FATAL_IF(symbol == NULL,
                         "Failed to find symbol '%s' in libnativehelper.so: %s", name, dlerror());
-    g_Methods[index] = symbol;
+    atomic_store_explicit(&g_Methods[index], symbol, memory_order_release);
+    return symbol;
 }
 
-static void InitializeOnce() {
-    void* handle = LoadLibnativehelper(RTLD_NOW);
-    LOG_ALWAYS_FATAL_IF(handle == NULL, "Failed to load libnativehelper.so: %s", dlerror());
-
-#undef BIND_SYMBOL
-#define BIND_SYMBOL(name) BindSymbol(handle, #name, k_ ## name);
-
-    // NDK file descriptor API in file_descriptor_jni.h.
-    BIND_SYMBOL(AFileDescriptor_create);
-    BIND_SYMBOL(AFileDescriptor_getFd);
-    BIND_SYMBOL(AFileDescriptor_setFd);
-
-    // JNI_Invocation API declared in jni.h.
-    BIND_SYMBOL(JNI_CreateJavaVM);
-    BIND_SYMBOL(JNI_GetCreatedJavaVMs);
-    BIND_SYMBOL(JNI_GetDefaultJavaVMInitArgs);
-
-    // Methods in JNIPlatformHelp.h.
-    BIND_SYMBOL(jniGetNioBufferBaseArray);
-    BIND_SYMBOL(jniGetNioBufferBaseArrayOffset);
-    BIND_SYMBOL(jniGetNioBufferFields);
-    BIND_SYMBOL(jniGetNioBufferPointer);
-    BIND_SYMBOL(jniUninitializeConstants);
-
-    // Methods in JniInvocation.h.
-    BIND_SYMBOL(JniInvocationCreate);
-    BIND_SYMBOL(JniInvocationDestroy);
-    BIND_SYMBOL(JniInvocationGetLibrary);
-    BIND_SYMBOL(JniInvocationInit);
-
-#undef BIND_SYMBOL
-
-    // Check every symbol is bound.
+void LibnativehelperLazyPrebind() {
     for (int i = 0; i < k_MethodCount; ++i) {
-        LOG_ALWAYS_FATAL_IF(g_Methods[i] == NULL,
-                            "Uninitialized method in libnativehelper_lazy at index: %d", i);
+        if (atomic_load_explicit(&g_Methods[i], memory_order_acquire) == NULL) {
+            BindMethod((enum MethodIndex) i);
+        }
     }
 }
 
-static void EnsureInitialized() {
-    static pthread_once_t initialized = PTHREAD_ONCE_INIT;
-    pthread_once(&initialized, InitializeOnce);
+
+static inline void* GetMethod(enum MethodIndex index) {
+    void* method = atomic_load_explicit(&g_Methods[index], memory_order_acquire);
+    if (__builtin_expect(method == NULL, false)) {
+        method = BindMethod(index);
+    }
+    return method;
 }
 
 #define INVOKE_METHOD(name, method_type, args...)       \
     do {                                                \
-        EnsureInitialized();                            \
-        void* method = g_Methods[k_ ## name];           \
+        void* method = GetMethod(k_ ## name);           \
         return ((method_type) method)(args);            \
     } while (0)
 
 #define INVOKE_VOID_METHOD(name, method_type, args...)  \
     do {                                                \
-        EnsureInitialized();                            \
-        void* method = g_Methods[k_ ## name];           \
+        void* method = GetMethod(k_ ## name);           \
         ((method_type) method)(args);                   \
     } while (0)
 
@@ -176,6 +241,32 @@ void AFileDescriptor_setFd(JNIEnv* env, jobject fileDescriptor, int fd) {
     INVOKE_VOID_METHOD(AFileDescriptor_setFd, M, env, fileDescriptor, fd);
 }
 
+int AFileDescriptor_getFdUnchecked(JNIEnv* env, jobject fileDescriptor) {
+    typedef int (*M)(JNIEnv*, jobject);
+    INVOKE_METHOD(AFileDescriptor_getFdUnchecked, M, env, fileDescriptor);
+}
+
+void AFileDescriptor_setFdUnchecked(JNIEnv* env, jobject fileDescriptor, int fd) {
+    typedef void (*M)(JNIEnv*, jobject, int);
+    INVOKE_VOID_METHOD(AFileDescriptor_setFdUnchecked, M, env, fileDescriptor, fd);
+}
+
+jobjectArray AFileDescriptor_createArray(JNIEnv* env, const int* fds, size_t count) {
+    typedef jobjectArray (*M)(JNIEnv*, const int*, size_t);
+    INVOKE_METHOD(AFileDescriptor_createArray, M, env, fds, count);
+}
+
+void AFileDescriptor_getFds(JNIEnv* env, jobjectArray fileDescriptors, int* fds, size_t count) {
+    typedef void (*M)(JNIEnv*, jobjectArray, int*, size_t);
+    INVOKE_VOID_METHOD(AFileDescriptor_getFds, M, env, fileDescriptors, fds, count);
+}
+
+void AFileDescriptor_setFds(JNIEnv* env, jobjectArray fileDescriptors, const int* fds,
+                            size_t count) {
+    typedef void (*M)(JNIEnv*, jobjectArray, const int*, size_t);
+    INVOKE_VOID_METHOD(AFileDescriptor_setFds, M, env, fileDescriptors, fds, count);
+}
+
 //
 // Forwarding for the JNI_Invocation API declarded in jni.h.
 //
@@ -219,6 +310,26 @@ jint JNI_GetCreatedJavaVMs(JavaVM** p_vm, jsize vm_max, jsize* p_vm_count) {
     INVOKE_METHOD(JNI_GetCreatedJavaVMs, M, p_vm, vm_max, p_vm_count);
 }
 
+//
+// Forwarding for methods in JniExceptionCache.h.
+//
+
+int jniRegisterExceptionClass(JNIEnv* env, const char* className) {
+    typedef int (*M)(JNIEnv*, const char*);
+    INVOKE_METHOD(jniRegisterExceptionClass, M, env, className);
+}
+
+int jniThrowExceptionWithCtorV(JNIEnv* env, const char* className, const char* ctorSig,
+                               va_list args) {
+    typedef int (*M)(JNIEnv*, const char*, const char*, va_list);
+    INVOKE_METHOD(jniThrowExceptionWithCtorV, M, env, className, ctorSig, args);
+}
+
+int jniThrowIOException(JNIEnv* env, int errno_value) {
+    typedef int (*M)(JNIEnv*, int);
+    INVOKE_METHOD(jniThrowIOException, M, env, errno_value);
+}
+
 //
 // Forwarding for methods in JNIPlatformHelp.h.
 //
@@ -240,16 +351,127 @@ jlong jniGetNioBufferFields(JNIEnv* env, jobject nioBuffer,
                           elementSizeShift);
 }
 
+void jniGetNioBufferInfo(JNIEnv* env, jobject nioBuffer, struct JniNioBufferInfo* info) {
+    typedef void (*M)(JNIEnv*, jobject, struct JniNioBufferInfo*);
+    INVOKE_VOID_METHOD(jniGetNioBufferInfo, M, env, nioBuffer, info);
+}
+
 jlong jniGetNioBufferPointer(JNIEnv* env, jobject nioBuffer) {
     typedef jlong (*M)(JNIEnv*, jobject);
     INVOKE_METHOD(jniGetNioBufferPointer, M, env, nioBuffer);
 }
 
+void jniLogExceptionDeduplicated(JNIEnv* env, int priority, const char* tag, jthrowable thrown) {
+    typedef void (*M)(JNIEnv*, int, const char*, jthrowable);
+    INVOKE_VOID_METHOD(jniLogExceptionDeduplicated, M, env, priority, tag, thrown);
+}
+
+void jniSetLogExceptionDeduplicationWindow(int64_t windowMs) {
+    typedef void (*M)(int64_t);
+    INVOKE_VOID_METHOD(jniSetLogExceptionDeduplicationWindow, M, windowMs);
+}
+
+void jniLogExceptionAsync(JNIEnv* env, int priority, const char* tag, jthrowable thrown) {
+    typedef void (*M)(JNIEnv*, int, const char*, jthrowable);
+    INVOKE_VOID_METHOD(jniLogExceptionAsync, M, env, priority, tag, thrown);
+}
+
+void jniFlushAsyncExceptionLog() {
+    typedef void (*M)();
+    INVOKE_VOID_METHOD(jniFlushAsyncExceptionLog, M);
+}
+
+void jniGetAsyncExceptionLogStats(struct JniAsyncExceptionLogStats* stats) {
+    typedef void (*M)(struct JniAsyncExceptionLogStats*);
+    INVOKE_VOID_METHOD(jniGetAsyncExceptionLogStats, M, stats);
+}
+
+void jniInitializeConstants(JNIEnv* env) {
+    typedef void (*M)(JNIEnv*);
+    INVOKE_VOID_METHOD(jniInitializeConstants, M, env);
+}
+
 void jniUninitializeConstants() {
     typedef void (*M)();
     INVOKE_VOID_METHOD(jniUninitializeConstants, M);
 }
 
+jstring jniInternString(JNIEnv* env, const char* utf8) {
+    typedef jstring (*M)(JNIEnv*, const char*);
+    INVOKE_METHOD(jniInternString, M, env, utf8);
+}
+
+//
+// Forwarding for methods in JniConstantsTable.h.
+//
+
+bool jniResolveConstants(JNIEnv* env, struct JniConstantsTable* table) {
+    typedef bool (*M)(JNIEnv*, struct JniConstantsTable*);
+    INVOKE_METHOD(jniResolveConstants, M, env, table);
+}
+
+bool jniResolveConstantsInParallel(JNIEnv* env, struct JniConstantsTable* const* tables,
+                                   size_t count, size_t maxThreads) {
+    typedef bool (*M)(JNIEnv*, struct JniConstantsTable* const*, size_t, size_t);
+    INVOKE_METHOD(jniResolveConstantsInParallel, M, env, tables, count, maxThreads);
+}
+
+void jniUnregisterConstants(JNIEnv* env, struct JniConstantsTable* table) {
+    typedef void (*M)(JNIEnv*, struct JniConstantsTable*);
+    INVOKE_VOID_METHOD(jniUnregisterConstants, M, env, table);
+}
+
+//
+// Forwarding for methods in JniArena.h.
+//
+
+size_t jniArenaBegin() {
+    typedef size_t (*M)();
+    INVOKE_METHOD(jniArenaBegin, M);
+}
+
+void jniArenaEnd(size_t mark) {
+    typedef void (*M)(size_t);
+    INVOKE_VOID_METHOD(jniArenaEnd, M, mark);
+}
+
+void* jniArenaAllocate(size_t size) {
+    typedef void* (*M)(size_t);
+    INVOKE_METHOD(jniArenaAllocate, M, size);
+}
+
+void* jniArenaReallocate(void* ptr, size_t oldSize, size_t newSize) {
+    typedef void* (*M)(void*, size_t, size_t);
+    INVOKE_METHOD(jniArenaReallocate, M, ptr, oldSize, newSize);
+}
+
+//
+// Forwarding for methods in JniDirectBufferPool.h.
+//
+
+struct JniDirectBufferPool* jniCreateDirectBufferPool(JNIEnv* env, const size_t* classSizes,
+                                                      size_t classCount,
+                                                      size_t buffersPerClass) {
+    typedef struct JniDirectBufferPool* (*M)(JNIEnv*, const size_t*, size_t, size_t);
+    INVOKE_METHOD(jniCreateDirectBufferPool, M, env, classSizes, classCount, buffersPerClass);
+}
+
+void jniDestroyDirectBufferPool(JNIEnv* env, struct JniDirectBufferPool* pool) {
+    typedef void (*M)(JNIEnv*, struct JniDirectBufferPool*);
+    INVOKE_VOID_METHOD(jniDestroyDirectBufferPool, M, env, pool);
+}
+
+jobject jniAcquireDirectBuffer(JNIEnv* env, struct JniDirectBufferPool* pool, size_t size,
+                               void** address) {
+    typedef jobject (*M)(JNIEnv*, struct JniDirectBufferPool*, size_t, void**);
+    INVOKE_METHOD(jniAcquireDirectBuffer, M, env, pool, size, address);
+}
+
+void jniReleaseDirectBuffer(JNIEnv* env, struct JniDirectBufferPool* pool, jobject buffer) {
+    typedef void (*M)(JNIEnv*, struct JniDirectBufferPool*, jobject);
+    INVOKE_VOID_METHOD(jniReleaseDirectBuffer, M, env, pool, buffer);
+}
+
 //
 // Forwarding for methods in JniInvocation.h.
 //
@@ -269,7 +491,67 @@ bool JniInvocationInit(struct JniInvocationImpl* instance, const char* library)
     INVOKE_METHOD(JniInvocationInit, M, instance, library);
 }
 
+bool JniInvocationInitWithFlags(struct JniInvocationImpl* instance, const char* library,
+                                int flags) {
+    typedef bool (*M)(struct JniInvocationImpl*, const char*, int);
+    INVOKE_METHOD(JniInvocationInitWithFlags, M, instance, library, flags);
+}
+
 const char* JniInvocationGetLibrary(const char* library, char* buffer) {
     typedef const char* (*M)(const char*, char*);
     INVOKE_METHOD(JniInvocationGetLibrary, M, library, buffer);
 }
+
+bool JniInvocationGetInitTimings(const struct JniInvocationImpl* instance,
+                                 struct JniInvocationInitTimings* timings) {
+    typedef bool (*M)(const struct JniInvocationImpl*, struct JniInvocationInitTimings*);
+    INVOKE_METHOD(JniInvocationGetInitTimings, M, instance, timings);
+}
+
+bool JniInvocationPreload(const char* library, int flags) {
+    typedef bool (*M)(const char*, int);
+    INVOKE_METHOD(JniInvocationPreload, M, library, flags);
+}
+
+//
+// Forwarding for methods in JniProfiling.h.
+//
+
+bool jniGetProfilingStats(enum JniProfilingEntryPoint entryPoint, struct JniProfilingStats* stats) {
+    typedef bool (*M)(enum JniProfilingEntryPoint, struct JniProfilingStats*);
+    INVOKE_METHOD(jniGetProfilingStats, M, entryPoint, stats);
+}
+
+void jniResetProfilingStats() {
+    typedef void (*M)();
+    INVOKE_VOID_METHOD(jniResetProfilingStats, M);
+}
+
+//
+// Forwarding for methods in JniTracing.h.
+//
+
+bool jniTraceJniEnv(JNIEnv* env) {
+    typedef bool (*M)(JNIEnv*);
+    INVOKE_METHOD(jniTraceJniEnv, M, env);
+}
+
+void jniUntraceJniEnv(JNIEnv* env) {
+    typedef void (*M)(JNIEnv*);
+    INVOKE_VOID_METHOD(jniUntraceJniEnv, M, env);
+}
+
+bool jniGetTracingStats(const char* function, struct JniTracingStats* stats) {
+    typedef bool (*M)(const char*, struct JniTracingStats*);
+    INVOKE_METHOD(jniGetTracingStats, M, function, stats);
+}
+
+void jniResetTracingStats() {
+    typedef void (*M)();
+    INVOKE_VOID_METHOD(jniResetTracingStats, M);
+}
+
+void jniLogTracingStats(int priority, const char* tag) {
+    typedef void (*M)(int, const char*);
+    INVOKE_VOID_METHOD(jniLogTracingStats, M, priority, tag);
+}
@@ -15,12 +15,14 @@
  */
 
 #include <array>
+#include <cmath>
 #include <string>
 
 #include <gtest/gtest.h>
 #include <string.h>
 
 #include "../ExpandableString.h"
+#include "../include_platform/nativehelper/JniArena.h"
 
 
 TEST(ExpandableString, InitializeAppendRelease) {
@@ -59,6 +61,121 @@ TEST(ExpandableString, InitializeWriteRelease) {
     EXPECT_GE(s.dataSize, 0u);
 }
 
+// Each change of capacity corresponds to one heap (re)allocation of the string storage.
+static void AppendCountingAllocations(struct ExpandableString* s, const char* text,
+                                      size_t* allocations) {
+    size_t oldCapacity = s->capacity;
+    EXPECT_TRUE(ExpandableStringAppend(s, text));
+    if (s->capacity != oldCapacity && s->data != s->buffer) {
+        ++*allocations;
+    }
+}
+
+TEST(ExpandableString, AppendGrowsGeometrically) {
+    const std::string kFrame = "\tat com.example.Foo.bar(Foo.java:42)\n";
+    struct ExpandableString s;
+    ExpandableStringInitialize(&s);
+    size_t allocations = 0;
+    constexpr size_t kAppends = 4096;
+    for (size_t i = 0; i < kAppends; ++i) {
+        AppendCountingAllocations(&s, kFrame.c_str(), &allocations);
+    }
+    EXPECT_EQ(s.dataSize, kAppends * kFrame.size());
+    EXPECT_GT(s.capacity, s.dataSize);
+    // Doubling growth needs at most log2(total size) allocations rather than one per append.
+    size_t maxAllocations = static_cast<size_t>(std::log2(kAppends * kFrame.size())) + 1u;
+    EXPECT_LE(allocations, maxAllocations);
+    ExpandableStringRelease(&s);
+    EXPECT_TRUE(s.data == NULL);
+    EXPECT_EQ(s.capacity, 0u);
+}
+
+TEST(ExpandableString, ReserveAvoidsReallocation) {
+    struct ExpandableString s;
+    ExpandableStringInitialize(&s);
+    EXPECT_TRUE(ExpandableStringReserve(&s, 1000u));
+    EXPECT_TRUE(s.data != NULL);
+    EXPECT_GE(s.capacity, 1001u);
+    EXPECT_STREQ(s.data, "");
+
+    const char* data = s.data;
+    size_t allocations = 0;
+    for (size_t i = 0; i < 100u; ++i) {
+        AppendCountingAllocations(&s, "0123456789", &allocations);
+    }
+    EXPECT_EQ(allocations, 0u);
+    EXPECT_EQ(data, s.data);
+    EXPECT_EQ(s.dataSize, 1000u);
+    ExpandableStringRelease(&s);
+}
+
+TEST(ExpandableString, CallerBufferAvoidsAllocation) {
+    const char* kSummary = "java.lang.IllegalStateException: Ahoy!";
+    char buffer[64];
+    struct ExpandableString s;
+    ExpandableStringInitializeWithBuffer(&s, buffer, sizeof(buffer));
+    EXPECT_TRUE(s.data == NULL);
+
+    size_t allocations = 0;
+    AppendCountingAllocations(&s, "java.lang.IllegalStateException", &allocations);
+    AppendCountingAllocations(&s, ": ", &allocations);
+    AppendCountingAllocations(&s, "Ahoy!", &allocations);
+    EXPECT_EQ(allocations, 0u);
+    EXPECT_EQ(s.data, buffer);
+    EXPECT_STREQ(s.data, kSummary);
+
+    // Overflowing the caller buffer moves the contents to the heap.
+    std::string tail(sizeof(buffer), 'x');
+    AppendCountingAllocations(&s, tail.c_str(), &allocations);
+    EXPECT_EQ(allocations, 1u);
+    EXPECT_NE(s.data, buffer);
+    EXPECT_EQ(std::string(kSummary) + tail, s.data);
+
+    // Caller buffer is used again after release.
+    EXPECT_TRUE(ExpandableStringAssign(&s, kSummary));
+    EXPECT_EQ(s.data, buffer);
+    EXPECT_STREQ(s.data, kSummary);
+    ExpandableStringRelease(&s);
+    EXPECT_TRUE(s.data == NULL);
+}
+
+TEST(ExpandableString, ArenaGrowsInPlace) {
+    ScopedJniArena arena;
+    struct ExpandableString s;
+    ExpandableStringInitializeWithArena(&s);
+    ASSERT_TRUE(ExpandableStringAppend(&s, "java.lang.IllegalStateException"));
+    char* first = s.data;
+    std::string expected = "java.lang.IllegalStateException";
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(ExpandableStringAppend(&s, "\n\tat Frame.method(Frame.java)"));
+        expected += "\n\tat Frame.method(Frame.java)";
+    }
+    EXPECT_TRUE(s.dataInArena);
+    EXPECT_EQ(first, s.data);
+    EXPECT_EQ(expected, s.data);
+    ExpandableStringRelease(&s);
+    EXPECT_TRUE(s.data == NULL);
+}
+
+TEST(ExpandableString, ArenaFallsBackToHeap) {
+    // Without an arena scope the string is on the heap.
+    struct ExpandableString s;
+    ExpandableStringInitializeWithArena(&s);
+    ASSERT_TRUE(ExpandableStringAppend(&s, "Ahoy!"));
+    EXPECT_FALSE(s.dataInArena);
+
+    // As it is once it outgrows the arena.
+    ScopedJniArena arena;
+    std::string large(256 * 1024, 'x');
+    ExpandableStringRelease(&s);
+    ASSERT_TRUE(ExpandableStringAppend(&s, "Ahoy!"));
+    EXPECT_TRUE(s.dataInArena);
+    ASSERT_TRUE(ExpandableStringAppend(&s, large.c_str()));
+    EXPECT_FALSE(s.dataInArena);
+    EXPECT_EQ("Ahoy!" + large, s.data);
+    ExpandableStringRelease(&s);
+}
+
 class ExpandableStringTestFixture : public :: testing::TestWithParam<size_t> {
     protected:
         struct ExpandableString expandableString;
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/JNIHelp.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+int gFindClassCalls;
+int gRegisterNativesCalls;
+int gDeleteLocalRefCalls;
+int gFoundClass;
+
+jclass FakeFindClass(JNIEnv*, const char*) {
+    ++gFindClassCalls;
+    return reinterpret_cast<jclass>(&gFoundClass);
+}
+
+jint FakeRegisterNatives(JNIEnv*, jclass, const JNINativeMethod*, jint) {
+    ++gRegisterNativesCalls;
+    return JNI_OK;
+}
+
+void FakeDeleteLocalRef(JNIEnv*, jobject) {
+    ++gDeleteLocalRefCalls;
+}
+
+JNIEnv* GetFakeEnv() {
+    static JNINativeInterface functions = []() {
+        JNINativeInterface f = {};
+        f.FindClass = FakeFindClass;
+        f.RegisterNatives = FakeRegisterNatives;
+        f.DeleteLocalRef = FakeDeleteLocalRef;
+        return f;
+    }();
+    static JNIEnv env = { &functions };
+    gFindClassCalls = gRegisterNativesCalls = gDeleteLocalRefCalls = 0;
+    return &env;
+}
+
+void NativeMethod(JNIEnv*, jclass) {}
+
+const JNINativeMethod kMethods[] = {
+    { "nativeMethod", "()V", reinterpret_cast<void*>(NativeMethod) },
+};
+
+}  // namespace
+
+TEST(JNIHelpRegistration, BatchFindsOnlyUnresolvedClasses) {
+    JNIEnv* env = GetFakeEnv();
+    int resolved;
+    JniNativeRegistration entries[] = {
+        { "com/example/A", nullptr, kMethods, 1, -1, -1 },
+        { "com/example/B", reinterpret_cast<jclass>(&resolved), kMethods, 1, -1, -1 },
+        { "com/example/C", nullptr, kMethods, 1, -1, -1 },
+    };
+    EXPECT_EQ(0, jniRegisterNativeMethodsBatch(env, entries, std::size(entries)));
+    EXPECT_EQ(2, gFindClassCalls);
+    EXPECT_EQ(3, gRegisterNativesCalls);
+    // Only the classes looked up by the batch are released; the caller owns the others.
+    EXPECT_EQ(2, gDeleteLocalRefCalls);
+    for (const JniNativeRegistration& entry : entries) {
+        EXPECT_GE(entry.findClassNs, 0);
+        EXPECT_GE(entry.registerNativesNs, 0);
+    }
+}
+
+TEST(JNIHelpRegistration, EmptyBatch) {
+    JNIEnv* env = GetFakeEnv();
+    EXPECT_EQ(0, jniRegisterNativeMethodsBatch(env, nullptr, 0));
+    EXPECT_EQ(0, gFindClassCalls);
+    EXPECT_EQ(0, gRegisterNativesCalls);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/JniArena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+TEST(JniArena, NoScope) {
+    EXPECT_EQ(nullptr, jniArenaAllocate(16));
+    EXPECT_EQ(nullptr, jniArenaReallocate(nullptr, 0, 16));
+}
+
+TEST(JniArena, ScopesReleaseTheirAllocations) {
+    void* first;
+    {
+        ScopedJniArena arena;
+        first = arena.allocate<char>(100);
+        ASSERT_NE(nullptr, first);
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first) % alignof(max_align_t));
+
+        void* inner;
+        {
+            ScopedJniArena nested;
+            inner = nested.allocate<double>(3);
+            ASSERT_NE(nullptr, inner);
+            EXPECT_GT(inner, first);
+            EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(inner) % alignof(double));
+        }
+        // The nested scope's memory is handed out again.
+        EXPECT_EQ(inner, arena.allocate<double>(3));
+    }
+    ScopedJniArena arena;
+    EXPECT_EQ(first, arena.allocate<char>(1));
+}
+
+TEST(JniArena, Exhausted) {
+    ScopedJniArena arena;
+    EXPECT_EQ(nullptr, arena.allocate<char>(SIZE_MAX));
+    EXPECT_EQ(nullptr, arena.allocate<uint64_t>(SIZE_MAX / 4));
+    EXPECT_EQ(nullptr, arena.allocate<char>(1024 * 1024));
+    // A failed allocation leaves the arena usable.
+    EXPECT_NE(nullptr, arena.allocate<char>(1024));
+}
+
+TEST(JniArena, ReallocateGrowsTheMostRecentAllocationInPlace) {
+    ScopedJniArena arena;
+    char* a = static_cast<char*>(jniArenaReallocate(nullptr, 0, 8));
+    ASSERT_NE(nullptr, a);
+    memcpy(a, "arena", 6);
+    EXPECT_EQ(a, jniArenaReallocate(a, 8, 512));
+
+    char* b = arena.allocate<char>(8);
+    ASSERT_NE(nullptr, b);
+    // |a| is no longer the most recent allocation, so it is copied.
+    char* moved = static_cast<char*>(jniArenaReallocate(a, 512, 1024));
+    ASSERT_NE(nullptr, moved);
+    EXPECT_GT(moved, b);
+    EXPECT_STREQ("arena", moved);
+}
+
+TEST(JniArena, ThreadsHaveTheirOwnArena) {
+    ScopedJniArena arena;
+    void* mine = arena.allocate<char>(1);
+    void* theirs = nullptr;
+    std::thread([&theirs]() {
+        ScopedJniArena arena;
+        theirs = arena.allocate<char>(1);
+    }).join();
+    EXPECT_NE(nullptr, theirs);
+    EXPECT_NE(mine, theirs);
+}
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/JniConstantsTable.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <android/file_descriptor_jni.h>
+#include <nativehelper/JNIPlatformHelp.h>
+#include <nativehelper/jni_gtest.h>
+
+#include "libnativehelper_benchmark.h"
+
+namespace android {
+
+namespace {
+
+enum {
+    kFileDescriptor,
+    kFileDescriptor_init,
+    kFileDescriptor_descriptor,
+    kMissing,
+    kMissing_method,
+    kConstantCount,
+};
+
+const JniConstantDescriptor kDescriptors[kConstantCount] = {
+    JNI_CONSTANT_CLASS("java/io/FileDescriptor"),
+    JNI_CONSTANT_METHOD(kFileDescriptor, "<init>", "()V"),
+    JNI_CONSTANT_FIELD(kFileDescriptor, "descriptor", "I"),
+    JNI_CONSTANT_OPTIONAL_CLASS("com/example/Missing"),
+    {kJniConstantMethod, "method", "()V", kMissing, true},
+};
+
+jclass (*gFindClass)(JNIEnv*, const char*);
+
+// The mock finds every class, this makes it miss the ones in the com.example package.
+jclass FindClassExceptExamples(JNIEnv* env, const char* name) {
+    if (strncmp(name, "com/example/", strlen("com/example/")) == 0) {
+        return nullptr;
+    }
+    return gFindClass(env, name);
+}
+
+// A VM that cannot attach threads, so parallel resolution falls back to the calling thread.
+jint FailAttachCurrentThread(JavaVM*, JNIEnv**, void*) {
+    return JNI_ERR;
+}
+
+jint DetachCurrentThread(JavaVM*) {
+    return JNI_OK;
+}
+
+JNIInvokeInterface MakeUnattachableInvokeInterface() {
+    JNIInvokeInterface functions = {};
+    functions.AttachCurrentThread = FailAttachCurrentThread;
+    functions.DetachCurrentThread = DetachCurrentThread;
+    return functions;
+}
+
+const JNIInvokeInterface gUnattachableInvokeInterface = MakeUnattachableInvokeInterface();
+JavaVM gUnattachableVm = {&gUnattachableInvokeInterface};
+
+jint GetUnattachableJavaVM(JNIEnv*, JavaVM** vm) {
+    *vm = &gUnattachableVm;
+    return JNI_OK;
+}
+
+}  // namespace
+
+class JniConstantsTableTest : public JNITestBase<CountingJNIProvider<BenchmarkMockJNIProvider>> {
+protected:
+    void SetUp() override {
+        JNITestBase::SetUp();
+        JNINativeInterface* functions = const_cast<JNINativeInterface*>(
+                CountingJNIProvider<BenchmarkMockJNIProvider>::WrappedEnv(env_)->functions);
+        if (functions->FindClass != FindClassExceptExamples) {
+            gFindClass = functions->FindClass;
+            functions->FindClass = FindClassExceptExamples;
+        }
+        functions->GetJavaVM = GetUnattachableJavaVM;
+        memset(values_, 0, sizeof(values_));
+        table_ = JNI_CONSTANTS_TABLE_INIT(kDescriptors, values_);
+    }
+
+    void TearDown() override {
+        jniUninitializeConstants();
+        env_->ExceptionClear();
+        JNITestBase::TearDown();
+    }
+
+    JniConstantValue values_[kConstantCount];
+    JniConstantsTable table_;
+};
+
+TEST_F(JniConstantsTableTest, ResolvesOnce) {
+    EXPECT_FALSE(jniConstantsResolved(&table_));
+    ASSERT_TRUE(jniResolveConstants(env_, &table_));
+    EXPECT_TRUE(jniConstantsResolved(&table_));
+    EXPECT_EQ(2u, provider_.CallCount(JniFunction::FindClass));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::GetMethodID));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::GetFieldID));
+
+    EXPECT_NE(nullptr, jniGetConstantClass(env_, &table_, kFileDescriptor));
+    EXPECT_NE(nullptr, jniGetConstantMethod(env_, &table_, kFileDescriptor_init));
+    EXPECT_NE(nullptr, jniGetConstantField(env_, &table_, kFileDescriptor_descriptor));
+    // Optional constants that are missing are null without an exception.
+    EXPECT_EQ(nullptr, jniGetConstantClass(env_, &table_, kMissing));
+    EXPECT_EQ(nullptr, jniGetConstantMethod(env_, &table_, kMissing_method));
+    EXPECT_FALSE(env_->ExceptionCheck());
+
+    ASSERT_TRUE(jniResolveConstants(env_, &table_));
+    EXPECT_EQ(2u, provider_.CallCount(JniFunction::FindClass));
+}
+
+TEST_F(JniConstantsTableTest, ResolvesLazily) {
+    EXPECT_NE(nullptr, jniGetConstantField(env_, &table_, kFileDescriptor_descriptor));
+    EXPECT_TRUE(jniConstantsResolved(&table_));
+}
+
+TEST_F(JniConstantsTableTest, RequiredConstantMissing) {
+    const JniConstantDescriptor descriptors[] = {
+        JNI_CONSTANT_CLASS("java/io/FileDescriptor"),
+        JNI_CONSTANT_CLASS("com/example/Missing"),
+    };
+    JniConstantValue values[2] = {};
+    JniConstantsTable table = JNI_CONSTANTS_TABLE_INIT(descriptors, values);
+    EXPECT_FALSE(jniResolveConstants(env_, &table));
+    EXPECT_FALSE(jniConstantsResolved(&table));
+    EXPECT_EQ(nullptr, jniGetConstantClass(env_, &table, 0));
+}
+
+TEST_F(JniConstantsTableTest, UninitializeResets) {
+    ASSERT_TRUE(jniResolveConstants(env_, &table_));
+    jniUninitializeConstants();
+    EXPECT_FALSE(jniConstantsResolved(&table_));
+    EXPECT_EQ(nullptr, values_[kFileDescriptor].clazz);
+
+    provider_.ResetCallCounts();
+    EXPECT_NE(nullptr, jniGetConstantClass(env_, &table_, kFileDescriptor));
+    EXPECT_EQ(2u, provider_.CallCount(JniFunction::FindClass));
+}
+
+TEST_F(JniConstantsTableTest, UnregisterUnlinks) {
+    std::unique_ptr<JniConstantValue[]> values(new JniConstantValue[kConstantCount]());
+    std::unique_ptr<JniConstantsTable> table(new JniConstantsTable(
+            JNI_CONSTANTS_TABLE_INIT(kDescriptors, values.get())));
+    ASSERT_TRUE(jniResolveConstants(env_, table.get()));
+    ASSERT_TRUE(jniResolveConstants(env_, &table_));
+
+    provider_.ResetCallCounts();
+    jniUnregisterConstants(env_, table.get());
+    EXPECT_FALSE(jniConstantsResolved(table.get()));
+    EXPECT_EQ(nullptr, values[kFileDescriptor].clazz);
+    // Only FileDescriptor has a reference, the optional class is missing.
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::DeleteGlobalRef));
+    // Unregistering again is a no-op.
+    jniUnregisterConstants(env_, table.get());
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::DeleteGlobalRef));
+
+    // The freed table is no longer reset by jniUninitializeConstants(), unlike the others.
+    table.reset();
+    values.reset();
+    jniUninitializeConstants();
+    EXPECT_FALSE(jniConstantsResolved(&table_));
+}
+
+// Resolved tables stay linked into libnativehelper until jniUninitializeConstants() in
+// TearDown(), so they need static storage.
+const JniConstantDescriptor kFileDescriptorDescriptors[] = {
+    JNI_CONSTANT_CLASS("java/io/FileDescriptor"),
+    JNI_CONSTANT_FIELD(0, "descriptor", "I"),
+};
+JniConstantValue gFileDescriptorValues[2];
+JniConstantsTable gFileDescriptorTable =
+        JNI_CONSTANTS_TABLE_INIT(kFileDescriptorDescriptors, gFileDescriptorValues);
+
+const JniConstantDescriptor kBufferDescriptors[] = {
+    JNI_CONSTANT_CLASS("java/nio/Buffer"),
+    JNI_CONSTANT_FIELD(0, "address", "J"),
+};
+JniConstantValue gBufferValues[2];
+JniConstantsTable gBufferTable = JNI_CONSTANTS_TABLE_INIT(kBufferDescriptors, gBufferValues);
+
+TEST_F(JniConstantsTableTest, ResolveInParallel) {
+    JniConstantsTable* tables[] = {&table_, &gFileDescriptorTable, &gBufferTable};
+
+    EXPECT_TRUE(jniResolveConstantsInParallel(env_, tables, 3, 4));
+    for (JniConstantsTable* table : tables) {
+        EXPECT_TRUE(jniConstantsResolved(table));
+    }
+    EXPECT_NE(nullptr, gBufferValues[1].field);
+}
+
+TEST_F(JniConstantsTableTest, ResolveInParallelReportsFailure) {
+    const JniConstantDescriptor missing[] = {
+        JNI_CONSTANT_CLASS("com/example/Missing"),
+    };
+    JniConstantValue missingValues[1] = {};
+    JniConstantsTable missingTable = JNI_CONSTANTS_TABLE_INIT(missing, missingValues);
+    JniConstantsTable* tables[] = {&missingTable, &table_};
+
+    EXPECT_FALSE(jniResolveConstantsInParallel(env_, tables, 2, 2));
+    EXPECT_FALSE(jniConstantsResolved(&missingTable));
+}
+
+// A thread-safe fake with a VM that attaches threads, for the worker threads of
+// jniResolveConstantsInParallel(). The fake of JniConstantsTableTest is single threaded.
+class AttachableVm {
+  public:
+    AttachableVm() {
+        functions_.FindClass = FindClass;
+        functions_.NewGlobalRef = [](JNIEnv*, jobject obj) { return obj; };
+        functions_.DeleteGlobalRef = [](JNIEnv*, jobject) {};
+        functions_.DeleteLocalRef = [](JNIEnv*, jobject) {};
+        functions_.GetFieldID = [](JNIEnv*, jclass cls, const char*, const char*) {
+            return reinterpret_cast<jfieldID>(cls);
+        };
+        functions_.ExceptionClear = [](JNIEnv*) {};
+        functions_.GetJavaVM = [](JNIEnv*, JavaVM** vm) {
+            *vm = &Get()->vm_;
+            return JNI_OK;
+        };
+        invoke_.AttachCurrentThread = [](JavaVM*, JNIEnv** env, void*) {
+            Get()->attached_.fetch_add(1);
+            *env = &Get()->env_;
+            return JNI_OK;
+        };
+        invoke_.DetachCurrentThread = [](JavaVM*) {
+            Get()->detached_.fetch_add(1);
+            return JNI_OK;
+        };
+        gInstance = this;
+    }
+
+    ~AttachableVm() { gInstance = nullptr; }
+
+    JNIEnv* env() { return &env_; }
+    int attached() const { return attached_.load(); }
+    int detached() const { return detached_.load(); }
+    int workerLookups() const { return worker_lookups_.load(); }
+
+  private:
+    static AttachableVm* Get() { return gInstance; }
+
+    // Lookups on the calling thread wait for a worker to look up a class, so that the test
+    // knows the workers did part of the resolution.
+    static jclass FindClass(JNIEnv*, const char* name) {
+        AttachableVm* self = Get();
+        std::unique_lock<std::mutex> lock(self->mutex_);
+        if (std::this_thread::get_id() == self->caller_) {
+            self->cv_.wait_for(lock, std::chrono::seconds(10),
+                               [self] { return self->worker_lookups_.load() > 0; });
+        } else {
+            self->worker_lookups_.fetch_add(1);
+            self->cv_.notify_all();
+        }
+        return reinterpret_cast<jclass>(const_cast<char*>(name));
+    }
+
+    static AttachableVm* gInstance;
+
+    JNINativeInterface functions_ = {};
+    JNIEnv env_ = {&functions_};
+    JNIInvokeInterface invoke_ = {};
+    JavaVM vm_ = {&invoke_};
+    const std::thread::id caller_ = std::this_thread::get_id();
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<int> attached_{0};
+    std::atomic<int> detached_{0};
+    std::atomic<int> worker_lookups_{0};
+};
+
+AttachableVm* AttachableVm::gInstance = nullptr;
+
+const JniConstantDescriptor kStringDescriptors[] = {
+    JNI_CONSTANT_CLASS("java/lang/String"),
+    JNI_CONSTANT_FIELD(0, "value", "[B"),
+};
+JniConstantValue gStringValues[2];
+JniConstantsTable gStringTable = JNI_CONSTANTS_TABLE_INIT(kStringDescriptors, gStringValues);
+
+const JniConstantDescriptor kIntegerDescriptors[] = {
+    JNI_CONSTANT_CLASS("java/lang/Integer"),
+    JNI_CONSTANT_FIELD(0, "value", "I"),
+};
+JniConstantValue gIntegerValues[2];
+JniConstantsTable gIntegerTable = JNI_CONSTANTS_TABLE_INIT(kIntegerDescriptors, gIntegerValues);
+
+TEST(JniConstantsTableParallelTest, ResolvesOnAttachedThreads) {
+    AttachableVm vm;
+    JniConstantsTable* tables[] = {&gFileDescriptorTable, &gBufferTable, &gStringTable,
+                                   &gIntegerTable};
+
+    EXPECT_TRUE(jniResolveConstantsInParallel(vm.env(), tables, 4, 4));
+    for (JniConstantsTable* table : tables) {
+        EXPECT_TRUE(jniConstantsResolved(table));
+    }
+    EXPECT_EQ(reinterpret_cast<jfieldID>(const_cast<char*>("java/lang/Integer")),
+              gIntegerValues[1].field);
+    // Every worker attaches and detaches once, and resolves at least one table.
+    EXPECT_EQ(3, vm.attached());
+    EXPECT_EQ(3, vm.detached());
+    EXPECT_GT(vm.workerLookups(), 0);
+
+    jniUninitializeConstants();
+}
+
+TEST_F(JniConstantsTableTest, InitializeConstants) {
+    jniUninitializeConstants();
+    provider_.ResetCallCounts();
+    jniInitializeConstants(env_);
+    EXPECT_GT(provider_.CallCount(JniFunction::FindClass), 0u);
+
+    // Nothing is left to resolve on first use.
+    jobject fileDescriptor = env_->NewGlobalRef(AFileDescriptor_create(env_));
+    provider_.ResetCallCounts();
+    AFileDescriptor_setFd(env_, fileDescriptor, 42);
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::FindClass));
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::GetFieldID));
+}
+
+}  // namespace android
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../JniConstants.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <jni.h>
+
+#include "nativehelper/JNIPlatformHelp.h"
+
+namespace {
+
+// The JniConstants cache only needs lookups to succeed, so a JNIEnv whose lookup functions
+// return distinct non-null handles is sufficient to measure the accessor cost without a VM.
+jclass FakeFindClass(JNIEnv*, const char*) {
+    static int clazz;
+    return reinterpret_cast<jclass>(&clazz);
+}
+
+// FakeFindClass taking about as long as a FindClass of a loaded class, so that other threads
+// find initialization in progress as they would with a VM.
+jclass SlowFakeFindClass(JNIEnv* env, const char* name) {
+    const auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(2);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+    return FakeFindClass(env, name);
+}
+
+jobject FakeNewGlobalRef(JNIEnv*, jobject obj) {
+    return obj;
+}
+
+jmethodID FakeGetMethodID(JNIEnv*, jclass, const char*, const char*) {
+    static int method;
+    return reinterpret_cast<jmethodID>(&method);
+}
+
+jfieldID FakeGetFieldID(JNIEnv*, jclass, const char*, const char*) {
+    static int field;
+    return reinterpret_cast<jfieldID>(&field);
+}
+
+JNIEnv* GetFakeEnv(bool slowFindClass = false) {
+    static JNINativeInterface functions[2];
+    static JNIEnv envs[2];
+    static std::once_flag once;
+    std::call_once(once, []() {
+        for (int i = 0; i < 2; ++i) {
+            JNINativeInterface& f = functions[i];
+            f.FindClass = (i == 0) ? FakeFindClass : SlowFakeFindClass;
+            f.NewGlobalRef = FakeNewGlobalRef;
+            f.GetMethodID = FakeGetMethodID;
+            f.GetStaticMethodID = FakeGetMethodID;
+            f.GetFieldID = FakeGetFieldID;
+            f.GetStaticFieldID = FakeGetFieldID;
+            envs[i].functions = &functions[i];
+        }
+    });
+    return &envs[slowFindClass ? 1 : 0];
+}
+
+// Measures the steady-state cost of a cached class lookup, which is a single acquire load, at
+// each thread count.
+void BM_JniConstants_ClassAccessor(benchmark::State& state) {
+    JNIEnv* env = GetFakeEnv();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JniConstants_FileDescriptorClass(env));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_JniConstants_ClassAccessor)->ThreadRange(1, 64)->UseRealTime();
+
+void BM_JniConstants_FieldAccessor(benchmark::State& state) {
+    JNIEnv* env = GetFakeEnv();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JniConstants_FileDescriptor_descriptor(env));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_JniConstants_FieldAccessor)->ThreadRange(1, 64)->UseRealTime();
+
+// Measures the cost of the first access after the cache has been cleared.
+void BM_JniConstants_Reinitialize(benchmark::State& state) {
+    JNIEnv* env = GetFakeEnv();
+    for (auto _ : state) {
+        jniUninitializeConstants();
+        benchmark::DoNotOptimize(JniConstants_NioBuffer_position(env));
+    }
+}
+BENCHMARK(BM_JniConstants_Reinitialize);
+
+// Releases the threads waiting in Wait() once |count| of them have arrived.
+class Barrier {
+  public:
+    explicit Barrier(int count) : count_(count) {}
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const int generation = generation_;
+        if (++arrived_ == count_) {
+            arrived_ = 0;
+            ++generation_;
+            changed_.notify_all();
+            return;
+        }
+        changed_.wait(lock, [&] { return generation_ != generation; });
+    }
+
+  private:
+    const int count_;
+    int arrived_ = 0;
+    int generation_ = 0;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+};
+
+// Measures the first access of range(0) threads at once after each restart of the cache, as
+// seen by tests that restart the runtime or by many threads reaching a first use together.
+// Reports the p99 latency of a thread's first access, and the throughput of restart cycles of
+// a first access and kAccessesPerCycle further accesses per thread.
+void BM_JniConstants_FirstUse(benchmark::State& state) {
+    constexpr int kAccessesPerCycle = 1000;
+    const int threadCount = static_cast<int>(state.range(0));
+    JNIEnv* env = GetFakeEnv(/*slowFindClass=*/true);
+    Barrier start(threadCount + 1);
+    Barrier done(threadCount + 1);
+    bool stop = false;
+    std::vector<std::vector<int64_t>> latencies(threadCount);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&, i]() {
+            for (;;) {
+                start.Wait();
+                if (stop) {
+                    return;
+                }
+                const auto begin = std::chrono::steady_clock::now();
+                benchmark::DoNotOptimize(JniConstants_NioBuffer_position(env));
+                const auto end = std::chrono::steady_clock::now();
+                latencies[i].push_back(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+                for (int j = 0; j < kAccessesPerCycle; ++j) {
+                    benchmark::DoNotOptimize(JniConstants_NioBuffer_position(env));
+                }
+                done.Wait();
+            }
+        });
+    }
+
+    double seconds = 0;
+    for (auto _ : state) {
+        // No accessor runs while uninitializing, as when the runtime has shut down.
+        jniUninitializeConstants();
+        const auto begin = std::chrono::steady_clock::now();
+        start.Wait();
+        done.Wait();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        state.SetIterationTime(elapsed.count());
+        seconds += elapsed.count();
+    }
+    stop = true;
+    start.Wait();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<int64_t> all;
+    for (const std::vector<int64_t>& thread : latencies) {
+        all.insert(all.end(), thread.begin(), thread.end());
+    }
+    std::sort(all.begin(), all.end());
+    if (!all.empty()) {
+        state.counters["p50_first_ns"] = static_cast<double>(all[all.size() / 2]);
+        state.counters["p99_first_ns"] = static_cast<double>(all[all.size() * 99 / 100]);
+    }
+    if (seconds > 0) {
+        const double accesses = static_cast<double>(state.iterations()) * threadCount *
+                                (kAccessesPerCycle + 1);
+        state.counters["accesses_per_second"] = accesses / seconds;
+    }
+}
+BENCHMARK(BM_JniConstants_FirstUse)->RangeMultiplier(2)->Range(1, 64)->UseManualTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
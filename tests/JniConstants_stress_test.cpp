@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../JniConstants.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <jni.h>
+
+#include "nativehelper/JNIPlatformHelp.h"
+
+namespace {
+
+// Number of classes in the JniConstants cache, each looked up once per initialization.
+constexpr int kCachedClassCount = 4;
+
+std::atomic<int> gFindClassCalls;
+
+jclass CountingFindClass(JNIEnv*, const char*) {
+    static int clazz;
+    gFindClassCalls.fetch_add(1, std::memory_order_relaxed);
+    // Widen the window in which other threads find initialization in progress.
+    std::this_thread::yield();
+    return reinterpret_cast<jclass>(&clazz);
+}
+
+jobject FakeNewGlobalRef(JNIEnv*, jobject obj) {
+    return obj;
+}
+
+jmethodID FakeGetMethodID(JNIEnv*, jclass, const char*, const char*) {
+    static int method;
+    return reinterpret_cast<jmethodID>(&method);
+}
+
+jfieldID FakeGetFieldID(JNIEnv*, jclass, const char*, const char*) {
+    static int field;
+    return reinterpret_cast<jfieldID>(&field);
+}
+
+JNIEnv* GetFakeEnv() {
+    static JNINativeInterface functions = []() {
+        JNINativeInterface f = {};
+        f.FindClass = CountingFindClass;
+        f.NewGlobalRef = FakeNewGlobalRef;
+        f.GetMethodID = FakeGetMethodID;
+        f.GetStaticMethodID = FakeGetMethodID;
+        f.GetFieldID = FakeGetFieldID;
+        f.GetStaticFieldID = FakeGetFieldID;
+        return f;
+    }();
+    static JNIEnv env = { &functions };
+    return &env;
+}
+
+// Releases the threads waiting in Wait() once |count| of them have arrived.
+class Barrier {
+  public:
+    explicit Barrier(int count) : count_(count) {}
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const int generation = generation_;
+        if (++arrived_ == count_) {
+            arrived_ = 0;
+            ++generation_;
+            changed_.notify_all();
+            return;
+        }
+        changed_.wait(lock, [&] { return generation_ != generation; });
+    }
+
+  private:
+    const int count_;
+    int arrived_ = 0;
+    int generation_ = 0;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+};
+
+}  // namespace
+
+class JniConstantsStressTest : public ::testing::Test {
+  protected:
+    void TearDown() override {
+        // Do not leave the fake handles behind for other tests.
+        jniUninitializeConstants();
+    }
+};
+
+// Restarts the cache as tests that restart the runtime do, with every thread making its first
+// access at once after each restart.
+TEST_F(JniConstantsStressTest, FirstUseAfterRestart) {
+    constexpr int kCycles = 200;
+    const int maxThreads = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 4, 16);
+    JNIEnv* env = GetFakeEnv();
+    for (int threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+        SCOPED_TRACE(threadCount);
+        Barrier start(threadCount + 1);
+        Barrier done(threadCount + 1);
+        std::atomic<int> failures{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back([&]() {
+                for (int cycle = 0; cycle < kCycles; ++cycle) {
+                    start.Wait();
+                    if (JniConstants_FileDescriptorClass(env) == nullptr ||
+                        JniConstants_FileDescriptor_init(env) == nullptr ||
+                        JniConstants_NioBuffer_position(env) == nullptr ||
+                        JniConstants_NioBufferClass(env) == nullptr) {
+                        failures.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    done.Wait();
+                }
+            });
+        }
+        int extraInitializations = 0;
+        for (int cycle = 0; cycle < kCycles; ++cycle) {
+            // No accessor runs while uninitializing, as when the runtime has shut down.
+            jniUninitializeConstants();
+            gFindClassCalls.store(0, std::memory_order_relaxed);
+            start.Wait();
+            done.Wait();
+            if (gFindClassCalls.load(std::memory_order_relaxed) != kCachedClassCount) {
+                ++extraInitializations;
+            }
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(0, failures.load());
+        // The cache is initialized exactly once per restart however many threads race.
+        EXPECT_EQ(0, extraInitializations);
+    }
+}
+
+// Hammers the accessors from several threads while the cache is initialized once.
+TEST_F(JniConstantsStressTest, ConcurrentAccessors) {
+    constexpr int kThreads = 8;
+    constexpr int kIterations = 100000;
+    JNIEnv* env = GetFakeEnv();
+    jniUninitializeConstants();
+    gFindClassCalls.store(0, std::memory_order_relaxed);
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < kIterations; ++j) {
+                if (JniConstants_NioBuffer_address(env) == nullptr) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(0, failures.load());
+    EXPECT_EQ(kCachedClassCount, gFindClassCalls.load());
+}
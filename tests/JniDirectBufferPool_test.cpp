@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/JniDirectBufferPool.h"
+
+#include <iterator>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/JNIPlatformHelp.h>
+#include <nativehelper/jni_gtest.h>
+
+#include "libnativehelper_benchmark.h"
+
+namespace android {
+
+class JniDirectBufferPoolTest : public JNITestBase<CountingJNIProvider<BenchmarkMockJNIProvider>> {
+protected:
+    void SetUp() override {
+        JNITestBase::SetUp();
+        pool_ = jniCreateDirectBufferPool(env_, kSizes, std::size(kSizes), kBuffersPerClass);
+        ASSERT_NE(nullptr, pool_);
+    }
+
+    void TearDown() override {
+        jniDestroyDirectBufferPool(env_, pool_);
+        env_->ExceptionClear();
+        JNITestBase::TearDown();
+    }
+
+    static constexpr size_t kSizes[] = {256, 4096};
+    static constexpr size_t kBuffersPerClass = 2;
+    JniDirectBufferPool* pool_ = nullptr;
+};
+
+TEST_F(JniDirectBufferPoolTest, WrapsEachBufferOnce) {
+    EXPECT_EQ(std::size(kSizes) * kBuffersPerClass,
+              provider_.CallCount(JniFunction::NewDirectByteBuffer));
+    provider_.ResetCallCounts();
+
+    for (int i = 0; i < 100; ++i) {
+        void* address = nullptr;
+        jobject buffer = jniAcquireDirectBuffer(env_, pool_, 100, &address);
+        ASSERT_NE(nullptr, buffer);
+        EXPECT_EQ(address, env_->GetDirectBufferAddress(buffer));
+        jniReleaseDirectBuffer(env_, pool_, buffer);
+    }
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::NewDirectByteBuffer));
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::NewGlobalRef));
+}
+
+TEST_F(JniDirectBufferPoolTest, LeasesFromTheSmallestFreeClass) {
+    void* small[kBuffersPerClass];
+    jobject smallBuffers[kBuffersPerClass];
+    for (size_t i = 0; i < kBuffersPerClass; ++i) {
+        smallBuffers[i] = jniAcquireDirectBuffer(env_, pool_, 256, &small[i]);
+        ASSERT_NE(nullptr, smallBuffers[i]);
+    }
+    EXPECT_EQ(static_cast<char*>(small[0]) + 256, small[1]);
+
+    // Once the small buffers are leased, small requests are served from the next class.
+    void* large = nullptr;
+    jobject largeBuffer = jniAcquireDirectBuffer(env_, pool_, 1, &large);
+    ASSERT_NE(nullptr, largeBuffer);
+    EXPECT_NE(small[1], large);
+
+    void* address = nullptr;
+    EXPECT_EQ(nullptr, jniAcquireDirectBuffer(env_, pool_, 4097, &address));
+    EXPECT_FALSE(env_->ExceptionCheck());
+
+    // A returned buffer is leased again.
+    jniReleaseDirectBuffer(env_, pool_, smallBuffers[0]);
+    EXPECT_EQ(smallBuffers[0], jniAcquireDirectBuffer(env_, pool_, 8, &address));
+    EXPECT_EQ(small[0], address);
+}
+
+TEST_F(JniDirectBufferPoolTest, Exhausted) {
+    void* address = nullptr;
+    for (size_t i = 0; i < std::size(kSizes) * kBuffersPerClass; ++i) {
+        EXPECT_NE(nullptr, jniAcquireDirectBuffer(env_, pool_, 1, &address));
+    }
+    EXPECT_EQ(nullptr, jniAcquireDirectBuffer(env_, pool_, 1, &address));
+    EXPECT_FALSE(env_->ExceptionCheck());
+}
+
+TEST_F(JniDirectBufferPoolTest, ClearThrows) {
+    JNINativeInterface* functions = const_cast<JNINativeInterface*>(
+            CountingJNIProvider<BenchmarkMockJNIProvider>::WrappedEnv(env_)->functions);
+    auto callObjectMethodV = functions->CallObjectMethodV;
+    functions->CallObjectMethodV = [](JNIEnv* env, jobject, jmethodID, va_list) -> jobject {
+        jniThrowRuntimeException(env, "clear");
+        return nullptr;
+    };
+    void* address = nullptr;
+    EXPECT_EQ(nullptr, jniAcquireDirectBuffer(env_, pool_, 1, &address));
+    EXPECT_TRUE(env_->ExceptionCheck());
+    env_->ExceptionClear();
+    functions->CallObjectMethodV = callObjectMethodV;
+
+    // The buffer went back to the pool.
+    for (size_t i = 0; i < std::size(kSizes) * kBuffersPerClass; ++i) {
+        EXPECT_NE(nullptr, jniAcquireDirectBuffer(env_, pool_, 1, &address));
+    }
+}
+
+TEST_F(JniDirectBufferPoolTest, InvalidSizeClasses) {
+    const size_t decreasing[] = {4096, 256};
+    EXPECT_EQ(nullptr, jniCreateDirectBufferPool(env_, decreasing, 2, 1));
+    EXPECT_TRUE(env_->ExceptionCheck());
+}
+
+TEST_F(JniDirectBufferPoolTest, ReleasingTwiceAborts) {
+    void* address = nullptr;
+    jobject buffer = jniAcquireDirectBuffer(env_, pool_, 1, &address);
+    jniReleaseDirectBuffer(env_, pool_, buffer);
+    EXPECT_DEATH(jniReleaseDirectBuffer(env_, pool_, buffer), "released twice");
+}
+
+}  // namespace android
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <nativehelper/JNIPlatformHelp.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/jni_gtest.h>
+
+#include "libnativehelper_benchmark.h"
+
+namespace android {
+
+namespace {
+
+// The logger thread attaches to this VM, which hands it the env of the test once the test
+// allows it, so that the queue can be filled while nothing is taken from it.
+JNIEnv* gLoggerEnv;
+std::mutex gAttachLock;
+std::condition_variable gAttachAllowedChanged;
+bool gAttachAllowed;
+std::atomic<int> gAttachedThreads;
+
+void AllowAttach(bool allowed = true) {
+    std::lock_guard<std::mutex> lock(gAttachLock);
+    gAttachAllowed = allowed;
+    gAttachAllowedChanged.notify_all();
+}
+
+jint AttachCurrentThreadAsDaemon(JavaVM*, JNIEnv** env, void*) {
+    std::unique_lock<std::mutex> lock(gAttachLock);
+    gAttachAllowedChanged.wait(lock, [] { return gAttachAllowed; });
+    *env = gLoggerEnv;
+    ++gAttachedThreads;
+    return JNI_OK;
+}
+
+jint DetachCurrentThread(JavaVM*) {
+    --gAttachedThreads;
+    return JNI_OK;
+}
+
+JNIInvokeInterface MakeLoggerInvokeInterface() {
+    JNIInvokeInterface functions = {};
+    functions.AttachCurrentThreadAsDaemon = AttachCurrentThreadAsDaemon;
+    functions.DetachCurrentThread = DetachCurrentThread;
+    return functions;
+}
+
+const JNIInvokeInterface gLoggerInvokeInterface = MakeLoggerInvokeInterface();
+JavaVM gLoggerVm = {&gLoggerInvokeInterface};
+
+jint GetLoggerJavaVM(JNIEnv*, JavaVM** vm) {
+    *vm = &gLoggerVm;
+    return JNI_OK;
+}
+
+jint FailAttachCurrentThreadAsDaemon(JavaVM*, JNIEnv**, void*) {
+    return JNI_ERR;
+}
+
+JNIInvokeInterface MakeFailingInvokeInterface() {
+    JNIInvokeInterface functions = {};
+    functions.AttachCurrentThreadAsDaemon = FailAttachCurrentThreadAsDaemon;
+    return functions;
+}
+
+const JNIInvokeInterface gFailingInvokeInterface = MakeFailingInvokeInterface();
+JavaVM gFailingVm = {&gFailingInvokeInterface};
+
+jint GetFailingJavaVM(JNIEnv*, JavaVM** vm) {
+    *vm = &gFailingVm;
+    return JNI_OK;
+}
+
+}  // namespace
+
+class JniExceptionLoggerTest : public JNITestBase<CountingJNIProvider<BenchmarkMockJNIProvider>> {
+protected:
+    void SetUp() override {
+        JNITestBase::SetUp();
+        JNINativeInterface* functions = const_cast<JNINativeInterface*>(
+                CountingJNIProvider<BenchmarkMockJNIProvider>::WrappedEnv(env_)->functions);
+        functions->GetJavaVM = GetLoggerJavaVM;
+        gLoggerEnv = env_;
+        AllowAttach(false);
+    }
+
+    void TearDown() override {
+        // Abandons the logger thread, which uses env_.
+        jniUninitializeConstants();
+        JNITestBase::TearDown();
+    }
+};
+
+// Death tests run first, and in a child process, so the logger thread is started afresh there.
+using JniExceptionLoggerDeathTest = JniExceptionLoggerTest;
+
+TEST_F(JniExceptionLoggerDeathTest, FallsBackToSynchronousLogging) {
+    JNINativeInterface* functions = const_cast<JNINativeInterface*>(
+            CountingJNIProvider<BenchmarkMockJNIProvider>::WrappedEnv(env_)->functions);
+    functions->GetJavaVM = GetFailingJavaVM;
+    EXPECT_EXIT(
+            {
+                for (int i = 0; i < 10; ++i) {
+                    jthrowable thrown =
+                            static_cast<jthrowable>(env_->NewGlobalRef(env_->NewStringUTF("e")));
+                    jniLogExceptionAsync(env_, 6, nullptr, thrown);
+                    jniFlushAsyncExceptionLog();
+                }
+                // The flush returns once the logger thread has failed, so at most the first
+                // exception is queued, and it is logged by the synchronous call that follows.
+                JniAsyncExceptionLogStats stats;
+                jniGetAsyncExceptionLogStats(&stats);
+                exit(stats.queued <= 1 && stats.logged == stats.queued ? 0 : 1);
+            },
+            ::testing::ExitedWithCode(0), "");
+}
+
+TEST_F(JniExceptionLoggerTest, QueuesDropsAndFlushes) {
+    constexpr size_t kQueueSize = 256;
+    constexpr size_t kExceptions = kQueueSize + 44;
+    for (size_t i = 0; i < kExceptions; ++i) {
+        jthrowable thrown = static_cast<jthrowable>(env_->NewGlobalRef(env_->NewStringUTF("e")));
+        jniLogExceptionAsync(env_, 6, "tag", thrown);
+        EXPECT_FALSE(env_->ExceptionCheck());
+    }
+
+    JniAsyncExceptionLogStats stats;
+    jniGetAsyncExceptionLogStats(&stats);
+    EXPECT_EQ(kQueueSize, stats.queued);
+    EXPECT_EQ(0u, stats.logged);
+    EXPECT_EQ(kExceptions - kQueueSize, stats.dropped);
+    // The caller only takes references, rendering happens on the logger thread.
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::CallObjectMethod));
+
+    AllowAttach();
+    jniFlushAsyncExceptionLog();
+    jniGetAsyncExceptionLogStats(&stats);
+    EXPECT_EQ(kQueueSize, stats.logged);
+    EXPECT_EQ(kQueueSize, provider_.CallCount(JniFunction::DeleteGlobalRef) -
+                                  (kExceptions - kQueueSize));
+}
+
+TEST_F(JniExceptionLoggerTest, RestartsAfterUninitialize) {
+    AllowAttach();
+    const int attachedThreads = gAttachedThreads.load();
+    for (int runtime = 0; runtime < 2; ++runtime) {
+        jthrowable thrown = static_cast<jthrowable>(env_->NewGlobalRef(env_->NewStringUTF("e")));
+        jniLogExceptionAsync(env_, 6, "tag", thrown);
+        jniFlushAsyncExceptionLog();
+        JniAsyncExceptionLogStats stats;
+        jniGetAsyncExceptionLogStats(&stats);
+        EXPECT_EQ(stats.queued, stats.logged);
+        EXPECT_EQ(attachedThreads + runtime + 1, gAttachedThreads.load());
+
+        // The runtime shuts down, and the logger thread is left parked without detaching.
+        jniUninitializeConstants();
+        EXPECT_EQ(attachedThreads + runtime + 1, gAttachedThreads.load());
+    }
+}
+
+TEST_F(JniExceptionLoggerTest, UninitializeDoesNotUseTheRuntime) {
+    JniAsyncExceptionLogStats before;
+    jniGetAsyncExceptionLogStats(&before);
+    for (int i = 0; i < 3; ++i) {
+        jthrowable thrown = static_cast<jthrowable>(env_->NewGlobalRef(env_->NewStringUTF("e")));
+        jniLogExceptionAsync(env_, 6, "tag", thrown);
+    }
+    const int attachedThreads = gAttachedThreads.load();
+    provider_.ResetCallCounts();
+
+    // The logger thread is still attaching when the runtime shuts down.
+    jniUninitializeConstants();
+    JniAsyncExceptionLogStats after;
+    jniGetAsyncExceptionLogStats(&after);
+    EXPECT_EQ(before.queued, after.queued);
+    EXPECT_EQ(before.logged, after.logged);
+    EXPECT_EQ(before.dropped + 3, after.dropped);
+
+    // Once attached, the thread finds itself abandoned and neither logs the exceptions nor
+    // deletes their references.
+    AllowAttach();
+    while (gAttachedThreads.load() == attachedThreads) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    jniGetAsyncExceptionLogStats(&after);
+    EXPECT_EQ(before.logged, after.logged);
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::DeleteGlobalRef));
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::CallObjectMethod));
+}
+
+}  // namespace android
@@ -16,6 +16,15 @@
 
 #include "../JniInvocation-priv.h"
 
+#include "nativehelper/JniInvocation.h"
+#include "nativehelper/JniTracing.h"
+
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
 #include <gtest/gtest.h>
 #include <jni.h>
 
@@ -69,3 +78,92 @@ TEST(JNIInvocation, GetCreatedJavaVMsBeforeInit) {
     EXPECT_EQ(status, JNI_OK);
     EXPECT_EQ(vm_count, 0);
 }
+
+TEST(JNIInvocation, GetInitTimingsBeforeInit) {
+    JniInvocationInitTimings timings;
+    EXPECT_FALSE(JniInvocationGetInitTimings(nullptr, &timings));
+    EXPECT_FALSE(JniInvocationGetInitTimings(JniInvocationCreate(), &timings));
+}
+
+// Tests that load libnativehelper_mock_runtime.so, which is installed next to the test, as the
+// runtime. Only debuggable devices let the runtime library be chosen.
+class JNIInvocationMockRuntime : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        char exe[PATH_MAX];
+        ssize_t length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        ASSERT_GT(length, 0);
+        library_.assign(exe, length);
+        library_.replace(library_.rfind('/') + 1, std::string::npos,
+                         "libnativehelper_mock_runtime.so");
+        if (strcmp(JniInvocationGetLibrary(library_.c_str(), nullptr), library_.c_str()) != 0) {
+            GTEST_SKIP() << "The runtime library cannot be overridden";
+        }
+        impl_ = JniInvocationCreate();
+        ASSERT_NE(nullptr, impl_);
+    }
+
+    void TearDown() override {
+        if (impl_ != nullptr) {
+            JniInvocationDestroy(impl_);
+        }
+    }
+
+    static uint64_t Calls(const char* function) {
+        JniTracingStats stats = {};
+        EXPECT_TRUE(jniGetTracingStats(function, &stats));
+        return stats.calls;
+    }
+
+    std::string library_;
+    JniInvocationImpl* impl_ = nullptr;
+};
+
+TEST_F(JNIInvocationMockRuntime, InitWithTraceJni) {
+    ASSERT_TRUE(JniInvocationInitWithFlags(impl_, library_.c_str(),
+                                           JNI_INVOCATION_INIT_TRACE_JNI));
+    JavaVM* vm = nullptr;
+    JNIEnv* env = nullptr;
+    ASSERT_EQ(JNI_OK, JNI_CreateJavaVM(&vm, &env, nullptr));
+
+    jniResetTracingStats();
+    EXPECT_EQ(JNI_VERSION_1_6, env->GetVersion());
+    EXPECT_EQ(1u, Calls("GetVersion"));
+
+    // Envs from the JavaVM are traced too.
+    JNIEnv* attached = nullptr;
+    ASSERT_EQ(JNI_OK, vm->AttachCurrentThread(&attached, nullptr));
+    EXPECT_EQ(env->functions, attached->functions);
+    attached->GetVersion();
+    EXPECT_EQ(2u, Calls("GetVersion"));
+    ASSERT_EQ(JNI_OK, vm->DetachCurrentThread());
+
+    jniUntraceJniEnv(env);
+}
+
+TEST_F(JNIInvocationMockRuntime, InitWithoutTraceJni) {
+    ASSERT_TRUE(JniInvocationInit(impl_, library_.c_str()));
+    JavaVM* vm = nullptr;
+    JNIEnv* env = nullptr;
+    ASSERT_EQ(JNI_OK, JNI_CreateJavaVM(&vm, &env, nullptr));
+
+    jniResetTracingStats();
+    EXPECT_EQ(JNI_VERSION_1_6, env->GetVersion());
+    EXPECT_EQ(0u, Calls("GetVersion"));
+}
+
+TEST_F(JNIInvocationMockRuntime, InitUsesPreloadedLibrary) {
+    // A library that is not loaded is not preloaded with JNI_INVOCATION_PRELOAD_NO_LOAD, which
+    // does not stop a later preload.
+    EXPECT_FALSE(JniInvocationPreload("libnativehelper_not_a_library.so",
+                                      JNI_INVOCATION_PRELOAD_NO_LOAD));
+    ASSERT_TRUE(JniInvocationPreload(library_.c_str(), 0));
+    // Only one preload is started.
+    EXPECT_FALSE(JniInvocationPreload(library_.c_str(), 0));
+
+    ASSERT_TRUE(JniInvocationInit(impl_, library_.c_str()));
+    JniInvocationInitTimings timings;
+    ASSERT_TRUE(JniInvocationGetInitTimings(impl_, &timings));
+    EXPECT_TRUE(timings.preloaded);
+    EXPECT_FALSE(timings.fallback_taken);
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "libnativehelper_benchmark.h"
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/JNIPlatformHelp.h>
+#include <nativehelper/JniProfiling.h>
+#include <nativehelper/jni_gtest.h>
+
+namespace android {
+
+class JniProfilingTest : public JNITestBase<BenchmarkMockJNIProvider> {
+protected:
+    void SetUp() override {
+        JNITestBase::SetUp();
+        struct JniProfilingStats stats;
+        if (!jniGetProfilingStats(kJniProfiling_jniGetNioBufferPointer, &stats)) {
+#if defined(LIBNATIVEHELPER_PROFILING)
+            FAIL() << "libnativehelper_profiling_tests must link libnativehelper_profiling";
+#else
+            GTEST_SKIP() << "libnativehelper was built without LIBNATIVEHELPER_PROFILING";
+#endif
+        }
+        jniResetProfilingStats();
+    }
+};
+
+TEST(JniProfiling, RejectsInvalidEntryPoint) {
+    struct JniProfilingStats stats;
+    EXPECT_FALSE(jniGetProfilingStats(kJniProfiling_EntryPointCount, &stats));
+}
+
+TEST_F(JniProfilingTest, CountsCallsOnAllThreads) {
+    static char storage[16];
+    jobject buffer = env_->NewGlobalRef(env_->NewDirectByteBuffer(storage, sizeof(storage)));
+    // Resolve the cached fields before other threads use the env.
+    EXPECT_EQ(reinterpret_cast<jlong>(storage), jniGetNioBufferPointer(env_, buffer));
+
+    std::thread thread([this, buffer]() {
+        for (int i = 0; i < 10; ++i) {
+            jniGetNioBufferPointer(env_, buffer);
+        }
+    });
+    thread.join();
+
+    struct JniProfilingStats stats;
+    ASSERT_TRUE(jniGetProfilingStats(kJniProfiling_jniGetNioBufferPointer, &stats));
+    EXPECT_EQ(11u, stats.calls);
+    uint64_t histogramCalls = 0;
+    for (uint64_t bucket : stats.histogram) {
+        histogramCalls += bucket;
+    }
+    EXPECT_EQ(stats.calls, histogramCalls);
+
+    ASSERT_TRUE(jniGetProfilingStats(kJniProfiling_jniGetNioBufferInfo, &stats));
+    EXPECT_EQ(0u, stats.calls);
+}
+
+TEST_F(JniProfilingTest, Reset) {
+    static char storage[16];
+    jobject buffer = env_->NewGlobalRef(env_->NewDirectByteBuffer(storage, sizeof(storage)));
+    struct JniNioBufferInfo info;
+    jniGetNioBufferInfo(env_, buffer, &info);
+
+    struct JniProfilingStats stats;
+    ASSERT_TRUE(jniGetProfilingStats(kJniProfiling_jniGetNioBufferInfo, &stats));
+    EXPECT_EQ(1u, stats.calls);
+
+    jniResetProfilingStats();
+    ASSERT_TRUE(jniGetProfilingStats(kJniProfiling_jniGetNioBufferInfo, &stats));
+    EXPECT_EQ(0u, stats.calls);
+    EXPECT_EQ(0u, stats.total_ns);
+}
+
+TEST_F(JniProfilingTest, ResetWhileCalling) {
+    static char storage[16];
+    jobject buffer = env_->NewGlobalRef(env_->NewDirectByteBuffer(storage, sizeof(storage)));
+    jniGetNioBufferPointer(env_, buffer);
+
+    // The calls made before a reset must not come back, whatever the calling thread was doing
+    // when it happened.
+    std::atomic<uint64_t> calls(0);
+    std::atomic<bool> stop(false);
+    std::thread thread([&]() {
+        while (!stop.load()) {
+            jniGetNioBufferPointer(env_, buffer);
+            ++calls;
+        }
+    });
+    for (int i = 0; i < 100; ++i) {
+        const uint64_t callsBeforeReset = calls.load();
+        jniResetProfilingStats();
+        std::this_thread::yield();
+        // One call may have ended during the reset and been counted after it.
+        const uint64_t callsSinceReset = calls.load() - callsBeforeReset + 1;
+        struct JniProfilingStats stats;
+        ASSERT_TRUE(jniGetProfilingStats(kJniProfiling_jniGetNioBufferPointer, &stats));
+        EXPECT_LE(stats.calls, callsSinceReset) << i;
+    }
+    stop = true;
+    thread.join();
+}
+
+}  // namespace android
@@ -20,6 +20,8 @@
 #include <gtest/gtest.h>
 #pragma clang diagnostic pop
 #include <sstream>
+#include <string>
+#include <vector>
 
 #define PARSE_FAILURES_NONFATAL  // return empty optionals wherever possible instead of asserting.
 #include "nativehelper/jni_macros.h"
@@ -1279,3 +1281,96 @@ TEST(JniSafeRegisterNativeMethods, JniMacros) {
   tmp_native_method =
       _NATIVEHELPER_JNI_MAKE_METHOD_OLD(kNormalNative, "v_eolib", "(JIZ)V", TestJniMacros_v_eolib);
 }
+
+TEST(JniSafeRegisterNativeMethods, MethodInfo) {
+  const nativehelper::JniNativeMethodInfo infos[] = {
+    MAKE_JNI_CRITICAL_NATIVE_METHOD_INFO_AUTOSIG("nativeDataSize", android_os_Parcel_dataSize),
+    MAKE_JNI_FAST_NATIVE_METHOD_INFO_AUTOSIG("nativeReadString", android_os_Parcel_readString),
+    MAKE_JNI_NATIVE_METHOD_INFO("nativeWriteStrongBinder",
+                                "(JLandroid/os/IBinder;)V",
+                                android_os_Parcel_writeStrongBinder),
+    MAKE_JNI_NATIVE_METHOD_INFO_AUTOSIG("v_eolib", TestJniMacros_v_eolib),
+  };
+
+  EXPECT_STREQ("nativeDataSize", infos[0].method.name);
+  EXPECT_STREQ("(J)I", infos[0].method.signature);
+  EXPECT_STREQ("IJ", infos[0].shorty);
+  EXPECT_EQ(1u, infos[0].argument_count);
+  EXPECT_EQ(nativehelper::detail::kCriticalNative, infos[0].native_kind);
+
+  EXPECT_STREQ("(J)Ljava/lang/String;", infos[1].method.signature);
+  EXPECT_STREQ("LJ", infos[1].shorty);
+  EXPECT_EQ(1u, infos[1].argument_count);
+  EXPECT_EQ(nativehelper::detail::kFastNative, infos[1].native_kind);
+
+  EXPECT_STREQ("(JLandroid/os/IBinder;)V", infos[2].method.signature);
+  EXPECT_STREQ("VJL", infos[2].shorty);
+  EXPECT_EQ(2u, infos[2].argument_count);
+  EXPECT_EQ(reinterpret_cast<void*>(&android_os_Parcel_writeStrongBinder), infos[2].method.fnPtr);
+
+  EXPECT_STREQ("VJIZ", infos[3].shorty);
+  EXPECT_EQ(3u, infos[3].argument_count);
+  EXPECT_EQ(nativehelper::detail::kNormalNative, infos[3].native_kind);
+}
+
+namespace {
+
+jint gRegisteredCount;
+
+jint FakeRegisterNatives(JNIEnv*, jclass, const JNINativeMethod* methods, jint count) {
+  gRegisteredCount = count;
+  // The table is copied onto the caller's stack, so check the contents here.
+  for (jint i = 0; i < count; ++i) {
+    EXPECT_NE(nullptr, methods[i].name);
+    EXPECT_NE(nullptr, methods[i].signature);
+    EXPECT_NE(nullptr, methods[i].fnPtr);
+  }
+  return JNI_OK;
+}
+
+}  // namespace
+
+TEST(JniSafeRegisterNativeMethods, RegisterNativeMethodTable) {
+  const nativehelper::JniNativeMethodInfo infos[] = {
+    MAKE_JNI_CRITICAL_NATIVE_METHOD_INFO_AUTOSIG("nativeDataSize", android_os_Parcel_dataSize),
+    MAKE_JNI_NATIVE_METHOD_INFO_AUTOSIG("v_eolib", TestJniMacros_v_eolib),
+  };
+
+  JNINativeInterface functions = {};
+  functions.RegisterNatives = FakeRegisterNatives;
+  JNIEnv env = { &functions };
+  int clazz;
+
+  gRegisteredCount = 0;
+  EXPECT_EQ(JNI_OK,
+            nativehelper::RegisterNativeMethodTable(&env, reinterpret_cast<jclass>(&clazz), infos));
+  EXPECT_EQ(2, gRegisteredCount);
+}
+
+TEST(JniSafeRegisterNativeMethods, CriticalNativeCandidate) {
+  using nativehelper::IsCriticalNativeCandidate;
+
+  // Static natives on primitives only.
+  static_assert(IsCriticalNativeCandidate<jint(JNIEnv*, jclass, jlong)>(), "");
+  static_assert(IsCriticalNativeCandidate<void(JNIEnv*, jclass)>(), "");
+  static_assert(IsCriticalNativeCandidate<decltype(android_os_Parcel_writeInt)>(), "");
+  // Instance natives, reference parameters or return types, and functions already
+  // written for @CriticalNative do not qualify.
+  static_assert(!IsCriticalNativeCandidate<decltype(TestJniMacros_v_eolib)>(), "");
+  static_assert(!IsCriticalNativeCandidate<decltype(android_os_Parcel_writeString)>(), "");
+  static_assert(!IsCriticalNativeCandidate<decltype(android_os_Parcel_readString)>(), "");
+  static_assert(!IsCriticalNativeCandidate<decltype(android_os_Parcel_dataSize)>(), "");
+
+  const nativehelper::JniNativeMethodInfo infos[] = {
+    MAKE_JNI_NATIVE_METHOD_INFO_AUTOSIG("nativeWriteInt", android_os_Parcel_writeInt),
+    MAKE_JNI_FAST_NATIVE_METHOD_INFO_AUTOSIG("nativeReadString", android_os_Parcel_readString),
+    MAKE_JNI_CRITICAL_NATIVE_METHOD_INFO_AUTOSIG("nativeDataSize", android_os_Parcel_dataSize),
+  };
+  std::vector<std::string> candidates;
+  nativehelper::ForEachCriticalNativeCandidate(
+      infos, [&](const nativehelper::JniNativeMethodInfo& info) {
+        candidates.push_back(info.method.name);
+      });
+  ASSERT_EQ(1u, candidates.size());
+  EXPECT_EQ("nativeWriteInt", candidates[0]);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/JniTracing.h"
+
+#include <cstdarg>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/jni_gtest.h>
+
+#include "libnativehelper_benchmark.h"
+
+namespace android {
+
+namespace {
+
+jint SumVarargs(JNIEnv*, jclass, jmethodID, va_list args) {
+    jint first = va_arg(args, jint);
+    jint second = va_arg(args, jint);
+    return first + second;
+}
+
+}  // namespace
+
+class JniTracingTest : public JNITestBase<BenchmarkMockJNIProvider> {
+protected:
+    void SetUp() override {
+        JNITestBase::SetUp();
+        original_ = env_->functions;
+        const_cast<JNINativeInterface*>(original_)->CallStaticIntMethodV = SumVarargs;
+        ASSERT_TRUE(jniTraceJniEnv(env_));
+        jniResetTracingStats();
+    }
+
+    void TearDown() override {
+        jniUntraceJniEnv(env_);
+        EXPECT_EQ(original_, env_->functions);
+        JNITestBase::TearDown();
+    }
+
+    static JniTracingStats Stats(const char* function) {
+        JniTracingStats stats = {};
+        EXPECT_TRUE(jniGetTracingStats(function, &stats));
+        return stats;
+    }
+
+    const JNINativeInterface* original_ = nullptr;
+};
+
+TEST_F(JniTracingTest, CountsCallsPerFunction) {
+    EXPECT_NE(original_, env_->functions);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_NE(nullptr, env_->FindClass("java/lang/String"));
+    }
+    EXPECT_FALSE(env_->ExceptionCheck());
+    EXPECT_EQ(3u, Stats("FindClass").calls);
+    EXPECT_EQ(1u, Stats("ExceptionCheck").calls);
+    EXPECT_EQ(0u, Stats("GetVersion").calls);
+
+    jniResetTracingStats();
+    EXPECT_EQ(0u, Stats("FindClass").calls);
+}
+
+TEST_F(JniTracingTest, ForwardsVarargs) {
+    // The C++ JNIEnv methods call the va_list variants, C callers use the variadic functions.
+    EXPECT_EQ(5, env_->functions->CallStaticIntMethod(env_, nullptr, nullptr, 2, 3));
+    EXPECT_EQ(1u, Stats("CallStaticIntMethod").calls);
+    // The variadic function forwards to the va_list variant of the original table, which is
+    // not counted again.
+    EXPECT_EQ(0u, Stats("CallStaticIntMethodV").calls);
+    EXPECT_EQ(7, env_->CallStaticIntMethod(nullptr, nullptr, 3, 4));
+    EXPECT_EQ(1u, Stats("CallStaticIntMethodV").calls);
+}
+
+TEST_F(JniTracingTest, SamplesLatency) {
+    constexpr uint64_t kSamples = 64;
+    constexpr uint64_t kCalls = kSamples * JNI_TRACING_SAMPLE_PERIOD;
+    for (uint64_t i = 0; i < kCalls; ++i) {
+        env_->ExceptionCheck();
+    }
+    JniTracingStats stats = Stats("ExceptionCheck");
+    EXPECT_EQ(kCalls, stats.calls);
+    // The gaps between samples are random.
+    EXPECT_GE(stats.sampled_calls, kSamples / 2);
+    EXPECT_LE(stats.sampled_calls, kSamples * 2);
+}
+
+TEST_F(JniTracingTest, TracesOneFunctionTable) {
+    // Tracing twice is harmless.
+    EXPECT_TRUE(jniTraceJniEnv(env_));
+
+    // Every mock env has its own table, which cannot be traced alongside the first one.
+    JNIEnv* other = provider_.CreateJNIEnv();
+    EXPECT_FALSE(jniTraceJniEnv(other));
+
+    // Once no env is traced, another table can be.
+    jniUntraceJniEnv(env_);
+    EXPECT_TRUE(jniTraceJniEnv(other));
+    jniUntraceJniEnv(other);
+    provider_.DestroyJNIEnv(other);
+    EXPECT_TRUE(jniTraceJniEnv(env_));
+}
+
+TEST_F(JniTracingTest, UnknownFunction) {
+    JniTracingStats stats;
+    EXPECT_FALSE(jniGetTracingStats("NotAJniFunction", &stats));
+}
+
+}  // namespace android
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../JniTracing-priv.h"
+
+#include "nativehelper/JniTracing.h"
+
+#include <gtest/gtest.h>
+
+#include "mock_java_vm.h"
+
+namespace android {
+
+class JniTracingVmTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        JniTracing_InstallOnJavaVM(vm_.vm(), vm_.env());
+        jniResetTracingStats();
+    }
+
+    void TearDown() override {
+        jniUntraceJniEnv(vm_.env());
+        EXPECT_EQ(vm_.nativeInterface(), vm_.env()->functions);
+    }
+
+    bool IsTraced(JNIEnv* env) const { return env->functions != vm_.nativeInterface(); }
+
+    static uint64_t Calls(const char* function) {
+        JniTracingStats stats = {};
+        EXPECT_TRUE(jniGetTracingStats(function, &stats));
+        return stats.calls;
+    }
+
+    MockJavaVM vm_;
+};
+
+TEST_F(JniTracingVmTest, TracesInitialEnv) {
+    EXPECT_NE(vm_.invokeInterface(), vm_.vm()->functions);
+    EXPECT_TRUE(IsTraced(vm_.env()));
+    EXPECT_EQ(JNI_VERSION_1_6, vm_.env()->GetVersion());
+    EXPECT_EQ(1u, Calls("GetVersion"));
+
+    // Installing again is harmless.
+    JniTracing_InstallOnJavaVM(vm_.vm(), vm_.env());
+    EXPECT_EQ(JNI_VERSION_1_6, vm_.env()->GetVersion());
+    EXPECT_EQ(2u, Calls("GetVersion"));
+}
+
+TEST_F(JniTracingVmTest, TracesGetEnv) {
+    jniUntraceJniEnv(vm_.env());
+    ASSERT_FALSE(IsTraced(vm_.env()));
+
+    JNIEnv* env = nullptr;
+    ASSERT_EQ(JNI_OK, vm_.vm()->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6));
+    EXPECT_EQ(vm_.env(), env);
+    EXPECT_TRUE(IsTraced(env));
+    env->GetVersion();
+    EXPECT_EQ(1u, Calls("GetVersion"));
+}
+
+TEST_F(JniTracingVmTest, IgnoresAgentEnvs) {
+    jniUntraceJniEnv(vm_.env());
+
+    // 0x30010000 is JVMTI_VERSION_1, whose environment is not a JNIEnv.
+    void* agent = nullptr;
+    ASSERT_EQ(JNI_OK, vm_.vm()->GetEnv(&agent, 0x30010000));
+    EXPECT_EQ(vm_.agent(), agent);
+    EXPECT_EQ(0, *static_cast<int*>(agent));
+    EXPECT_FALSE(IsTraced(vm_.env()));
+}
+
+TEST_F(JniTracingVmTest, TracesAttachCurrentThread) {
+    jniUntraceJniEnv(vm_.env());
+
+    JNIEnv* env = nullptr;
+    ASSERT_EQ(JNI_OK, vm_.vm()->AttachCurrentThread(&env, nullptr));
+    EXPECT_EQ(1, vm_.attached());
+    EXPECT_TRUE(IsTraced(env));
+    ASSERT_EQ(JNI_OK, vm_.vm()->DetachCurrentThread());
+    EXPECT_EQ(0, vm_.attached());
+}
+
+TEST_F(JniTracingVmTest, TracesAttachCurrentThreadAsDaemon) {
+    jniUntraceJniEnv(vm_.env());
+
+    JNIEnv* env = nullptr;
+    ASSERT_EQ(JNI_OK, vm_.vm()->AttachCurrentThreadAsDaemon(&env, nullptr));
+    EXPECT_TRUE(IsTraced(env));
+    env->GetVersion();
+    EXPECT_EQ(1u, Calls("GetVersion"));
+    ASSERT_EQ(JNI_OK, vm_.vm()->DetachCurrentThread());
+}
+
+}  // namespace android
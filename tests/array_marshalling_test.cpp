@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/array_marshalling.h"
+
+#include <string.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/jni_gtest.h>
+
+#include "libnativehelper_benchmark.h"
+
+using nativehelper::floatToHalf;
+using nativehelper::halfToFloat;
+
+TEST(ArrayMarshalling, ConvertElements) {
+    const jint ints[] = {0, -1, INT32_MAX, INT32_MIN};
+    int64_t wide[4];
+    nativehelper::convertElements(ints, 4, wide);
+    EXPECT_EQ(-1, wide[1]);
+    EXPECT_EQ(INT32_MIN, wide[3]);
+
+    const jlong longs[] = {INT64_C(0x100000002), -2};
+    int32_t narrow[2];
+    nativehelper::convertElements(longs, 2, narrow);
+    EXPECT_EQ(2, narrow[0]);
+    EXPECT_EQ(-2, narrow[1]);
+}
+
+TEST(ArrayMarshalling, ReverseByteOrder) {
+    const uint8_t bytes[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+    uint32_t words[2];
+    // Deliberately misaligned.
+    nativehelper::reverseByteOrder(bytes + 1, 2, words);
+    EXPECT_EQ(0x02030405u, words[0]);
+    EXPECT_EQ(0x06070809u, words[1]);
+
+    const uint8_t one[] = {0x3f, 0xf0, 0, 0, 0, 0, 0, 0};
+    double value;
+    nativehelper::reverseByteOrder(one, 1, &value);
+    EXPECT_EQ(1.0, value);
+}
+
+// The kernels handle whole vectors explicitly and the rest one element at a time, so these
+// convert enough elements for both and compare them with the scalar conversion.
+TEST(ArrayMarshalling, ConvertElementsVectorized) {
+    std::vector<jint> ints(37);
+    for (size_t i = 0; i < ints.size(); ++i) {
+        ints[i] = static_cast<jint>(i * 0x9e3779b9u);
+    }
+    std::vector<int64_t> wide(ints.size());
+    nativehelper::convertElements(ints.data(), ints.size(), wide.data());
+    for (size_t i = 0; i < ints.size(); ++i) {
+        EXPECT_EQ(static_cast<int64_t>(ints[i]), wide[i]) << i;
+    }
+}
+
+template <typename T>
+void CheckReverseByteOrder() {
+    constexpr size_t kCount = 37;
+    std::vector<uint8_t> bytes(kCount * sizeof(T) + 1);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(i * 13 + 1);
+    }
+    std::vector<T> values(kCount);
+    // Deliberately misaligned.
+    nativehelper::reverseByteOrder(bytes.data() + 1, kCount, values.data());
+    for (size_t i = 0; i < kCount; ++i) {
+        uint8_t expected[sizeof(T)];
+        for (size_t b = 0; b < sizeof(T); ++b) {
+            expected[b] = bytes[1 + i * sizeof(T) + sizeof(T) - 1 - b];
+        }
+        EXPECT_EQ(0, memcmp(expected, &values[i], sizeof(T))) << i;
+    }
+}
+
+TEST(ArrayMarshalling, ReverseByteOrderVectorized) {
+    CheckReverseByteOrder<uint16_t>();
+    CheckReverseByteOrder<int32_t>();
+    CheckReverseByteOrder<float>();
+    CheckReverseByteOrder<int64_t>();
+}
+
+TEST(ArrayMarshalling, FloatsToHalvesMatchesFloatToHalf) {
+    // Every exponent with a spread of mantissas, both signs, and the NaNs and infinities.
+    std::vector<jfloat> floats;
+    for (uint64_t bits = 0; bits <= UINT32_MAX; bits += 0x1003) {
+        const uint32_t value = static_cast<uint32_t>(bits);
+        jfloat f;
+        memcpy(&f, &value, sizeof(f));
+        floats.push_back(f);
+    }
+    floats.push_back(std::numeric_limits<float>::infinity());
+    floats.push_back(-std::numeric_limits<float>::quiet_NaN());
+    floats.push_back(std::ldexp(3.0f, -25));
+    floats.push_back(65520.0f);
+    std::vector<uint16_t> halves(floats.size());
+    nativehelper::floatsToHalves(floats.data(), floats.size(), halves.data());
+    for (size_t i = 0; i < floats.size(); ++i) {
+        ASSERT_EQ(floatToHalf(floats[i]), halves[i]) << floats[i];
+    }
+}
+
+TEST(ArrayMarshalling, FloatToHalf) {
+    EXPECT_EQ(0x0000, floatToHalf(0.0f));
+    EXPECT_EQ(0x8000, floatToHalf(-0.0f));
+    EXPECT_EQ(0x3c00, floatToHalf(1.0f));
+    EXPECT_EQ(0xc000, floatToHalf(-2.0f));
+    EXPECT_EQ(0x7bff, floatToHalf(65504.0f));
+    // Halfway between the largest half and the next power of two rounds up to infinity.
+    EXPECT_EQ(0x7c00, floatToHalf(65520.0f));
+    EXPECT_EQ(0x7c00, floatToHalf(std::numeric_limits<float>::infinity()));
+    EXPECT_EQ(0xfc00, floatToHalf(-std::numeric_limits<float>::infinity()));
+    EXPECT_EQ(0x7e00, floatToHalf(std::numeric_limits<float>::quiet_NaN()));
+    // Subnormals, with ties rounding to even.
+    EXPECT_EQ(0x0001, floatToHalf(std::ldexp(1.0f, -24)));
+    EXPECT_EQ(0x0000, floatToHalf(std::ldexp(1.0f, -25)));
+    EXPECT_EQ(0x0002, floatToHalf(std::ldexp(3.0f, -25)));
+    EXPECT_EQ(0x0400, floatToHalf(std::ldexp(1.0f, -14)));
+    // 1 + 2^-11 is halfway between 1 and the next half, and rounds to even.
+    EXPECT_EQ(0x3c00, floatToHalf(1.0f + std::ldexp(1.0f, -11)));
+    EXPECT_EQ(0x3c02, floatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)));
+}
+
+TEST(ArrayMarshalling, HalfRoundTrip) {
+    for (uint32_t half = 0; half <= 0xffff; ++half) {
+        const float value = halfToFloat(static_cast<uint16_t>(half));
+        if ((half & 0x7c00) == 0x7c00 && (half & 0x03ff) != 0) {
+            EXPECT_TRUE(std::isnan(value)) << half;
+            EXPECT_EQ((half & 0x8000) | 0x7e00, floatToHalf(value)) << half;
+        } else {
+            EXPECT_EQ(half, floatToHalf(value)) << half;
+        }
+    }
+    EXPECT_EQ(1.0f, halfToFloat(0x3c00));
+    EXPECT_EQ(std::ldexp(1.0f, -24), halfToFloat(0x0001));
+    EXPECT_EQ(-std::numeric_limits<float>::infinity(), halfToFloat(0xfc00));
+}
+
+TEST(ArrayMarshalling, PackBooleans) {
+    std::vector<jboolean> booleans(19);
+    for (size_t i = 0; i < booleans.size(); ++i) {
+        booleans[i] = (i % 3 == 0) ? (i == 9 ? 42 : JNI_TRUE) : JNI_FALSE;
+    }
+    uint8_t bits[3] = {0xff, 0xff, 0xff};
+    nativehelper::packBooleans(booleans.data(), booleans.size(), bits);
+    EXPECT_EQ(0x49, bits[0]);
+    EXPECT_EQ(0x92, bits[1]);
+    // Bits past the end are cleared.
+    EXPECT_EQ(0x04, bits[2]);
+
+    std::vector<jboolean> unpacked(booleans.size());
+    nativehelper::unpackBooleans(bits, unpacked.size(), unpacked.data());
+    for (size_t i = 0; i < booleans.size(); ++i) {
+        EXPECT_EQ(booleans[i] != 0 ? JNI_TRUE : JNI_FALSE, unpacked[i]) << i;
+    }
+}
+
+namespace android {
+
+class ArrayMarshallingJniTest : public JNITestBase<BenchmarkMockJNIProvider> {
+protected:
+    void TearDown() override {
+        env_->ExceptionClear();
+        JNITestBase::TearDown();
+    }
+};
+
+TEST_F(ArrayMarshallingJniTest, WidenAndNarrowAcrossChunks) {
+    constexpr jsize kLength = 3 * nativehelper::kMarshallingChunkSize + 5;
+    jintArray array = env_->NewIntArray(kLength);
+    std::vector<int64_t> values(kLength);
+    for (jsize i = 0; i < kLength; ++i) {
+        values[i] = INT64_C(0x100000000) * i - i;
+    }
+    ASSERT_TRUE(setArrayRegionFrom<jint>(env_, array, 0, kLength, values.data()));
+
+    std::vector<int64_t> read(kLength - 1);
+    ASSERT_TRUE(getArrayRegionAs<jint>(env_, array, 1, kLength - 1, read.data()));
+    for (jsize i = 1; i < kLength; ++i) {
+        EXPECT_EQ(-i, read[i - 1]) << i;
+    }
+}
+
+TEST_F(ArrayMarshallingJniTest, OutOfBounds) {
+    jintArray array = env_->NewIntArray(10);
+    int64_t values[11] = {};
+    EXPECT_FALSE(getArrayRegionAs<jint>(env_, array, 0, 11, values));
+    EXPECT_TRUE(env_->ExceptionCheck());
+    env_->ExceptionClear();
+    EXPECT_FALSE(setArrayRegionFrom<jint>(env_, array, 5, -1, values));
+    EXPECT_TRUE(env_->ExceptionCheck());
+    env_->ExceptionClear();
+    EXPECT_FALSE(getArrayRegionAs<jint>(env_, nullptr, 0, 0, values));
+    EXPECT_TRUE(env_->ExceptionCheck());
+}
+
+TEST_F(ArrayMarshallingJniTest, OutOfBoundsWritesNothing) {
+    constexpr jsize kLength = 2 * nativehelper::kMarshallingChunkSize;
+    jintArray array = env_->NewIntArray(kLength);
+    std::vector<int64_t> values(kLength + 1, 7);
+    // The leading chunks are in bounds, the last is not.
+    EXPECT_FALSE(setArrayRegionFrom<jint>(env_, array, 0, kLength + 1, values.data()));
+    EXPECT_TRUE(env_->ExceptionCheck());
+    env_->ExceptionClear();
+    // start + length overflows a jsize.
+    EXPECT_FALSE(setArrayRegionFrom<jint>(env_, array, 1, INT32_MAX, values.data()));
+    EXPECT_TRUE(env_->ExceptionCheck());
+    env_->ExceptionClear();
+    std::vector<jint> stored(kLength);
+    env_->GetIntArrayRegion(array, 0, kLength, stored.data());
+    for (jint value : stored) {
+        ASSERT_EQ(0, value);
+    }
+}
+
+TEST_F(ArrayMarshallingJniTest, BigEndian) {
+    const jbyte bytes[] = {0x00, 0x12, 0x34, 0x56, 0x78, -0x01, -0x02, -0x03, -0x04};
+    jbyteArray array = env_->NewByteArray(sizeof(bytes));
+    env_->SetByteArrayRegion(array, 0, sizeof(bytes), bytes);
+
+    int32_t words[2];
+    ASSERT_TRUE(getBigEndianArrayRegion(env_, array, 1, 2, words));
+    EXPECT_EQ(0x12345678, words[0]);
+    EXPECT_EQ(-0x010204, words[1]);
+
+    const uint16_t shorts[] = {0xabcd, 0x0102};
+    ASSERT_TRUE(setBigEndianArrayRegion(env_, array, 0, 2, shorts));
+    jbyte written[4];
+    env_->GetByteArrayRegion(array, 0, 4, written);
+    EXPECT_EQ(static_cast<jbyte>(0xab), written[0]);
+    EXPECT_EQ(static_cast<jbyte>(0xcd), written[1]);
+    EXPECT_EQ(0x01, written[2]);
+    EXPECT_EQ(0x02, written[3]);
+
+    EXPECT_FALSE(getBigEndianArrayRegion(env_, array, 2, 2, words));
+    EXPECT_TRUE(env_->ExceptionCheck());
+}
+
+TEST_F(ArrayMarshallingJniTest, Halves) {
+    const uint16_t halves[] = {0x3c00, 0xc000, 0x7c00, 0x0001};
+    jfloatArray array = env_->NewFloatArray(4);
+    ASSERT_TRUE(setFloatArrayRegionFromHalves(env_, array, 0, 4, halves));
+    jfloat floats[4];
+    env_->GetFloatArrayRegion(array, 0, 4, floats);
+    EXPECT_EQ(-2.0f, floats[1]);
+    EXPECT_EQ(std::ldexp(1.0f, -24), floats[3]);
+
+    uint16_t read[4];
+    ASSERT_TRUE(getFloatArrayRegionAsHalves(env_, array, 0, 4, read));
+    EXPECT_EQ(std::vector<uint16_t>(halves, halves + 4), std::vector<uint16_t>(read, read + 4));
+}
+
+TEST_F(ArrayMarshallingJniTest, BitsAcrossChunks) {
+    constexpr jsize kLength = nativehelper::kMarshallingChunkSize + 12;
+    std::vector<uint8_t> bits((kLength + 7) / 8);
+    for (size_t i = 0; i < bits.size(); ++i) {
+        bits[i] = static_cast<uint8_t>(i * 37);
+    }
+    bits.back() &= 0x0f;
+    jbooleanArray array = env_->NewBooleanArray(kLength);
+    ASSERT_TRUE(setBooleanArrayRegionFromBits(env_, array, 0, kLength, bits.data()));
+
+    std::vector<uint8_t> read(bits.size(), 0xff);
+    ASSERT_TRUE(getBooleanArrayRegionAsBits(env_, array, 0, kLength, read.data()));
+    EXPECT_EQ(bits, read);
+}
+
+}  // namespace android
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/fromStringArray.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/jni_gtest.h>
+#include <nativehelper/toStringArray.h>
+
+#include "libnativehelper_benchmark.h"
+
+namespace android {
+
+class FromStringArrayTest : public JNITestBase<CountingJNIProvider<BenchmarkMockJNIProvider>> {
+protected:
+    void TearDown() override {
+        env_->ExceptionClear();
+        JNITestBase::TearDown();
+    }
+};
+
+TEST_F(FromStringArrayTest, RoundTrip) {
+    const std::vector<std::string> strings = {"", "a", "/data/local/tmp", ""};
+    jobjectArray array = toStringArray(env_, strings);
+    ASSERT_NE(nullptr, array);
+
+    NativeStringArray result;
+    ASSERT_TRUE(fromStringArray(env_, array, &result));
+    ASSERT_EQ(strings.size(), result.size());
+    for (size_t i = 0; i < strings.size(); ++i) {
+        EXPECT_EQ(strings[i], result[i]);
+        EXPECT_EQ(strings[i].size(), strlen(result.c_str(i)));
+    }
+    std::vector<std::string> copies(result.begin(), result.end());
+    EXPECT_EQ(strings, copies);
+}
+
+TEST_F(FromStringArrayTest, Empty) {
+    NativeStringArray result;
+    ASSERT_TRUE(fromStringArray(env_, toStringArray(env_, std::vector<std::string>()), &result));
+    EXPECT_TRUE(result.empty());
+}
+
+TEST_F(FromStringArrayTest, ReplacesContents) {
+    NativeStringArray result;
+    ASSERT_TRUE(fromStringArray(env_, toStringArray(env_, std::vector<std::string>{"a", "b"}),
+                                &result));
+    ASSERT_TRUE(fromStringArray(env_, toStringArray(env_, std::vector<std::string>{"c"}),
+                                &result));
+    ASSERT_EQ(1u, result.size());
+    EXPECT_EQ("c", result[0]);
+}
+
+TEST_F(FromStringArrayTest, NullArray) {
+    NativeStringArray result;
+    EXPECT_FALSE(fromStringArray(env_, nullptr, &result));
+    EXPECT_TRUE(env_->ExceptionCheck());
+    EXPECT_TRUE(result.empty());
+}
+
+TEST_F(FromStringArrayTest, NullElement) {
+    jobjectArray array = toStringArray(env_, std::vector<std::string>{"a", "b"});
+    env_->SetObjectArrayElement(array, 1, nullptr);
+
+    NativeStringArray result;
+    EXPECT_FALSE(fromStringArray(env_, array, &result));
+    EXPECT_TRUE(env_->ExceptionCheck());
+    EXPECT_TRUE(result.empty());
+}
+
+TEST_F(FromStringArrayTest, CallCounts) {
+    for (size_t count : {1, 64, 300}) {
+        jobject array = env_->NewGlobalRef(
+                toStringArray(env_, std::vector<std::string>(count, "entry")));
+        provider_.ResetCallCounts();
+
+        NativeStringArray result;
+        ASSERT_TRUE(fromStringArray(env_, static_cast<jobjectArray>(array), &result));
+        EXPECT_EQ(count, result.size());
+        // Each element is read once.
+        EXPECT_EQ(count, provider_.CallCount(JniFunction::GetObjectArrayElement));
+        EXPECT_EQ(count, provider_.CallCount(JniFunction::GetStringLength));
+        EXPECT_EQ(count, provider_.CallCount(JniFunction::GetStringUTFLength));
+        EXPECT_EQ(count, provider_.CallCount(JniFunction::GetStringUTFRegion));
+        EXPECT_EQ(0u, provider_.CallCount(JniFunction::GetStringUTFChars));
+        // Element references are released with a local frame per batch of 128.
+        EXPECT_LE(provider_.CallCount(JniFunction::PushLocalFrame), count / 128 + 2);
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,60 @@
+#!/bin/bash
+#
+# Copyright (C) 2021 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Generates a translation unit registering N natives with NATIVE_METHOD_AUTOSIG, used to
+# track the compile-time cost of nativehelper/detail/signature_checker.h.
+#
+# Usage: gen_jni_macros_compile_benchmark.sh <count> > out.cpp
+#
+# Natives cycle through return types and up to four argument types, so many of them share a
+# function type, as in real registration files. The default count of 1000 yields 102 distinct
+# function types.
+
+set -e
+
+count=${1:-1000}
+
+# Only final types can be used with signature inference.
+arg_types=(jint jlong jboolean jdouble jfloat jstring jintArray jbyteArray)
+ret_types=(void jint jlong jboolean jstring jbyteArray)
+
+cat <<HEADER
+// Generated by gen_jni_macros_compile_benchmark.sh. Do not edit.
+
+#include <nativehelper/jni_macros.h>
+
+HEADER
+
+for ((i = 0; i < count; ++i)); do
+  ret=${ret_types[$((i % ${#ret_types[@]}))]}
+  params="JNIEnv*, jclass"
+  for ((j = 0; j < i % 5; ++j)); do
+    params="${params}, ${arg_types[$(((i / 5 + j) % ${#arg_types[@]}))]}"
+  done
+  if [[ "${ret}" == "void" ]]; then
+    echo "static void Benchmark_method${i}(${params}) {}"
+  else
+    echo "static ${ret} Benchmark_method${i}(${params}) { return ${ret}{}; }"
+  fi
+done
+
+echo
+echo "extern const JNINativeMethod gJniMacrosCompileBenchmarkMethods[];"
+echo "const JNINativeMethod gJniMacrosCompileBenchmarkMethods[] = {"
+for ((i = 0; i < count; ++i)); do
+  echo "    NATIVE_METHOD_AUTOSIG(Benchmark, method${i}),"
+done
+echo "};"
@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// JNI cost contracts of the helpers, checked with CountingJNIProvider. A change that makes a
+// helper call into the runtime more often should fail here rather than show up as a
+// regression in the benchmarks.
+
+#include "libnativehelper_benchmark.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <android/file_descriptor_jni.h>
+#include <nativehelper/JNIHelp.h>
+#include <nativehelper/JNIPlatformHelp.h>
+#include <nativehelper/ScopedLocalRef.h>
+#include <nativehelper/jni_gtest.h>
+#include <nativehelper/scoped_primitive_array.h>
+#include <nativehelper/toStringArray.h>
+
+namespace android {
+
+class JniCallCountTest : public JNITestBase<CountingJNIProvider<BenchmarkMockJNIProvider>> {
+protected:
+    jobject NewFileDescriptor(int fd) {
+        jobject fileDescriptor = env_->NewGlobalRef(AFileDescriptor_create(env_));
+        AFileDescriptor_setFd(env_, fileDescriptor, fd);
+        return fileDescriptor;
+    }
+};
+
+TEST_F(JniCallCountTest, ForwardsToWrappedEnv) {
+    jstring s = env_->NewStringUTF("forwarded");
+    EXPECT_EQ(9, env_->GetStringUTFLength(s));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::NewStringUTF));
+    EXPECT_EQ(1u, provider_.CallCount(env_, JniFunction::GetStringUTFLength));
+    EXPECT_EQ(2u, provider_.TotalCallCount()) << provider_.CallCountsToString();
+
+    provider_.ResetCallCounts();
+    EXPECT_EQ(0u, provider_.TotalCallCount());
+}
+
+TEST_F(JniCallCountTest, VarargsAreCountedOnce) {
+    jclass clazz = env_->FindClass("java/io/FileDescriptor");
+    jmethodID init = env_->GetMethodID(clazz, "<init>", "()V");
+    provider_.ResetCallCounts();
+
+    // The C++ wrappers call the va_list variants, C code calls the variadic functions.
+    EXPECT_NE(nullptr, env_->NewObject(clazz, init));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::NewObjectV));
+    EXPECT_NE(nullptr, env_->functions->NewObject(env_, clazz, init));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::NewObject));
+    EXPECT_EQ(2u, provider_.TotalCallCount()) << provider_.CallCountsToString();
+}
+
+TEST_F(JniCallCountTest, AFileDescriptor_getFd) {
+    jobject fileDescriptor = NewFileDescriptor(42);
+    provider_.ResetCallCounts();
+
+    EXPECT_EQ(42, AFileDescriptor_getFd(env_, fileDescriptor));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::IsInstanceOf));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::GetIntField));
+    EXPECT_EQ(2u, provider_.TotalCallCount()) << provider_.CallCountsToString();
+}
+
+TEST_F(JniCallCountTest, AFileDescriptor_getFdUnchecked) {
+    jobject fileDescriptor = NewFileDescriptor(42);
+    provider_.ResetCallCounts();
+
+    EXPECT_EQ(42, AFileDescriptor_getFdUnchecked(env_, fileDescriptor));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::GetIntField));
+    // Debug builds of libnativehelper keep the IsInstanceOf check.
+    EXPECT_LE(provider_.TotalCallCount(), 2u) << provider_.CallCountsToString();
+}
+
+TEST_F(JniCallCountTest, JniConstantsAreCached) {
+    jobject fileDescriptor = NewFileDescriptor(-1);
+    provider_.ResetCallCounts();
+
+    AFileDescriptor_setFd(env_, fileDescriptor, 42);
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::FindClass));
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::GetFieldID));
+}
+
+TEST_F(JniCallCountTest, jniLogExceptionDeduplicated) {
+    jniSetLogExceptionDeduplicationWindow(60 * 1000);
+    jthrowable storm = static_cast<jthrowable>(env_->NewGlobalRef(env_->NewStringUTF("storm")));
+    jthrowable other = static_cast<jthrowable>(env_->NewGlobalRef(env_->NewStringUTF("other")));
+    provider_.ResetCallCounts();
+
+    // Only the first of a storm of identical exceptions renders a stack trace.
+    for (int i = 0; i < 100; ++i) {
+        jniLogExceptionDeduplicated(env_, ANDROID_LOG_VERBOSE, "JniCallCountTest", storm);
+    }
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::CallVoidMethod));
+    jniLogExceptionDeduplicated(env_, ANDROID_LOG_VERBOSE, "JniCallCountTest", other);
+    EXPECT_EQ(2u, provider_.CallCount(JniFunction::CallVoidMethod));
+
+    // Without a window every exception is logged in full.
+    jniSetLogExceptionDeduplicationWindow(0);
+    provider_.ResetCallCounts();
+    for (int i = 0; i < 3; ++i) {
+        jniLogExceptionDeduplicated(env_, ANDROID_LOG_VERBOSE, "JniCallCountTest", storm);
+    }
+    EXPECT_EQ(3u, provider_.CallCount(JniFunction::CallVoidMethod));
+    jniSetLogExceptionDeduplicationWindow(10 * 1000);
+}
+
+TEST_F(JniCallCountTest, jniInternString) {
+    jniUninitializeConstants();
+    provider_.ResetCallCounts();
+
+    // Each distinct string is created once, whatever the pointer to its contents.
+    jstring contentType = jniInternString(env_, "Content-Type");
+    ASSERT_NE(nullptr, contentType);
+    const std::string copy = "Content-Type";
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(contentType, jniInternString(env_, "Content-Type"));
+        EXPECT_EQ(contentType, jniInternString(env_, copy.c_str()));
+    }
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::NewStringUTF));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::NewGlobalRef));
+
+    jstring contentLength = jniInternString(env_, "Content-Length");
+    EXPECT_NE(contentType, contentLength);
+    EXPECT_EQ(2u, provider_.CallCount(JniFunction::NewStringUTF));
+
+    // Interned strings are created again after the runtime is shut down.
+    jniUninitializeConstants();
+    provider_.ResetCallCounts();
+    EXPECT_NE(nullptr, jniInternString(env_, "Content-Type"));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::NewStringUTF));
+}
+
+TEST_F(JniCallCountTest, jniThrowExceptionIsCached) {
+    jniUninitializeConstants();
+    ASSERT_EQ(0, jniRegisterExceptionClass(env_, "java/lang/IllegalStateException"));
+    provider_.ResetCallCounts();
+
+    // The C++ throw helpers share the class cache in JNIHelp.c, including for names built at
+    // runtime rather than taken from a literal.
+    const std::string className = "java/lang/IllegalStateException";
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(0, jniThrowException(env_, className.c_str(), "cached"));
+        env_->ExceptionClear();
+        EXPECT_EQ(0, jniThrowNullPointerException(env_, "cached"));
+        env_->ExceptionClear();
+    }
+    // NullPointerException is a well-known class, resolved by its first throw.
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::FindClass));
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::GetMethodID));
+    EXPECT_EQ(20u, provider_.CallCount(JniFunction::Throw));
+}
+
+jclass (*gFindClass)(JNIEnv*, const char*);
+
+jclass FindClassWithoutErrnoException(JNIEnv* env, const char* name) {
+    if (strcmp(name, "android/system/ErrnoException") == 0) {
+        return nullptr;
+    }
+    return gFindClass(env, name);
+}
+
+TEST_F(JniCallCountTest, jniThrowExceptionMissingClass) {
+    jniUninitializeConstants();
+    JNINativeInterface* functions = const_cast<JNINativeInterface*>(
+            CountingJNIProvider<BenchmarkMockJNIProvider>::WrappedEnv(env_)->functions);
+    gFindClass = functions->FindClass;
+    functions->FindClass = FindClassWithoutErrnoException;
+    provider_.ResetCallCounts();
+
+    // A class that fails to resolve is only looked up in the cache once per initialization.
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(-1, jniThrowErrnoException(env_, "missing", EIO));
+        env_->ExceptionClear();
+    }
+    EXPECT_EQ(11u, provider_.CallCount(JniFunction::FindClass));
+
+    functions->FindClass = gFindClass;
+    jniUninitializeConstants();
+    provider_.ResetCallCounts();
+    EXPECT_EQ(0, jniThrowErrnoException(env_, "found", EIO));
+    env_->ExceptionClear();
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::FindClass));
+}
+
+// Set if NewGlobalRef is called with an exception pending.
+bool gNewGlobalRefWithExceptionPending;
+jobject (*gNewGlobalRef)(JNIEnv*, jobject);
+
+jobject CheckedNewGlobalRef(JNIEnv* env, jobject obj) {
+    gNewGlobalRefWithExceptionPending |= env->ExceptionCheck();
+    return gNewGlobalRef(env, obj);
+}
+
+TEST_F(JniCallCountTest, jniThrowIOExceptionWithExceptionPending) {
+    jniUninitializeConstants();
+    jthrowable pending =
+            static_cast<jthrowable>(env_->NewGlobalRef(env_->NewStringUTF("pending")));
+    JNINativeInterface* functions = const_cast<JNINativeInterface*>(
+            CountingJNIProvider<BenchmarkMockJNIProvider>::WrappedEnv(env_)->functions);
+    gNewGlobalRef = functions->NewGlobalRef;
+    functions->NewGlobalRef = CheckedNewGlobalRef;
+    gNewGlobalRefWithExceptionPending = false;
+
+    // The message is not cached with an exception pending, and the pending exception is read
+    // to be logged before it is replaced.
+    env_->Throw(pending);
+    provider_.ResetCallCounts();
+    EXPECT_EQ(0, jniThrowIOException(env_, EIO));
+    EXPECT_FALSE(gNewGlobalRefWithExceptionPending);
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::ExceptionOccurred));
+    ASSERT_TRUE(env_->ExceptionCheck());
+    EXPECT_NE(pending, env_->ExceptionOccurred());
+    env_->ExceptionClear();
+
+    // Without an exception pending the message is cached by the first throw.
+    EXPECT_EQ(0, jniThrowIOException(env_, EIO));
+    env_->ExceptionClear();
+    provider_.ResetCallCounts();
+    EXPECT_EQ(0, jniThrowIOException(env_, EIO));
+    env_->ExceptionClear();
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::NewStringUTF));
+
+    functions->NewGlobalRef = gNewGlobalRef;
+}
+
+TEST_F(JniCallCountTest, ScopedArrayRW) {
+    jbyteArray array = static_cast<jbyteArray>(env_->NewGlobalRef(env_->NewByteArray(64)));
+    provider_.ResetCallCounts();
+    {
+        ScopedByteArrayRW bytes(env_, array);
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            bytes[i] = static_cast<jbyte>(i);
+        }
+        // The length is read once, not on every size().
+        EXPECT_EQ(1u, provider_.CallCount(JniFunction::GetArrayLength));
+        bytes.commit();
+        EXPECT_EQ(1u, provider_.CallCount(JniFunction::ReleaseByteArrayElements));
+        EXPECT_NE(nullptr, bytes.get());
+    }
+    EXPECT_EQ(2u, provider_.CallCount(JniFunction::ReleaseByteArrayElements));
+
+    provider_.ResetCallCounts();
+    {
+        ScopedByteArrayRW bytes(env_, array);
+        bytes.discard();
+        EXPECT_EQ(nullptr, bytes.get());
+        EXPECT_EQ(0u, bytes.size());
+    }
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::ReleaseByteArrayElements));
+
+    provider_.ResetCallCounts();
+    {
+        ScopedByteArrayRW bytes(env_, array);
+        bytes[8] = 1;
+        bytes.commitRange(8, 1);
+        EXPECT_EQ(nullptr, bytes.get());
+        EXPECT_EQ(0u, bytes.size());
+    }
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::ReleaseByteArrayElements));
+    // The mock returns the array itself rather than a copy, so there is nothing to write back.
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::SetByteArrayRegion));
+}
+
+TEST_F(JniCallCountTest, ScopedArrayRWCommitRangeOutOfBounds) {
+    jbyteArray array = static_cast<jbyteArray>(env_->NewGlobalRef(env_->NewByteArray(16)));
+    const jsize kSpans[][2] = {{-1, 1}, {0, -1}, {16, 1}, {8, 9}, {1, INT32_MAX}};
+    for (const auto& span : kSpans) {
+        provider_.ResetCallCounts();
+        {
+            ScopedByteArrayRW bytes(env_, array);
+            bytes.commitRange(span[0], span[1]);
+            EXPECT_TRUE(env_->ExceptionCheck()) << span[0] << ", " << span[1];
+            env_->ExceptionClear();
+            EXPECT_EQ(nullptr, bytes.get());
+            EXPECT_EQ(0u, bytes.size());
+        }
+        EXPECT_EQ(1u, provider_.CallCount(JniFunction::ReleaseByteArrayElements));
+    }
+
+    // The end of the array is within it.
+    {
+        ScopedByteArrayRW bytes(env_, array);
+        bytes.commitRange(16, 0);
+        bytes.reset(array);
+        bytes.commitRange(8, 8);
+    }
+    EXPECT_FALSE(env_->ExceptionCheck());
+}
+
+TEST_F(JniCallCountTest, ScopedArrayRegionOutOfBounds) {
+    jintArray array = static_cast<jintArray>(env_->NewGlobalRef(env_->NewIntArray(16)));
+    provider_.ResetCallCounts();
+    {
+        // Rejected before the copy is allocated.
+        ScopedPrimitiveArrayRegionRO<jint> region(env_, array, 8, INT32_MAX);
+        EXPECT_EQ(nullptr, region.get());
+        EXPECT_TRUE(env_->ExceptionCheck());
+        env_->ExceptionClear();
+    }
+    {
+        ScopedPrimitiveArrayRegionRW<jint> region(env_, array, -1, 4);
+        EXPECT_EQ(nullptr, region.get());
+        EXPECT_TRUE(env_->ExceptionCheck());
+        env_->ExceptionClear();
+    }
+    {
+        // The end of the window does not fit in a jsize.
+        ScopedPrimitiveArrayChunksRW<jint, 4> chunks(env_, array, INT32_MAX - 1, 8);
+        EXPECT_FALSE(chunks.next());
+        EXPECT_TRUE(env_->ExceptionCheck());
+        env_->ExceptionClear();
+    }
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::GetIntArrayRegion));
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::SetIntArrayRegion));
+
+    ScopedPrimitiveArrayChunksRO<jint, 4> chunks(env_, array, 2, 14);
+    size_t elements = 0;
+    while (chunks.next()) {
+        elements += chunks.size();
+    }
+    EXPECT_EQ(14u, elements);
+    EXPECT_FALSE(env_->ExceptionCheck());
+    env_->DeleteGlobalRef(array);
+}
+
+TEST_F(JniCallCountTest, ScopedArrayRegionRWExceptionPending) {
+    jintArray array = static_cast<jintArray>(env_->NewGlobalRef(env_->NewIntArray(16)));
+    provider_.ResetCallCounts();
+    {
+        ScopedPrimitiveArrayRegionRW<jint> region(env_, array, 4, 8);
+        region[0] = 1;
+        jniThrowRuntimeException(env_, "failed");
+    }
+    EXPECT_TRUE(env_->ExceptionCheck());
+    env_->ExceptionClear();
+    {
+        ScopedPrimitiveArrayChunksRW<jint, 4> chunks(env_, array);
+        EXPECT_TRUE(chunks.next());
+        chunks[0] = 1;
+        // Neither written back nor followed by another chunk.
+        jniThrowRuntimeException(env_, "failed");
+        EXPECT_FALSE(chunks.next());
+        chunks[0] = 1;
+    }
+    EXPECT_TRUE(env_->ExceptionCheck());
+    env_->ExceptionClear();
+    {
+        ScopedIntArrayRW ints(env_, array);
+        ints[0] = 1;
+        jniThrowRuntimeException(env_, "failed");
+        ints.commitRange(0, 1);
+    }
+    EXPECT_TRUE(env_->ExceptionCheck());
+    env_->ExceptionClear();
+    // JNI does not allow Set<Type>ArrayRegion with an exception pending.
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::SetIntArrayRegion));
+    env_->DeleteGlobalRef(array);
+}
+
+TEST_F(JniCallCountTest, toStringArray) {
+    for (size_t count : {1, 64, 300}) {
+        std::vector<std::string> strings(count, "entry");
+        provider_.ResetCallCounts();
+
+        EXPECT_NE(nullptr, toStringArray(env_, strings));
+        EXPECT_EQ(1u, provider_.CallCount(JniFunction::NewObjectArray));
+        EXPECT_EQ(count, provider_.CallCount(JniFunction::NewStringUTF));
+        EXPECT_EQ(count, provider_.CallCount(JniFunction::SetObjectArrayElement));
+        // Element references are released with a local frame per batch of 128.
+        EXPECT_LE(provider_.CallCount(JniFunction::PushLocalFrame), count / 128 + 2);
+        // The String class is looked up once per array, not once per element.
+        EXPECT_EQ(1u, provider_.CallCount(JniFunction::FindClass));
+    }
+}
+
+#if __cplusplus >= 201703L
+TEST_F(JniCallCountTest, toStringArrayStringView) {
+    using namespace std::string_view_literals;
+    const std::vector<std::string_view> strings = {"entry"sv, "a\0b"sv, ""sv};
+    provider_.ResetCallCounts();
+
+    jobjectArray array = toStringArray(env_, strings);
+    ASSERT_NE(nullptr, array);
+    // Views are created from their length, without a NUL-terminated copy for NewStringUTF.
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::NewStringUTF));
+    EXPECT_EQ(strings.size(), provider_.CallCount(JniFunction::NewString));
+    for (size_t i = 0; i < strings.size(); ++i) {
+        ScopedLocalRef<jstring> s(env_,
+                                  static_cast<jstring>(env_->GetObjectArrayElement(array, i)));
+        EXPECT_EQ(static_cast<jsize>(strings[i].size()), env_->GetStringLength(s.get()));
+    }
+}
+#endif
+
+TEST_F(JniCallCountTest, toStringArrayNullElement) {
+    const char* const strings[] = {"first", nullptr, "third"};
+    jobjectArray array = toStringArray(env_, 3, [&strings](size_t i) { return strings[i]; });
+    ASSERT_NE(nullptr, array);
+    EXPECT_FALSE(env_->ExceptionCheck());
+    EXPECT_NE(nullptr, env_->GetObjectArrayElement(array, 0));
+    EXPECT_EQ(nullptr, env_->GetObjectArrayElement(array, 1));
+    EXPECT_NE(nullptr, env_->GetObjectArrayElement(array, 2));
+}
+
+TEST(CountingJNIProviderTest, CountsPerThread) {
+    constexpr int kThreads = 4;
+    constexpr int kCallsPerThread = 1000;
+
+    CountingJNIProvider<> provider;
+    provider.SetUp();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&provider]() {
+            JNIEnv* env = provider.CreateJNIEnv();
+            JNINativeInterface* functions = const_cast<JNINativeInterface*>(
+                    CountingJNIProvider<>::WrappedEnv(env)->functions);
+            functions->GetVersion = [](JNIEnv*) -> jint { return JNI_VERSION_1_6; };
+            for (int i = 0; i < kCallsPerThread; ++i) {
+                EXPECT_EQ(JNI_VERSION_1_6, env->GetVersion());
+            }
+            EXPECT_EQ(static_cast<uint64_t>(kCallsPerThread),
+                      CountingJNIProvider<>::CallCount(env, JniFunction::GetVersion));
+            provider.DestroyJNIEnv(env);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // Counts of destroyed envs are kept.
+    EXPECT_EQ(static_cast<uint64_t>(kThreads * kCallsPerThread),
+              provider.CallCount(JniFunction::GetVersion));
+    EXPECT_EQ(static_cast<uint64_t>(kThreads * kCallsPerThread), provider.TotalCallCount());
+    provider.TearDown();
+}
+
+}  // namespace android
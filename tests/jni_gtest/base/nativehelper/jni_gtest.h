@@ -16,7 +16,17 @@
 
 #pragma once
 
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -68,8 +78,8 @@ protected:
     }
 
     void TearDown() override {
-        provider_->DestroyJNIEnv(env_);
-        provider_->TearDown();
+        provider_.DestroyJNIEnv(env_);
+        provider_.TearDown();
         Test::TearDown();
     }
 
@@ -82,7 +92,8 @@ protected:
 
 // A mockable implementation of the Provider concept. It is the responsibility
 // of the test to stub out any needed functions (all function pointers will be
-// null initially).
+// null initially). Each env has its own function table, so tests may create one
+// env per thread.
 //
 // TODO: Consider googlemock.
 class MockJNIProvider {
@@ -94,7 +105,6 @@ public:
         // Nothing to here.
     }
 
-    // TODO: Spawn threads to allow more envs?
     JNIEnv* CreateJNIEnv() {
         return CreateMockedJNIEnv().release();
     }
@@ -120,5 +130,498 @@ protected:
     }
 };
 
-}  // namespace android
+// Every JNINativeInterface function, in table order. VARARGS marks the C variadic
+// functions, which have a va_list variant of the same name with a V suffix.
+#define JNI_GTEST_FUNCTION_LIST(V, VARARGS) \
+    V(GetVersion) \
+    V(DefineClass) \
+    V(FindClass) \
+    V(FromReflectedMethod) \
+    V(FromReflectedField) \
+    V(ToReflectedMethod) \
+    V(GetSuperclass) \
+    V(IsAssignableFrom) \
+    V(ToReflectedField) \
+    V(Throw) \
+    V(ThrowNew) \
+    V(ExceptionOccurred) \
+    V(ExceptionDescribe) \
+    V(ExceptionClear) \
+    V(FatalError) \
+    V(PushLocalFrame) \
+    V(PopLocalFrame) \
+    V(NewGlobalRef) \
+    V(DeleteGlobalRef) \
+    V(DeleteLocalRef) \
+    V(IsSameObject) \
+    V(NewLocalRef) \
+    V(EnsureLocalCapacity) \
+    V(AllocObject) \
+    VARARGS(NewObject) \
+    V(NewObjectV) \
+    V(NewObjectA) \
+    V(GetObjectClass) \
+    V(IsInstanceOf) \
+    V(GetMethodID) \
+    VARARGS(CallObjectMethod) \
+    V(CallObjectMethodV) \
+    V(CallObjectMethodA) \
+    VARARGS(CallBooleanMethod) \
+    V(CallBooleanMethodV) \
+    V(CallBooleanMethodA) \
+    VARARGS(CallByteMethod) \
+    V(CallByteMethodV) \
+    V(CallByteMethodA) \
+    VARARGS(CallCharMethod) \
+    V(CallCharMethodV) \
+    V(CallCharMethodA) \
+    VARARGS(CallShortMethod) \
+    V(CallShortMethodV) \
+    V(CallShortMethodA) \
+    VARARGS(CallIntMethod) \
+    V(CallIntMethodV) \
+    V(CallIntMethodA) \
+    VARARGS(CallLongMethod) \
+    V(CallLongMethodV) \
+    V(CallLongMethodA) \
+    VARARGS(CallFloatMethod) \
+    V(CallFloatMethodV) \
+    V(CallFloatMethodA) \
+    VARARGS(CallDoubleMethod) \
+    V(CallDoubleMethodV) \
+    V(CallDoubleMethodA) \
+    VARARGS(CallVoidMethod) \
+    V(CallVoidMethodV) \
+    V(CallVoidMethodA) \
+    VARARGS(CallNonvirtualObjectMethod) \
+    V(CallNonvirtualObjectMethodV) \
+    V(CallNonvirtualObjectMethodA) \
+    VARARGS(CallNonvirtualBooleanMethod) \
+    V(CallNonvirtualBooleanMethodV) \
+    V(CallNonvirtualBooleanMethodA) \
+    VARARGS(CallNonvirtualByteMethod) \
+    V(CallNonvirtualByteMethodV) \
+    V(CallNonvirtualByteMethodA) \
+    VARARGS(CallNonvirtualCharMethod) \
+    V(CallNonvirtualCharMethodV) \
+    V(CallNonvirtualCharMethodA) \
+    VARARGS(CallNonvirtualShortMethod) \
+    V(CallNonvirtualShortMethodV) \
+    V(CallNonvirtualShortMethodA) \
+    VARARGS(CallNonvirtualIntMethod) \
+    V(CallNonvirtualIntMethodV) \
+    V(CallNonvirtualIntMethodA) \
+    VARARGS(CallNonvirtualLongMethod) \
+    V(CallNonvirtualLongMethodV) \
+    V(CallNonvirtualLongMethodA) \
+    VARARGS(CallNonvirtualFloatMethod) \
+    V(CallNonvirtualFloatMethodV) \
+    V(CallNonvirtualFloatMethodA) \
+    VARARGS(CallNonvirtualDoubleMethod) \
+    V(CallNonvirtualDoubleMethodV) \
+    V(CallNonvirtualDoubleMethodA) \
+    VARARGS(CallNonvirtualVoidMethod) \
+    V(CallNonvirtualVoidMethodV) \
+    V(CallNonvirtualVoidMethodA) \
+    V(GetFieldID) \
+    V(GetObjectField) \
+    V(GetBooleanField) \
+    V(GetByteField) \
+    V(GetCharField) \
+    V(GetShortField) \
+    V(GetIntField) \
+    V(GetLongField) \
+    V(GetFloatField) \
+    V(GetDoubleField) \
+    V(SetObjectField) \
+    V(SetBooleanField) \
+    V(SetByteField) \
+    V(SetCharField) \
+    V(SetShortField) \
+    V(SetIntField) \
+    V(SetLongField) \
+    V(SetFloatField) \
+    V(SetDoubleField) \
+    V(GetStaticMethodID) \
+    VARARGS(CallStaticObjectMethod) \
+    V(CallStaticObjectMethodV) \
+    V(CallStaticObjectMethodA) \
+    VARARGS(CallStaticBooleanMethod) \
+    V(CallStaticBooleanMethodV) \
+    V(CallStaticBooleanMethodA) \
+    VARARGS(CallStaticByteMethod) \
+    V(CallStaticByteMethodV) \
+    V(CallStaticByteMethodA) \
+    VARARGS(CallStaticCharMethod) \
+    V(CallStaticCharMethodV) \
+    V(CallStaticCharMethodA) \
+    VARARGS(CallStaticShortMethod) \
+    V(CallStaticShortMethodV) \
+    V(CallStaticShortMethodA) \
+    VARARGS(CallStaticIntMethod) \
+    V(CallStaticIntMethodV) \
+    V(CallStaticIntMethodA) \
+    VARARGS(CallStaticLongMethod) \
+    V(CallStaticLongMethodV) \
+    V(CallStaticLongMethodA) \
+    VARARGS(CallStaticFloatMethod) \
+    V(CallStaticFloatMethodV) \
+    V(CallStaticFloatMethodA) \
+    VARARGS(CallStaticDoubleMethod) \
+    V(CallStaticDoubleMethodV) \
+    V(CallStaticDoubleMethodA) \
+    VARARGS(CallStaticVoidMethod) \
+    V(CallStaticVoidMethodV) \
+    V(CallStaticVoidMethodA) \
+    V(GetStaticFieldID) \
+    V(GetStaticObjectField) \
+    V(GetStaticBooleanField) \
+    V(GetStaticByteField) \
+    V(GetStaticCharField) \
+    V(GetStaticShortField) \
+    V(GetStaticIntField) \
+    V(GetStaticLongField) \
+    V(GetStaticFloatField) \
+    V(GetStaticDoubleField) \
+    V(SetStaticObjectField) \
+    V(SetStaticBooleanField) \
+    V(SetStaticByteField) \
+    V(SetStaticCharField) \
+    V(SetStaticShortField) \
+    V(SetStaticIntField) \
+    V(SetStaticLongField) \
+    V(SetStaticFloatField) \
+    V(SetStaticDoubleField) \
+    V(NewString) \
+    V(GetStringLength) \
+    V(GetStringChars) \
+    V(ReleaseStringChars) \
+    V(NewStringUTF) \
+    V(GetStringUTFLength) \
+    V(GetStringUTFChars) \
+    V(ReleaseStringUTFChars) \
+    V(GetArrayLength) \
+    V(NewObjectArray) \
+    V(GetObjectArrayElement) \
+    V(SetObjectArrayElement) \
+    V(NewBooleanArray) \
+    V(NewByteArray) \
+    V(NewCharArray) \
+    V(NewShortArray) \
+    V(NewIntArray) \
+    V(NewLongArray) \
+    V(NewFloatArray) \
+    V(NewDoubleArray) \
+    V(GetBooleanArrayElements) \
+    V(GetByteArrayElements) \
+    V(GetCharArrayElements) \
+    V(GetShortArrayElements) \
+    V(GetIntArrayElements) \
+    V(GetLongArrayElements) \
+    V(GetFloatArrayElements) \
+    V(GetDoubleArrayElements) \
+    V(ReleaseBooleanArrayElements) \
+    V(ReleaseByteArrayElements) \
+    V(ReleaseCharArrayElements) \
+    V(ReleaseShortArrayElements) \
+    V(ReleaseIntArrayElements) \
+    V(ReleaseLongArrayElements) \
+    V(ReleaseFloatArrayElements) \
+    V(ReleaseDoubleArrayElements) \
+    V(GetBooleanArrayRegion) \
+    V(GetByteArrayRegion) \
+    V(GetCharArrayRegion) \
+    V(GetShortArrayRegion) \
+    V(GetIntArrayRegion) \
+    V(GetLongArrayRegion) \
+    V(GetFloatArrayRegion) \
+    V(GetDoubleArrayRegion) \
+    V(SetBooleanArrayRegion) \
+    V(SetByteArrayRegion) \
+    V(SetCharArrayRegion) \
+    V(SetShortArrayRegion) \
+    V(SetIntArrayRegion) \
+    V(SetLongArrayRegion) \
+    V(SetFloatArrayRegion) \
+    V(SetDoubleArrayRegion) \
+    V(RegisterNatives) \
+    V(UnregisterNatives) \
+    V(MonitorEnter) \
+    V(MonitorExit) \
+    V(GetJavaVM) \
+    V(GetStringRegion) \
+    V(GetStringUTFRegion) \
+    V(GetPrimitiveArrayCritical) \
+    V(ReleasePrimitiveArrayCritical) \
+    V(GetStringCritical) \
+    V(ReleaseStringCritical) \
+    V(NewWeakGlobalRef) \
+    V(DeleteWeakGlobalRef) \
+    V(ExceptionCheck) \
+    V(NewDirectByteBuffer) \
+    V(GetDirectBufferAddress) \
+    V(GetDirectBufferCapacity) \
+    V(GetObjectRefType)
+
+enum class JniFunction : size_t {
+#define JNI_GTEST_FUNCTION_ENUM(name) name,
+    JNI_GTEST_FUNCTION_LIST(JNI_GTEST_FUNCTION_ENUM, JNI_GTEST_FUNCTION_ENUM)
+#undef JNI_GTEST_FUNCTION_ENUM
+};
+
+constexpr size_t kJniFunctionCount = 0
+#define JNI_GTEST_FUNCTION_COUNT(name) + 1
+    JNI_GTEST_FUNCTION_LIST(JNI_GTEST_FUNCTION_COUNT, JNI_GTEST_FUNCTION_COUNT);
+#undef JNI_GTEST_FUNCTION_COUNT
+
+inline const char* JniFunctionName(JniFunction function) {
+    static const char* const kNames[] = {
+#define JNI_GTEST_FUNCTION_NAME(name) #name,
+        JNI_GTEST_FUNCTION_LIST(JNI_GTEST_FUNCTION_NAME, JNI_GTEST_FUNCTION_NAME)
+#undef JNI_GTEST_FUNCTION_NAME
+    };
+    return kNames[static_cast<size_t>(function)];
+}
+
+namespace jni_gtest_detail {
+
+// The env handed out by CountingJNIProvider. Its function table counts the call and then
+// forwards it to the wrapped env.
+struct CountingJNIEnv : public JNIEnv {
+    explicit CountingJNIEnv(JNIEnv* wrapped_env) : JNIEnv{nullptr}, wrapped(wrapped_env) {
+    }
+
+    static JNIEnv* Count(JNIEnv* env, JniFunction function) {
+        CountingJNIEnv* self = static_cast<CountingJNIEnv*>(env);
+        self->counts[static_cast<size_t>(function)].fetch_add(1, std::memory_order_relaxed);
+        return self->wrapped;
+    }
+
+    JNIEnv* const wrapped;
+    // An env is only used by its own thread, but the counts may be read from any thread.
+    std::atomic<uint64_t> counts[kJniFunctionCount] = {};
+};
+
+template <typename Fn, Fn JNINativeInterface::*kSlot, JniFunction kFunction>
+struct CountingThunk;
+
+template <typename R,
+          typename... Args,
+          R (*JNINativeInterface::*kSlot)(JNIEnv*, Args...),
+          JniFunction kFunction>
+struct CountingThunk<R (*)(JNIEnv*, Args...), kSlot, kFunction> {
+    static R Call(JNIEnv* env, Args... args) {
+        JNIEnv* wrapped = CountingJNIEnv::Count(env, kFunction);
+        return (wrapped->functions->*kSlot)(wrapped, args...);
+    }
+};
+
+// The variadic functions are forwarded to the va_list variant kVSlot of the wrapped env,
+// which is not counted. The three shapes below are all the variadic functions in JNI.
+template <typename VFn, VFn JNINativeInterface::*kVSlot, JniFunction kFunction>
+struct VarargsCountingThunk;
+
+template <typename R,
+          R (*JNINativeInterface::*kVSlot)(JNIEnv*, jobject, jmethodID, va_list),
+          JniFunction kFunction>
+struct VarargsCountingThunk<R (*)(JNIEnv*, jobject, jmethodID, va_list), kVSlot, kFunction> {
+    static R Call(JNIEnv* env, jobject obj, jmethodID method, ...) {
+        JNIEnv* wrapped = CountingJNIEnv::Count(env, kFunction);
+        va_list args;
+        va_start(args, method);
+        if constexpr (std::is_void<R>::value) {
+            (wrapped->functions->*kVSlot)(wrapped, obj, method, args);
+            va_end(args);
+        } else {
+            R result = (wrapped->functions->*kVSlot)(wrapped, obj, method, args);
+            va_end(args);
+            return result;
+        }
+    }
+};
+
+template <typename R,
+          R (*JNINativeInterface::*kVSlot)(JNIEnv*, jobject, jclass, jmethodID, va_list),
+          JniFunction kFunction>
+struct VarargsCountingThunk<R (*)(JNIEnv*, jobject, jclass, jmethodID, va_list),
+                            kVSlot,
+                            kFunction> {
+    static R Call(JNIEnv* env, jobject obj, jclass clazz, jmethodID method, ...) {
+        JNIEnv* wrapped = CountingJNIEnv::Count(env, kFunction);
+        va_list args;
+        va_start(args, method);
+        if constexpr (std::is_void<R>::value) {
+            (wrapped->functions->*kVSlot)(wrapped, obj, clazz, method, args);
+            va_end(args);
+        } else {
+            R result = (wrapped->functions->*kVSlot)(wrapped, obj, clazz, method, args);
+            va_end(args);
+            return result;
+        }
+    }
+};
+
+template <typename R,
+          R (*JNINativeInterface::*kVSlot)(JNIEnv*, jclass, jmethodID, va_list),
+          JniFunction kFunction>
+struct VarargsCountingThunk<R (*)(JNIEnv*, jclass, jmethodID, va_list), kVSlot, kFunction> {
+    static R Call(JNIEnv* env, jclass clazz, jmethodID method, ...) {
+        JNIEnv* wrapped = CountingJNIEnv::Count(env, kFunction);
+        va_list args;
+        va_start(args, method);
+        if constexpr (std::is_void<R>::value) {
+            (wrapped->functions->*kVSlot)(wrapped, clazz, method, args);
+            va_end(args);
+        } else {
+            R result = (wrapped->functions->*kVSlot)(wrapped, clazz, method, args);
+            va_end(args);
+            return result;
+        }
+    }
+};
+
+inline const JNINativeInterface* CountingFunctions() {
+    static const JNINativeInterface kFunctions = [] {
+        JNINativeInterface functions;
+        memset(&functions, 0, sizeof(functions));
+#define JNI_GTEST_COUNTING_THUNK(name)                                                  \
+        functions.name = &CountingThunk<decltype(JNINativeInterface::name),             \
+                                        &JNINativeInterface::name,                      \
+                                        JniFunction::name>::Call;
+#define JNI_GTEST_VARARGS_COUNTING_THUNK(name)                                          \
+        functions.name = &VarargsCountingThunk<decltype(JNINativeInterface::name##V),   \
+                                               &JNINativeInterface::name##V,            \
+                                               JniFunction::name>::Call;
+        JNI_GTEST_FUNCTION_LIST(JNI_GTEST_COUNTING_THUNK, JNI_GTEST_VARARGS_COUNTING_THUNK)
+#undef JNI_GTEST_COUNTING_THUNK
+#undef JNI_GTEST_VARARGS_COUNTING_THUNK
+        return functions;
+    }();
+    return &kFunctions;
+}
+
+}  // namespace jni_gtest_detail
+
+// A Provider that counts every JNI call made through its envs and forwards it to an env of
+// the wrapped Provider. Tests use it to pin down the JNI cost of a helper:
+//
+//   CountingJNIProvider<SomeMockProvider> provider;
+//   JNIEnv* env = provider.CreateJNIEnv();
+//   provider.ResetCallCounts();
+//   AFileDescriptor_getFdUnchecked(env, fd);
+//   EXPECT_EQ(1u, provider.CallCount(JniFunction::GetIntField));
+//
+// Functions are stubbed on the wrapped env, see WrappedEnv(). CreateJNIEnv and
+// DestroyJNIEnv may be called from any thread if the wrapped Provider allows it, with one env
+// per thread. Counts are kept per env and summed on demand, so counting itself does not
+// contend across threads.
+template <typename Provider = MockJNIProvider>
+class CountingJNIProvider {
+public:
+    void SetUp() {
+        provider_.SetUp();
+    }
+
+    JNIEnv* CreateJNIEnv() {
+        JNIEnv* wrapped = provider_.CreateJNIEnv();
+        if (wrapped == nullptr) {
+            return nullptr;
+        }
+        jni_gtest_detail::CountingJNIEnv* env = new jni_gtest_detail::CountingJNIEnv(wrapped);
+        env->functions = jni_gtest_detail::CountingFunctions();
+        std::lock_guard<std::mutex> lock(mutex_);
+        envs_.push_back(env);
+        return env;
+    }
+
+    void DestroyJNIEnv(JNIEnv* env) {
+        jni_gtest_detail::CountingJNIEnv* counting = AsCounting(env);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < kJniFunctionCount; ++i) {
+                retired_counts_[i] += counting->counts[i].load(std::memory_order_relaxed);
+            }
+            envs_.erase(std::find(envs_.begin(), envs_.end(), counting));
+        }
+        provider_.DestroyJNIEnv(counting->wrapped);
+        delete counting;
+    }
 
+    void TearDown() {
+        provider_.TearDown();
+    }
+
+    // The env that calls made on env are forwarded to.
+    static JNIEnv* WrappedEnv(JNIEnv* env) {
+        return AsCounting(env)->wrapped;
+    }
+
+    // Calls to function made through env.
+    static uint64_t CallCount(JNIEnv* env, JniFunction function) {
+        return AsCounting(env)->counts[static_cast<size_t>(function)].load(
+                std::memory_order_relaxed);
+    }
+
+    // Calls to function made through all envs of this provider, including destroyed ones.
+    uint64_t CallCount(JniFunction function) const {
+        const size_t index = static_cast<size_t>(function);
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t count = retired_counts_[index];
+        for (const jni_gtest_detail::CountingJNIEnv* env : envs_) {
+            count += env->counts[index].load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    // Calls to any function made through all envs of this provider.
+    uint64_t TotalCallCount() const {
+        uint64_t count = 0;
+        for (size_t i = 0; i < kJniFunctionCount; ++i) {
+            count += CallCount(static_cast<JniFunction>(i));
+        }
+        return count;
+    }
+
+    void ResetCallCounts() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::fill(std::begin(retired_counts_), std::end(retired_counts_), 0);
+        for (jni_gtest_detail::CountingJNIEnv* env : envs_) {
+            for (std::atomic<uint64_t>& count : env->counts) {
+                count.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // The non-zero counts as "FindClass=1 GetIntField=2", for failure messages.
+    std::string CallCountsToString() const {
+        std::string result;
+        for (size_t i = 0; i < kJniFunctionCount; ++i) {
+            const JniFunction function = static_cast<JniFunction>(i);
+            const uint64_t count = CallCount(function);
+            if (count != 0) {
+                if (!result.empty()) {
+                    result += ' ';
+                }
+                result += std::string(JniFunctionName(function)) + "=" + std::to_string(count);
+            }
+        }
+        return result;
+    }
+
+    Provider& wrapped_provider() {
+        return provider_;
+    }
+
+private:
+    static jni_gtest_detail::CountingJNIEnv* AsCounting(JNIEnv* env) {
+        return static_cast<jni_gtest_detail::CountingJNIEnv*>(env);
+    }
+
+    Provider provider_;
+
+    mutable std::mutex mutex_;
+    std::vector<jni_gtest_detail::CountingJNIEnv*> envs_;
+    uint64_t retired_counts_[kJniFunctionCount] = {};
+};
+
+}  // namespace android
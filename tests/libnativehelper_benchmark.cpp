@@ -0,0 +1,568 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmarks for the libnativehelper hot paths.
+//
+// The same benchmarks run against either a fake JNIEnv or a real runtime, selected with
+// --jni_provider=mock (the default) or --jni_provider=art. The two cannot share a process as
+// libnativehelper caches classes, methods and fields per process. Mock numbers measure the
+// native side of each helper only; art numbers include the JNI transitions.
+
+#include "libnativehelper_benchmark.h"
+
+#include "../JniConstants.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <android/file_descriptor_jni.h>
+#include <benchmark/benchmark.h>
+#include <nativehelper/JNIHelp.h>
+#include <nativehelper/JNIPlatformHelp.h>
+#include <nativehelper/JniTracing.h>
+#include <nativehelper/ScopedPrimitiveArray.h>
+#include <nativehelper/ScopedUtfChars.h>
+#include <nativehelper/array_marshalling.h>
+#include <nativehelper/fromStringArray.h>
+#include <nativehelper/scoped_critical_arrays.h>
+#include <nativehelper/scoped_object_array.h>
+#include <nativehelper/toStringArray.h>
+
+namespace {
+
+// Benchmarks keep their inputs as global references: the runtime does not free local
+// references created outside a native method, and the mock only keeps pinned objects alive.
+jobject Pin(JNIEnv* env, jobject local) {
+    jobject global = env->NewGlobalRef(local);
+    env->DeleteLocalRef(local);
+    return global;
+}
+
+jobject NewFileDescriptor(JNIEnv* env, int fd) {
+    jobject fileDescriptor = Pin(env, AFileDescriptor_create(env));
+    AFileDescriptor_setFd(env, fileDescriptor, fd);
+    return fileDescriptor;
+}
+
+jbyteArray NewByteArray(JNIEnv* env, jsize length) {
+    return static_cast<jbyteArray>(Pin(env, env->NewByteArray(length)));
+}
+
+jfloatArray NewFloatArray(JNIEnv* env, jsize length) {
+    return static_cast<jfloatArray>(Pin(env, env->NewFloatArray(length)));
+}
+
+jstring NewString(JNIEnv* env, size_t length) {
+    return static_cast<jstring>(Pin(env, env->NewStringUTF(std::string(length, 'x').c_str())));
+}
+
+void BM_JniConstants_FileDescriptorClass(benchmark::State& state, JNIEnv* env) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JniConstants_FileDescriptorClass(env));
+    }
+}
+
+void BM_AFileDescriptor_getFd(benchmark::State& state, JNIEnv* env) {
+    jobject fileDescriptor = NewFileDescriptor(env, 42);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AFileDescriptor_getFd(env, fileDescriptor));
+    }
+    env->DeleteGlobalRef(fileDescriptor);
+}
+
+void BM_AFileDescriptor_getFdUnchecked(benchmark::State& state, JNIEnv* env) {
+    jobject fileDescriptor = NewFileDescriptor(env, 42);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AFileDescriptor_getFdUnchecked(env, fileDescriptor));
+    }
+    env->DeleteGlobalRef(fileDescriptor);
+}
+
+void BM_AFileDescriptor_setFd(benchmark::State& state, JNIEnv* env) {
+    jobject fileDescriptor = NewFileDescriptor(env, -1);
+    for (auto _ : state) {
+        AFileDescriptor_setFd(env, fileDescriptor, 42);
+    }
+    env->DeleteGlobalRef(fileDescriptor);
+}
+
+void BM_jniGetNioBufferPointer(benchmark::State& state, JNIEnv* env) {
+    static char storage[4096];
+    jobject buffer = Pin(env, env->NewDirectByteBuffer(storage, sizeof(storage)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(jniGetNioBufferPointer(env, buffer));
+    }
+    env->DeleteGlobalRef(buffer);
+}
+
+void BM_jniGetNioBufferInfo(benchmark::State& state, JNIEnv* env) {
+    static char storage[4096];
+    jobject buffer = Pin(env, env->NewDirectByteBuffer(storage, sizeof(storage)));
+    JniNioBufferInfo info;
+    for (auto _ : state) {
+        jniGetNioBufferInfo(env, buffer, &info);
+        benchmark::DoNotOptimize(info.address);
+    }
+    env->DeleteGlobalRef(buffer);
+}
+
+void BM_ScopedByteArrayRO(benchmark::State& state, JNIEnv* env) {
+    jbyteArray array = NewByteArray(env, state.range(0));
+    for (auto _ : state) {
+        ScopedByteArrayRO bytes(env, array);
+        benchmark::DoNotOptimize(bytes.get());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    env->DeleteGlobalRef(array);
+}
+
+void BM_ScopedByteArrayRW(benchmark::State& state, JNIEnv* env) {
+    jbyteArray array = NewByteArray(env, state.range(0));
+    for (auto _ : state) {
+        ScopedByteArrayRW bytes(env, array);
+        benchmark::DoNotOptimize(bytes.get());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    env->DeleteGlobalRef(array);
+}
+
+void BM_ScopedPrimitiveArrayRegionRO(benchmark::State& state, JNIEnv* env) {
+    jbyteArray array = NewByteArray(env, state.range(0));
+    for (auto _ : state) {
+        ScopedPrimitiveArrayRegionRO<jbyte> bytes(env, array, 0, state.range(0));
+        benchmark::DoNotOptimize(bytes.get());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    env->DeleteGlobalRef(array);
+}
+
+// Mixes two float arrays into a third, pinning or copying each array separately.
+void BM_mixScopedFloatArrays(benchmark::State& state, JNIEnv* env) {
+    jfloatArray left = NewFloatArray(env, state.range(0));
+    jfloatArray right = NewFloatArray(env, state.range(0));
+    jfloatArray out = NewFloatArray(env, state.range(0));
+    for (auto _ : state) {
+        ScopedFloatArrayRO l(env, left);
+        ScopedFloatArrayRO r(env, right);
+        ScopedFloatArrayRW o(env, out);
+        for (size_t i = 0; i < o.size(); ++i) {
+            o[i] = 0.5f * (l[i] + r[i]);
+        }
+        benchmark::DoNotOptimize(o.get());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    env->DeleteGlobalRef(left);
+    env->DeleteGlobalRef(right);
+    env->DeleteGlobalRef(out);
+}
+
+void BM_mixScopedCriticalArrays(benchmark::State& state, JNIEnv* env) {
+    jfloatArray left = NewFloatArray(env, state.range(0));
+    jfloatArray right = NewFloatArray(env, state.range(0));
+    jfloatArray out = NewFloatArray(env, state.range(0));
+    for (auto _ : state) {
+        ScopedCriticalArrays<const jfloat, const jfloat, jfloat> arrays(env, left, right, out);
+        auto [l, r, o] = arrays.spans();
+        for (size_t i = 0; i < o.size(); ++i) {
+            o[i] = 0.5f * (l[i] + r[i]);
+        }
+        benchmark::DoNotOptimize(o.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    env->DeleteGlobalRef(left);
+    env->DeleteGlobalRef(right);
+    env->DeleteGlobalRef(out);
+}
+
+// Scalar equivalents of the array marshalling kernels, with vectorization disabled, which is
+// what the kernels are measured against.
+#if defined(__clang__)
+#define SCALAR_FUNCTION __attribute__((noinline))
+#define SCALAR_LOOP _Pragma("clang loop vectorize(disable) interleave(disable)")
+#else
+#define SCALAR_FUNCTION __attribute__((noinline, optimize("no-tree-vectorize")))
+#define SCALAR_LOOP
+#endif
+
+SCALAR_FUNCTION void ScalarConvertElements(const jint* in, size_t count, int64_t* out) {
+    SCALAR_LOOP
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = in[i];
+    }
+}
+
+SCALAR_FUNCTION void ScalarReverseByteOrder(const uint32_t* in, size_t count, uint32_t* out) {
+    SCALAR_LOOP
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = __builtin_bswap32(in[i]);
+    }
+}
+
+SCALAR_FUNCTION void ScalarFloatsToHalves(const jfloat* in, size_t count, uint16_t* out) {
+    SCALAR_LOOP
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = nativehelper::floatToHalf(in[i]);
+    }
+}
+
+SCALAR_FUNCTION void ScalarPackBooleans(const jboolean* in, size_t count, uint8_t* out) {
+    memset(out, 0, (count + 7) / 8);
+    SCALAR_LOOP
+    for (size_t i = 0; i < count; ++i) {
+        out[i / 8] |= static_cast<uint8_t>((in[i] != 0 ? 1u : 0u) << (i % 8));
+    }
+}
+
+// Runs |kernel| over state.range(0) elements of In, converting them to Out.
+template <typename In, typename Out, typename Kernel>
+void RunKernel(benchmark::State& state, size_t outCount, Kernel kernel) {
+    const size_t count = state.range(0);
+    std::vector<In> in(count);
+    for (size_t i = 0; i < count; ++i) {
+        in[i] = static_cast<In>(i * 7 % 5);
+    }
+    std::vector<Out> out(outCount);
+    for (auto _ : state) {
+        kernel(in.data(), count, out.data());
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+void BM_convertElements(benchmark::State& state, JNIEnv*) {
+    RunKernel<jint, int64_t>(state, state.range(0), nativehelper::convertElements<jint, int64_t>);
+}
+
+void BM_convertElementsScalar(benchmark::State& state, JNIEnv*) {
+    RunKernel<jint, int64_t>(state, state.range(0), ScalarConvertElements);
+}
+
+void BM_reverseByteOrder(benchmark::State& state, JNIEnv*) {
+    RunKernel<uint32_t, uint32_t>(state, state.range(0), nativehelper::reverseByteOrder<uint32_t>);
+}
+
+void BM_reverseByteOrderScalar(benchmark::State& state, JNIEnv*) {
+    RunKernel<uint32_t, uint32_t>(state, state.range(0), ScalarReverseByteOrder);
+}
+
+void BM_floatsToHalves(benchmark::State& state, JNIEnv*) {
+    RunKernel<jfloat, uint16_t>(state, state.range(0), nativehelper::floatsToHalves);
+}
+
+void BM_floatsToHalvesScalar(benchmark::State& state, JNIEnv*) {
+    RunKernel<jfloat, uint16_t>(state, state.range(0), ScalarFloatsToHalves);
+}
+
+void BM_packBooleans(benchmark::State& state, JNIEnv*) {
+    RunKernel<jboolean, uint8_t>(state, (state.range(0) + 7) / 8, nativehelper::packBooleans);
+}
+
+void BM_packBooleansScalar(benchmark::State& state, JNIEnv*) {
+    RunKernel<jboolean, uint8_t>(state, (state.range(0) + 7) / 8, ScalarPackBooleans);
+}
+
+void BM_getArrayRegionAs(benchmark::State& state, JNIEnv* env) {
+    const jsize length = state.range(0);
+    jintArray array = static_cast<jintArray>(Pin(env, env->NewIntArray(length)));
+    std::vector<int64_t> values(length);
+    for (auto _ : state) {
+        getArrayRegionAs<jint>(env, array, 0, length, values.data());
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+    env->DeleteGlobalRef(array);
+}
+
+// The loop getArrayRegionAs replaces.
+void BM_getArrayRegionAsScalar(benchmark::State& state, JNIEnv* env) {
+    const jsize length = state.range(0);
+    jintArray array = static_cast<jintArray>(Pin(env, env->NewIntArray(length)));
+    std::vector<int64_t> values(length);
+    for (auto _ : state) {
+        ScopedIntArrayRO ints(env, array);
+        ScalarConvertElements(ints.get(), ints.size(), values.data());
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+    env->DeleteGlobalRef(array);
+}
+
+void BM_getBigEndianArrayRegion(benchmark::State& state, JNIEnv* env) {
+    const jsize count = state.range(0);
+    jbyteArray array = NewByteArray(env, count * sizeof(int32_t));
+    std::vector<int32_t> values(count);
+    for (auto _ : state) {
+        getBigEndianArrayRegion(env, array, 0, count, values.data());
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    env->DeleteGlobalRef(array);
+}
+
+void BM_ScopedUtfChars(benchmark::State& state, JNIEnv* env) {
+    jstring s = NewString(env, state.range(0));
+    for (auto _ : state) {
+        ScopedUtfChars chars(env, s);
+        benchmark::DoNotOptimize(chars.size());
+    }
+    env->DeleteGlobalRef(s);
+}
+
+void BM_ScopedUtfCharsWithBuffer(benchmark::State& state, JNIEnv* env) {
+    jstring s = NewString(env, state.range(0));
+    for (auto _ : state) {
+        ScopedUtfCharsWithBuffer<> chars(env, s);
+        benchmark::DoNotOptimize(chars.size());
+    }
+    env->DeleteGlobalRef(s);
+}
+
+void BM_NewStringUTF(benchmark::State& state, JNIEnv* env) {
+    const std::string s(state.range(0), 'x');
+    for (auto _ : state) {
+        jstring string = env->NewStringUTF(s.c_str());
+        benchmark::DoNotOptimize(string);
+        env->DeleteLocalRef(string);
+    }
+}
+
+void BM_jniCreateStringUtf8(benchmark::State& state, JNIEnv* env) {
+    const std::string s(state.range(0), 'x');
+    for (auto _ : state) {
+        jstring string = jniCreateStringUtf8(env, s.data(), s.size());
+        benchmark::DoNotOptimize(string);
+        env->DeleteLocalRef(string);
+    }
+}
+
+void BM_toStringArray(benchmark::State& state, JNIEnv* env) {
+    std::vector<std::string> strings;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        strings.push_back("/data/local/tmp/entry_" + std::to_string(i));
+    }
+    for (auto _ : state) {
+        jobjectArray array = toStringArray(env, strings);
+        benchmark::DoNotOptimize(array);
+        env->DeleteLocalRef(array);
+    }
+    state.SetItemsProcessed(state.iterations() * strings.size());
+}
+
+// Returns a global reference to a String[] of |count| paths.
+jobjectArray NewPathArray(JNIEnv* env, int64_t count) {
+    std::vector<std::string> strings;
+    for (int64_t i = 0; i < count; ++i) {
+        strings.push_back("/data/local/tmp/entry_" + std::to_string(i));
+    }
+    return static_cast<jobjectArray>(env->NewGlobalRef(toStringArray(env, strings)));
+}
+
+void BM_fromStringArray(benchmark::State& state, JNIEnv* env) {
+    jobjectArray array = NewPathArray(env, state.range(0));
+    NativeStringArray result;
+    for (auto _ : state) {
+        fromStringArray(env, array, &result);
+        benchmark::DoNotOptimize(result.c_str(0));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    env->DeleteGlobalRef(array);
+}
+
+// What fromStringArray replaces: a GetStringUTFChars and std::string per element.
+void BM_fromStringArrayNaive(benchmark::State& state, JNIEnv* env) {
+    jobjectArray array = NewPathArray(env, state.range(0));
+    std::vector<std::string> result;
+    for (auto _ : state) {
+        const jsize count = env->GetArrayLength(array);
+        result.clear();
+        result.reserve(count);
+        for (jsize i = 0; i < count; ++i) {
+            jstring s = static_cast<jstring>(env->GetObjectArrayElement(array, i));
+            const char* chars = env->GetStringUTFChars(s, nullptr);
+            result.emplace_back(chars);
+            env->ReleaseStringUTFChars(s, chars);
+            env->DeleteLocalRef(s);
+        }
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    env->DeleteGlobalRef(array);
+}
+
+// Walks a String[] the usual way, with a DeleteLocalRef per element.
+void BM_ObjectArrayElements(benchmark::State& state, JNIEnv* env) {
+    jobjectArray array = NewPathArray(env, state.range(0));
+    const jsize length = env->GetArrayLength(array);
+    for (auto _ : state) {
+        size_t total = 0;
+        for (jsize i = 0; i < length; ++i) {
+            jstring s = static_cast<jstring>(env->GetObjectArrayElement(array, i));
+            ScopedUtfChars chars(env, s);
+            total += chars.size();
+            env->DeleteLocalRef(s);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+    env->DeleteGlobalRef(array);
+}
+
+void BM_ScopedUtfCharsArrayRO(benchmark::State& state, JNIEnv* env) {
+    jobjectArray array = NewPathArray(env, state.range(0));
+    for (auto _ : state) {
+        size_t total = 0;
+        for (ScopedUtfChars chars : ScopedUtfCharsArrayRO(env, array)) {
+            total += chars.size();
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    env->DeleteGlobalRef(array);
+}
+
+void BM_jniThrowRuntimeException(benchmark::State& state, JNIEnv* env) {
+    for (auto _ : state) {
+        jniThrowRuntimeException(env, "benchmark");
+        env->ExceptionClear();
+    }
+}
+
+void BM_jniThrowNullPointerException(benchmark::State& state, JNIEnv* env) {
+    for (auto _ : state) {
+        jniThrowNullPointerException(env, "benchmark");
+        env->ExceptionClear();
+    }
+}
+
+void BM_jniLogException(benchmark::State& state, JNIEnv* env) {
+    jniThrowRuntimeException(env, "benchmark");
+    jthrowable exception = static_cast<jthrowable>(Pin(env, env->ExceptionOccurred()));
+    env->ExceptionClear();
+    for (auto _ : state) {
+        // Verbose so that the log itself is normally filtered out and the measurement is of
+        // formatting the exception.
+        jniLogException(env, ANDROID_LOG_VERBOSE, "libnativehelper_benchmarks", exception);
+    }
+    env->DeleteGlobalRef(exception);
+}
+
+void RegisterBenchmarks(const char* provider, JNIEnv* env) {
+    using Benchmark = void (*)(benchmark::State&, JNIEnv*);
+    auto add = [&](const char* name, Benchmark fn) {
+        return benchmark::RegisterBenchmark((std::string(provider) + "/" + name).c_str(), fn, env);
+    };
+    add("BM_JniConstants_FileDescriptorClass", BM_JniConstants_FileDescriptorClass);
+    add("BM_AFileDescriptor_getFd", BM_AFileDescriptor_getFd);
+    add("BM_AFileDescriptor_getFdUnchecked", BM_AFileDescriptor_getFdUnchecked);
+    add("BM_AFileDescriptor_setFd", BM_AFileDescriptor_setFd);
+    add("BM_jniGetNioBufferPointer", BM_jniGetNioBufferPointer);
+    add("BM_jniGetNioBufferInfo", BM_jniGetNioBufferInfo);
+    add("BM_ScopedByteArrayRO", BM_ScopedByteArrayRO)->Range(16, 64 << 10);
+    add("BM_ScopedByteArrayRW", BM_ScopedByteArrayRW)->Range(16, 64 << 10);
+    add("BM_ScopedPrimitiveArrayRegionRO", BM_ScopedPrimitiveArrayRegionRO)->Range(16, 64 << 10);
+    add("BM_mixScopedFloatArrays", BM_mixScopedFloatArrays)->Range(16, 64 << 10);
+    add("BM_mixScopedCriticalArrays", BM_mixScopedCriticalArrays)->Range(16, 64 << 10);
+    add("BM_convertElements", BM_convertElements)->Range(16, 64 << 10);
+    add("BM_convertElementsScalar", BM_convertElementsScalar)->Range(16, 64 << 10);
+    add("BM_reverseByteOrder", BM_reverseByteOrder)->Range(16, 64 << 10);
+    add("BM_reverseByteOrderScalar", BM_reverseByteOrderScalar)->Range(16, 64 << 10);
+    add("BM_floatsToHalves", BM_floatsToHalves)->Range(16, 64 << 10);
+    add("BM_floatsToHalvesScalar", BM_floatsToHalvesScalar)->Range(16, 64 << 10);
+    add("BM_packBooleans", BM_packBooleans)->Range(16, 64 << 10);
+    add("BM_packBooleansScalar", BM_packBooleansScalar)->Range(16, 64 << 10);
+    add("BM_getArrayRegionAs", BM_getArrayRegionAs)->Range(16, 64 << 10);
+    add("BM_getArrayRegionAsScalar", BM_getArrayRegionAsScalar)->Range(16, 64 << 10);
+    add("BM_getBigEndianArrayRegion", BM_getBigEndianArrayRegion)->Range(16, 16 << 10);
+    add("BM_ScopedUtfChars", BM_ScopedUtfChars)->Range(8, 4 << 10);
+    add("BM_ScopedUtfCharsWithBuffer", BM_ScopedUtfCharsWithBuffer)->Range(8, 4 << 10);
+    add("BM_NewStringUTF", BM_NewStringUTF)->Range(8, 4 << 10);
+    add("BM_jniCreateStringUtf8", BM_jniCreateStringUtf8)->Range(8, 4 << 10);
+    add("BM_toStringArray", BM_toStringArray)->Range(1, 4 << 10);
+    add("BM_fromStringArray", BM_fromStringArray)->Range(1, 1 << 10);
+    add("BM_fromStringArrayNaive", BM_fromStringArrayNaive)->Range(1, 1 << 10);
+    add("BM_ObjectArrayElements", BM_ObjectArrayElements)->Range(1, 1 << 10);
+    add("BM_ScopedUtfCharsArrayRO", BM_ScopedUtfCharsArrayRO)->Range(1, 1 << 10);
+    add("BM_jniThrowRuntimeException", BM_jniThrowRuntimeException);
+    add("BM_jniThrowNullPointerException", BM_jniThrowNullPointerException);
+    add("BM_jniLogException", BM_jniLogException);
+}
+
+// With |trace|, JNI calls made through the env are traced, which slows them down, and the
+// calls of each JNI function are logged at the end.
+template <typename Provider>
+int RunBenchmarks(const char* name, bool trace, int argc, char** argv) {
+    Provider provider;
+    provider.SetUp();
+    JNIEnv* env = provider.CreateJNIEnv();
+    if (env == nullptr) {
+        fprintf(stderr, "Unable to create a JNIEnv with the %s provider\n", name);
+        return 1;
+    }
+    if (trace && !jniTraceJniEnv(env)) {
+        fprintf(stderr, "Unable to trace the JNIEnv of the %s provider\n", name);
+        return 1;
+    }
+    RegisterBenchmarks(name, env);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    if (trace) {
+        jniLogTracingStats(ANDROID_LOG_INFO, "libnativehelper_benchmarks");
+        jniUntraceJniEnv(env);
+    }
+    provider.DestroyJNIEnv(env);
+    provider.TearDown();
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    static const char kProviderFlag[] = "--jni_provider=";
+    static const char kTracingFlag[] = "--jni_tracing";
+    const char* provider = "mock";
+    bool trace = false;
+    for (int i = 1; i < argc;) {
+        if (strncmp(argv[i], kProviderFlag, strlen(kProviderFlag)) == 0) {
+            provider = argv[i] + strlen(kProviderFlag);
+        } else if (strcmp(argv[i], kTracingFlag) == 0) {
+            trace = true;
+        } else {
+            ++i;
+            continue;
+        }
+        // Hide the flag from google-benchmark's own parsing.
+        for (int j = i; j < argc - 1; ++j) {
+            argv[j] = argv[j + 1];
+        }
+        --argc;
+    }
+
+    if (strcmp(provider, "mock") == 0) {
+        return RunBenchmarks<android::BenchmarkMockJNIProvider>(provider, trace, argc, argv);
+    }
+    if (strcmp(provider, "art") == 0) {
+        return RunBenchmarks<android::ArtJNIProvider>(provider, trace, argc, argv);
+    }
+    fprintf(stderr, "Unknown --jni_provider '%s', expected 'mock' or 'art'\n", provider);
+    return 1;
+}
@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <string.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <jni.h>
+#include <nativehelper/JniInvocation.h>
+#include <nativehelper/jni_gtest.h>
+
+namespace android {
+
+// A MockJNIProvider with just enough of a fake object model for the libnativehelper helpers
+// to run: strings, primitive and object arrays, FileDescriptors, direct buffers and pending
+// exceptions.
+//
+// The fake does not model object lifetime or type checks. Objects returned by the New*
+// functions come from a fixed ring that is reused, so they are only valid for a short while;
+// benchmark inputs must be pinned with NewGlobalRef, which copies them to stable storage.
+// The fake heap is shared by all envs, so unlike MockJNIProvider it is single threaded.
+class BenchmarkMockJNIProvider : public MockJNIProvider {
+  public:
+    JNIEnv* CreateJNIEnv() {
+        std::unique_ptr<JNIEnv> env = CreateMockedJNIEnv();
+        InstallFakes(const_cast<JNINativeInterface*>(env->functions));
+        return env.release();
+    }
+
+  private:
+    struct FakeObject {
+        std::string chars;          // java.lang.String, or an exception's message.
+        std::vector<jbyte> bytes;   // Primitive arrays, of elementSize bytes per element.
+        size_t elementSize = 1;
+        std::vector<jobject> elements;  // Object[].
+        bool isObjectArray = false;
+        jint descriptor = -1;       // java.io.FileDescriptor.descriptor.
+        jlong address = 0;          // java.nio.Buffer.address.
+        jint position = 0;          // java.nio.Buffer.position.
+        jint limit = 0;             // java.nio.Buffer.limit.
+    };
+
+    enum FakeMember {
+        kUnknownMember,
+        kDescriptorField,
+        kAddressField,
+        kPositionField,
+        kLimitField,
+        kElementSizeShiftField,
+        kGetNameMethod,
+        kGetMessageMethod,
+        kToStringMethod,
+    };
+
+    // Enough for the largest array a benchmark builds and all of its elements to be live.
+    static constexpr size_t kTransientObjects = 8192;
+
+    struct Heap {
+        FakeObject transient[kTransientObjects];
+        size_t next = 0;
+        std::deque<FakeObject> pinned;
+        std::unordered_map<std::string, std::unique_ptr<FakeObject>> classes;
+        jthrowable pending = nullptr;
+    };
+
+    static Heap& GetHeap() {
+        static Heap heap;
+        return heap;
+    }
+
+    static FakeObject* Get(jobject obj) { return reinterpret_cast<FakeObject*>(obj); }
+
+    static jobject NewTransient() {
+        Heap& heap = GetHeap();
+        FakeObject* obj = &heap.transient[heap.next++ % kTransientObjects];
+        *obj = FakeObject();
+        return reinterpret_cast<jobject>(obj);
+    }
+
+    static jobject NewTransientString(const char* chars) {
+        jobject obj = NewTransient();
+        Get(obj)->chars = chars;
+        return obj;
+    }
+
+    static const FakeMember* MemberFor(const char* name) {
+        static const struct {
+            const char* name;
+            FakeMember member;
+        } kMembers[] = {
+            {"descriptor", kDescriptorField},
+            {"address", kAddressField},
+            {"position", kPositionField},
+            {"limit", kLimitField},
+            {"_elementSizeShift", kElementSizeShiftField},
+            {"getName", kGetNameMethod},
+            {"getMessage", kGetMessageMethod},
+            {"toString", kToStringMethod},
+        };
+        for (const auto& entry : kMembers) {
+            if (strcmp(entry.name, name) == 0) {
+                return &entry.member;
+            }
+        }
+        static const FakeMember kUnknown = kUnknownMember;
+        return &kUnknown;
+    }
+
+    static FakeMember MemberOf(const void* id) { return *static_cast<const FakeMember*>(id); }
+
+    // Throws an ArrayIndexOutOfBoundsException, as the runtime does, unless [start, start + len)
+    // is within |array|.
+    static bool CheckRegion(jarray array, jsize start, jsize len) {
+        const FakeObject* obj = Get(array);
+        const jsize length = static_cast<jsize>(obj->bytes.size() / obj->elementSize);
+        if (start < 0 || len < 0 || start > length - len) {
+            GetHeap().pending = static_cast<jthrowable>(
+                    NewTransientString("java.lang.ArrayIndexOutOfBoundsException"));
+            return false;
+        }
+        return true;
+    }
+
+    // Variadic fakes cannot be lambdas.
+    static jobject FakeNewObject(JNIEnv*, jclass, jmethodID, ...) { return NewTransient(); }
+    static jobject FakeCallStaticObjectMethod(JNIEnv*, jclass, jmethodID, ...) { return nullptr; }
+    static jint FakeCallStaticIntMethod(JNIEnv*, jclass, jmethodID, ...) { return 0; }
+
+    static void InstallFakes(JNINativeInterface* f) {
+        f->FindClass = [](JNIEnv*, const char* name) -> jclass {
+            std::unique_ptr<FakeObject>& cls = GetHeap().classes[name];
+            if (cls == nullptr) {
+                cls.reset(new FakeObject());
+                cls->chars = name;
+            }
+            return reinterpret_cast<jclass>(cls.get());
+        };
+        f->GetObjectClass = [](JNIEnv* env, jobject) -> jclass {
+            return env->FindClass("java/lang/RuntimeException");
+        };
+        f->IsInstanceOf = [](JNIEnv*, jobject, jclass) -> jboolean { return JNI_TRUE; };
+        f->NewGlobalRef = [](JNIEnv*, jobject obj) -> jobject {
+            Heap& heap = GetHeap();
+            heap.pinned.push_back(*Get(obj));
+            return reinterpret_cast<jobject>(&heap.pinned.back());
+        };
+        f->DeleteGlobalRef = [](JNIEnv*, jobject) {};
+        f->DeleteLocalRef = [](JNIEnv*, jobject) {};
+        f->PushLocalFrame = [](JNIEnv*, jint) -> jint { return JNI_OK; };
+        f->PopLocalFrame = [](JNIEnv*, jobject result) -> jobject { return result; };
+        f->EnsureLocalCapacity = [](JNIEnv*, jint) -> jint { return JNI_OK; };
+
+        f->GetMethodID = [](JNIEnv*, jclass, const char* name, const char*) {
+            return reinterpret_cast<jmethodID>(const_cast<FakeMember*>(MemberFor(name)));
+        };
+        f->GetStaticMethodID = f->GetMethodID;
+        f->GetFieldID = [](JNIEnv*, jclass, const char* name, const char*) {
+            return reinterpret_cast<jfieldID>(const_cast<FakeMember*>(MemberFor(name)));
+        };
+        f->GetStaticFieldID = f->GetFieldID;
+
+        f->NewObject = FakeNewObject;
+        f->NewObjectV = [](JNIEnv*, jclass, jmethodID, va_list) -> jobject {
+            return NewTransient();
+        };
+        f->CallObjectMethodV = [](JNIEnv*, jobject obj, jmethodID method, va_list) -> jobject {
+            switch (MemberOf(method)) {
+                case kGetNameMethod:
+                    return NewTransientString("java.lang.RuntimeException");
+                case kGetMessageMethod:
+                    return Get(obj)->chars.empty() ? nullptr
+                                                   : NewTransientString(Get(obj)->chars.c_str());
+                case kToStringMethod:
+                    return NewTransientString("java.lang.RuntimeException\n\tat Benchmark.run");
+                default:
+                    return nullptr;
+            }
+        };
+        f->CallVoidMethodV = [](JNIEnv*, jobject, jmethodID, va_list) {};
+        f->CallStaticObjectMethod = FakeCallStaticObjectMethod;
+        f->CallStaticIntMethod = FakeCallStaticIntMethod;
+        // Used by CountingJNIProvider, which forwards variadic calls to their va_list variant.
+        f->CallStaticObjectMethodV = [](JNIEnv*, jclass, jmethodID, va_list) -> jobject {
+            return nullptr;
+        };
+        f->CallStaticIntMethodV = [](JNIEnv*, jclass, jmethodID, va_list) -> jint { return 0; };
+
+        f->GetIntField = [](JNIEnv*, jobject obj, jfieldID field) -> jint {
+            switch (MemberOf(field)) {
+                case kDescriptorField: return Get(obj)->descriptor;
+                case kPositionField: return Get(obj)->position;
+                case kLimitField: return Get(obj)->limit;
+                default: return 0;
+            }
+        };
+        f->SetIntField = [](JNIEnv*, jobject obj, jfieldID field, jint value) {
+            if (MemberOf(field) == kDescriptorField) {
+                Get(obj)->descriptor = value;
+            }
+        };
+        f->GetLongField = [](JNIEnv*, jobject obj, jfieldID field) -> jlong {
+            return MemberOf(field) == kAddressField ? Get(obj)->address : 0;
+        };
+        f->NewDirectByteBuffer = [](JNIEnv*, void* address, jlong capacity) -> jobject {
+            jobject obj = NewTransient();
+            Get(obj)->address = reinterpret_cast<jlong>(address);
+            Get(obj)->limit = static_cast<jint>(capacity);
+            return obj;
+        };
+        f->GetDirectBufferAddress = [](JNIEnv*, jobject buf) -> void* {
+            return reinterpret_cast<void*>(Get(buf)->address);
+        };
+
+        f->GetArrayLength = [](JNIEnv*, jarray array) -> jsize {
+            const FakeObject* obj = Get(array);
+            return static_cast<jsize>(obj->isObjectArray ? obj->elements.size()
+                                                         : obj->bytes.size() / obj->elementSize);
+        };
+#define FAKE_PRIMITIVE_ARRAY(PRIMITIVE_TYPE, NAME) \
+        f->New ## NAME ## Array = [](JNIEnv*, jsize length) -> PRIMITIVE_TYPE ## Array { \
+            jobject obj = NewTransient(); \
+            Get(obj)->bytes.resize(length * sizeof(PRIMITIVE_TYPE)); \
+            Get(obj)->elementSize = sizeof(PRIMITIVE_TYPE); \
+            return static_cast<PRIMITIVE_TYPE ## Array>(obj); \
+        }; \
+        f->Get ## NAME ## ArrayElements = [](JNIEnv*, PRIMITIVE_TYPE ## Array array, \
+                                             jboolean* isCopy) -> PRIMITIVE_TYPE* { \
+            if (isCopy != nullptr) *isCopy = JNI_FALSE; \
+            return reinterpret_cast<PRIMITIVE_TYPE*>(Get(array)->bytes.data()); \
+        }; \
+        f->Release ## NAME ## ArrayElements = [](JNIEnv*, PRIMITIVE_TYPE ## Array, \
+                                                 PRIMITIVE_TYPE*, jint) {}; \
+        f->Get ## NAME ## ArrayRegion = [](JNIEnv*, PRIMITIVE_TYPE ## Array array, jsize start, \
+                                           jsize len, PRIMITIVE_TYPE* buf) { \
+            if (CheckRegion(array, start, len)) { \
+                memcpy(buf, Get(array)->bytes.data() + start * sizeof(PRIMITIVE_TYPE), \
+                       len * sizeof(PRIMITIVE_TYPE)); \
+            } \
+        }; \
+        f->Set ## NAME ## ArrayRegion = [](JNIEnv*, PRIMITIVE_TYPE ## Array array, jsize start, \
+                                           jsize len, const PRIMITIVE_TYPE* buf) { \
+            if (CheckRegion(array, start, len)) { \
+                memcpy(Get(array)->bytes.data() + start * sizeof(PRIMITIVE_TYPE), buf, \
+                       len * sizeof(PRIMITIVE_TYPE)); \
+            } \
+        }
+        FAKE_PRIMITIVE_ARRAY(jboolean, Boolean);
+        FAKE_PRIMITIVE_ARRAY(jbyte, Byte);
+        FAKE_PRIMITIVE_ARRAY(jchar, Char);
+        FAKE_PRIMITIVE_ARRAY(jdouble, Double);
+        FAKE_PRIMITIVE_ARRAY(jfloat, Float);
+        FAKE_PRIMITIVE_ARRAY(jint, Int);
+        FAKE_PRIMITIVE_ARRAY(jlong, Long);
+        FAKE_PRIMITIVE_ARRAY(jshort, Short);
+#undef FAKE_PRIMITIVE_ARRAY
+        f->GetPrimitiveArrayCritical = [](JNIEnv*, jarray array, jboolean* isCopy) -> void* {
+            if (isCopy != nullptr) *isCopy = JNI_FALSE;
+            return Get(array)->bytes.data();
+        };
+        f->ReleasePrimitiveArrayCritical = [](JNIEnv*, jarray, void*, jint) {};
+
+        f->NewStringUTF = [](JNIEnv*, const char* chars) -> jstring {
+            // As the runtime does, a null argument makes a null string without an exception.
+            if (chars == nullptr) {
+                return nullptr;
+            }
+            return static_cast<jstring>(NewTransientString(chars));
+        };
+        f->NewString = [](JNIEnv*, const jchar* chars, jsize length) -> jstring {
+            jobject obj = NewTransient();
+            // Keeps the low byte only, which is enough for the ASCII benchmark strings.
+            Get(obj)->chars.assign(chars, chars + length);
+            return static_cast<jstring>(obj);
+        };
+        f->GetStringUTFChars = [](JNIEnv*, jstring s, jboolean* isCopy) -> const char* {
+            if (isCopy != nullptr) *isCopy = JNI_FALSE;
+            return Get(s)->chars.c_str();
+        };
+        f->ReleaseStringUTFChars = [](JNIEnv*, jstring, const char*) {};
+        f->GetStringUTFLength = [](JNIEnv*, jstring s) -> jsize {
+            return static_cast<jsize>(Get(s)->chars.size());
+        };
+        // Benchmark strings are ASCII, so UTF-16 and modified UTF-8 lengths match.
+        f->GetStringLength = f->GetStringUTFLength;
+        f->GetStringUTFRegion = [](JNIEnv*, jstring s, jsize start, jsize len, char* buf) {
+            memcpy(buf, Get(s)->chars.data() + start, len);
+            buf[len] = '\0';
+        };
+        f->NewObjectArray = [](JNIEnv*, jsize length, jclass, jobject initial) -> jobjectArray {
+            jobject obj = NewTransient();
+            Get(obj)->elements.assign(length, initial);
+            Get(obj)->isObjectArray = true;
+            return static_cast<jobjectArray>(obj);
+        };
+        f->GetObjectArrayElement = [](JNIEnv*, jobjectArray array, jsize index) -> jobject {
+            return Get(array)->elements[index];
+        };
+        f->SetObjectArrayElement = [](JNIEnv*, jobjectArray array, jsize index, jobject value) {
+            Get(array)->elements[index] = value;
+        };
+
+        f->Throw = [](JNIEnv*, jthrowable obj) -> jint {
+            GetHeap().pending = obj;
+            return JNI_OK;
+        };
+        f->ThrowNew = [](JNIEnv*, jclass, const char* message) -> jint {
+            GetHeap().pending =
+                    static_cast<jthrowable>(NewTransientString(message != nullptr ? message : ""));
+            return JNI_OK;
+        };
+        f->ExceptionOccurred = [](JNIEnv*) -> jthrowable { return GetHeap().pending; };
+        f->ExceptionCheck = [](JNIEnv*) -> jboolean {
+            return GetHeap().pending != nullptr ? JNI_TRUE : JNI_FALSE;
+        };
+        f->ExceptionClear = [](JNIEnv*) { GetHeap().pending = nullptr; };
+    }
+};
+
+// Provider backed by a real runtime, created through JniInvocation the same way dalvikvm does.
+// CreateJNIEnv() returns nullptr if no runtime can be started, e.g. on a host without a boot
+// image.
+class ArtJNIProvider {
+  public:
+    void SetUp() {}
+
+    JNIEnv* CreateJNIEnv() {
+        if (!jni_invocation_.Init(nullptr)) {
+            return nullptr;
+        }
+        JavaVMInitArgs args = {JNI_VERSION_1_6, 0, nullptr, JNI_TRUE};
+        JNIEnv* env = nullptr;
+        if (JNI_CreateJavaVM(&vm_, &env, &args) != JNI_OK) {
+            return nullptr;
+        }
+        return env;
+    }
+
+    void DestroyJNIEnv(JNIEnv*) {
+        if (vm_ != nullptr) {
+            vm_->DestroyJavaVM();
+            vm_ = nullptr;
+        }
+    }
+
+    void TearDown() {}
+
+  private:
+    JniInvocation jni_invocation_;
+    JavaVM* vm_ = nullptr;
+};
+
+}  // namespace android
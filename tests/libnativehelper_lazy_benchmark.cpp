@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmarks for the libnativehelper_lazy forwarders. Compare with the same benchmarks in
+// libnativehelper_benchmarks, which call libnativehelper directly, to get the forwarding cost.
+
+#include "libnativehelper_benchmark.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+#include <android/file_descriptor_jni.h>
+#include <benchmark/benchmark.h>
+#include <nativehelper/JNIPlatformHelp.h>
+#include <nativehelper/LibnativehelperLazy.h>
+
+namespace {
+
+JNIEnv* gEnv;
+
+void BM_Lazy_AFileDescriptor_getFd(benchmark::State& state) {
+    jobject fileDescriptor = gEnv->NewGlobalRef(AFileDescriptor_create(gEnv));
+    AFileDescriptor_setFd(gEnv, fileDescriptor, 42);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AFileDescriptor_getFd(gEnv, fileDescriptor));
+    }
+    gEnv->DeleteGlobalRef(fileDescriptor);
+}
+BENCHMARK(BM_Lazy_AFileDescriptor_getFd);
+
+void BM_Lazy_AFileDescriptor_getFdUnchecked(benchmark::State& state) {
+    jobject fileDescriptor = gEnv->NewGlobalRef(AFileDescriptor_create(gEnv));
+    AFileDescriptor_setFd(gEnv, fileDescriptor, 42);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(AFileDescriptor_getFdUnchecked(gEnv, fileDescriptor));
+    }
+    gEnv->DeleteGlobalRef(fileDescriptor);
+}
+BENCHMARK(BM_Lazy_AFileDescriptor_getFdUnchecked);
+
+void BM_Lazy_jniGetNioBufferPointer(benchmark::State& state) {
+    static char storage[4096];
+    jobject buffer = gEnv->NewGlobalRef(gEnv->NewDirectByteBuffer(storage, sizeof(storage)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(jniGetNioBufferPointer(gEnv, buffer));
+    }
+    gEnv->DeleteGlobalRef(buffer);
+}
+BENCHMARK(BM_Lazy_jniGetNioBufferPointer);
+
+// Once every method is bound this is the cost of the already-bound check.
+void BM_Lazy_Prebind(benchmark::State& state) {
+    for (auto _ : state) {
+        LibnativehelperLazyPrebind();
+    }
+}
+BENCHMARK(BM_Lazy_Prebind);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // The forwarders abort if libnativehelper cannot be loaded, so check up front.
+    if (dlopen("libnativehelper.so", RTLD_NOW) == nullptr) {
+        fprintf(stderr, "libnativehelper.so is not available: %s\n", dlerror());
+        return 1;
+    }
+    android::BenchmarkMockJNIProvider provider;
+    provider.SetUp();
+    gEnv = provider.CreateJNIEnv();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+
+    provider.DestroyJNIEnv(gEnv);
+    provider.TearDown();
+    return 0;
+}
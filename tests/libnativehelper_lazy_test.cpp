@@ -19,9 +19,16 @@
 #include <gtest/gtest.h>
 #include "jni.h"
 
+#include "nativehelper/JniArena.h"
+#include "nativehelper/JniConstantsTable.h"
+#include "nativehelper/JniDirectBufferPool.h"
+#include "nativehelper/JniExceptionCache.h"
 #include "nativehelper/JniInvocation.h"
+#include "nativehelper/JniProfiling.h"
+#include "nativehelper/JniTracing.h"
 #include "nativehelper/JNIHelp.h"
 #include "nativehelper/JNIPlatformHelp.h"
+#include "nativehelper/LibnativehelperLazy.h"
 
 // The tests here are just for the case when libnativehelper.so cannot be loaded by
 // libnativehelper_lazy.
@@ -40,8 +47,59 @@ TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJNIPlatformHelp) {
   EXPECT_DEATH(jniGetNioBufferBaseArray(env, NULL), kLoadFailed);
   EXPECT_DEATH(jniGetNioBufferBaseArrayOffset(env, NULL), kLoadFailed);
   EXPECT_DEATH(jniGetNioBufferFields(env, NULL, NULL, NULL, NULL), kLoadFailed);
+  EXPECT_DEATH(jniGetNioBufferInfo(env, NULL, NULL), kLoadFailed);
   EXPECT_DEATH(jniGetNioBufferPointer(env, NULL), kLoadFailed);
+  EXPECT_DEATH(jniLogExceptionDeduplicated(env, 0, "tag", NULL), kLoadFailed);
+  EXPECT_DEATH(jniSetLogExceptionDeduplicationWindow(0), kLoadFailed);
+  EXPECT_DEATH(jniLogExceptionAsync(env, 0, "tag", NULL), kLoadFailed);
+  EXPECT_DEATH(jniFlushAsyncExceptionLog(), kLoadFailed);
+  EXPECT_DEATH(jniGetAsyncExceptionLogStats(NULL), kLoadFailed);
+  EXPECT_DEATH(jniInitializeConstants(env), kLoadFailed);
   EXPECT_DEATH(jniUninitializeConstants(), kLoadFailed);
+  EXPECT_DEATH(jniInternString(env, "interned"), kLoadFailed);
+}
+
+static int ThrowExceptionWithCtor(C_JNIEnv* env, const char* className, const char* ctorSig, ...) {
+  va_list args;
+  va_start(args, ctorSig);
+  int status = jniThrowExceptionWithCtorV(env, className, ctorSig, args);
+  va_end(args);
+  return status;
+}
+
+TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniExceptionCache) {
+  C_JNIEnv* env = NULL;
+  EXPECT_DEATH(jniRegisterExceptionClass(env, "java/lang/IllegalStateException"), kLoadFailed);
+  EXPECT_DEATH(ThrowExceptionWithCtor(env, "java/lang/IllegalStateException",
+                                      "(Ljava/lang/String;)V", NULL),
+               kLoadFailed);
+  EXPECT_DEATH(jniThrowIOException(env, EIO), kLoadFailed);
+}
+
+TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniConstantsTable) {
+  C_JNIEnv* env = NULL;
+  JniConstantsTable table = {};
+  JniConstantsTable* tables[] = { &table };
+  EXPECT_DEATH(jniResolveConstants(env, &table), kLoadFailed);
+  EXPECT_DEATH(jniResolveConstantsInParallel(env, tables, 1, 1), kLoadFailed);
+  EXPECT_DEATH(jniUnregisterConstants(env, &table), kLoadFailed);
+}
+
+TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniArena) {
+  EXPECT_DEATH(jniArenaBegin(), kLoadFailed);
+  EXPECT_DEATH(jniArenaEnd(0), kLoadFailed);
+  EXPECT_DEATH(jniArenaAllocate(1), kLoadFailed);
+  EXPECT_DEATH(jniArenaReallocate(NULL, 0, 1), kLoadFailed);
+}
+
+TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniDirectBufferPool) {
+  C_JNIEnv* env = NULL;
+  const size_t sizes[] = { 4096 };
+  void* address = NULL;
+  EXPECT_DEATH(jniCreateDirectBufferPool(env, sizes, 1, 1), kLoadFailed);
+  EXPECT_DEATH(jniDestroyDirectBufferPool(env, NULL), kLoadFailed);
+  EXPECT_DEATH(jniAcquireDirectBuffer(env, NULL, 1, &address), kLoadFailed);
+  EXPECT_DEATH(jniReleaseDirectBuffer(env, NULL, NULL), kLoadFailed);
 }
 
 TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniInvocation) {
@@ -49,6 +107,24 @@ TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniInvocation) {
   EXPECT_DEATH(JniInvocationDestroy(NULL), kLoadFailed);
   EXPECT_DEATH(JniInvocationGetLibrary("a", NULL), kLoadFailed);
   EXPECT_DEATH(JniInvocationInit(NULL, "a"), kLoadFailed);
+  EXPECT_DEATH(JniInvocationInitWithFlags(NULL, "a", JNI_INVOCATION_INIT_TRACE_JNI), kLoadFailed);
+  EXPECT_DEATH(JniInvocationGetInitTimings(NULL, NULL), kLoadFailed);
+  EXPECT_DEATH(JniInvocationPreload("a", 0), kLoadFailed);
+}
+
+TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniProfiling) {
+  EXPECT_DEATH(jniGetProfilingStats(kJniProfiling_jniThrowException, NULL), kLoadFailed);
+  EXPECT_DEATH(jniResetProfilingStats(), kLoadFailed);
+}
+
+TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniTracing) {
+  C_JNIEnv* env = NULL;
+  JniTracingStats stats;
+  EXPECT_DEATH(jniTraceJniEnv(env), kLoadFailed);
+  EXPECT_DEATH(jniUntraceJniEnv(env), kLoadFailed);
+  EXPECT_DEATH(jniGetTracingStats("FindClass", &stats), kLoadFailed);
+  EXPECT_DEATH(jniResetTracingStats(), kLoadFailed);
+  EXPECT_DEATH(jniLogTracingStats(ANDROID_LOG_INFO, "tag"), kLoadFailed);
 }
 
 TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniApi) {
@@ -63,3 +139,7 @@ TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForJniApi) {
   EXPECT_EQ(JNI_OK, JNI_GetCreatedJavaVMs(&vm, 1, &count));
   EXPECT_EQ(0, count);
 }
+
+TEST_F(LibnativehelperLazyTest, NoLibnativehelperIsForPrebind) {
+  EXPECT_DEATH(LibnativehelperLazyPrebind(), kLoadFailed);
+}
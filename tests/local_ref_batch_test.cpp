@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/local_ref_batch.h"
+
+#include <type_traits>
+#include <utility>
+
+// This is a test that scoped headers work independently.
+
+static_assert(!std::is_move_assignable<LocalRefBatch>::value,
+              "Frames are LIFO, so batches must not be move assigned");
+
+jobject TestLocalRefBatch(JNIEnv* env, jobjectArray array) {
+    LocalRefBatch batch(env, 16);
+    jobject first = batch.add(env->GetObjectArrayElement(array, 0));
+    ScopedLocalRef<jobject> second(env, env->GetObjectArrayElement(array, 1));
+    batch.add(std::move(second));
+    batch.size();
+    jobject kept = batch.escape(first);
+    batch.clear();
+    LocalRefBatch moved(std::move(batch));
+    moved.isValid();
+    return kept;
+}
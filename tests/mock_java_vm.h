@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <jni.h>
+
+namespace android {
+
+// A JavaVM that hands out the same JNIEnv to every thread, for testing code that wraps the
+// JNIInvokeInterface. The only JNI function of the env is GetVersion. GetEnv with a version
+// that is not a JNI version returns agent(), as a runtime returns a JVMTI environment.
+class MockJavaVM {
+  public:
+    MockJavaVM() {
+        invoke_.DestroyJavaVM = DestroyJavaVM;
+        invoke_.AttachCurrentThread = AttachCurrentThread;
+        invoke_.DetachCurrentThread = DetachCurrentThread;
+        invoke_.GetEnv = GetEnv;
+        invoke_.AttachCurrentThreadAsDaemon = AttachCurrentThreadAsDaemon;
+        vm_.functions = &invoke_;
+        functions_.GetVersion = GetVersion;
+        env_.functions = &functions_;
+    }
+
+    MockJavaVM(const MockJavaVM&) = delete;
+    MockJavaVM& operator=(const MockJavaVM&) = delete;
+
+    JavaVM* vm() { return &vm_; }
+    JNIEnv* env() { return &env_; }
+    void* agent() { return &agent_; }
+
+    // The tables the VM and env were created with, which tracing replaces.
+    const JNIInvokeInterface* invokeInterface() const { return &invoke_; }
+    const JNINativeInterface* nativeInterface() const { return &functions_; }
+
+    int attached() const { return attached_; }
+
+  private:
+    static MockJavaVM* From(JavaVM* vm) { return reinterpret_cast<MockJavaVM*>(vm); }
+
+    static jint DestroyJavaVM(JavaVM*) { return JNI_OK; }
+
+    static jint AttachCurrentThread(JavaVM* vm, JNIEnv** env, void*) {
+        ++From(vm)->attached_;
+        *env = From(vm)->env();
+        return JNI_OK;
+    }
+
+    static jint AttachCurrentThreadAsDaemon(JavaVM* vm, JNIEnv** env, void* args) {
+        return AttachCurrentThread(vm, env, args);
+    }
+
+    static jint DetachCurrentThread(JavaVM* vm) {
+        --From(vm)->attached_;
+        return JNI_OK;
+    }
+
+    static jint GetEnv(JavaVM* vm, void** env, jint version) {
+        if ((version & 0xffff0000) == 0x00010000) {
+            *env = From(vm)->env();
+        } else {
+            *env = From(vm)->agent();
+        }
+        return JNI_OK;
+    }
+
+    static jint GetVersion(JNIEnv*) { return JNI_VERSION_1_6; }
+
+    // Must stay the first member, as From() relies on it.
+    JavaVM vm_;
+    JNIEnv env_;
+    JNIInvokeInterface invoke_ = {};
+    JNINativeInterface functions_ = {};
+    int agent_ = 0;
+    int attached_ = 0;
+};
+
+}  // namespace android
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A runtime library for JniInvocation to load in tests, in place of libart.so. It has a single
+// MockJavaVM, which JNI_CreateJavaVM returns every time.
+
+#include <jni.h>
+
+#include "mock_java_vm.h"
+
+static android::MockJavaVM gVm;
+
+extern "C" jint JNI_GetDefaultJavaVMInitArgs(void*) {
+    return JNI_OK;
+}
+
+extern "C" jint JNI_CreateJavaVM(JavaVM** vm, JNIEnv** env, void*) {
+    *vm = gVm.vm();
+    *env = gVm.env();
+    return JNI_OK;
+}
+
+extern "C" jint JNI_GetCreatedJavaVMs(JavaVM** vms, jsize size, jsize* count) {
+    if (size > 0) {
+        vms[0] = gVm.vm();
+    }
+    *count = 1;
+    return JNI_OK;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/scoped_critical_arrays.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/jni_gtest.h>
+
+#include "libnativehelper_benchmark.h"
+
+namespace android {
+
+namespace {
+
+struct Release {
+    jarray array;
+    jint mode;
+};
+
+std::vector<Release> gReleases;
+
+void RecordRelease(JNIEnv*, jarray array, void*, jint mode) {
+    gReleases.push_back({array, mode});
+}
+
+}  // namespace
+
+class ScopedCriticalArraysTest : public JNITestBase<BenchmarkMockJNIProvider> {
+protected:
+    void SetUp() override {
+        JNITestBase::SetUp();
+        const_cast<JNINativeInterface*>(env_->functions)->ReleasePrimitiveArrayCritical =
+                RecordRelease;
+        gReleases.clear();
+    }
+
+    void TearDown() override {
+        env_->ExceptionClear();
+        JNITestBase::TearDown();
+    }
+
+    jfloatArray NewFloatArray(const std::vector<jfloat>& values) {
+        jfloatArray array = env_->NewFloatArray(values.size());
+        env_->SetFloatArrayRegion(array, 0, values.size(), values.data());
+        return array;
+    }
+};
+
+TEST_F(ScopedCriticalArraysTest, PinsAndReleasesInReverseOrder) {
+    jfloatArray left = NewFloatArray({1, 2, 3});
+    jfloatArray right = NewFloatArray({10, 20, 30});
+    jfloatArray out = env_->NewFloatArray(3);
+    const JNINativeInterface* functions = env_->functions;
+    {
+        ScopedCriticalArrays<const jfloat, const jfloat, jfloat> arrays(env_, left, right, out);
+        ASSERT_TRUE(arrays.isValid());
+        EXPECT_EQ(out, arrays.getJavaArray<2>());
+        auto [l, r, o] = arrays.spans();
+        ASSERT_EQ(3u, o.size());
+        for (size_t i = 0; i < o.size(); ++i) {
+            o[i] = l[i] + r[i];
+        }
+        EXPECT_TRUE(gReleases.empty());
+    }
+    EXPECT_EQ(functions, env_->functions);
+    ASSERT_EQ(3u, gReleases.size());
+    EXPECT_EQ(out, gReleases[0].array);
+    EXPECT_EQ(0, gReleases[0].mode);
+    EXPECT_EQ(right, gReleases[1].array);
+    EXPECT_EQ(JNI_ABORT, gReleases[1].mode);
+    EXPECT_EQ(left, gReleases[2].array);
+
+    jfloat sums[3];
+    env_->GetFloatArrayRegion(out, 0, 3, sums);
+    EXPECT_EQ(11, sums[0]);
+    EXPECT_EQ(33, sums[2]);
+}
+
+TEST_F(ScopedCriticalArraysTest, Release) {
+    jintArray array = env_->NewIntArray(4);
+    jintArray empty = env_->NewIntArray(0);
+    ScopedCriticalArrays<jint, const jint> arrays(env_, array, empty);
+    ASSERT_TRUE(arrays.isValid());
+    EXPECT_EQ(4u, arrays.get<0>().size());
+    EXPECT_TRUE(arrays.get<1>().empty());
+    arrays.release();
+    EXPECT_FALSE(arrays.isValid());
+    EXPECT_EQ(nullptr, arrays.get<0>().data());
+    // The empty array is not pinned.
+    ASSERT_EQ(1u, gReleases.size());
+    // JNI calls may be made again.
+    EXPECT_FALSE(env_->ExceptionCheck());
+}
+
+TEST_F(ScopedCriticalArraysTest, NullArray) {
+    jbyteArray array = env_->NewByteArray(4);
+    ScopedCriticalArrays<const jbyte, jbyte> arrays(env_, array, nullptr);
+    EXPECT_FALSE(arrays.isValid());
+    EXPECT_TRUE(env_->ExceptionCheck());
+    EXPECT_TRUE(arrays.get<0>().empty());
+    EXPECT_TRUE(gReleases.empty());
+}
+
+TEST_F(ScopedCriticalArraysTest, Nests) {
+    jintArray outer = env_->NewIntArray(2);
+    jintArray inner = env_->NewIntArray(3);
+    const JNINativeInterface* functions = env_->functions;
+    {
+        ScopedCriticalArrays<jint> outerArrays(env_, outer);
+        ASSERT_TRUE(outerArrays.isValid());
+        {
+            ScopedCriticalArrays<const jint> innerArrays(env_, inner);
+            ASSERT_TRUE(innerArrays.isValid());
+            EXPECT_EQ(3u, innerArrays.get<0>().size());
+        }
+        ASSERT_EQ(1u, gReleases.size());
+        EXPECT_EQ(inner, gReleases[0].array);
+        EXPECT_EQ(2u, outerArrays.get<0>().size());
+    }
+    ASSERT_EQ(2u, gReleases.size());
+    EXPECT_EQ(outer, gReleases[1].array);
+    // The env is left as it was, so JNI calls may be made again.
+    EXPECT_EQ(functions, env_->functions);
+    EXPECT_FALSE(env_->ExceptionCheck());
+}
+
+}  // namespace android
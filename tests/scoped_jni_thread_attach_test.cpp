@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/scoped_jni_thread_attach.h"
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// A VM that only tracks which threads are attached.
+class FakeVm {
+  public:
+    FakeVm() : mFunctions(), mVm{&mFunctions} {
+        mFunctions.reserved0 = this;
+        mFunctions.GetEnv = GetEnv;
+        mFunctions.AttachCurrentThread = AttachCurrentThread;
+        mFunctions.DetachCurrentThread = DetachCurrentThread;
+    }
+
+    JavaVM* get() { return &mVm; }
+
+    std::atomic<int> getEnvCalls{0};
+    std::atomic<int> attachCalls{0};
+    std::atomic<int> detachCalls{0};
+
+  private:
+    static FakeVm* From(JavaVM* vm) {
+        return static_cast<FakeVm*>(const_cast<void*>(vm->functions->reserved0));
+    }
+
+    static jint GetEnv(JavaVM* vm, void** env, jint) {
+        From(vm)->getEnvCalls++;
+        *env = tEnv;
+        return tEnv != nullptr ? JNI_OK : JNI_EDETACHED;
+    }
+
+    static jint AttachCurrentThread(JavaVM* vm, JNIEnv** env, void*) {
+        From(vm)->attachCalls++;
+        tEnv = reinterpret_cast<JNIEnv*>(&tEnv);
+        *env = tEnv;
+        return JNI_OK;
+    }
+
+    static jint DetachCurrentThread(JavaVM* vm) {
+        From(vm)->detachCalls++;
+        tEnv = nullptr;
+        return JNI_OK;
+    }
+
+    static thread_local JNIEnv* tEnv;
+
+    JNIInvokeInterface mFunctions;
+    JavaVM mVm;
+};
+
+thread_local JNIEnv* FakeVm::tEnv = nullptr;
+
+}  // namespace
+
+TEST(ScopedJniThreadAttach, AttachesOncePerThread) {
+    FakeVm vm;
+    std::thread thread([&vm]() {
+        JNIEnv* first = nullptr;
+        for (int i = 0; i < 100; ++i) {
+            ScopedJniThreadAttach attach(vm.get(), "worker");
+            ASSERT_TRUE(attach.isValid());
+            if (first == nullptr) {
+                first = attach.env();
+            }
+            EXPECT_EQ(first, attach.env());
+        }
+        EXPECT_EQ(1, vm.getEnvCalls);
+        EXPECT_EQ(1, vm.attachCalls);
+        EXPECT_EQ(0, vm.detachCalls);
+    });
+    thread.join();
+    // Detached when the thread exited.
+    EXPECT_EQ(1, vm.detachCalls);
+}
+
+TEST(ScopedJniThreadAttach, DoesNotDetachAttachedThreads) {
+    FakeVm vm;
+    std::thread thread([&vm]() {
+        JNIEnv* env = nullptr;
+        ASSERT_EQ(JNI_OK, vm.get()->AttachCurrentThread(&env, nullptr));
+        EXPECT_EQ(env, GetJniEnvForCurrentThread(vm.get()));
+        EXPECT_EQ(env, GetJniEnvForCurrentThread(vm.get()));
+        // Not cached, as the owner may detach the thread.
+        EXPECT_EQ(2, vm.getEnvCalls);
+        vm.get()->DetachCurrentThread();
+    });
+    thread.join();
+    EXPECT_EQ(1, vm.attachCalls);
+    EXPECT_EQ(1, vm.detachCalls);
+}
+
+TEST(ScopedJniThreadAttach, ReattachesThreadsDetachedByOwner) {
+    FakeVm vm;
+    std::thread thread([&vm]() {
+        JNIEnv* env = nullptr;
+        ASSERT_EQ(JNI_OK, vm.get()->AttachCurrentThread(&env, nullptr));
+        EXPECT_EQ(env, GetJniEnvForCurrentThread(vm.get()));
+        vm.get()->DetachCurrentThread();
+        // Attach-per-event code detached the thread, so it is attached again.
+        ScopedJniThreadAttach attach(vm.get(), "worker");
+        ASSERT_TRUE(attach.isValid());
+        EXPECT_EQ(2, vm.attachCalls);
+        EXPECT_EQ(attach.env(), GetJniEnvForCurrentThread(vm.get()));
+        EXPECT_EQ(2, vm.getEnvCalls);
+    });
+    thread.join();
+    // Detached by its owner, then when the thread exited.
+    EXPECT_EQ(2, vm.detachCalls);
+}
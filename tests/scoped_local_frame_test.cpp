@@ -20,4 +20,13 @@
 
 void TestScopedLocalFrame(JNIEnv* env) {
     ScopedLocalFrame slf(env);
+    ScopedLocalFrame small(env, 4);
+    small.isValid();
+}
+
+void TestScopedBatchedLocalFrame(JNIEnv* env) {
+    ScopedBatchedLocalFrame frame(env, 16, 2);
+    for (int i = 0; frame.isValid() && i < 100; ++i) {
+        frame.next();
+    }
 }
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/scoped_object_array.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/jni_gtest.h>
+#include <nativehelper/toStringArray.h>
+
+#include "libnativehelper_benchmark.h"
+
+namespace android {
+
+class ScopedObjectArrayTest
+    : public JNITestBase<CountingJNIProvider<BenchmarkMockJNIProvider>> {
+protected:
+    void TearDown() override {
+        env_->ExceptionClear();
+        JNITestBase::TearDown();
+    }
+
+    jobjectArray NewStringArray(size_t count) {
+        std::vector<std::string> strings;
+        for (size_t i = 0; i < count; ++i) {
+            strings.push_back("entry_" + std::to_string(i));
+        }
+        return toStringArray(env_, strings);
+    }
+};
+
+TEST_F(ScopedObjectArrayTest, VisitsEveryElement) {
+    jobjectArray array = NewStringArray(3);
+    ScopedObjectArrayRO<jstring> elements(env_, array);
+    ASSERT_TRUE(elements.isValid());
+    EXPECT_EQ(3u, elements.size());
+    EXPECT_EQ(array, elements.get());
+    jsize expected = 0;
+    for (auto it = elements.begin(); it != elements.end(); ++it) {
+        EXPECT_EQ(expected, it.index());
+        EXPECT_EQ(env_->GetObjectArrayElement(array, expected), *it);
+        ++expected;
+    }
+    EXPECT_EQ(3, expected);
+}
+
+TEST_F(ScopedObjectArrayTest, HoldsOneElement) {
+    constexpr size_t kCount = 163;
+    jobjectArray array = NewStringArray(kCount);
+    provider_.ResetCallCounts();
+    {
+        ScopedObjectArrayRO<> elements(env_, array);
+        size_t visited = 0;
+        for (jobject element : elements) {
+            EXPECT_NE(nullptr, element);
+            ++visited;
+        }
+        EXPECT_EQ(kCount, visited);
+    }
+    EXPECT_EQ(1u, provider_.CallCount(JniFunction::GetArrayLength));
+    EXPECT_EQ(kCount, provider_.CallCount(JniFunction::GetObjectArrayElement));
+    // Each element is deleted as the iterator moves on, whatever the length of the array.
+    EXPECT_EQ(kCount, provider_.CallCount(JniFunction::DeleteLocalRef));
+    EXPECT_EQ(0u, provider_.CallCount(JniFunction::PushLocalFrame));
+}
+
+TEST_F(ScopedObjectArrayTest, NullArray) {
+    ScopedObjectArrayRO<> elements(env_, nullptr);
+    EXPECT_FALSE(elements.isValid());
+    EXPECT_TRUE(env_->ExceptionCheck());
+    EXPECT_EQ(0u, elements.size());
+    EXPECT_TRUE(elements.begin() == elements.end());
+}
+
+TEST_F(ScopedObjectArrayTest, UtfChars) {
+    std::vector<std::string> strings;
+    for (ScopedUtfChars chars : ScopedUtfCharsArrayRO(env_, NewStringArray(70))) {
+        ASSERT_NE(nullptr, chars.c_str());
+        strings.emplace_back(chars.c_str(), chars.size());
+    }
+    ASSERT_EQ(70u, strings.size());
+    EXPECT_EQ("entry_0", strings[0]);
+    EXPECT_EQ("entry_69", strings[69]);
+}
+
+TEST_F(ScopedObjectArrayTest, UtfCharsNullElement) {
+    jobjectArray array = NewStringArray(2);
+    env_->SetObjectArrayElement(array, 1, nullptr);
+    ScopedUtfCharsArrayRO elements(env_, array);
+    auto it = elements.begin();
+    EXPECT_NE(nullptr, (*it).c_str());
+    ++it;
+    EXPECT_EQ(1, it.index());
+    EXPECT_EQ(nullptr, (*it).c_str());
+    EXPECT_TRUE(env_->ExceptionCheck());
+}
+
+namespace {
+
+std::vector<jobject> gDeletedRefs;
+
+void RecordDeleteLocalRef(JNIEnv*, jobject ref) {
+    gDeletedRefs.push_back(ref);
+}
+
+bool IsDeleted(jobject ref) {
+    return std::find(gDeletedRefs.begin(), gDeletedRefs.end(), ref) != gDeletedRefs.end();
+}
+
+}  // namespace
+
+class ScopedObjectArrayDeleteTest : public JNITestBase<BenchmarkMockJNIProvider> {
+protected:
+    void SetUp() override {
+        JNITestBase::SetUp();
+        const_cast<JNINativeInterface*>(env_->functions)->DeleteLocalRef = RecordDeleteLocalRef;
+        gDeletedRefs.clear();
+    }
+};
+
+TEST_F(ScopedObjectArrayDeleteTest, TwoLiveRanges) {
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    for (size_t i = 0; i < 100; ++i) {
+        keys.push_back("key_" + std::to_string(i));
+        values.push_back("value_" + std::to_string(i));
+    }
+    jobjectArray keyArray = toStringArray(env_, keys);
+    jobjectArray valueArray = toStringArray(env_, values);
+    gDeletedRefs.clear();
+    ScopedObjectArrayRO<jstring> keyElements(env_, keyArray);
+    ScopedObjectArrayRO<jstring> valueElements(env_, valueArray);
+    auto key = keyElements.begin();
+    auto value = valueElements.begin();
+    for (; key != keyElements.end() && value != valueElements.end(); ++key, ++value) {
+        // Moving one range on never releases the other's element.
+        EXPECT_FALSE(IsDeleted(*key));
+        EXPECT_FALSE(IsDeleted(*value));
+        EXPECT_EQ(env_->GetObjectArrayElement(keyArray, key.index()), *key);
+        EXPECT_EQ(env_->GetObjectArrayElement(valueArray, value.index()), *value);
+    }
+    EXPECT_EQ(100, key.index());
+    EXPECT_EQ(100, value.index());
+    EXPECT_EQ(200u, gDeletedRefs.size());
+}
+
+}  // namespace android
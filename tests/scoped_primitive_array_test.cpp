@@ -31,4 +31,47 @@ void TestCompilationRW(JNIEnv* env, jintArray array) {
     sba.get();
     sba.size();
     sba[3] = 3;
+    sba.commit();
+    sba.commitRange(3, 1);
+    sba.discard();
+}
+
+void TestCompilationROWithCapacity(JNIEnv* env, jlongArray array) {
+    ScopedLongArrayROWithCapacity<4> sla(env, array);
+    sla.reset(nullptr);
+    sla.get();
+    sla.size();
+    ScopedLongArrayROWithCapacity<0> empty(env);
+}
+
+void TestCompilationCriticalRO(JNIEnv* env, jdoubleArray array) {
+    ScopedDoubleArrayCriticalRO sda(env, array);
+    sda.get();
+    sda.size();
+    (void) sda[0];
+}
+
+void TestCompilationRegion(JNIEnv* env, jbyteArray array) {
+    ScopedPrimitiveArrayRegionRO<jbyte> ro(env, array, 16, 32);
+    ro.get();
+    ro.size();
+    ro.offset();
+    ScopedPrimitiveArrayRegionRW<jbyte, 0> rw(env, array, 16, 32);
+    rw[0] = ro[0];
+    rw.commit();
+}
+
+void TestCompilationChunks(JNIEnv* env, jshortArray array) {
+    ScopedPrimitiveArrayChunksRO<jshort> ro(env, array);
+    while (ro.next()) {
+        ro.get();
+        ro.offset();
+    }
+    ScopedPrimitiveArrayChunksRW<jshort, 16> rw(env, array, 8, 64);
+    while (rw.next()) {
+        for (size_t i = 0; i < rw.size(); ++i) {
+            rw[i] = 0;
+        }
+    }
+    rw.flush();
 }
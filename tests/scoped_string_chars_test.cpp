@@ -18,7 +18,16 @@
 
 // This is a test that scoped headers work independently.
 
-void TestCompilationScopedStringChars(JNIEnv* env, string s) {
-    ScopedStringChars ssc(s);
+void TestCompilationScopedStringChars(JNIEnv* env, jstring s) {
+    ScopedStringChars ssc(env, s);
     ssc.get();
 }
+
+void TestCompilationScopedStringCharsRO(JNIEnv* env, jstring s) {
+    ScopedStringCharsRO<> ssc(env, s);
+    ssc.get();
+    ssc.size();
+    ssc.isCritical();
+    ScopedStringCharsRO<0> critical(env, s);
+    critical.get();
+}
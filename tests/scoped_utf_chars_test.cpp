@@ -21,4 +21,17 @@
 void TestCompilationScopedUtfChars(JNIEnv* env, jstring s) {
     ScopedUtfChars suc(env, s);
     suc.c_str();
-}
\ No newline at end of file
+}
+
+void TestCompilationScopedUtfCharsWithBuffer(JNIEnv* env, jstring s) {
+    char buffer[32];
+    ScopedUtfChars suc(env, s, buffer, sizeof(buffer));
+    suc.size();
+    ScopedUtfCharsWithBuffer<> sucb(env, s);
+    sucb.c_str();
+    sucb.size();
+#if __cplusplus >= 201703L
+    suc.view();
+    sucb.view();
+#endif
+}
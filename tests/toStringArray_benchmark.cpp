@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <jni.h>
+
+#include <string>
+#include <vector>
+
+#include "nativehelper/toStringArray.h"
+
+namespace {
+
+// Without a VM the absolute times only reflect the work done on the native side, so each fake
+// JNI function also counts itself. The jni_calls_per_element counter is the number that matters
+// when comparing with a real runtime, where every call is a transition.
+size_t gJniCalls;
+
+int gObject;
+
+jobject FakeObject() {
+    ++gJniCalls;
+    return reinterpret_cast<jobject>(&gObject);
+}
+
+jclass FakeFindClass(JNIEnv*, const char*) {
+    return static_cast<jclass>(FakeObject());
+}
+
+jobject FakeNewGlobalRef(JNIEnv*, jobject obj) {
+    ++gJniCalls;
+    return obj;
+}
+
+void FakeDeleteRef(JNIEnv*, jobject) {
+    ++gJniCalls;
+}
+
+jobjectArray FakeNewObjectArray(JNIEnv*, jsize, jclass, jobject) {
+    return static_cast<jobjectArray>(FakeObject());
+}
+
+jstring FakeNewStringUTF(JNIEnv*, const char* s) {
+    benchmark::DoNotOptimize(strlen(s));
+    return static_cast<jstring>(FakeObject());
+}
+
+jstring FakeNewString(JNIEnv*, const jchar* chars, jsize length) {
+    benchmark::DoNotOptimize(chars);
+    benchmark::DoNotOptimize(length);
+    return static_cast<jstring>(FakeObject());
+}
+
+void FakeSetObjectArrayElement(JNIEnv*, jobjectArray, jsize, jobject) {
+    ++gJniCalls;
+}
+
+jint FakePushLocalFrame(JNIEnv*, jint) {
+    ++gJniCalls;
+    return JNI_OK;
+}
+
+jobject FakePopLocalFrame(JNIEnv*, jobject result) {
+    ++gJniCalls;
+    return result;
+}
+
+jboolean FakeExceptionCheck(JNIEnv*) {
+    ++gJniCalls;
+    return JNI_FALSE;
+}
+
+JNIEnv* GetFakeEnv() {
+    static JNINativeInterface functions = []() {
+        JNINativeInterface f = {};
+        f.FindClass = FakeFindClass;
+        f.NewGlobalRef = FakeNewGlobalRef;
+        f.DeleteGlobalRef = FakeDeleteRef;
+        f.DeleteLocalRef = FakeDeleteRef;
+        f.NewObjectArray = FakeNewObjectArray;
+        f.NewStringUTF = FakeNewStringUTF;
+        f.NewString = FakeNewString;
+        f.SetObjectArrayElement = FakeSetObjectArrayElement;
+        f.PushLocalFrame = FakePushLocalFrame;
+        f.PopLocalFrame = FakePopLocalFrame;
+        f.ExceptionCheck = FakeExceptionCheck;
+        return f;
+    }();
+    static JNIEnv env = { &functions };
+    return &env;
+}
+
+std::vector<std::string> MakeStrings(size_t count) {
+    std::vector<std::string> strings;
+    strings.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        strings.push_back("/data/local/tmp/entry_" + std::to_string(i));
+    }
+    return strings;
+}
+
+void SetPerElementCounters(benchmark::State& state, size_t count) {
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["jni_calls_per_element"] =
+            static_cast<double>(gJniCalls) / (state.iterations() * count);
+}
+
+void BM_toStringArray(benchmark::State& state) {
+    JNIEnv* env = GetFakeEnv();
+    const std::vector<std::string> strings = MakeStrings(state.range(0));
+    gJniCalls = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(toStringArray(env, strings));
+    }
+    SetPerElementCounters(state, strings.size());
+}
+BENCHMARK(BM_toStringArray)->Range(1, 16 << 10);
+
+#if __cplusplus >= 201703L
+void BM_toStringArray_StringView(benchmark::State& state) {
+    JNIEnv* env = GetFakeEnv();
+    const std::vector<std::string> strings = MakeStrings(state.range(0));
+    const std::vector<std::string_view> views(strings.begin(), strings.end());
+    gJniCalls = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(toStringArray(env, views));
+    }
+    SetPerElementCounters(state, views.size());
+}
+BENCHMARK(BM_toStringArray_StringView)->Range(1, 16 << 10);
+#endif
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nativehelper/utf8_to_utf16.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <nativehelper/JNIHelp.h>
+#include <nativehelper/jni_gtest.h>
+
+namespace {
+
+std::u16string Transcode(const std::string& utf8) {
+    std::u16string utf16(utf8.size(), u'\0');
+    size_t count = jniUtf8ToUtf16(utf8.data(), utf8.size(),
+                                  reinterpret_cast<jchar*>(&utf16[0]));
+    utf16.resize(count);
+    return utf16;
+}
+
+}  // namespace
+
+TEST(Utf8ToUtf16, Ascii) {
+    EXPECT_EQ(u"", Transcode(""));
+    EXPECT_EQ(u"a", Transcode("a"));
+    // Longer than the eight byte fast path, with a tail.
+    EXPECT_EQ(u"/data/local/tmp/file.txt", Transcode("/data/local/tmp/file.txt"));
+    EXPECT_EQ(std::u16string(u"a\0b", 3), Transcode(std::string("a\0b", 3)));
+}
+
+TEST(Utf8ToUtf16, MultiByte) {
+    EXPECT_EQ(u"é", Transcode("\xc3\xa9"));
+    EXPECT_EQ(u"€", Transcode("\xe2\x82\xac"));
+    EXPECT_EQ(u"\U0001f600", Transcode("\xf0\x9f\x98\x80"));
+    EXPECT_EQ(u"\U0010ffff", Transcode("\xf4\x8f\xbf\xbf"));
+    EXPECT_EQ(u"01234567é" u"01234567", Transcode("01234567\xc3\xa9" "01234567"));
+}
+
+TEST(Utf8ToUtf16, IllFormed) {
+    // Lone continuation byte and invalid lead bytes.
+    EXPECT_EQ(u"a�b", Transcode("a\x80" "b"));
+    EXPECT_EQ(u"��", Transcode("\xc0\xaf"));
+    EXPECT_EQ(u"�", Transcode("\xff"));
+    // Overlong three byte form.
+    EXPECT_EQ(u"���", Transcode("\xe0\x80\xaf"));
+    // Encoded surrogate.
+    EXPECT_EQ(u"���", Transcode("\xed\xa0\x80"));
+    // Above U+10FFFF.
+    EXPECT_EQ(u"����", Transcode("\xf4\x90\x80\x80"));
+    // Truncated sequences are one U+FFFD each and do not swallow the next character.
+    EXPECT_EQ(u"�", Transcode("\xc3"));
+    EXPECT_EQ(u"�(", Transcode("\xc3("));
+    EXPECT_EQ(u"�", Transcode("\xe2\x82"));
+    EXPECT_EQ(u"�a", Transcode("\xf0\x9f\x98" "a"));
+}
+
+class JniCreateStringUtf8Test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        env_ = provider_.CreateJNIEnv();
+        JNINativeInterface* functions = const_cast<JNINativeInterface*>(env_->functions);
+        functions->NewString = [](JNIEnv*, const jchar* chars, jsize length) -> jstring {
+            gLastString.assign(reinterpret_cast<const char16_t*>(chars), length);
+            return reinterpret_cast<jstring>(&gLastString);
+        };
+    }
+
+    void TearDown() override {
+        provider_.DestroyJNIEnv(env_);
+    }
+
+    static std::u16string gLastString;
+
+    android::MockJNIProvider provider_;
+    JNIEnv* env_;
+};
+
+std::u16string JniCreateStringUtf8Test::gLastString;
+
+TEST_F(JniCreateStringUtf8Test, CallsNewString) {
+    // Not NUL-terminated.
+    const char utf8[] = {'\xc3', '\xa9', 't', '\xc3', '\xa9'};
+    EXPECT_NE(nullptr, jniCreateStringUtf8(env_, utf8, sizeof(utf8)));
+    EXPECT_EQ(u"été", gLastString);
+}
+
+TEST_F(JniCreateStringUtf8Test, LongerThanStackBuffer) {
+    std::string utf8(1000, 'x');
+    utf8 += "\xe2\x82\xac";
+    EXPECT_NE(nullptr, jniCreateStringUtf8(env_, utf8));
+    EXPECT_EQ(std::u16string(1000, u'x') + u"€", gLastString);
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Natives of JniCallingConventionBenchmark. Functions registered under several calling
+// conventions share one implementation, so that the measurements differ only in the cost of the
+// transition.
+//
+// This library is only loaded by the benchmark app, so that a registration failure here cannot
+// prevent the MTS test apps from loading libnativehelper_mts_jni.
+
+#include <iterator>
+
+#include <jni.h>
+
+#include <nativehelper/jni_macros.h>
+#include <nativehelper/scoped_primitive_array.h>
+#include <nativehelper/scoped_utf_chars.h>
+#include <nativehelper/JNIPlatformHelp.h>
+
+namespace {
+
+static jint add(JNIEnv* /*env*/, jclass /*clazz*/, jint a, jint b) {
+    return a + b;
+}
+
+static jint addCritical(jint a, jint b) {
+    return a + b;
+}
+
+static jint nop(JNIEnv* /*env*/, jclass /*clazz*/) {
+    return 0;
+}
+
+static jint nopCritical() {
+    return 0;
+}
+
+static jint sumIntArray(JNIEnv* env, jclass /*clazz*/, jintArray array) {
+    ScopedIntArrayRO ints(env, array);
+    if (ints.get() == nullptr) {
+        return 0;
+    }
+    jint sum = 0;
+    for (size_t i = 0; i < ints.size(); ++i) {
+        sum += ints[i];
+    }
+    return sum;
+}
+
+static jint sumIntArrayPinned(JNIEnv* env, jclass /*clazz*/, jintArray array) {
+    ScopedIntArrayCriticalRO ints(env, array);
+    if (ints.get() == nullptr) {
+        return 0;
+    }
+    jint sum = 0;
+    for (size_t i = 0; i < ints.size(); ++i) {
+        sum += ints[i];
+    }
+    return sum;
+}
+
+static jint utfLength(JNIEnv* env, jclass /*clazz*/, jstring string) {
+    ScopedUtfChars chars(env, string);
+    if (chars.c_str() == nullptr) {
+        return -1;
+    }
+    return static_cast<jint>(chars.size());
+}
+
+static jint utfLengthWithBuffer(JNIEnv* env, jclass /*clazz*/, jstring string) {
+    ScopedUtfCharsWithBuffer<> chars(env, string);
+    if (chars.c_str() == nullptr) {
+        return -1;
+    }
+    return static_cast<jint>(chars.size());
+}
+
+static jlong nioBufferPointer(JNIEnv* env, jclass /*clazz*/, jobject buffer) {
+    return jniGetNioBufferPointer(env, buffer);
+}
+
+static void throwNullPointerException(JNIEnv* env, jclass /*clazz*/) {
+    jniThrowNullPointerException(env, "benchmark");
+}
+
+static void throwExceptionWithIntFormat(JNIEnv* env, jclass /*clazz*/, jint value) {
+    jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException", "benchmark %d", value);
+}
+
+}  // namespace
+
+JNIEXPORT jint JNI_OnLoad(JavaVM* vm, void* /*reserved*/) {
+    JNIEnv* env;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+
+    static const JNINativeMethod methods[] = {
+        MAKE_JNI_NATIVE_METHOD("nop", "()I", nop),
+        MAKE_JNI_FAST_NATIVE_METHOD("nopFast", "()I", nop),
+        MAKE_JNI_CRITICAL_NATIVE_METHOD("nopCritical", "()I", nopCritical),
+        MAKE_JNI_NATIVE_METHOD("add", "(II)I", add),
+        MAKE_JNI_FAST_NATIVE_METHOD("addFast", "(II)I", add),
+        MAKE_JNI_CRITICAL_NATIVE_METHOD("addCritical", "(II)I", addCritical),
+        MAKE_JNI_NATIVE_METHOD("sumIntArray", "([I)I", sumIntArray),
+        MAKE_JNI_FAST_NATIVE_METHOD("sumIntArrayFast", "([I)I", sumIntArray),
+        MAKE_JNI_FAST_NATIVE_METHOD("sumIntArrayPinnedFast", "([I)I", sumIntArrayPinned),
+        MAKE_JNI_NATIVE_METHOD("utfLength", "(Ljava/lang/String;)I", utfLength),
+        MAKE_JNI_FAST_NATIVE_METHOD("utfLengthFast", "(Ljava/lang/String;)I", utfLength),
+        MAKE_JNI_FAST_NATIVE_METHOD("utfLengthWithBufferFast", "(Ljava/lang/String;)I",
+                                    utfLengthWithBuffer),
+        MAKE_JNI_NATIVE_METHOD("nioBufferPointer", "(Ljava/nio/ByteBuffer;)J", nioBufferPointer),
+        MAKE_JNI_FAST_NATIVE_METHOD("nioBufferPointerFast", "(Ljava/nio/ByteBuffer;)J",
+                                    nioBufferPointer),
+        MAKE_JNI_NATIVE_METHOD("throwNullPointerException", "()V", throwNullPointerException),
+        MAKE_JNI_FAST_NATIVE_METHOD("throwNullPointerExceptionFast", "()V",
+                                    throwNullPointerException),
+        MAKE_JNI_NATIVE_METHOD("throwExceptionWithIntFormat", "(I)V",
+                               throwExceptionWithIntFormat),
+    };
+    int rc = jniRegisterNativeMethods(env,
+                                      "com/android/art/libnativehelper/JniCallingConventionBenchmark",
+                                      methods,
+                                      std::size(methods));
+    if (rc != JNI_OK) return rc;
+
+    return JNI_VERSION_1_6;
+}
@@ -15,13 +15,16 @@
  */
 
 #include <iterator>
+#include <vector>
 
 #include <dlfcn.h>
 #include <jni.h>
 
+#include <android/file_descriptor_jni.h>
 #include <android/log.h>
 #include <nativehelper/jni_macros.h>
 #include <nativehelper/scoped_local_ref.h>
+#include <nativehelper/scoped_primitive_array.h>
 #include <nativehelper/scoped_string_chars.h>
 #include <nativehelper/scoped_utf_chars.h>
 #include <nativehelper/JNIPlatformHelp.h>
@@ -83,6 +86,63 @@ static void fileDescriptorSetFD(JNIEnv* env, jclass /*clazz*/, jobject jiofd, ji
     jniSetFileDescriptorOfFD(env, jiofd, unix_fd);
 }
 
+static jint fileDescriptorGetFDUnchecked(JNIEnv* env, jclass /*clazz*/, jobject jiofd) {
+    return AFileDescriptor_getFdUnchecked(env, jiofd);
+}
+
+static void fileDescriptorSetFDUnchecked(JNIEnv* env, jclass /*clazz*/, jobject jiofd,
+                                         jint unix_fd) {
+    AFileDescriptor_setFdUnchecked(env, jiofd, unix_fd);
+}
+
+static jobjectArray fileDescriptorCreateArray(JNIEnv* env, jclass /*clazz*/, jintArray unix_fds) {
+    ScopedIntArrayRO fds(env, unix_fds);
+    if (fds.get() == nullptr) {
+        return nullptr;
+    }
+    return AFileDescriptor_createArray(env, fds.get(), fds.size());
+}
+
+static jintArray fileDescriptorGetFDs(JNIEnv* env, jclass /*clazz*/, jobjectArray jiofds) {
+    jsize count = env->GetArrayLength(jiofds);
+    std::vector<int> fds(count);
+    AFileDescriptor_getFds(env, jiofds, fds.data(), fds.size());
+    jintArray result = env->NewIntArray(count);
+    if (result != nullptr) {
+        env->SetIntArrayRegion(result, 0, count, fds.data());
+    }
+    return result;
+}
+
+static void fileDescriptorSetFDs(JNIEnv* env, jclass /*clazz*/, jobjectArray jiofds,
+                                 jintArray unix_fds) {
+    ScopedIntArrayRO fds(env, unix_fds);
+    if (fds.get() != nullptr) {
+        AFileDescriptor_setFds(env, jiofds, fds.get(), fds.size());
+    }
+}
+
+static jlongArray getNioBufferInfo(JNIEnv* env, jclass /*clazz*/, jobject buffer) {
+    JniNioBufferInfo info;
+    jniGetNioBufferInfo(env, buffer, &info);
+    ScopedLocalRef<jarray> baseArray(env, info.baseArray);
+    const jlong values[] = {
+        info.isDirect,
+        info.address != 0,
+        baseArray.get() != nullptr,
+        info.baseArrayOffset,
+        info.position,
+        info.limit,
+        info.elementSizeShift,
+        info.remainingBytes,
+    };
+    jlongArray result = env->NewLongArray(std::size(values));
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, std::size(values), values);
+    }
+    return result;
+}
+
 static jstring createString(JNIEnv* env, jclass /*clazz*/, jstring value) {
     ScopedStringChars ssc(env, value);
     return jniCreateString(env, ssc.get(), ssc.size());
@@ -127,6 +187,24 @@ JNIEXPORT jint JNI_OnLoad(JavaVM* vm, void* reserved) {
         MAKE_JNI_NATIVE_METHOD("fileDescriptorSetFD",
                                "(Ljava/io/FileDescriptor;I)V",
                                fileDescriptorSetFD),
+        MAKE_JNI_NATIVE_METHOD("fileDescriptorGetFDUnchecked",
+                               "(Ljava/io/FileDescriptor;)I",
+                               fileDescriptorGetFDUnchecked),
+        MAKE_JNI_NATIVE_METHOD("fileDescriptorSetFDUnchecked",
+                               "(Ljava/io/FileDescriptor;I)V",
+                               fileDescriptorSetFDUnchecked),
+        MAKE_JNI_NATIVE_METHOD("fileDescriptorCreateArray",
+                               "([I)[Ljava/io/FileDescriptor;",
+                               fileDescriptorCreateArray),
+        MAKE_JNI_NATIVE_METHOD("fileDescriptorGetFDs",
+                               "([Ljava/lang/Object;)[I",
+                               fileDescriptorGetFDs),
+        MAKE_JNI_NATIVE_METHOD("fileDescriptorSetFDs",
+                               "([Ljava/lang/Object;[I)V",
+                               fileDescriptorSetFDs),
+        MAKE_JNI_NATIVE_METHOD("getNioBufferInfo",
+                               "(Ljava/nio/Buffer;)[J",
+                               getNioBufferInfo),
         MAKE_JNI_NATIVE_METHOD("createString",
                                "(Ljava/lang/String;)Ljava/lang/String;",
                                createString),
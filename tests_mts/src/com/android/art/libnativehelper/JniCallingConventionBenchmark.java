@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.art.libnativehelper;
+
+import android.os.Bundle;
+import android.test.AndroidTestCase;
+import android.util.Log;
+
+import androidx.test.platform.app.InstrumentationRegistry;
+
+import dalvik.annotation.optimization.CriticalNative;
+import dalvik.annotation.optimization.FastNative;
+
+import java.nio.ByteBuffer;
+
+/**
+ * Measures the cost of calling the same natives registered as normal, {@code @FastNative} and
+ * {@code @CriticalNative} methods, and of the libnativehelper helpers natives commonly use.
+ *
+ * <p>Each case is timed over several rounds after a warm-up and the fastest round is reported, in
+ * nanoseconds per call, to logcat under the {@code JniCallingConvention} tag and as
+ * instrumentation status so that results can be collected across devices and ART versions.
+ */
+public class JniCallingConventionBenchmark extends AndroidTestCase {
+    private static final String TAG = "JniCallingConvention";
+
+    private static final int WARMUP_ITERATIONS = 10_000;
+    private static final int ITERATIONS = 100_000;
+    private static final int EXCEPTION_ITERATIONS = 10_000;
+    private static final int ROUNDS = 5;
+
+    static {
+        System.loadLibrary("nativehelper_calling_convention_jni");
+    }
+
+    private static native int nop();
+    @FastNative
+    private static native int nopFast();
+    @CriticalNative
+    private static native int nopCritical();
+
+    private static native int add(int a, int b);
+    @FastNative
+    private static native int addFast(int a, int b);
+    @CriticalNative
+    private static native int addCritical(int a, int b);
+
+    private static native int sumIntArray(int[] array);
+    @FastNative
+    private static native int sumIntArrayFast(int[] array);
+    @FastNative
+    private static native int sumIntArrayPinnedFast(int[] array);
+
+    private static native int utfLength(String string);
+    @FastNative
+    private static native int utfLengthFast(String string);
+    @FastNative
+    private static native int utfLengthWithBufferFast(String string);
+
+    private static native long nioBufferPointer(ByteBuffer buffer);
+    @FastNative
+    private static native long nioBufferPointerFast(ByteBuffer buffer);
+
+    private static native void throwNullPointerException();
+    @FastNative
+    private static native void throwNullPointerExceptionFast();
+    private static native void throwExceptionWithIntFormat(int value);
+
+    /** Runs a case |iterations| times and returns the elapsed time in nanoseconds. */
+    private interface Case {
+        long run(int iterations);
+    }
+
+    // Written by every case so that the calls cannot be optimized out.
+    private static volatile long sSink;
+
+    private final Bundle mResults = new Bundle();
+
+    @Override
+    protected void tearDown() throws Exception {
+        if (!mResults.isEmpty()) {
+            InstrumentationRegistry.getInstrumentation().sendStatus(0, mResults);
+            mResults.clear();
+        }
+        super.tearDown();
+    }
+
+    private void measure(String name, int iterations, Case c) {
+        c.run(WARMUP_ITERATIONS);
+        long best = Long.MAX_VALUE;
+        for (int round = 0; round < ROUNDS; ++round) {
+            best = Math.min(best, c.run(iterations));
+        }
+        double nsPerOp = (double) best / iterations;
+        Log.i(TAG, String.format("%s: %.1f ns/op", name, nsPerOp));
+        mResults.putDouble(name, nsPerOp);
+    }
+
+    public void testNoArguments() {
+        assertEquals(0, nop());
+        assertEquals(0, nopFast());
+        assertEquals(0, nopCritical());
+        measure("nop", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += nop();
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("nopFast", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += nopFast();
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("nopCritical", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += nopCritical();
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+    }
+
+    public void testIntArguments() {
+        assertEquals(3, add(1, 2));
+        assertEquals(3, addFast(1, 2));
+        assertEquals(3, addCritical(1, 2));
+        measure("add", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum = add(sum, i);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("addFast", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum = addFast(sum, i);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("addCritical", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum = addCritical(sum, i);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+    }
+
+    public void testScopedPrimitiveArray() {
+        final int[] array = new int[256];
+        int expected = 0;
+        for (int i = 0; i < array.length; ++i) {
+            array[i] = i;
+            expected += i;
+        }
+        assertEquals(expected, sumIntArray(array));
+        assertEquals(expected, sumIntArrayFast(array));
+        assertEquals(expected, sumIntArrayPinnedFast(array));
+        measure("ScopedIntArrayRO-256", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += sumIntArray(array);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("ScopedIntArrayRO-256-Fast", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += sumIntArrayFast(array);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("ScopedIntArrayCriticalRO-256-Fast", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += sumIntArrayPinnedFast(array);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+    }
+
+    public void testScopedUtfChars() {
+        final String string = "/data/local/tmp/libnativehelper";
+        assertEquals(string.length(), utfLength(string));
+        assertEquals(string.length(), utfLengthFast(string));
+        assertEquals(string.length(), utfLengthWithBufferFast(string));
+        measure("ScopedUtfChars", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += utfLength(string);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("ScopedUtfChars-Fast", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += utfLengthFast(string);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("ScopedUtfCharsWithBuffer-Fast", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += utfLengthWithBufferFast(string);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+    }
+
+    public void testNioBuffer() {
+        final ByteBuffer buffer = ByteBuffer.allocateDirect(4096);
+        assertTrue(nioBufferPointer(buffer) != 0);
+        assertEquals(nioBufferPointer(buffer), nioBufferPointerFast(buffer));
+        measure("jniGetNioBufferPointer", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            long sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += nioBufferPointer(buffer);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+        measure("jniGetNioBufferPointer-Fast", ITERATIONS, n -> {
+            long start = System.nanoTime();
+            long sum = 0;
+            for (int i = 0; i < n; ++i) {
+                sum += nioBufferPointerFast(buffer);
+            }
+            long elapsed = System.nanoTime() - start;
+            sSink = sum;
+            return elapsed;
+        });
+    }
+
+    public void testThrow() {
+        measure("jniThrowNullPointerException", EXCEPTION_ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int caught = 0;
+            for (int i = 0; i < n; ++i) {
+                try {
+                    throwNullPointerException();
+                } catch (NullPointerException e) {
+                    ++caught;
+                }
+            }
+            long elapsed = System.nanoTime() - start;
+            assertEquals(n, caught);
+            return elapsed;
+        });
+        measure("jniThrowNullPointerException-Fast", EXCEPTION_ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int caught = 0;
+            for (int i = 0; i < n; ++i) {
+                try {
+                    throwNullPointerExceptionFast();
+                } catch (NullPointerException e) {
+                    ++caught;
+                }
+            }
+            long elapsed = System.nanoTime() - start;
+            assertEquals(n, caught);
+            return elapsed;
+        });
+        measure("jniThrowExceptionFmt", EXCEPTION_ITERATIONS, n -> {
+            long start = System.nanoTime();
+            int caught = 0;
+            for (int i = 0; i < n; ++i) {
+                try {
+                    throwExceptionWithIntFormat(i);
+                } catch (IllegalArgumentException e) {
+                    ++caught;
+                }
+            }
+            long elapsed = System.nanoTime() - start;
+            assertEquals(n, caught);
+            return elapsed;
+        });
+    }
+}
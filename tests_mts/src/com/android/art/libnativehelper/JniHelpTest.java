@@ -47,6 +47,13 @@ public class JniHelpTest extends AndroidTestCase {
     private static native FileDescriptor fileDescriptorCreate(int unixFd);
     private static native int fileDescriptorGetFD(FileDescriptor jiofd);
     private static native void fileDescriptorSetFD(FileDescriptor jiofd, int unixFd);
+    private static native int fileDescriptorGetFDUnchecked(FileDescriptor jiofd);
+    private static native void fileDescriptorSetFDUnchecked(FileDescriptor jiofd, int unixFd);
+    private static native FileDescriptor[] fileDescriptorCreateArray(int[] unixFds);
+    private static native int[] fileDescriptorGetFDs(Object[] jiofds);
+    private static native void fileDescriptorSetFDs(Object[] jiofds, int[] unixFds);
+
+    private static native long[] getNioBufferInfo(Buffer buffer);
 
     private static native String createString(String input);
 
@@ -169,6 +176,48 @@ public class JniHelpTest extends AndroidTestCase {
         assertEquals(UNIX_FD, fileDescriptorGetFD(jiofd));
     }
 
+    public void testFileDescriptorUnchecked() {
+        final int UNIX_FD = 63;
+        FileDescriptor jiofd = fileDescriptorCreate(0);
+        fileDescriptorSetFDUnchecked(jiofd, UNIX_FD);
+        assertEquals(UNIX_FD, fileDescriptorGetFDUnchecked(jiofd));
+        assertEquals(UNIX_FD, fileDescriptorGetFD(jiofd));
+    }
+
+    public void testFileDescriptorBulk() {
+        final int[] UNIX_FDS = { -1, 0, 7, 1000 };
+        FileDescriptor[] jiofds = fileDescriptorCreateArray(UNIX_FDS);
+        assertEquals(UNIX_FDS.length, jiofds.length);
+        for (int i = 0; i < UNIX_FDS.length; ++i) {
+            assertEquals(UNIX_FDS[i], fileDescriptorGetFD(jiofds[i]));
+        }
+        Assert.assertArrayEquals(UNIX_FDS, fileDescriptorGetFDs(jiofds));
+
+        final int[] NEW_UNIX_FDS = { 3, 4, 5, 6 };
+        fileDescriptorSetFDs(jiofds, NEW_UNIX_FDS);
+        Assert.assertArrayEquals(NEW_UNIX_FDS, fileDescriptorGetFDs(jiofds));
+    }
+
+    public void testFileDescriptorBulkGetWithNullAndObjectArray() {
+        Object[] jiofds = { fileDescriptorCreate(9), null };
+        Assert.assertArrayEquals(new int[] { 9, -1 }, fileDescriptorGetFDs(jiofds));
+    }
+
+    public void testGetNioBufferInfoDirect() {
+        IntBuffer buffer = ByteBuffer.allocateDirect(64).asIntBuffer();
+        buffer.position(3).limit(10);
+        // { isDirect, hasAddress, hasBaseArray, baseArrayOffset, position, limit, shift, remaining }
+        Assert.assertArrayEquals(new long[] { 1, 1, 0, 0, 3, 10, 2, 28 },
+                                 getNioBufferInfo(buffer));
+    }
+
+    public void testGetNioBufferInfoHeap() {
+        ShortBuffer buffer = ShortBuffer.allocate(16);
+        buffer.position(4);
+        Assert.assertArrayEquals(new long[] { 0, 0, 1, 8, 4, 16, 1, 24 },
+                                 getNioBufferInfo(buffer));
+    }
+
     public void testCreateString() {
         String input = "The treacherous mountain path lay ahead.";
         String output = createString(input);